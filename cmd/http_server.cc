@@ -1,5 +1,5 @@
 #include "reyao/http/http_server.h"
-#include "reyao/util.h"
+#include "reyao/http/http_static_servlet.h"
 
 #include <iostream>
 
@@ -8,7 +8,7 @@ using namespace reyao;
 int main(int argc, char** argv) {
     g_logger->setLevel(LogLevel::WARN);
      if (argc < 3) {
-         std::cerr << "usage: ./http_server thread_name port\n";
+         std::cerr << "usage: ./http_server thread_name port [docroot]\n";
          exit(0);
      }
     int num = atoi(argv[1]);
@@ -18,22 +18,18 @@ int main(int argc, char** argv) {
     auto addr = IPv4Address::CreateAddress("0.0.0.0", port);
     HttpServer server(&sh, addr, true);
     auto dispatch = server.getDispatch();
-    dispatch->addServlet("/", [](const HttpRequest& req,
-			    	 HttpResponse* rsp,
-				 const HttpSession& session) {
-	    rsp->addHeader("Server", "Reyao");
-	    rsp->addHeader("Content-Type", "text/html");
-        rsp->setBody(reyao::ReadFile("/home/crash/server-cfg/readme.html"));
-		return 0;
-    });
-    dispatch->addGlobalServlet("/", [](const HttpRequest& req,
-			    	 HttpResponse* rsp,
-				 const HttpSession& session) {
-	    rsp->addHeader("Server", "Reyao");
-	    rsp->addHeader("Content-Type", "text/html");
-        rsp->setBody(reyao::ReadFile("/home/crash/server-cfg/readme.html"));
-		return 0;
-    });
+    // 静态文件由 StaticFileServlet 发送。默认只有 "/" 返回配置目录下的 readme.html，
+    // 配置目录里的其他文件不对外；指定 docroot 时才发送整个目录
+    StaticFileServlet::Options options;
+    options.indexFile = "readme.html";
+    options.maxMemoryFileSize = 64 * 1024;
+    if (argc > 3) {
+        dispatch->addGlobalServlet("/*", std::make_shared<StaticFileServlet>(
+                                   argv[3], options));
+    } else {
+        dispatch->addServlet("/", std::make_shared<StaticFileServlet>(
+                             "/home/crash/server-cfg", options));
+    }
 
     server.start();
     sh.wait();
@@ -6,8 +6,20 @@
 #include <ifaddrs.h>
 #include <stddef.h>
 
+#include <algorithm>
+
 namespace reyao {
 
+Address::SPtr Address::Create(int family) {
+    switch (family) {
+        case AF_INET:
+            return std::make_shared<IPv4Address>();
+        case AF_UNIX:
+            return std::make_shared<UnixAddress>();
+        default:
+            return nullptr;
+    }
+}
 
 IPv4Address::IPv4Address() {
     memset(&addr_, 0, sizeof(addr_));
@@ -92,5 +104,73 @@ IPv4Address::SPtr IPv4Address::CreateAddress(const char* addr, uint16_t port) {
     return ret;
 }
 
+static const socklen_t kUnixPathOffset = offsetof(sockaddr_un, sun_path);
+
+UnixAddress::UnixAddress() {
+    memset(&addr_, 0, sizeof(addr_));
+    addr_.sun_family = AF_UNIX;
+    length_ = sizeof(addr_);
+}
+
+UnixAddress::UnixAddress(const std::string& path) {
+    memset(&addr_, 0, sizeof(addr_));
+    addr_.sun_family = AF_UNIX;
+    bool abstract = !path.empty() && path[0] == '@';
+    // 普通路径要留出结尾的 '\0'，抽象名字的 '@' 占 sun_path[0]
+    size_t maxLen = abstract ? sizeof(addr_.sun_path) : sizeof(addr_.sun_path) - 1;
+    if (path.size() > maxLen) {
+        LOG_ERROR << "unix socket path too long: " << path
+                  << " (" << path.size() << " > " << maxLen << ")";
+        // 长度为 0 的地址 bind/connect 都会返回 EINVAL，不会被截断成另一个路径
+        length_ = 0;
+        return;
+    }
+    size_t len = path.size();
+    memcpy(addr_.sun_path, path.data(), len);
+    if (abstract) {
+        // 抽象命名空间：sun_path[0] 为 '\0'，长度不包含结尾的 '\0'
+        addr_.sun_path[0] = '\0';
+        length_ = kUnixPathOffset + len;
+    } else {
+        length_ = kUnixPathOffset + len + 1;
+    }
+}
+
+bool UnixAddress::isAbstract() const {
+    return length_ > kUnixPathOffset && addr_.sun_path[0] == '\0';
+}
+
+std::string UnixAddress::getPath() const {
+    if (length_ <= kUnixPathOffset) {
+        return "";
+    }
+    if (isAbstract()) {
+        return "@" + std::string(addr_.sun_path + 1,
+                                 length_ - kUnixPathOffset - 1);
+    }
+    return std::string(addr_.sun_path);
+}
+
+const sockaddr* UnixAddress::getAddr() const {
+    return (sockaddr*)&addr_;
+}
+
+sockaddr* UnixAddress::getAddr() {
+    return (sockaddr*)&addr_;
+}
+
+socklen_t UnixAddress::getAddrLen() const {
+    return length_;
+}
+
+std::string UnixAddress::toString() const {
+    std::string path = getPath();
+    return "unix:" + (path.empty() ? std::string("(unnamed)") : path);
+}
+
+UnixAddress::SPtr UnixAddress::CreateAddress(const std::string& path) {
+    auto addr = std::make_shared<UnixAddress>(path);
+    return addr->isValid() ? addr : nullptr;
+}
 
 } //namepsace reyao
\ No newline at end of file
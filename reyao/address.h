@@ -2,6 +2,7 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
@@ -14,7 +15,25 @@
 
 namespace reyao {
 
-class IPv4Address {
+// 地址基类，Socket/TcpServer/TcpClient 只依赖这个接口，不关心具体协议族
+class Address {
+public:
+    typedef std::shared_ptr<Address> SPtr;
+    virtual ~Address() {}
+
+    int getFamily() const { return getAddr()->sa_family; }
+    virtual const sockaddr* getAddr() const = 0;
+    virtual sockaddr* getAddr() = 0;
+    virtual socklen_t getAddrLen() const = 0;
+    // getsockname/getpeername/recvfrom 等填充地址后回写实际长度，定长地址忽略
+    virtual void setAddrLen(socklen_t len) {}
+    virtual std::string toString() const = 0;
+
+    // 按协议族创建一个空地址，用于接收 getsockname/recvfrom 的结果
+    static Address::SPtr Create(int family);
+};
+
+class IPv4Address : public Address {
 public:
     typedef std::shared_ptr<IPv4Address> SPtr;
     IPv4Address();
@@ -23,10 +42,10 @@ public:
 
     uint16_t getPort() const;
     void setPort(uint16_t port);
-    const sockaddr* getAddr() const;
-    sockaddr* getAddr();
-    socklen_t getAddrLen() const;
-    std::string toString() const;
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    std::string toString() const override;
 
     // FIXME: gethostbyname will block the thread!
     static sockaddr_in GetHostByName(const char* hostname, uint16_t port = 0);
@@ -39,5 +58,30 @@ private:
     sockaddr_in addr_;
 };
 
+// AF_UNIX 地址，path 以 '@' 开头时表示 Linux 抽象命名空间（不在文件系统中创建文件）
+class UnixAddress : public Address {
+public:
+    typedef std::shared_ptr<UnixAddress> SPtr;
+    UnixAddress();
+    // 路径超过 sun_path 的长度时不截断，记录错误并得到无效地址
+    explicit UnixAddress(const std::string& path);
+
+    bool isValid() const { return length_ > 0; }
+    bool isAbstract() const;
+    std::string getPath() const;
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    void setAddrLen(socklen_t len) override { length_ = len; }
+    std::string toString() const override;
+
+    // 路径过长时返回 nullptr
+    static UnixAddress::SPtr CreateAddress(const std::string& path);
+
+private:
+    sockaddr_un addr_;
+    socklen_t length_;
+};
+
 
 } //namespace reyao
\ No newline at end of file
@@ -175,7 +175,8 @@ void AsyncLog::start()
 void AsyncLog::stop() {
     exit_ = true;
     cond_.notify();
-    thread_.detach();
+    // 等后台线程写完最后一批日志再返回，否则进程退出析构缓冲区时后台线程可能仍在使用
+    thread_.join();
 }
 
 } // namespace reyao
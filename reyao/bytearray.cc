@@ -3,8 +3,12 @@
 
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
@@ -180,30 +184,44 @@ double ByteArray::readDouble() {
 }
 
 std::string ByteArray::readString16() {
-    uint16_t len = readUint16();
-    std::string buf;
-    buf.resize(len);
-    read(&buf[0], len);
-    return buf;
+    return readStringView16().toString();
 }
 
 std::string ByteArray::readString32() {
-    uint32_t len = readUint32();
-    std::string buf;
-    buf.resize(len);
-    read(&buf[0], len);
-    return buf;
+    return readStringView32().toString();
 }
 
 std::string ByteArray::readString64() {
+    return readStringView64().toString();
+}
+
+StringPiece ByteArray::readStringView16() {
+    uint16_t len = readUint16();
+    return readView(len);
+}
+
+StringPiece ByteArray::readStringView32() {
+    uint32_t len = readUint32();
+    return readView(len);
+}
+
+StringPiece ByteArray::readStringView64() {
     uint64_t len = readUint64();
-    std::string buf;
-    buf.resize(len);
-    read(&buf[0], len);
-    return buf;
+    return readView(len);
+}
+
+StringPiece ByteArray::readView(size_t size) {
+    if (size > getReadSize()) {
+        throw std::out_of_range("have no enough data to read");
+    }
+    StringPiece view(peek(), size);
+    readPos_ += size;
+    return view;
 }
 
 void ByteArray::reset() {
+    mapped_.reset();
+    mappedLen_ = 0;
     readPos_ = 0;
     writePos_ = 0;
     buf_.resize(kInitSize);
@@ -225,7 +243,7 @@ void ByteArray::read(void* buf, size_t size) {
         throw std::out_of_range("have no enough data to read");
     }
 
-    memcpy(buf, &buf_[readPos_], size);
+    memcpy(buf, peek(), size);
     readPos_ += size;
 }
 
@@ -237,49 +255,176 @@ char* ByteArray::getWriteArea(size_t len) {
 const char* ByteArray::getReadArea(size_t* len) const {
     *len = *len > getReadSize() ? getReadSize() : *len;
 
-    return &buf_[readPos_];
+    return peek();
+}
+
+// O_DIRECT 要求缓冲区地址、写入长度和文件偏移都按块对齐
+static const size_t kDirectAlign = 4096;
+static const size_t kDirectChunk = 1024 * 1024;
+
+static bool WriteAll(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
 }
 
-bool ByteArray::writeToFile(const std::string& name) const {
-    std::ofstream ofs;
-    ofs.open(name, std::ios::binary | std::ios::trunc);
-    if (!ofs) {
+static bool WriteDirect(int fd, const char* buf, size_t len) {
+    void* staging = nullptr;
+    if (posix_memalign(&staging, kDirectAlign, kDirectChunk) != 0) {
+        return false;
+    }
+    std::unique_ptr<char, void(*)(void*)> guard((char*)staging, free);
+    size_t total = len;
+    bool ok = true;
+    while (ok && len > 0) {
+        size_t n = std::min(len, kDirectChunk);
+        memcpy(staging, buf, n);
+        // 最后一块补齐到块大小，写完后再 ftruncate 回真实长度
+        size_t padded = (n + kDirectAlign - 1) / kDirectAlign * kDirectAlign;
+        memset((char*)staging + n, 0, padded - n);
+        ok = WriteAll(fd, (const char*)staging, padded);
+        buf += n;
+        len -= n;
+    }
+    return ok && ftruncate(fd, total) == 0;
+}
+
+bool ByteArray::writeToFile(const std::string& name, bool direct) const {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = -1;
+    if (direct) {
+        fd = ::open(name.c_str(), flags | O_DIRECT, 0644);
+        if (fd == -1 && errno == EINVAL) {
+            // tmpfs 等文件系统不支持 O_DIRECT
+            direct = false;
+        }
+    }
+    if (fd == -1) {
+        fd = ::open(name.c_str(), flags, 0644);
+    }
+    if (fd == -1) {
         LOG_DEBUG << "ByteArray::writeToFile(" << name << ")"
                   << " errro=" << strerror(errno);
         return false;
     }
-    ofs.write(&buf_[readPos_], getReadSize());
-    return true;
+    bool ok = direct ? WriteDirect(fd, peek(), getReadSize())
+                     : WriteAll(fd, peek(), getReadSize());
+    if (!ok && direct && errno == EINVAL) {
+        // 有的文件系统 open 时接受 O_DIRECT，写入时才返回 EINVAL，重新打开后普通写入
+        ::close(fd);
+        fd = ::open(name.c_str(), flags, 0644);
+        ok = fd != -1 && WriteAll(fd, peek(), getReadSize());
+    }
+    if (!ok) {
+        LOG_DEBUG << "ByteArray::writeToFile(" << name << ")"
+                  << " errro=" << strerror(errno);
+    }
+    if (fd != -1) {
+        ::close(fd);
+    }
+    return ok;
 }
 
 bool ByteArray::readFromFile(const std::string& name) {
-    std::ifstream ifs;
-    ifs.open(name, std::ios::binary);
-    if (!ifs) {
+    int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         LOG_DEBUG << "ByteArray::readFromFile(" << name << ")"
                   << " errro=" << strerror(errno);
         return false;       
     }
-    std::shared_ptr<char> buf(new char[kInitSize], [](char* ptr) { delete []ptr; });
-    while (!ifs.eof()) {
-        ifs.read(buf.get(), kInitSize);
-        write(buf.get(), ifs.gcount());
+    // 按文件大小一次性预留空间，再直接读进缓冲区；大小未知（如 /proc）时按块读到 EOF
+    struct stat st;
+    size_t remain = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        remain = st.st_size;
     }
+    while (true) {
+        size_t chunk = remain ? remain : kInitSize;
+        char* buf = getWriteArea(chunk);
+        ssize_t n = ::read(fd, buf, chunk);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        writePos_ += n;
+        if (remain) {
+            remain -= n;
+            if (remain == 0) {
+                break;
+            }
+        }
+    }
+    ::close(fd);
     return true;
 }
 
-std::string ByteArray::toString() {
-    std::string buf;
-    buf.resize(getReadSize());
-    if (buf.empty()) {
-        return buf;
+bool ByteArray::mapFile(const std::string& name) {
+    int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        LOG_DEBUG << "ByteArray::mapFile(" << name << ")"
+                  << " errro=" << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        ::close(fd);
+        return false;
     }
-    read(&buf[0], buf.size());
-    return buf;
+    size_t len = st.st_size;
+    if (len == 0) {
+        // 空文件无法 mmap
+        ::close(fd);
+        reset();
+        return true;
+    }
+    void* addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_DEBUG << "ByteArray::mapFile(" << name << ")"
+                  << " mmap errro=" << strerror(errno);
+        return false;
+    }
+    madvise(addr, len, MADV_SEQUENTIAL);
+    mapped_.reset((const char*)addr, [len](const char* p) {
+        munmap((void*)p, len);
+    });
+    mappedLen_ = len;
+    readPos_ = 0;
+    writePos_ = len;
+    return true;
+}
+
+void ByteArray::unmap() {
+    if (!mapped_) {
+        return;
+    }
+    size_t readSize = getReadSize();
+    std::vector<char> buf(kCheapPrepend + std::max(readSize, kInitSize));
+    memcpy(&buf[kCheapPrepend], peek(), readSize);
+    buf_.swap(buf);
+    mapped_.reset();
+    mappedLen_ = 0;
+    readPos_ = kCheapPrepend;
+    writePos_ = readPos_ + readSize;
+}
+
+std::string ByteArray::toString() {
+    return readView(getReadSize()).toString();
 }
 
 std::string ByteArray::toHexString() {
-    std::string buf = toString();
+    StringPiece buf = readView(getReadSize());
     std::stringstream ss;
     for (size_t i = 0; i < buf.size(); i++) {
         if (i > 0 && i % 32 == 0) {
@@ -292,13 +437,16 @@ std::string ByteArray::toHexString() {
 }
 
 const char* ByteArray::findCRLF() const {
-    const char* crlf = std::search(&buf_[readPos_], 
-                                   &buf_[writePos_],
-                                   kCRLF, kCRLF + 2);
-    return crlf == &buf_[writePos_] ? nullptr : crlf;
+    const char* end = data() + writePos_;
+    const char* crlf = std::search(peek(), end, kCRLF, kCRLF + 2);
+    return crlf == end ? nullptr : crlf;
 }
 
-void ByteArray::addCapacity(int size) {
+void ByteArray::addCapacity(size_t size) {
+    unmap();
+    if (getWriteSize() >= size) {
+        return;
+    }
     if (getWriteSize() + getReadPos() < size + kCheapPrepend) {
         buf_.resize(writePos_ + size);
     } else {
@@ -313,6 +461,7 @@ void ByteArray::addCapacity(int size) {
 }
 
 void ByteArray::writePrepend(const void* data, size_t len) {
+    unmap();
     assert(len <= getReadPos());
     readPos_ -= len;
     const char* buf = static_cast<const char*>(data);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "reyao/endian.h"
+#include "reyao/stringpiece.h"
 
 #include <sys/uio.h>
 
@@ -51,6 +52,16 @@ public:
     std::string readString32();
     std::string readString64();
 
+    // 视图读取：返回指向内部缓冲区的 StringPiece，读位置照常前移但不拷贝数据
+    // 生命周期约定：视图只在下一次修改 ByteArray 之前有效，
+    // 任何 write*/getWriteArea/writePrepend/reset/readFromFile 都可能移动或释放底层内存，
+    // 需要长期保存的字段应调用 StringPiece::toString() 拷贝出来
+    StringPiece readStringView16();
+    StringPiece readStringView32();
+    StringPiece readStringView64();
+    StringPiece readView(size_t size);
+    // 当前所有可读数据的视图，不移动读位置
+    StringPiece peekView() const { return StringPiece(peek(), getReadSize()); }
 
     char* getWriteArea(size_t len);
     const char* getReadArea(size_t* len) const;
@@ -58,8 +69,14 @@ public:
     void reset();
     void write(const void* buf, size_t size);
     void read(void* buf, size_t size);
-    bool writeToFile(const std::string& name) const;
+    // direct 为 true 时以 O_DIRECT 打开文件，经对齐的暂存缓冲区分块写入，绕过 page cache；
+    // 文件系统不支持 O_DIRECT 时退化为普通的 write
+    bool writeToFile(const std::string& name, bool direct = false) const;
     bool readFromFile(const std::string& name);
+    // 以只读方式 mmap 整个文件，ByteArray 进入映射模式，读操作直接在映射内存上进行，不拷贝
+    // 映射模式下的任何写操作都会先把剩余可读数据拷贝回内部缓冲区并解除映射（写时复制）
+    bool mapFile(const std::string& name);
+    bool isMapped() const { return mapped_ != nullptr; }
     std::string toString();
     std::string toHexString();
 
@@ -68,25 +85,31 @@ public:
     void setReadPos(size_t pos) { readPos_ = pos; }
     size_t getReadPos() const { return readPos_; }
 
-    const char* peek() const { return &buf_[0] + readPos_; }
+    const char* peek() const { return data() + readPos_; }
     const char* findCRLF() const;
 
     int getEndian() const { return endian_; }
     void setEndian(int endian) { endian_ = endian; }
 
     size_t getReadSize() const { return writePos_ - readPos_; }
-    size_t getWriteSize() const { return buf_.size() - writePos_; }
-    size_t getCapacity() const { return buf_.size(); }
+    size_t getWriteSize() const { return getCapacity() - writePos_; }
+    size_t getCapacity() const { return mapped_ ? mappedLen_ : buf_.size(); }
 
     void writePrepend(const void* data, size_t len);
 
 private:
-    void addCapacity(int size);
+    void addCapacity(size_t size);
+    const char* data() const { return mapped_ ? mapped_.get() : &buf_[0]; }
+    // 解除映射模式，把剩余可读数据拷回 buf_
+    void unmap();
 
     int endian_ = BIG_ENDIAN;
     size_t writePos_;
     size_t readPos_;
     std::vector<char> buf_;
+    // 映射模式下的只读文件映射，拷贝 ByteArray 时共享同一映射
+    std::shared_ptr<const char> mapped_;
+    size_t mappedLen_ = 0;
 };
 
 } // namespace reyao
@@ -0,0 +1,214 @@
+#include "reyao/connection_pool.h"
+#include "reyao/hook.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <errno.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace reyao {
+
+ConnectionPool::ConnectionPool(Scheduler* sche)
+    : ConnectionPool(sche, Options()) {
+}
+
+ConnectionPool::ConnectionPool(Scheduler* sche, const Options& options)
+    : sche_(sche),
+      options_(options) {
+    if (options_.evictInterval > 0) {
+        evictTimer_ = sche_->addTimer(options_.evictInterval,
+                                      std::bind(&ConnectionPool::evict, this),
+                                      true);
+    }
+}
+
+ConnectionPool::~ConnectionPool() {
+    stop();
+}
+
+void ConnectionPool::stop() {
+    if (evictTimer_) {
+        evictTimer_->cancel();
+        evictTimer_.reset();
+    }
+    MutexGuard lock(mutex_);
+    for (auto& it : entries_) {
+        for (auto& idle : it.second.idle) {
+            idle.conn->close();
+        }
+    }
+    entries_.clear();
+}
+
+Socket::SPtr ConnectionPool::borrow(Address::SPtr addr) {
+    const std::string key = addr->toString();
+    while (true) {
+        IdleConn idle;
+        {
+            MutexGuard lock(mutex_);
+            Entry& entry = entries_[key];
+            if (!entry.addr) {
+                entry.addr = addr;
+            }
+            if (entry.idle.empty()) {
+                if (entry.retryAt > GetCurrentMs()) {
+                    ++backoffRejected_;
+                    errno = ECONNREFUSED;
+                    return nullptr;
+                }
+                break;
+            }
+            // 后进先出，最近用过的连接最可能还是好的
+            idle = entry.idle.back();
+            entry.idle.pop_back();
+        }
+        if (isExpired(idle.created, GetCurrentMs()) || !IsHealthy(idle.conn)) {
+            closeConn(idle.conn);
+            continue;
+        }
+        ++reusedCount_;
+        return idle.conn;
+    }
+    return connect(addr);
+}
+
+void ConnectionPool::giveBack(Address::SPtr addr, Socket::SPtr conn, bool reusable) {
+    if (!conn) {
+        return;
+    }
+    if (!reusable || !conn->isConnected()) {
+        closeConn(conn);
+        return;
+    }
+    int64_t now = GetCurrentMs();
+    // 生命周期从 connect 成功开始算，不是 connect 建立的连接从归还时开始算
+    int64_t created = conn->getConnectTime() ? conn->getConnectTime() : now;
+    bool keep = false;
+    {
+        MutexGuard lock(mutex_);
+        Entry& entry = entries_[addr->toString()];
+        if (!entry.addr) {
+            entry.addr = addr;
+        }
+        if (!isExpired(created, now) &&
+            (options_.maxIdle == 0 || entry.idle.size() < options_.maxIdle)) {
+            IdleConn idle;
+            idle.conn = conn;
+            idle.created = created;
+            idle.lastUsed = now;
+            entry.idle.push_back(idle);
+            keep = true;
+        }
+    }
+    if (!keep) {
+        closeConn(conn);
+    }
+}
+
+ConnectionPool::Stats ConnectionPool::getStats() {
+    Stats stats;
+    stats.created = createdCount_;
+    stats.reused = reusedCount_;
+    stats.closed = closedCount_;
+    stats.connectFailed = connectFailed_;
+    stats.backoffRejected = backoffRejected_;
+    MutexGuard lock(mutex_);
+    for (auto& it : entries_) {
+        stats.idle += it.second.idle.size();
+    }
+    return stats;
+}
+
+Socket::SPtr ConnectionPool::connect(Address::SPtr addr) {
+    Socket::SPtr conn = Socket::CreateStream(*addr);
+    conn->newSock();
+    conn->applyProfile(options_.profile, Socket::CONNECT_STAGE);
+    bool ok = conn->connect(*addr, options_.connectTimeout);
+    int64_t now = GetCurrentMs();
+
+    MutexGuard lock(mutex_);
+    Entry& entry = entries_[addr->toString()];
+    if (!ok) {
+        ++connectFailed_;
+        entry.backoff = entry.backoff ?
+                        std::min(entry.backoff * 2, options_.maxBackoff) :
+                        options_.minBackoff;
+        entry.retryAt = now + entry.backoff;
+        LOG_WARN << "connect " << addr->toString() << " fail, error="
+                 << strerror(errno) << " retry after " << entry.backoff << "ms";
+        return nullptr;
+    }
+    ++createdCount_;
+    entry.backoff = 0;
+    entry.retryAt = 0;
+    return conn;
+}
+
+bool ConnectionPool::IsHealthy(const Socket::SPtr& conn) {
+    if (!conn->isConnected()) {
+        return false;
+    }
+    // 直接调用原始 recv，避免被 hook 成等待可读
+    char c;
+    ssize_t n = recv_origin(conn->getSockfd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+bool ConnectionPool::isExpired(int64_t created, int64_t now) const {
+    return options_.maxLifetime > 0 && now - created >= options_.maxLifetime;
+}
+
+void ConnectionPool::closeConn(const Socket::SPtr& conn) {
+    ++closedCount_;
+    conn->close();
+}
+
+void ConnectionPool::evict() {
+    int64_t now = GetCurrentMs();
+    std::vector<Socket::SPtr> expired;
+    std::vector<Address::SPtr> refill;
+    {
+        MutexGuard lock(mutex_);
+        for (auto& it : entries_) {
+            Entry& entry = it.second;
+            // 队头是最久没用过的连接
+            auto idle = entry.idle.begin();
+            while (idle != entry.idle.end()) {
+                bool timeout = options_.idleTimeout > 0 &&
+                               now - idle->lastUsed >= options_.idleTimeout &&
+                               entry.idle.size() > options_.minIdle;
+                if (timeout || isExpired(idle->created, now)) {
+                    expired.push_back(idle->conn);
+                    idle = entry.idle.erase(idle);
+                } else {
+                    ++idle;
+                }
+            }
+            if (entry.idle.size() < options_.minIdle && entry.retryAt <= now) {
+                refill.insert(refill.end(),
+                              options_.minIdle - entry.idle.size(),
+                              entry.addr);
+            }
+        }
+    }
+    for (auto& conn : expired) {
+        closeConn(conn);
+    }
+    // 定时器回调运行在 worker 协程中，可以直接 connect
+    Address::SPtr failed;
+    for (auto& addr : refill) {
+        if (addr == failed) {
+            continue;
+        }
+        Socket::SPtr conn = connect(addr);
+        if (!conn) {
+            failed = addr;
+            continue;
+        }
+        giveBack(addr, conn);
+    }
+}
+
+} // namespace reyao
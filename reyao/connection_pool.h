@@ -0,0 +1,94 @@
+#pragma once
+
+#include "reyao/socket.h"
+#include "reyao/address.h"
+#include "reyao/scheduler.h"
+#include "reyao/mutex.h"
+#include "reyao/timer.h"
+#include "reyao/nocopyable.h"
+
+#include <memory>
+#include <string>
+#include <list>
+#include <map>
+#include <atomic>
+
+namespace reyao {
+
+// 按地址缓存空闲的流式连接，供 RpcClient/HttpClient 借出和归还
+// borrow 会在当前协程中 connect，必须在 worker 线程中调用
+class ConnectionPool : public NoCopyable {
+public:
+    typedef std::shared_ptr<ConnectionPool> SPtr;
+
+    // 时间单位均为毫秒，0 表示不限制
+    struct Options {
+        size_t minIdle = 0;             // 每个地址保持的最少空闲连接，由定时器补足
+        size_t maxIdle = 8;             // 每个地址最多缓存的空闲连接
+        int64_t maxLifetime = 0;        // 连接建立后的最长使用时间
+        int64_t idleTimeout = 60 * 1000;
+        int64_t evictInterval = 5 * 1000;
+        int64_t connectTimeout = 10 * 1000;
+        int64_t minBackoff = 100;       // 连接失败后的重连退避，指数增长
+        int64_t maxBackoff = 10 * 1000;
+        SocketProfile profile;
+    };
+
+    struct Stats {
+        uint64_t created = 0;
+        uint64_t reused = 0;
+        uint64_t closed = 0;
+        uint64_t connectFailed = 0;
+        uint64_t backoffRejected = 0;
+        size_t idle = 0;
+    };
+
+    explicit ConnectionPool(Scheduler* sche);
+    ConnectionPool(Scheduler* sche, const Options& options);
+    ~ConnectionPool();
+
+    // 优先复用空闲连接，没有时新建；处于退避期或连接失败时返回 nullptr
+    Socket::SPtr borrow(Address::SPtr addr);
+    // reusable 为 false（读写出错、对端要求关闭）时直接关闭连接
+    void giveBack(Address::SPtr addr, Socket::SPtr conn, bool reusable = true);
+    // 停止回收定时器并关闭所有空闲连接，定时器未停止时 Scheduler 不会退出
+    void stop();
+
+    const Options& getOptions() const { return options_; }
+    Stats getStats();
+
+private:
+    struct IdleConn {
+        Socket::SPtr conn;
+        int64_t created;
+        int64_t lastUsed;
+    };
+
+    struct Entry {
+        Address::SPtr addr;
+        std::list<IdleConn> idle;
+        int64_t backoff = 0;
+        int64_t retryAt = 0;
+    };
+
+    Socket::SPtr connect(Address::SPtr addr);
+    // 空闲连接是否还能用：对端已关闭或有未读的残留数据都视为不可用
+    static bool IsHealthy(const Socket::SPtr& conn);
+    bool isExpired(int64_t created, int64_t now) const;
+    void closeConn(const Socket::SPtr& conn);
+    void evict();
+
+    Scheduler* sche_;
+    Options options_;
+    Mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    Timer::SPtr evictTimer_;
+
+    std::atomic<uint64_t> createdCount_{0};
+    std::atomic<uint64_t> reusedCount_{0};
+    std::atomic<uint64_t> closedCount_{0};
+    std::atomic<uint64_t> connectFailed_{0};
+    std::atomic<uint64_t> backoffRejected_{0};
+};
+
+} // namespace reyao
@@ -12,6 +12,7 @@ namespace reyao {
 Epoller::IOEvent::EventCtx& Epoller::IOEvent::getEventCtx(int type) {
     switch (type) {
         case EPOLLIN:
+        case EPOLLRDHUP:
             return readEvent;
         case EPOLLOUT:
             return writeEvent;
@@ -68,8 +69,9 @@ bool Epoller::addEvent(int fd, int type, Func func) {
         resize(fd * 1.5);
     }
     event = ioEvents_[fd];
-    // 事件已注册
-    if (event->types & type) {
+    // 事件已注册，EPOLLIN 和 EPOLLRDHUP 共用读事件
+    int conflict = (type & (EPOLLIN | EPOLLRDHUP)) ? (EPOLLIN | EPOLLRDHUP) : type;
+    if (event->types & conflict) {
         LOG_ERROR << "addEvent(" << fd
                   << ", " << type << ")"
                   << " event->types:" << event->types;
@@ -186,6 +188,10 @@ bool Epoller::handleAllEvent(int fd) {
         event->triggleEvent(EPOLLIN);
         --pendingEvents_;
     }
+    if (event->types & EPOLLRDHUP) {
+        event->triggleEvent(EPOLLRDHUP);
+        --pendingEvents_;
+    }
     if (event->types & EPOLLOUT) {
         event->triggleEvent(EPOLLOUT);
         --pendingEvents_;
@@ -235,12 +241,15 @@ void Epoller::wait(epoll_event* events, int maxcnt, int timeout) {
             Epoller::IOEvent* ioEvent = (Epoller::IOEvent*)event.data.ptr;
             if (event.events & (EPOLLERR | EPOLLHUP)) { 
                 // peer关闭，标记 socket 注册的读写 event，当作读写事件统一处理，即关闭连接
-                event.events |= (EPOLLIN | EPOLLOUT) & ioEvent->types;
+                event.events |= (EPOLLIN | EPOLLOUT | EPOLLRDHUP) & ioEvent->types;
             }
             int realEvents = 0;
             if (event.events & EPOLLIN) {
                 realEvents |= EPOLLIN;
             }
+            if (event.events & EPOLLRDHUP) {
+                realEvents |= EPOLLRDHUP;
+            }
             if (event.events & EPOLLOUT) {
                 realEvents |= EPOLLOUT;
             }
@@ -265,6 +274,10 @@ void Epoller::wait(epoll_event* events, int maxcnt, int timeout) {
                 ioEvent->triggleEvent(EPOLLIN);
                 --pendingEvents_;
             }
+            if (realEvents & EPOLLRDHUP) {
+                ioEvent->triggleEvent(EPOLLRDHUP);
+                --pendingEvents_;
+            }
             if (realEvents & EPOLLOUT) {
                 ioEvent->triggleEvent(EPOLLOUT);
                 --pendingEvents_;
@@ -19,9 +19,11 @@ class Epoller {
 public:
     typedef std::function<void()> Func;
     // support type:
-    // NONE     --> 0x0,
-    // EPOLLIN  --> 0x1
-    // EPOLLOUT --> 0x4 
+    // NONE       --> 0x0,
+    // EPOLLIN    --> 0x1
+    // EPOLLOUT   --> 0x4 
+    // EPOLLRDHUP --> 0x2000，只在对端关闭时触发，有数据可读时不触发；
+    //                和 EPOLLIN 共用读事件，两者不能同时注册
     struct IOEvent {
         struct EventCtx {
             Worker* worker = nullptr;
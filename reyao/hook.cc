@@ -8,6 +8,7 @@
 #include <dlfcn.h>
 #include <stdarg.h>
 #include <sys/epoll.h>
+#include <sys/sendfile.h>
 
 #include <iostream>
 
@@ -40,6 +41,8 @@ static int64_t s_connectTimeout = 5000;
     XX(sendto) \
     XX(sendmsg) \
     XX(sendmmsg) \
+    XX(sendfile) \
+    XX(splice) \
     XX(fcntl) \
     XX(ioctl) \
     XX(getsockopt) \
@@ -386,6 +389,29 @@ int sendmmsg(int sockfd, struct mmsghdr *msgvec,
                         SO_SNDTIMEO, msgvec, vlen, flags);
 }
 
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    return reyao::do_io(out_fd, sendfile_origin, "sendfile", EPOLLOUT,
+                        SO_SNDTIMEO, in_fd, offset, count);
+}
+
+ssize_t splice(int fd_in, loff_t* off_in, int fd_out,
+               loff_t* off_out, size_t len, unsigned int flags) {
+    if (!reyao::t_hookEnable) {
+        return splice_origin(fd_in, off_in, fd_out, off_out, len, flags);
+    }
+    // splice 的两端至少有一端是管道，只对 sockfd 一端等待事件：
+    // sockfd 在输入端时等可读，在输出端时等可写
+    auto fdctx = g_fdmanager->getFdContext(fd_in);
+    if (fdctx && fdctx->isSocketFd()) {
+        return reyao::do_io(fd_in, splice_origin, "splice", EPOLLIN,
+                            SO_RCVTIMEO, off_in, fd_out, off_out, len, flags);
+    }
+    auto func = [=](int) {
+        return splice_origin(fd_in, off_in, fd_out, off_out, len, flags);
+    };
+    return reyao::do_io(fd_out, func, "splice", EPOLLOUT, SO_SNDTIMEO);
+}
+
 int fcntl(int fd, int cmd, ... /* arg */ ) {
     va_list va;
     va_start(va, cmd);
@@ -98,6 +98,13 @@ typedef int (*sendmmsgFunc_t)(int sockfd, struct mmsghdr *msgvec,
 		                          unsigned int vlen, int flags);
 extern sendmmsgFunc_t sendmmsg_origin;
 
+typedef ssize_t (*sendfileFunc_t)(int out_fd, int in_fd, off_t* offset, size_t count);
+extern sendfileFunc_t sendfile_origin;
+
+typedef ssize_t (*spliceFunc_t)(int fd_in, loff_t* off_in, int fd_out,
+                                loff_t* off_out, size_t len, unsigned int flags);
+extern spliceFunc_t splice_origin;
+
 typedef int (*fcntlFunc_t)(int fd, int cmd, ... /* arg */ );
 extern fcntlFunc_t fcntl_origin;
 
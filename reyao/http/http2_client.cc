@@ -0,0 +1,401 @@
+#include "reyao/http/http2_client.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+namespace reyao {
+
+std::string Http2Client::Response::getHeader(const std::string& name) const {
+    for (auto& kv : headers) {
+        if (strcasecmp(kv.first.c_str(), name.c_str()) == 0) {
+            return kv.second;
+        }
+    }
+    return "";
+}
+
+Http2Client::Http2Client(Socket::SPtr sock, bool owner, int32_t windowSize)
+    : SocketStream(sock, owner),
+      windowSize_(std::max(windowSize, Http2Codec::kDefaultWindowSize + 0)) {
+}
+
+static std::string ClientSettings(int32_t windowSize) {
+    std::string payload;
+    Http2Codec::AppendSetting(&payload, H2_SETTINGS_ENABLE_PUSH, 0);
+    Http2Codec::AppendSetting(&payload, H2_SETTINGS_INITIAL_WINDOW_SIZE, windowSize);
+    return payload;
+}
+
+Http2Client::SPtr Http2Client::Connect(Address::SPtr addr, int64_t timeout,
+                                       int32_t windowSize) {
+    Socket::SPtr sock = Socket::CreateTcp();
+    if (!sock->connect(*addr, timeout)) {
+        return nullptr;
+    }
+    SPtr client = std::make_shared<Http2Client>(sock, true, windowSize);
+    return client->start("") ? client : nullptr;
+}
+
+Http2Client::SPtr Http2Client::Upgrade(Address::SPtr addr, const std::string& path,
+                                       const std::string& host, int64_t timeout,
+                                       int32_t windowSize) {
+    Socket::SPtr sock = Socket::CreateTcp();
+    if (!sock->connect(*addr, timeout)) {
+        return nullptr;
+    }
+    SPtr client = std::make_shared<Http2Client>(sock, true, windowSize);
+    // HTTP2-Settings 使用不带填充的 base64url
+    std::string payload = ClientSettings(client->windowSize_);
+    std::string settings = Base64Encode(payload.data(), payload.size());
+    for (auto& c : settings) {
+        c = c == '+' ? '-' : (c == '/' ? '_' : c);
+    }
+    settings.erase(settings.find_last_not_of('=') + 1);
+    std::string req = "GET " + path + " HTTP/1.1\r\n"
+                      "Host: " + host + "\r\n"
+                      "Connection: Upgrade, HTTP2-Settings\r\n"
+                      "Upgrade: h2c\r\n"
+                      "HTTP2-Settings: " + settings + "\r\n\r\n";
+    if (sock->send(req.data(), req.size()) != (int)req.size()) {
+        return nullptr;
+    }
+    std::string data;
+    char buf[1024];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        if (data.size() > 8192) {
+            return nullptr;
+        }
+        int n = sock->recv(buf, sizeof(buf));
+        if (n <= 0) {
+            return nullptr;
+        }
+        data.append(buf, n);
+    }
+    if (data.compare(0, 12, "HTTP/1.1 101") != 0) {
+        LOG_WARN << "h2c upgrade fail: " << data.substr(0, end);
+        return nullptr;
+    }
+    // 升级请求占用 stream 1，已经发完
+    Stream& stream = client->streams_[1];
+    stream.rsp.streamId = 1;
+    stream.recvWindow = client->windowSize_;
+    client->nextStreamId_ = 3;
+    return client->start(data.substr(end + 4)) ? client : nullptr;
+}
+
+bool Http2Client::start(const std::string& buffered) {
+    if (!buffered.empty()) {
+        inBuf_.write(buffered.data(), buffered.size());
+    }
+    append(Http2Codec::kPreface, Http2Codec::kPrefaceSize);
+    std::string frames;
+    Http2Codec::AppendFrame(&frames, Http2FrameType::SETTINGS, 0, 0,
+                            ClientSettings(windowSize_));
+    if (windowSize_ > Http2Codec::kDefaultWindowSize) {
+        Http2Codec::AppendWindowUpdate(&frames, 0,
+                                       windowSize_ - Http2Codec::kDefaultWindowSize);
+    }
+    connRecvWindow_ = windowSize_;
+    append(frames);
+    return flush() >= 0;
+}
+
+uint32_t Http2Client::sendRequest(const std::string& method, const std::string& path,
+                                  const Headers& headers, const StringPiece& body) {
+    if (error_ || goaway_) {
+        return 0;
+    }
+    uint32_t id = nextStreamId_;
+    nextStreamId_ += 2;
+    std::string block;
+    encoder_.begin(&block);
+    encoder_.encode(":method", method, &block);
+    encoder_.encode(":scheme", "http", &block);
+    encoder_.encode(":path", path, &block);
+    bool hasAuthority = false;
+    for (auto& kv : headers) {
+        if (kv.first == "host") {
+            encoder_.encode(":authority", kv.second, &block);
+            hasAuthority = true;
+        }
+    }
+    if (!hasAuthority) {
+        encoder_.encode(":authority", "localhost", &block);
+    }
+    for (auto& kv : headers) {
+        if (kv.first != "host") {
+            encoder_.encode(kv.first, kv.second, &block);
+        }
+    }
+    Stream& stream = streams_[id];
+    stream.rsp.streamId = id;
+    stream.sendWindow = peer_.initialWindowSize;
+    stream.recvWindow = windowSize_;
+    std::string frames;
+    Http2Codec::AppendHeaders(&frames, id, block, body.empty(), peer_.maxFrameSize);
+    append(frames);
+    if (flush() < 0) {
+        error_ = true;
+        return 0;
+    }
+    size_t pos = 0;
+    while (pos < body.size()) {
+        auto it = streams_.find(id);
+        if (it == streams_.end()) {
+            // 服务端已经回复（如 413）或重置了这个流
+            break;
+        }
+        int64_t window = std::min(connSendWindow_, it->second.sendWindow);
+        if (window <= 0) {
+            if (!pump()) {
+                return 0;
+            }
+            continue;
+        }
+        size_t n = std::min<size_t>(std::min<int64_t>(window, peer_.maxFrameSize),
+                                    body.size() - pos);
+        bool last = pos + n == body.size();
+        frames.clear();
+        Http2Codec::AppendFrame(&frames, Http2FrameType::DATA, last ? H2_END_STREAM : 0, id,
+                                StringPiece(body.data() + pos, n));
+        connSendWindow_ -= n;
+        it->second.sendWindow -= n;
+        pos += n;
+        append(frames);
+        if (flush() < 0) {
+            error_ = true;
+            return 0;
+        }
+    }
+    return id;
+}
+
+bool Http2Client::recvResponse(Response* rsp) {
+    while (done_.empty()) {
+        if (streams_.empty() || error_ || !pump()) {
+            return false;
+        }
+    }
+    *rsp = std::move(done_.front());
+    done_.pop_front();
+    return true;
+}
+
+bool Http2Client::readFrame(Http2FrameHeader* header) {
+    while (true) {
+        size_t size = inBuf_.getReadSize();
+        if (size >= Http2Codec::kFrameHeaderSize) {
+            Http2Codec::ParseHeader(inBuf_.peek(), header);
+            if (header->length > 16384) {
+                return fail(Http2Error::FRAME_SIZE_ERROR);
+            }
+            if (size >= Http2Codec::kFrameHeaderSize + header->length) {
+                inBuf_.readView(Http2Codec::kFrameHeaderSize);
+                return true;
+            }
+        }
+        if (read(&inBuf_, 64 * 1024) <= 0) {
+            error_ = true;
+            return false;
+        }
+    }
+}
+
+bool Http2Client::pump() {
+    Http2FrameHeader header;
+    if (!readFrame(&header)) {
+        return false;
+    }
+    StringPiece payload = inBuf_.readView(header.length);
+    if (!handleFrame(header, payload.data(), payload.size())) {
+        return false;
+    }
+    if (getPendingSize() > 0 && flush() < 0) {
+        error_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool Http2Client::handleFrame(const Http2FrameHeader& header, const char* payload,
+                              size_t len) {
+    if (headerStreamId_ != 0 && (header.type != Http2FrameType::CONTINUATION ||
+                                 header.streamId != headerStreamId_)) {
+        return fail(Http2Error::PROTOCOL_ERROR);
+    }
+    std::string frames;
+    switch (header.type) {
+        case Http2FrameType::DATA: {
+            size_t frameLen = len;
+            if (!Http2Codec::StripPadding(header, &payload, &len)) {
+                return fail(Http2Error::PROTOCOL_ERROR);
+            }
+            connRecvWindow_ -= frameLen;
+            if (connRecvWindow_ < windowSize_ / 2) {
+                Http2Codec::AppendWindowUpdate(&frames, 0, windowSize_ - connRecvWindow_);
+                connRecvWindow_ = windowSize_;
+            }
+            auto it = streams_.find(header.streamId);
+            if (it != streams_.end()) {
+                Stream& stream = it->second;
+                stream.rsp.body.append(payload, len);
+                stream.recvWindow -= frameLen;
+                if (header.flags & H2_END_STREAM) {
+                    finish(header.streamId, Http2Error::NO_ERROR);
+                } else if (stream.recvWindow < windowSize_ / 2) {
+                    Http2Codec::AppendWindowUpdate(&frames, header.streamId,
+                                                   windowSize_ - stream.recvWindow);
+                    stream.recvWindow = windowSize_;
+                }
+            }
+            break;
+        }
+        case Http2FrameType::HEADERS:
+            if (!Http2Codec::StripPadding(header, &payload, &len)) {
+                return fail(Http2Error::PROTOCOL_ERROR);
+            }
+            headerStreamId_ = header.streamId;
+            headerEndStream_ = header.flags & H2_END_STREAM;
+            headerBlock_.assign(payload, len);
+            if ((header.flags & H2_END_HEADERS) && !onHeaderBlock()) {
+                return false;
+            }
+            break;
+        case Http2FrameType::CONTINUATION:
+            if (headerStreamId_ == 0) {
+                return fail(Http2Error::PROTOCOL_ERROR);
+            }
+            headerBlock_.append(payload, len);
+            if ((header.flags & H2_END_HEADERS) && !onHeaderBlock()) {
+                return false;
+            }
+            break;
+        case Http2FrameType::RST_STREAM:
+            if (len != 4) {
+                return fail(Http2Error::FRAME_SIZE_ERROR);
+            }
+            finish(header.streamId, static_cast<Http2Error>(Http2Codec::ReadUint32(payload)));
+            break;
+        case Http2FrameType::SETTINGS: {
+            if (header.flags & H2_ACK) {
+                break;
+            }
+            int64_t oldWindow = peer_.initialWindowSize;
+            Http2Error error = Http2Codec::ApplySettings(payload, len, &peer_);
+            if (error != Http2Error::NO_ERROR) {
+                return fail(error);
+            }
+            for (auto& kv : streams_) {
+                kv.second.sendWindow += (int64_t)peer_.initialWindowSize - oldWindow;
+            }
+            encoder_.setMaxTableSize(peer_.headerTableSize);
+            Http2Codec::AppendFrame(&frames, Http2FrameType::SETTINGS, H2_ACK, 0,
+                                    StringPiece());
+            break;
+        }
+        case Http2FrameType::PING:
+            if (!(header.flags & H2_ACK)) {
+                Http2Codec::AppendFrame(&frames, Http2FrameType::PING, H2_ACK, 0,
+                                        StringPiece(payload, len));
+            }
+            break;
+        case Http2FrameType::GOAWAY: {
+            if (len < 8) {
+                return fail(Http2Error::FRAME_SIZE_ERROR);
+            }
+            goaway_ = true;
+            goawayError_ = static_cast<Http2Error>(Http2Codec::ReadUint32(payload + 4));
+            // 编号大于 lastStreamId 的流没有被处理
+            uint32_t lastId = Http2Codec::ReadUint32(payload) & 0x7fffffff;
+            std::vector<uint32_t> ids;
+            for (auto& kv : streams_) {
+                if (kv.first > lastId || goawayError_ != Http2Error::NO_ERROR) {
+                    ids.push_back(kv.first);
+                }
+            }
+            for (auto id : ids) {
+                finish(id, Http2Error::REFUSED_STREAM);
+            }
+            break;
+        }
+        case Http2FrameType::WINDOW_UPDATE: {
+            if (len != 4) {
+                return fail(Http2Error::FRAME_SIZE_ERROR);
+            }
+            uint32_t increment = Http2Codec::ReadUint32(payload) & 0x7fffffff;
+            if (header.streamId == 0) {
+                connSendWindow_ += increment;
+            } else {
+                auto it = streams_.find(header.streamId);
+                if (it != streams_.end()) {
+                    it->second.sendWindow += increment;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (!frames.empty()) {
+        append(frames);
+    }
+    return true;
+}
+
+bool Http2Client::onHeaderBlock() {
+    uint32_t id = headerStreamId_;
+    headerStreamId_ = 0;
+    auto it = streams_.find(id);
+    Response* rsp = it == streams_.end() ? nullptr : &it->second.rsp;
+    // trailer 和 1xx 的字段不保存
+    bool keep = rsp && rsp->status == 0;
+    int status = 0;
+    bool ok = decoder_.decode(headerBlock_.data(), headerBlock_.size(),
+                              [&](const StringPiece& name, const StringPiece& value) {
+        if (name == ":status") {
+            status = atoi(value.toString().c_str());
+        } else if (keep && (name.empty() || name[0] != ':')) {
+            rsp->headers.push_back(std::make_pair(name.toString(), value.toString()));
+        }
+    });
+    if (!ok) {
+        return fail(Http2Error::COMPRESSION_ERROR);
+    }
+    if (keep) {
+        if (status >= 100 && status < 200) {
+            rsp->headers.clear();
+        } else {
+            rsp->status = status;
+        }
+    }
+    if (rsp && headerEndStream_) {
+        finish(id, Http2Error::NO_ERROR);
+    }
+    return true;
+}
+
+void Http2Client::finish(uint32_t id, Http2Error error) {
+    auto it = streams_.find(id);
+    if (it == streams_.end()) {
+        return;
+    }
+    it->second.rsp.error = error;
+    done_.push_back(std::move(it->second.rsp));
+    streams_.erase(it);
+}
+
+bool Http2Client::fail(Http2Error error) {
+    std::string frames;
+    Http2Codec::AppendGoaway(&frames, 0, error);
+    append(frames);
+    flush();
+    error_ = true;
+    return false;
+}
+
+} // namespace reyao
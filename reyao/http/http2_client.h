@@ -0,0 +1,99 @@
+#pragma once
+
+#include "reyao/http/http2_frame.h"
+#include "reyao/http/http2_hpack.h"
+#include "reyao/socket_stream.h"
+#include "reyao/bytearray.h"
+#include "reyao/address.h"
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace reyao {
+
+// h2c 客户端，在协程中使用：一条连接上可以连续发出多个请求，响应按完成的顺序取回。
+// 发送和接收都在调用方的协程中进行，请求 body 受发送窗口限制时边读帧边等待 WINDOW_UPDATE；
+// 收到的 DATA 立即补充窗口，SETTINGS 和 PING 自动回复
+class Http2Client : public SocketStream {
+public:
+    typedef std::shared_ptr<Http2Client> SPtr;
+    typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+    struct Response {
+        uint32_t streamId = 0;
+        int status = 0;
+        Headers headers;                    // 不包括伪头部
+        std::string body;
+        // 流被服务端重置时的错误码，此时 status 可能为 0
+        Http2Error error = Http2Error::NO_ERROR;
+
+        std::string getHeader(const std::string& name) const;
+    };
+
+    // windowSize 是每个流和整个连接的接收窗口
+    Http2Client(Socket::SPtr sock, bool owner, int32_t windowSize = 65535);
+
+    // prior knowledge：直接发出连接前言，失败返回 nullptr
+    static SPtr Connect(Address::SPtr addr, int64_t timeout = 5000,
+                        int32_t windowSize = 65535);
+    // 先发 "Upgrade: h2c" 的 HTTP/1.1 GET path，收到 101 后切换，
+    // 这个请求的响应在 stream 1 上返回
+    static SPtr Upgrade(Address::SPtr addr, const std::string& path,
+                        const std::string& host = "localhost", int64_t timeout = 5000,
+                        int32_t windowSize = 65535);
+
+    // 发出一个请求，返回 stream id，失败返回 0；headers 中的名字必须是小写
+    uint32_t sendRequest(const std::string& method, const std::string& path,
+                         const Headers& headers = Headers(),
+                         const StringPiece& body = StringPiece());
+    // 等待下一个完成（或被重置）的响应，连接出错或关闭时返回 false
+    bool recvResponse(Response* rsp);
+    // 没有取走的响应和还在进行中的流
+    size_t getActiveStreams() const { return streams_.size() + done_.size(); }
+    // 收到 GOAWAY 时的错误码
+    bool isGoaway() const { return goaway_; }
+    Http2Error getGoawayError() const { return goawayError_; }
+    const Http2Settings& getPeerSettings() const { return peer_; }
+
+private:
+    struct Stream {
+        Response rsp;
+        int64_t sendWindow = 0;
+        int32_t recvWindow = 0;
+    };
+
+    // 发出连接前言和 SETTINGS，buffered 是升级时多读的数据
+    bool start(const std::string& buffered);
+    bool readFrame(Http2FrameHeader* header);
+    // 读一个帧并处理，出错返回 false
+    bool pump();
+    bool handleFrame(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onHeaderBlock();
+    void finish(uint32_t id, Http2Error error);
+    bool fail(Http2Error error);
+
+    ByteArray inBuf_;
+    int32_t windowSize_;
+    HpackEncoder encoder_;
+    HpackDecoder decoder_;
+    Http2Settings peer_;
+    uint32_t nextStreamId_ = 1;
+    std::unordered_map<uint32_t, Stream> streams_;
+    std::deque<Response> done_;
+    int64_t connSendWindow_ = 65535;
+    int32_t connRecvWindow_ = 65535;
+    uint32_t headerStreamId_ = 0;
+    bool headerEndStream_ = false;
+    std::string headerBlock_;
+    bool goaway_ = false;
+    Http2Error goawayError_ = Http2Error::NO_ERROR;
+    bool error_ = false;
+};
+
+} // namespace reyao
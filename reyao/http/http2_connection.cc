@@ -0,0 +1,837 @@
+#include "reyao/http/http2_connection.h"
+#include "reyao/http/http_server.h"
+#include "reyao/worker.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace reyao {
+
+// 本端不修改 SETTINGS_MAX_FRAME_SIZE，使用协议默认值
+static const uint32_t kMaxFrameSize = 16384;
+// prior knowledge 时 "PRI * HTTP/2.0\r\n\r\n" 已被 HTTP/1 解析器当作请求头读走
+static const char kPrefaceTail[] = "SM\r\n\r\n";
+// 还没收完的头部块（HEADERS 加 CONTINUATION）的上限
+static const size_t kMaxHeaderBlock = 1024 * 1024;
+// HttpLimits 不限制头部大小时，解码后的头部列表仍然使用这个上限
+static const size_t kDefaultMaxHeaderList = 64 * 1024;
+
+// 流式 body 的 servlet 在 HTTP/2 下读的是已经收完的 body
+class BufferedBodyReader : public HttpBodyReader {
+public:
+    explicit BufferedBodyReader(const std::string& body) : body_(body) {}
+    int read(void* buf, size_t len) override {
+        size_t n = std::min(len, body_.size() - pos_);
+        memcpy(buf, body_.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    const std::string& body_;
+    size_t pos_ = 0;
+};
+
+// 只属于 HTTP/1.1 连接的头部，HTTP/2 中不能出现
+static bool IsConnectionHeader(const StringPiece& name) {
+    return name.caseEqual("connection") || name.caseEqual("keep-alive") ||
+           name.caseEqual("proxy-connection") || name.caseEqual("transfer-encoding") ||
+           name.caseEqual("upgrade");
+}
+
+Http2Connection::Http2Connection(HttpServer* server, HttpTakeover& conn,
+                                 const Http2Options& options)
+    : server_(server),
+      conn_(conn),
+      options_(options),
+      worker_(conn.worker),
+      session_(conn.client, false) {
+    // 连接窗口初始是 65535，只能用 WINDOW_UPDATE 扩大
+    options_.connectionWindowSize = std::max(options_.connectionWindowSize,
+                                             Http2Codec::kDefaultWindowSize + 0);
+    options_.initialWindowSize = std::max(options_.initialWindowSize, 1);
+    maxHeaderList_ = server->getLimits().maxHeaderSize;
+    if (maxHeaderList_ == 0) {
+        maxHeaderList_ = kDefaultMaxHeaderList;
+    }
+    if (!conn.buffered.empty()) {
+        inBuf_.write(conn.buffered.data(), conn.buffered.size());
+    }
+}
+
+void Http2Connection::run(const HttpRequest* upgrade, const std::string& settings) {
+    std::string payload;
+    Http2Codec::AppendSetting(&payload, H2_SETTINGS_MAX_CONCURRENT_STREAMS,
+                              options_.maxConcurrentStreams);
+    Http2Codec::AppendSetting(&payload, H2_SETTINGS_INITIAL_WINDOW_SIZE,
+                              options_.initialWindowSize);
+    Http2Codec::AppendSetting(&payload, H2_SETTINGS_MAX_HEADER_LIST_SIZE, maxHeaderList_);
+    Http2Codec::AppendFrame(&outBuf_, Http2FrameType::SETTINGS, 0, 0, payload);
+    connRecvWindow_ = options_.connectionWindowSize;
+    if (connRecvWindow_ > Http2Codec::kDefaultWindowSize) {
+        Http2Codec::AppendWindowUpdate(&outBuf_, 0,
+                                       connRecvWindow_ - Http2Codec::kDefaultWindowSize);
+    }
+    ++tasks_;
+    worker_->addTask(std::bind(&Http2Connection::writeLoop, this));
+
+    bool ok = true;
+    if (upgrade) {
+        // HTTP2-Settings 相当于客户端的第一个 SETTINGS，不需要 ACK
+        if (Http2Codec::ApplySettings(settings.data(), settings.size(), &peer_) !=
+            Http2Error::NO_ERROR) {
+            ok = goaway(Http2Error::PROTOCOL_ERROR);
+        } else {
+            encoder_.setMaxTableSize(peer_.headerTableSize);
+            StreamPtr stream = std::make_shared<Stream>();
+            stream->id = 1;
+            stream->sendWindow = peer_.initialWindowSize;
+            stream->endStream = true;
+            copyRequest(*upgrade, stream.get());
+            lastStreamId_ = 1;
+            streams_[1] = stream;
+            dispatch(stream);
+        }
+    }
+    const char* preface = upgrade ? Http2Codec::kPreface : kPrefaceTail;
+    size_t prefaceLen = upgrade ? Http2Codec::kPrefaceSize : sizeof(kPrefaceTail) - 1;
+    while (ok && inBuf_.getReadSize() < prefaceLen) {
+        ok = session_.read(&inBuf_, 4096) > 0;
+    }
+    if (ok) {
+        if (memcmp(inBuf_.peek(), preface, prefaceLen) != 0) {
+            ok = goaway(Http2Error::PROTOCOL_ERROR);
+        } else {
+            inBuf_.readView(prefaceLen);
+        }
+    }
+    // 前言之后的第一个帧必须是 SETTINGS
+    bool first = true;
+    while (ok && !closing_) {
+        // 对端不读时写队列只增不减，读协程也停下来，不再生成 ACK、RST 和新的响应
+        while (outBuf_.size() >= options_.maxQueuedBytes && !broken_) {
+            wait(&reader_);
+        }
+        Http2FrameHeader header;
+        if (!readFrame(&header)) {
+            break;
+        }
+        if (first && header.type != Http2FrameType::SETTINGS) {
+            goaway(Http2Error::PROTOCOL_ERROR);
+            break;
+        }
+        first = false;
+        StringPiece frame = inBuf_.readView(header.length);
+        ok = handleFrame(header, frame.data(), frame.size());
+    }
+
+    closing_ = true;
+    // 还没收完的请求直接丢弃，已经在处理的流跑完再关闭连接
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        if (!it->second->endStream) {
+            releaseBody(it->second.get());
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    wakeAll();
+    while (tasks_ > 0) {
+        wait(&closer_);
+    }
+    conn_.close();
+}
+
+bool Http2Connection::readFrame(Http2FrameHeader* header) {
+    while (true) {
+        size_t size = inBuf_.getReadSize();
+        if (size >= Http2Codec::kFrameHeaderSize) {
+            Http2Codec::ParseHeader(inBuf_.peek(), header);
+            if (header->length > kMaxFrameSize) {
+                return goaway(Http2Error::FRAME_SIZE_ERROR);
+            }
+            if (size >= Http2Codec::kFrameHeaderSize + header->length) {
+                inBuf_.readView(Http2Codec::kFrameHeaderSize);
+                return true;
+            }
+        }
+        if (session_.read(&inBuf_, 64 * 1024) <= 0) {
+            return false;
+        }
+    }
+}
+
+bool Http2Connection::handleFrame(const Http2FrameHeader& header, const char* payload,
+                                  size_t len) {
+    // 头部块没有结束时只能收到同一个流的 CONTINUATION
+    if (headerStreamId_ != 0 && (header.type != Http2FrameType::CONTINUATION ||
+                                 header.streamId != headerStreamId_)) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    switch (header.type) {
+        case Http2FrameType::DATA:
+            return onData(header, payload, len);
+        case Http2FrameType::HEADERS:
+            return onHeaders(header, payload, len);
+        case Http2FrameType::CONTINUATION:
+            if (headerStreamId_ == 0) {
+                return goaway(Http2Error::PROTOCOL_ERROR);
+            }
+            if (headerBlock_.size() + len > kMaxHeaderBlock) {
+                return goaway(Http2Error::ENHANCE_YOUR_CALM);
+            }
+            headerBlock_.append(payload, len);
+            return (header.flags & H2_END_HEADERS) ? onHeaderBlock() : true;
+        case Http2FrameType::PRIORITY:
+            // 不支持优先级，所有流按到达顺序处理
+            return true;
+        case Http2FrameType::RST_STREAM:
+            return onRstStream(header, payload, len);
+        case Http2FrameType::SETTINGS:
+            return onSettings(header, payload, len);
+        case Http2FrameType::PUSH_PROMISE:
+            // 客户端不能推送
+            return goaway(Http2Error::PROTOCOL_ERROR);
+        case Http2FrameType::PING:
+            if (header.streamId != 0) {
+                return goaway(Http2Error::PROTOCOL_ERROR);
+            }
+            if (len != 8) {
+                return goaway(Http2Error::FRAME_SIZE_ERROR);
+            }
+            if (!(header.flags & H2_ACK)) {
+                Http2Codec::AppendFrame(&outBuf_, Http2FrameType::PING, H2_ACK, 0,
+                                        StringPiece(payload, len));
+                kick();
+            }
+            return true;
+        case Http2FrameType::GOAWAY:
+            // 对端不会再发起新的流，已有的流继续处理，等对端关闭连接
+            return true;
+        case Http2FrameType::WINDOW_UPDATE:
+            return onWindowUpdate(header, payload, len);
+        default:
+            // 未知类型的帧忽略
+            return true;
+    }
+}
+
+bool Http2Connection::onHeaders(const Http2FrameHeader& header, const char* payload,
+                                size_t len) {
+    if (header.streamId == 0) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    if (!Http2Codec::StripPadding(header, &payload, &len)) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    headerStreamId_ = header.streamId;
+    headerEndStream_ = header.flags & H2_END_STREAM;
+    headerBlock_.assign(payload, len);
+    return (header.flags & H2_END_HEADERS) ? onHeaderBlock() : true;
+}
+
+bool Http2Connection::onHeaderBlock() {
+    uint32_t id = headerStreamId_;
+    headerStreamId_ = 0;
+    StreamPtr stream;
+    auto it = streams_.find(id);
+    Http2Error error = Http2Error::NO_ERROR;
+    if (it != streams_.end()) {
+        // 已有的流上再收到 HEADERS 是 trailer，必须结束请求
+        stream = it->second;
+        if (stream->endStream || !headerEndStream_) {
+            error = Http2Error::PROTOCOL_ERROR;
+        }
+    } else if (id % 2 == 0) {
+        error = Http2Error::PROTOCOL_ERROR;
+    } else if (id <= lastStreamId_) {
+        error = Http2Error::STREAM_CLOSED;
+    } else {
+        stream = std::make_shared<Stream>();
+        stream->id = id;
+        stream->sendWindow = peer_.initialWindowSize;
+        stream->recvWindow = options_.initialWindowSize;
+        lastStreamId_ = id;
+    }
+    // 出错或是 trailer 时也要解码，保持和对端的动态表一致
+    bool keep = error == Http2Error::NO_ERROR && it == streams_.end();
+    std::string* out = keep ? &stream->headers : nullptr;
+    size_t listSize = 0;
+    fields_.clear();
+    // 超过上限时不再保存，回复 431；超过两倍时认为是恶意的，停止解码并关闭连接
+    bool ok = decoder_.decode(headerBlock_.data(), headerBlock_.size(),
+                              [&](const StringPiece& name, const StringPiece& value) {
+        listSize += name.size() + value.size() + HpackTable::kEntryOverhead;
+        if (out && listSize <= maxHeaderList_) {
+            fields_.push_back(std::make_pair(out->size(), name.size()));
+            out->append(name.data(), name.size());
+            out->append(value.data(), value.size());
+        }
+    }, maxHeaderList_ * 2);
+    if (headerBlock_.capacity() > 64 * 1024) {
+        std::string().swap(headerBlock_);
+    } else {
+        headerBlock_.clear();
+    }
+    if (!ok) {
+        return goaway(Http2Error::COMPRESSION_ERROR);
+    }
+    if (error != Http2Error::NO_ERROR) {
+        return goaway(error);
+    }
+    if (!keep) {
+        // trailer 中的字段不使用
+        stream->endStream = true;
+        dispatch(stream);
+        return true;
+    }
+    if (streams_.size() >= options_.maxConcurrentStreams) {
+        Http2Codec::AppendRstStream(&outBuf_, id, Http2Error::REFUSED_STREAM);
+        kick();
+        return true;
+    }
+    stream->endStream = headerEndStream_;
+    if (listSize > maxHeaderList_) {
+        respondError(stream, HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+        return true;
+    }
+    if (!buildRequest(stream.get())) {
+        Http2Codec::AppendRstStream(&outBuf_, id, Http2Error::PROTOCOL_ERROR);
+        kick();
+        return true;
+    }
+    streams_[id] = stream;
+    if (stream->endStream) {
+        dispatch(stream);
+    }
+    return true;
+}
+
+bool Http2Connection::buildRequest(Stream* stream) {
+    HttpRequest& req = stream->req;
+    const std::string& buf = stream->headers;
+    StringPiece method, path, scheme, authority;
+    std::vector<StringPiece> cookies;
+    bool regular = false;
+    bool hasHost = false;
+    for (size_t i = 0; i < fields_.size(); i++) {
+        size_t pos = fields_[i].first;
+        size_t nameLen = fields_[i].second;
+        size_t end = i + 1 < fields_.size() ? fields_[i + 1].first : buf.size();
+        StringPiece name(buf.data() + pos, nameLen);
+        StringPiece value(buf.data() + pos + nameLen, end - pos - nameLen);
+        if (!name.empty() && name[0] == ':') {
+            // 伪头部必须在普通头部之前
+            if (regular) {
+                return false;
+            }
+            if (name == ":method") {
+                method = value;
+            } else if (name == ":path") {
+                path = value;
+            } else if (name == ":scheme") {
+                scheme = value;
+            } else if (name == ":authority") {
+                authority = value;
+            } else {
+                return false;
+            }
+            continue;
+        }
+        regular = true;
+        if (IsConnectionHeader(name)) {
+            return false;
+        }
+        if (name == "cookie") {
+            // 对端可能把 cookie 拆成多个字段，合并后交给 servlet
+            cookies.push_back(value);
+            continue;
+        }
+        if (name == "host") {
+            hasHost = true;
+        }
+        req.appendHeader(name, value);
+    }
+    if (method.empty() || scheme.empty() || path.empty() || path[0] != '/') {
+        return false;
+    }
+    if (!hasHost && !authority.empty()) {
+        req.appendHeader("host", authority);
+    }
+    if (cookies.size() == 1) {
+        req.appendHeader("cookie", cookies[0]);
+    } else if (cookies.size() > 1) {
+        std::string cookie = cookies[0].toString();
+        for (size_t i = 1; i < cookies.size(); i++) {
+            cookie.append("; ").append(cookies[i].data(), cookies[i].size());
+        }
+        req.addHeader("cookie", cookie);
+    }
+    req.setMethod(StringToHttpMethod(method));
+    req.setVersion(0x20);
+    req.setKeepAlive(true);
+    const char* begin = path.begin();
+    const char* last = path.end();
+    const char* p = std::find(begin, last, '#');
+    if (p != last) {
+        req.setFragmentView(StringPiece(p + 1, last - p - 1));
+        last = p;
+    }
+    p = std::find(begin, last, '?');
+    if (p != last) {
+        req.setQueryView(StringPiece(p + 1, last - p - 1));
+        last = p;
+    }
+    req.setPathView(StringPiece(begin, last - begin));
+    return true;
+}
+
+void Http2Connection::copyRequest(const HttpRequest& from, Stream* stream) {
+    HttpRequest& req = stream->req;
+    req.setMethod(from.getMethod());
+    req.setVersion(0x20);
+    req.setKeepAlive(true);
+    req.setPath(from.getPath().toString());
+    if (!from.getQuery().empty()) {
+        req.setQuery(from.getQuery().toString());
+    }
+    if (!from.getFragment().empty()) {
+        req.setFragment(from.getFragment().toString());
+    }
+    for (size_t i = 0; i < from.getHeaderCount(); i++) {
+        const HttpRequest::Header& header = from.getHeaderAt(i);
+        if (IsConnectionHeader(header.name) || header.name.caseEqual("HTTP2-Settings")) {
+            continue;
+        }
+        req.addHeader(header.name.toString(), header.value.toString());
+    }
+    stream->body = from.getBody().toString();
+    bufferedBytes_ += stream->body.size();
+}
+
+bool Http2Connection::onData(const Http2FrameHeader& header, const char* payload,
+                             size_t len) {
+    if (header.streamId == 0) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    // 窗口按整个帧（包括填充）计算
+    if ((int64_t)len > connRecvWindow_) {
+        return goaway(Http2Error::FLOW_CONTROL_ERROR);
+    }
+    connRecvWindow_ -= len;
+    size_t frameLen = len;
+    if (!Http2Codec::StripPadding(header, &payload, &len)) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    bool endStream = header.flags & H2_END_STREAM;
+    auto it = streams_.find(header.streamId);
+    if (it == streams_.end() || it->second->endStream) {
+        replenish(nullptr, false);
+        if (header.streamId > lastStreamId_) {
+            return goaway(Http2Error::PROTOCOL_ERROR);
+        }
+        Http2Codec::AppendRstStream(&outBuf_, header.streamId, Http2Error::STREAM_CLOSED);
+        kick();
+        return true;
+    }
+    StreamPtr stream = it->second;
+    if ((int64_t)frameLen > stream->recvWindow) {
+        replenish(nullptr, false);
+        resetStream(stream, Http2Error::FLOW_CONTROL_ERROR);
+        return true;
+    }
+    stream->recvWindow -= frameLen;
+    uint64_t maxBodySize = server_->getLimits().maxBodySize;
+    if (maxBodySize && stream->body.size() + len > maxBodySize) {
+        replenish(nullptr, false);
+        respondError(stream, HttpStatus::PAYLOAD_TOO_LARGE);
+        return true;
+    }
+    // 窗口收到数据就补充，缓存的 body 总量在这里限制，超过时拒绝这个流，对端可以重试
+    if (bufferedBytes_ + len > options_.maxBufferedBytes) {
+        replenish(nullptr, false);
+        resetStream(stream, Http2Error::REFUSED_STREAM);
+        return true;
+    }
+    bufferedBytes_ += len;
+    stream->body.append(payload, len);
+    replenish(stream.get(), !endStream);
+    if (endStream) {
+        stream->endStream = true;
+        dispatch(stream);
+    }
+    return true;
+}
+
+void Http2Connection::replenish(Stream* stream, bool more) {
+    // 数据收下就已经读进内存，窗口用掉一半时补满
+    if (connRecvWindow_ < options_.connectionWindowSize / 2) {
+        Http2Codec::AppendWindowUpdate(&outBuf_, 0,
+                                       options_.connectionWindowSize - connRecvWindow_);
+        connRecvWindow_ = options_.connectionWindowSize;
+        kick();
+    }
+    if (stream && more && stream->recvWindow < options_.initialWindowSize / 2) {
+        Http2Codec::AppendWindowUpdate(&outBuf_, stream->id,
+                                       options_.initialWindowSize - stream->recvWindow);
+        stream->recvWindow = options_.initialWindowSize;
+        kick();
+    }
+}
+
+bool Http2Connection::onSettings(const Http2FrameHeader& header, const char* payload,
+                                 size_t len) {
+    if (header.streamId != 0) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    if (header.flags & H2_ACK) {
+        return len == 0 ? true : goaway(Http2Error::FRAME_SIZE_ERROR);
+    }
+    int64_t oldWindow = peer_.initialWindowSize;
+    Http2Error error = Http2Codec::ApplySettings(payload, len, &peer_);
+    if (error != Http2Error::NO_ERROR) {
+        return goaway(error);
+    }
+    encoder_.setMaxTableSize(peer_.headerTableSize);
+    // 初始窗口的变化作用到所有已有的流上
+    int64_t delta = (int64_t)peer_.initialWindowSize - oldWindow;
+    if (delta != 0) {
+        for (auto& kv : streams_) {
+            kv.second->sendWindow += delta;
+            if (kv.second->sendWindow > Http2Codec::kMaxWindowSize) {
+                return goaway(Http2Error::FLOW_CONTROL_ERROR);
+            }
+            if (delta > 0) {
+                wake(&kv.second->waiter);
+            }
+        }
+    }
+    Http2Codec::AppendFrame(&outBuf_, Http2FrameType::SETTINGS, H2_ACK, 0, StringPiece());
+    kick();
+    return true;
+}
+
+bool Http2Connection::onWindowUpdate(const Http2FrameHeader& header, const char* payload,
+                                     size_t len) {
+    if (len != 4) {
+        return goaway(Http2Error::FRAME_SIZE_ERROR);
+    }
+    uint32_t increment = Http2Codec::ReadUint32(payload) & 0x7fffffff;
+    if (header.streamId == 0) {
+        if (increment == 0) {
+            return goaway(Http2Error::PROTOCOL_ERROR);
+        }
+        connSendWindow_ += increment;
+        if (connSendWindow_ > Http2Codec::kMaxWindowSize) {
+            return goaway(Http2Error::FLOW_CONTROL_ERROR);
+        }
+        for (auto& stream : blocked_) {
+            wake(&stream->waiter);
+        }
+        blocked_.clear();
+        return true;
+    }
+    auto it = streams_.find(header.streamId);
+    if (it == streams_.end()) {
+        // 已经结束的流上的窗口更新忽略
+        return true;
+    }
+    StreamPtr stream = it->second;
+    if (increment == 0) {
+        resetStream(stream, Http2Error::PROTOCOL_ERROR);
+        return true;
+    }
+    stream->sendWindow += increment;
+    if (stream->sendWindow > Http2Codec::kMaxWindowSize) {
+        resetStream(stream, Http2Error::FLOW_CONTROL_ERROR);
+        return true;
+    }
+    wake(&stream->waiter);
+    return true;
+}
+
+bool Http2Connection::onRstStream(const Http2FrameHeader& header, const char* payload,
+                                  size_t len) {
+    if (header.streamId == 0) {
+        return goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    if (len != 4) {
+        return goaway(Http2Error::FRAME_SIZE_ERROR);
+    }
+    auto it = streams_.find(header.streamId);
+    if (it == streams_.end()) {
+        return header.streamId <= lastStreamId_ ? true : goaway(Http2Error::PROTOCOL_ERROR);
+    }
+    StreamPtr stream = it->second;
+    stream->reset = true;
+    wake(&stream->waiter);
+    if (!stream->running) {
+        dropStream(stream);
+    }
+    return true;
+}
+
+bool Http2Connection::goaway(Http2Error error) {
+    if (!closing_) {
+        if (error != Http2Error::NO_ERROR) {
+            LOG_WARN << "http2 connection error " << static_cast<uint32_t>(error)
+                     << ", client=" << conn_.client->toString();
+        }
+        Http2Codec::AppendGoaway(&outBuf_, lastStreamId_, error);
+        kick();
+        closing_ = true;
+    }
+    return false;
+}
+
+void Http2Connection::resetStream(const StreamPtr& stream, Http2Error error) {
+    Http2Codec::AppendRstStream(&outBuf_, stream->id, error);
+    kick();
+    stream->reset = true;
+    wake(&stream->waiter);
+    if (!stream->running) {
+        dropStream(stream);
+    }
+}
+
+void Http2Connection::dropStream(const StreamPtr& stream) {
+    releaseBody(stream.get());
+    streams_.erase(stream->id);
+}
+
+void Http2Connection::releaseBody(Stream* stream) {
+    bufferedBytes_ -= stream->body.size();
+    std::string().swap(stream->body);
+}
+
+void Http2Connection::dispatch(const StreamPtr& stream) {
+    stream->running = true;
+    ++tasks_;
+    worker_->addTask(std::bind(&Http2Connection::runStream, this, stream));
+}
+
+void Http2Connection::runStream(StreamPtr stream) {
+    HttpRequest& req = stream->req;
+    Servlet::SPtr servlet = server_->getDispatch()->getMatchServlet(req.getPath(),
+                                                                    req.getRouteParams());
+    BufferedBodyReader reader(stream->body);
+    if (servlet->isStreamBody()) {
+        req.setBodyReader(&reader);
+    } else {
+        req.setBodyView(stream->body);
+    }
+    HttpResponse rsp(0x11, true);
+    server_->prepare(&rsp);
+    servlet->handle(req, &rsp, session_);
+    releaseBody(stream.get());
+    if (!stream->reset && !broken_) {
+        if (rsp.getTakeover()) {
+            resetStream(stream, Http2Error::HTTP_1_1_REQUIRED);
+        } else {
+            if (server_->getGzip().enable) {
+                server_->compress(req.getPath(), req.getHeaderView(HttpRequest::ACCEPT_ENCODING),
+                                  &rsp);
+            }
+            sendResponse(stream, &rsp, req.getMethod() == HttpMethod::HEAD);
+        }
+    }
+    streams_.erase(stream->id);
+    onTaskDone();
+}
+
+void Http2Connection::respondError(const StreamPtr& stream, HttpStatus status) {
+    HttpResponse rsp(0x11, true);
+    rsp.setStatus(status);
+    server_->prepare(&rsp);
+    std::string block;
+    encodeHeaders(&rsp, false, &block);
+    Http2Codec::AppendHeaders(&outBuf_, stream->id, block, true, peer_.maxFrameSize);
+    if (!stream->endStream) {
+        // 请求还没发完，让对端停止发送
+        Http2Codec::AppendRstStream(&outBuf_, stream->id, Http2Error::NO_ERROR);
+    }
+    kick();
+    stream->reset = true;
+    if (!stream->running) {
+        dropStream(stream);
+    }
+}
+
+// HTTP/2 的头部名必须是小写
+static StringPiece ToLower(const StringPiece& name, std::string* buf) {
+    buf->assign(name.data(), name.size());
+    for (auto& c : *buf) {
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+    }
+    return *buf;
+}
+
+// 每次都不同的值不进动态表，避免挤掉可以复用的条目
+static HpackEncoder::Indexing GetIndexing(const StringPiece& name) {
+    if (name == "set-cookie" || name == "authorization") {
+        return HpackEncoder::NEVER;
+    }
+    if (name == "content-length" || name == "date" || name == "etag" ||
+        name == "last-modified" || name == "content-range" || name == "age") {
+        return HpackEncoder::WITHOUT;
+    }
+    return HpackEncoder::INCREMENTAL;
+}
+
+void Http2Connection::encodeHeaders(HttpResponse* rsp, bool isHead, std::string* block) {
+    encoder_.begin(block);
+    char status[16];
+    snprintf(status, sizeof(status), "%d", static_cast<int>(rsp->getStatus()));
+    encoder_.encode(":status", status, block);
+    const HttpResponse::HeaderMap& headers = rsp->getHeaders();
+    std::string name;
+    if (rsp->getDefaultHeaders()) {
+        rsp->getDefaultHeaders()->forEach([&](const std::string& key, const StringPiece& value) {
+            if (headers.find(key) == headers.end()) {
+                StringPiece lower = ToLower(key, &name);
+                encoder_.encode(lower, value, block, GetIndexing(lower));
+            }
+        });
+    }
+    // "Date: ...\r\n"
+    const StringPiece& date = rsp->getDate();
+    if (date.size() > 8 && headers.find("Date") == headers.end()) {
+        encoder_.encode("date", StringPiece(date.data() + 6, date.size() - 8), block,
+                        HpackEncoder::WITHOUT);
+    }
+    for (auto& kv : headers) {
+        StringPiece lower = ToLower(kv.first, &name);
+        if (IsConnectionHeader(lower) || lower == "content-length") {
+            continue;
+        }
+        encoder_.encode(lower, kv.second, block, GetIndexing(lower));
+    }
+    if (rsp->getStatus() != HttpStatus::NOT_MODIFIED) {
+        char length[32];
+        snprintf(length, sizeof(length), "%zu", rsp->getBody().size());
+        encoder_.encode("content-length", length, block, HpackEncoder::WITHOUT);
+    }
+}
+
+bool Http2Connection::sendResponse(const StreamPtr& stream, HttpResponse* rsp, bool isHead) {
+    std::string block;
+    encodeHeaders(rsp, isHead, &block);
+    const std::string& body = rsp->getBody();
+    bool noBody = isHead || body.empty();
+    // 头部块编码和入队之间不能切换协程，否则动态表的顺序和对端不一致
+    Http2Codec::AppendHeaders(&outBuf_, stream->id, block, noBody, peer_.maxFrameSize);
+    kick();
+    size_t pos = 0;
+    ++senders_;
+    bool ok = true;
+    while (!noBody && pos < body.size()) {
+        if (stream->reset || broken_) {
+            ok = false;
+            break;
+        }
+        int64_t window = std::min(connSendWindow_, stream->sendWindow);
+        if (window <= 0) {
+            // 读协程已经停止，不会再收到 WINDOW_UPDATE
+            if (closing_) {
+                ok = false;
+                break;
+            }
+            blocked_.push_back(stream);
+            wait(&stream->waiter);
+            continue;
+        }
+        if (outBuf_.size() >= options_.maxQueuedBytes) {
+            drainWaiters_.push_back(stream);
+            wait(&stream->waiter);
+            continue;
+        }
+        size_t n = std::min<size_t>(std::min<int64_t>(window, peer_.maxFrameSize),
+                                    body.size() - pos);
+        bool last = pos + n == body.size();
+        Http2Codec::AppendFrame(&outBuf_, Http2FrameType::DATA, last ? H2_END_STREAM : 0,
+                                stream->id, StringPiece(body.data() + pos, n));
+        connSendWindow_ -= n;
+        stream->sendWindow -= n;
+        pos += n;
+        kick();
+        if (senders_ > 1 && pos < body.size()) {
+            // 多个流同时发送时每次只发一帧，排到队尾，避免大响应占满连接窗口
+            worker_->addTask(Coroutine::GetCurCoroutine());
+            Coroutine::YieldToSuspend();
+        }
+    }
+    --senders_;
+    return ok;
+}
+
+void Http2Connection::wait(Coroutine::SPtr* waiter) {
+    // 唤醒任务加在本 worker 的队列上，挂起之前不会被调度，不会丢失唤醒
+    *waiter = Coroutine::GetCurCoroutine();
+    Coroutine::YieldToSuspend();
+}
+
+void Http2Connection::wake(Coroutine::SPtr* waiter) {
+    if (*waiter) {
+        Coroutine::SPtr co;
+        co.swap(*waiter);
+        worker_->addTask(co);
+    }
+}
+
+void Http2Connection::wakeAll() {
+    for (auto& kv : streams_) {
+        wake(&kv.second->waiter);
+    }
+    blocked_.clear();
+    for (auto& stream : drainWaiters_) {
+        wake(&stream->waiter);
+    }
+    drainWaiters_.clear();
+    wake(&reader_);
+    kick();
+}
+
+void Http2Connection::writeLoop() {
+    while (!broken_) {
+        if (outBuf_.empty()) {
+            if (closing_ && tasks_ == 1) {
+                break;
+            }
+            wait(&writer_);
+            continue;
+        }
+        // 换出整个队列一次 writev 发出，期间其他协程继续往新的队列里追加
+        sending_.swap(outBuf_);
+        outBuf_.clear();
+        for (auto& stream : drainWaiters_) {
+            wake(&stream->waiter);
+        }
+        drainWaiters_.clear();
+        wake(&reader_);
+        session_.appendRef(sending_.data(), sending_.size());
+        if (session_.flush() < 0) {
+            broken_ = true;
+            // 读协程可能阻塞在 read 上，关闭连接让它返回
+            ::shutdown(conn_.client->getSockfd(), SHUT_RDWR);
+            wakeAll();
+        }
+    }
+    onTaskDone();
+}
+
+void Http2Connection::onTaskDone() {
+    if (--tasks_ == 0) {
+        wake(&closer_);
+    } else if (closing_) {
+        kick();
+    }
+}
+
+} // namespace reyao
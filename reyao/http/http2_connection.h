@@ -0,0 +1,136 @@
+#pragma once
+
+#include "reyao/http/http2_frame.h"
+#include "reyao/http/http2_hpack.h"
+#include "reyao/http/http_session.h"
+#include "reyao/http/http_request.h"
+#include "reyao/http/http_response.h"
+#include "reyao/coroutine.h"
+#include "reyao/bytearray.h"
+#include "reyao/nocopyable.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reyao {
+
+class HttpServer;
+class Worker;
+
+struct Http2Options {
+    bool enable = false;
+    uint32_t maxConcurrentStreams = 100;
+    int32_t initialWindowSize = 1024 * 1024;            // 每个流的接收窗口
+    int32_t connectionWindowSize = 16 * 1024 * 1024;    // 整个连接的接收窗口
+    size_t maxQueuedBytes = 256 * 1024;                 // 写队列超过后生成响应的流和读协程等待
+    size_t maxBufferedBytes = 16 * 1024 * 1024;         // 连接上所有还没交给 servlet 的请求 body
+};
+
+// 一条 h2c 连接的服务端，在接管连接的协程中读帧：
+// 每个请求收完后在同一个 worker 上开一个协程交给 servlet，多个流的 servlet 并发执行；
+// 响应编码成帧追加到连接共享的写队列，由独立的写协程整块发出，读协程和流的协程都不直接写 socket。
+// DATA 帧受连接和流的发送窗口限制，窗口用完或写队列过长时流的协程挂起，
+// 收到 WINDOW_UPDATE 或队列发出后唤醒；所有状态只在这个 worker 上访问，不需要加锁。
+// servlet 拿到的 HttpResponse 没有绑定连接，不能使用流式响应，session 只能用来获取连接信息；
+// 接管连接的 servlet（WebSocket、SSE）回复 RST_STREAM(HTTP_1_1_REQUIRED)
+class Http2Connection : public NoCopyable {
+public:
+    Http2Connection(HttpServer* server, HttpTakeover& conn, const Http2Options& options);
+
+    // upgrade 不为空时是 "Upgrade: h2c" 的请求，作为 stream 1 处理，
+    // settings 是解码后的 HTTP2-Settings；返回时所有流都已结束，连接已关闭
+    void run(const HttpRequest* upgrade = nullptr, const std::string& settings = "");
+
+private:
+    struct Stream {
+        uint32_t id = 0;
+        HttpRequest req;
+        std::string headers;            // 解码后的头部，req 中的视图指向这里
+        std::string body;
+        bool endStream = false;         // 对端已发完请求
+        bool reset = false;             // 收到或发出了 RST_STREAM，不再发送响应
+        bool running = false;           // 已经交给 servlet，由它的协程删除
+        int64_t sendWindow = 0;
+        int64_t recvWindow = 0;
+        Coroutine::SPtr waiter;         // 等待发送窗口或写队列的协程
+    };
+    typedef std::shared_ptr<Stream> StreamPtr;
+
+    bool readFrame(Http2FrameHeader* header);
+    bool handleFrame(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onHeaders(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onHeaderBlock();
+    bool onData(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onSettings(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onWindowUpdate(const Http2FrameHeader& header, const char* payload, size_t len);
+    bool onRstStream(const Http2FrameHeader& header, const char* payload, size_t len);
+    // 连接错误：发出 GOAWAY，停止读
+    bool goaway(Http2Error error);
+    // 流错误：发出 RST_STREAM，流不再处理
+    void resetStream(const StreamPtr& stream, Http2Error error);
+    // 按伪头部和普通头部构造请求，请求不合法时返回 false
+    bool buildRequest(Stream* stream);
+    void copyRequest(const HttpRequest& from, Stream* stream);
+    // 请求完整后开协程处理
+    void dispatch(const StreamPtr& stream);
+    void runStream(StreamPtr stream);
+    // 立即回复只有头部的响应（错误、限流），不开协程
+    void respondError(const StreamPtr& stream, HttpStatus status);
+    void encodeHeaders(HttpResponse* rsp, bool isHead, std::string* block);
+    bool sendResponse(const StreamPtr& stream, HttpResponse* rsp, bool isHead);
+    // 当前协程挂起直到被 wake 唤醒
+    void wait(Coroutine::SPtr* waiter);
+    void wake(Coroutine::SPtr* waiter);
+    void wakeAll();
+    // 收到的 DATA 用掉一半窗口后发出 WINDOW_UPDATE
+    void replenish(Stream* stream, bool more);
+    // 删除还没交给 servlet 的流
+    void dropStream(const StreamPtr& stream);
+    void releaseBody(Stream* stream);
+
+    // 写队列
+    void kick() { wake(&writer_); }
+    void writeLoop();
+    void onTaskDone();
+
+    HttpServer* server_;
+    HttpTakeover& conn_;
+    Http2Options options_;
+    Worker* worker_;
+    HttpSession session_;
+    ByteArray inBuf_;
+
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    Http2Settings peer_;
+    std::unordered_map<uint32_t, StreamPtr> streams_;
+    uint32_t lastStreamId_ = 0;
+    // 还没收完的头部块（HEADERS 后面跟着 CONTINUATION）
+    uint32_t headerStreamId_ = 0;
+    bool headerEndStream_ = false;
+    std::string headerBlock_;
+    std::vector<std::pair<size_t, size_t>> fields_;
+    size_t maxHeaderList_;                  // 解码后头部列表的上限
+
+    int64_t connSendWindow_ = Http2Codec::kDefaultWindowSize;
+    int64_t connRecvWindow_ = 0;
+    std::vector<StreamPtr> blocked_;        // 等待发送窗口的流
+    size_t bufferedBytes_ = 0;              // 所有流缓存的请求 body
+    size_t senders_ = 0;                    // 正在发送 DATA 的流
+
+    std::string outBuf_;
+    std::string sending_;
+    Coroutine::SPtr writer_;                // 写协程空闲时在这里等待
+    Coroutine::SPtr reader_;                // 写队列过长时读协程在这里等待
+    std::vector<StreamPtr> drainWaiters_;  // 等待写队列发出的流
+    Coroutine::SPtr closer_;                // run 在这里等待所有协程结束
+    size_t tasks_ = 0;                      // 流的协程和写协程
+    bool closing_ = false;                  // 不再读帧
+    bool broken_ = false;                   // 写失败，连接不可用
+};
+
+} // namespace reyao
@@ -0,0 +1,161 @@
+#include "reyao/http/http2_frame.h"
+
+#include <algorithm>
+
+namespace reyao {
+
+const char Http2Codec::kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+uint32_t Http2Codec::ReadUint32(const char* p) {
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+    return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | u[3];
+}
+
+static void WriteUint32(char* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+void Http2Codec::ParseHeader(const char* data, Http2FrameHeader* header) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    header->length = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    header->type = static_cast<Http2FrameType>(p[3]);
+    header->flags = p[4];
+    // 最高位保留
+    header->streamId = ReadUint32(data + 5) & 0x7fffffff;
+}
+
+void Http2Codec::EncodeHeader(char* buf, uint32_t length, Http2FrameType type,
+                              uint8_t flags, uint32_t streamId) {
+    buf[0] = length >> 16;
+    buf[1] = length >> 8;
+    buf[2] = length;
+    buf[3] = static_cast<uint8_t>(type);
+    buf[4] = flags;
+    WriteUint32(buf + 5, streamId);
+}
+
+void Http2Codec::AppendFrame(std::string* out, Http2FrameType type, uint8_t flags,
+                             uint32_t streamId, const StringPiece& payload) {
+    size_t pos = out->size();
+    out->resize(pos + kFrameHeaderSize);
+    EncodeHeader(&(*out)[pos], payload.size(), type, flags, streamId);
+    out->append(payload.data(), payload.size());
+}
+
+void Http2Codec::AppendHeaders(std::string* out, uint32_t streamId, const StringPiece& block,
+                               bool endStream, uint32_t maxFrameSize) {
+    size_t len = std::min<size_t>(block.size(), maxFrameSize);
+    uint8_t flags = endStream ? H2_END_STREAM : 0;
+    if (len == block.size()) {
+        flags |= H2_END_HEADERS;
+    }
+    AppendFrame(out, Http2FrameType::HEADERS, flags, streamId, StringPiece(block.data(), len));
+    // CONTINUATION 必须紧跟在 HEADERS 后面，调用方一次性放进发送队列
+    for (size_t pos = len; pos < block.size(); pos += len) {
+        len = std::min<size_t>(block.size() - pos, maxFrameSize);
+        AppendFrame(out, Http2FrameType::CONTINUATION,
+                    pos + len == block.size() ? H2_END_HEADERS : 0, streamId,
+                    StringPiece(block.data() + pos, len));
+    }
+}
+
+void Http2Codec::AppendSetting(std::string* payload, Http2SettingId id, uint32_t value) {
+    char buf[6];
+    buf[0] = id >> 8;
+    buf[1] = id;
+    WriteUint32(buf + 2, value);
+    payload->append(buf, sizeof(buf));
+}
+
+void Http2Codec::AppendWindowUpdate(std::string* out, uint32_t streamId, uint32_t increment) {
+    char buf[4];
+    WriteUint32(buf, increment);
+    AppendFrame(out, Http2FrameType::WINDOW_UPDATE, 0, streamId, StringPiece(buf, 4));
+}
+
+void Http2Codec::AppendRstStream(std::string* out, uint32_t streamId, Http2Error error) {
+    char buf[4];
+    WriteUint32(buf, static_cast<uint32_t>(error));
+    AppendFrame(out, Http2FrameType::RST_STREAM, 0, streamId, StringPiece(buf, 4));
+}
+
+void Http2Codec::AppendGoaway(std::string* out, uint32_t lastStreamId, Http2Error error) {
+    char buf[8];
+    WriteUint32(buf, lastStreamId);
+    WriteUint32(buf + 4, static_cast<uint32_t>(error));
+    AppendFrame(out, Http2FrameType::GOAWAY, 0, 0, StringPiece(buf, 8));
+}
+
+Http2Error Http2Codec::ApplySettings(const char* data, size_t len, Http2Settings* settings) {
+    if (len % 6 != 0) {
+        return Http2Error::FRAME_SIZE_ERROR;
+    }
+    for (size_t pos = 0; pos < len; pos += 6) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data + pos);
+        uint16_t id = (uint16_t)p[0] << 8 | p[1];
+        uint32_t value = ReadUint32(data + pos + 2);
+        switch (id) {
+            case H2_SETTINGS_HEADER_TABLE_SIZE:
+                settings->headerTableSize = value;
+                break;
+            case H2_SETTINGS_ENABLE_PUSH:
+                if (value > 1) {
+                    return Http2Error::PROTOCOL_ERROR;
+                }
+                settings->enablePush = value;
+                break;
+            case H2_SETTINGS_MAX_CONCURRENT_STREAMS:
+                settings->maxConcurrentStreams = value;
+                break;
+            case H2_SETTINGS_INITIAL_WINDOW_SIZE:
+                if (value > (uint32_t)kMaxWindowSize) {
+                    return Http2Error::FLOW_CONTROL_ERROR;
+                }
+                settings->initialWindowSize = value;
+                break;
+            case H2_SETTINGS_MAX_FRAME_SIZE:
+                if (value < 16384 || value > 16777215) {
+                    return Http2Error::PROTOCOL_ERROR;
+                }
+                settings->maxFrameSize = value;
+                break;
+            case H2_SETTINGS_MAX_HEADER_LIST_SIZE:
+                settings->maxHeaderListSize = value;
+                break;
+            default:
+                break;
+        }
+    }
+    return Http2Error::NO_ERROR;
+}
+
+bool Http2Codec::StripPadding(const Http2FrameHeader& header, const char** data,
+                              size_t* len) {
+    size_t padding = 0;
+    if (header.flags & H2_PADDED) {
+        if (*len < 1) {
+            return false;
+        }
+        padding = (uint8_t)(*data)[0];
+        ++*data;
+        --*len;
+    }
+    if (header.type == Http2FrameType::HEADERS && (header.flags & H2_PRIORITY)) {
+        // 依赖的流和权重，不支持优先级，直接跳过
+        if (*len < 5) {
+            return false;
+        }
+        *data += 5;
+        *len -= 5;
+    }
+    if (padding > *len) {
+        return false;
+    }
+    *len -= padding;
+    return true;
+}
+
+} // namespace reyao
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "reyao/stringpiece.h"
+
+#include <stdint.h>
+
+#include <string>
+
+namespace reyao {
+
+enum class Http2FrameType : uint8_t {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9,
+};
+
+// 不同帧类型的标志位含义不同，同值的 END_STREAM 和 ACK 分别用于数据帧和控制帧
+enum Http2Flag : uint8_t {
+    H2_END_STREAM = 0x1,
+    H2_ACK = 0x1,
+    H2_END_HEADERS = 0x4,
+    H2_PADDED = 0x8,
+    H2_PRIORITY = 0x20,
+};
+
+enum class Http2Error : uint32_t {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    INTERNAL_ERROR = 0x2,
+    FLOW_CONTROL_ERROR = 0x3,
+    SETTINGS_TIMEOUT = 0x4,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    CANCEL = 0x8,
+    COMPRESSION_ERROR = 0x9,
+    CONNECT_ERROR = 0xa,
+    ENHANCE_YOUR_CALM = 0xb,
+    INADEQUATE_SECURITY = 0xc,
+    HTTP_1_1_REQUIRED = 0xd,
+};
+
+enum Http2SettingId : uint16_t {
+    H2_SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    H2_SETTINGS_ENABLE_PUSH = 0x2,
+    H2_SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    H2_SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    H2_SETTINGS_MAX_FRAME_SIZE = 0x5,
+    H2_SETTINGS_MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+struct Http2FrameHeader {
+    uint32_t length = 0;
+    Http2FrameType type = Http2FrameType::DATA;
+    uint8_t flags = 0;
+    uint32_t streamId = 0;
+};
+
+// 未收到对端 SETTINGS 之前使用协议默认值
+struct Http2Settings {
+    uint32_t headerTableSize = 4096;
+    uint32_t enablePush = 1;
+    uint32_t maxConcurrentStreams = UINT32_MAX;
+    uint32_t initialWindowSize = 65535;
+    uint32_t maxFrameSize = 16384;
+    uint32_t maxHeaderListSize = UINT32_MAX;
+};
+
+// RFC 7540 的帧编解码，与连接无关
+class Http2Codec {
+public:
+    static const size_t kFrameHeaderSize = 9;
+    static const int32_t kDefaultWindowSize = 65535;
+    static const int32_t kMaxWindowSize = 0x7fffffff;
+    // 客户端连接前言
+    static const char kPreface[];
+    static const size_t kPrefaceSize = 24;
+
+    static void ParseHeader(const char* data, Http2FrameHeader* header);
+    static void EncodeHeader(char* buf, uint32_t length, Http2FrameType type,
+                             uint8_t flags, uint32_t streamId);
+    // 在 out 后面追加一个完整的帧
+    static void AppendFrame(std::string* out, Http2FrameType type, uint8_t flags,
+                            uint32_t streamId, const StringPiece& payload);
+    // 头部块超过 maxFrameSize 时拆成 HEADERS 和若干 CONTINUATION
+    static void AppendHeaders(std::string* out, uint32_t streamId, const StringPiece& block,
+                              bool endStream, uint32_t maxFrameSize);
+    static void AppendSetting(std::string* payload, Http2SettingId id, uint32_t value);
+    static void AppendWindowUpdate(std::string* out, uint32_t streamId, uint32_t increment);
+    static void AppendRstStream(std::string* out, uint32_t streamId, Http2Error error);
+    static void AppendGoaway(std::string* out, uint32_t lastStreamId, Http2Error error);
+    // 按 SETTINGS payload 更新 settings，未知的参数忽略，取值非法时返回对应的错误码
+    static Http2Error ApplySettings(const char* data, size_t len, Http2Settings* settings);
+    // 去掉 PADDED 的填充和 HEADERS 的优先级字段，返回 false 表示填充长度不合法
+    static bool StripPadding(const Http2FrameHeader& header, const char** data,
+                             size_t* len);
+    static uint32_t ReadUint32(const char* p);
+};
+
+} // namespace reyao
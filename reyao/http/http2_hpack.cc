@@ -0,0 +1,553 @@
+#include "reyao/http/http2_hpack.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace reyao {
+
+struct HuffmanSym {
+    uint32_t code;
+    uint8_t len;
+};
+
+// RFC 7541 附录 B
+static const HuffmanSym kHuffmanTable[Hpack::kHuffmanSymbols] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+static const int kMaxCodeLen = 30;
+
+// 解码用的表：码长不超过 8 位的符号按高 8 位直接查，
+// 更长的码按规范 Huffman 码的性质，同一码长的码是连续的，按码长比较区间
+struct HuffmanDecodeTable {
+    struct Short {
+        uint16_t sym;
+        uint8_t len;            // 0 表示需要更多的位
+    };
+    Short shortCodes[256];
+    uint32_t first[kMaxCodeLen + 1];
+    uint32_t count[kMaxCodeLen + 1];
+    uint16_t offset[kMaxCodeLen + 1];
+    uint16_t syms[Hpack::kHuffmanSymbols];
+
+    HuffmanDecodeTable() {
+        memset(shortCodes, 0, sizeof(shortCodes));
+        memset(count, 0, sizeof(count));
+        memset(first, 0, sizeof(first));
+        for (int sym = 0; sym < Hpack::kHuffmanSymbols; sym++) {
+            const HuffmanSym& h = kHuffmanTable[sym];
+            count[h.len]++;
+            if (h.len <= 8) {
+                uint32_t begin = h.code << (8 - h.len);
+                for (uint32_t i = 0; i < (1u << (8 - h.len)); i++) {
+                    shortCodes[begin + i].sym = sym;
+                    shortCodes[begin + i].len = h.len;
+                }
+            }
+        }
+        uint16_t pos = 0;
+        for (int len = 1; len <= kMaxCodeLen; len++) {
+            offset[len] = pos;
+            pos += count[len];
+        }
+        uint16_t fill[kMaxCodeLen + 1];
+        memcpy(fill, offset, sizeof(fill));
+        for (int sym = 0; sym < Hpack::kHuffmanSymbols; sym++) {
+            const HuffmanSym& h = kHuffmanTable[sym];
+            if (fill[h.len] == offset[h.len]) {
+                first[h.len] = h.code;
+            }
+            syms[fill[h.len]++] = sym;
+        }
+    }
+};
+
+static const HuffmanDecodeTable& GetDecodeTable() {
+    static const HuffmanDecodeTable table;
+    return table;
+}
+
+void Hpack::EncodeInteger(uint64_t value, int prefix, uint8_t flags, std::string* out) {
+    uint64_t max = (1u << prefix) - 1;
+    if (value < max) {
+        out->push_back((char)(flags | value));
+        return;
+    }
+    out->push_back((char)(flags | max));
+    value -= max;
+    while (value >= 0x80) {
+        out->push_back((char)(0x80 | (value & 0x7F)));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+bool Hpack::DecodeInteger(const uint8_t** p, const uint8_t* end, int prefix,
+                          uint64_t* value) {
+    const uint8_t* cur = *p;
+    if (cur == end) {
+        return false;
+    }
+    uint64_t max = (1u << prefix) - 1;
+    uint64_t v = *cur++ & max;
+    if (v == max) {
+        int shift = 0;
+        while (true) {
+            if (cur == end || shift > 28) {
+                return false;
+            }
+            uint8_t b = *cur++;
+            v += (uint64_t)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80)) {
+                break;
+            }
+        }
+        if (v > UINT32_MAX) {
+            return false;
+        }
+    }
+    *p = cur;
+    *value = v;
+    return true;
+}
+
+void Hpack::EncodeString(const StringPiece& str, std::string* out) {
+    size_t huffman = HuffmanSize(str);
+    if (huffman < str.size()) {
+        EncodeInteger(huffman, 7, 0x80, out);
+        HuffmanEncode(str, out);
+    } else {
+        EncodeInteger(str.size(), 7, 0, out);
+        out->append(str.data(), str.size());
+    }
+}
+
+size_t Hpack::HuffmanSize(const StringPiece& str) {
+    size_t bits = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        bits += kHuffmanTable[(uint8_t)str[i]].len;
+    }
+    return (bits + 7) / 8;
+}
+
+void Hpack::HuffmanEncode(const StringPiece& str, std::string* out) {
+    size_t pos = out->size();
+    out->resize(pos + HuffmanSize(str));
+    char* p = &(*out)[pos];
+    // 码长最多 30 位，累积不超过 37 位，放在 64 位里足够
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        const HuffmanSym& h = kHuffmanTable[(uint8_t)str[i]];
+        acc = acc << h.len | h.code;
+        bits += h.len;
+        while (bits >= 8) {
+            bits -= 8;
+            *p++ = (char)(acc >> bits);
+        }
+    }
+    if (bits > 0) {
+        // 用 EOS 的高位（全 1）填充
+        *p++ = (char)(acc << (8 - bits) | (0xFF >> bits));
+    }
+}
+
+bool Hpack::HuffmanDecode(const uint8_t* data, size_t len, std::string* out) {
+    const HuffmanDecodeTable& table = GetDecodeTable();
+    const uint8_t* end = data + len;
+    // 未消费的位放在 acc 的高位
+    uint64_t acc = 0;
+    int bits = 0;
+    while (true) {
+        while (bits <= 56 && data < end) {
+            acc |= (uint64_t)*data++ << (56 - bits);
+            bits += 8;
+        }
+        if (bits == 0) {
+            return true;
+        }
+        const HuffmanDecodeTable::Short& s = table.shortCodes[acc >> 56];
+        int codeLen = 0;
+        uint16_t sym = 0;
+        if (s.len != 0 && s.len <= bits) {
+            codeLen = s.len;
+            sym = s.sym;
+        } else {
+            for (int l = 9; l <= kMaxCodeLen && l <= bits; l++) {
+                uint32_t code = acc >> (64 - l);
+                if (code - table.first[l] < table.count[l]) {
+                    codeLen = l;
+                    sym = table.syms[table.offset[l] + code - table.first[l]];
+                    break;
+                }
+            }
+        }
+        if (codeLen == 0) {
+            // 剩下的位不足一个码，只能是不超过 7 位的全 1 填充
+            return data == end && bits < 8 && (acc >> (64 - bits)) == (1u << bits) - 1;
+        }
+        if (sym == 256) {
+            return false;
+        }
+        out->push_back((char)sym);
+        acc <<= codeLen;
+        bits -= codeLen;
+    }
+}
+
+uint32_t Hpack::HuffmanCode(int sym) {
+    return kHuffmanTable[sym].code;
+}
+
+uint8_t Hpack::HuffmanLength(int sym) {
+    return kHuffmanTable[sym].len;
+}
+
+struct StaticEntry {
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 附录 A
+static const StaticEntry kStaticTable[HpackTable::kStaticCount] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+bool HpackTable::get(size_t index, StringPiece* name, StringPiece* value) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= kStaticCount) {
+        *name = kStaticTable[index - 1].name;
+        *value = kStaticTable[index - 1].value;
+        return true;
+    }
+    index -= kStaticCount + 1;
+    if (index >= entries_.size()) {
+        return false;
+    }
+    *name = entries_[index].name;
+    *value = entries_[index].value;
+    return true;
+}
+
+void HpackTable::add(const StringPiece& name, const StringPiece& value) {
+    size_t size = name.size() + value.size() + kEntryOverhead;
+    if (size > maxSize_) {
+        // 比整个表还大的条目使表清空，本身也不加入
+        evict(0);
+        return;
+    }
+    // name 可能引用即将被淘汰的条目，先拷贝
+    Entry entry{name.toString(), value.toString()};
+    evict(maxSize_ - size);
+    entries_.push_front(std::move(entry));
+    size_ += size;
+}
+
+size_t HpackTable::find(const StringPiece& name, const StringPiece& value,
+                        bool* exact) const {
+    size_t nameIndex = 0;
+    for (size_t i = 0; i < kStaticCount; i++) {
+        if (name == kStaticTable[i].name) {
+            if (value == kStaticTable[i].value) {
+                *exact = true;
+                return i + 1;
+            }
+            if (nameIndex == 0) {
+                nameIndex = i + 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (name == entries_[i].name) {
+            if (value == entries_[i].value) {
+                *exact = true;
+                return i + kStaticCount + 1;
+            }
+            if (nameIndex == 0) {
+                nameIndex = i + kStaticCount + 1;
+            }
+        }
+    }
+    *exact = false;
+    return nameIndex;
+}
+
+void HpackTable::setMaxSize(size_t size) {
+    maxSize_ = size;
+    evict(size);
+}
+
+void HpackTable::evict(size_t limit) {
+    while (size_ > limit) {
+        const Entry& entry = entries_.back();
+        size_ -= entry.name.size() + entry.value.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+HpackDecoder::HpackDecoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      maxTableSize_(maxTableSize) {
+}
+
+bool HpackDecoder::readString(const uint8_t** p, const uint8_t* end, std::string* out) {
+    if (*p == end) {
+        return false;
+    }
+    bool huffman = **p & 0x80;
+    uint64_t len;
+    if (!Hpack::DecodeInteger(p, end, 7, &len) || len > (uint64_t)(end - *p)) {
+        return false;
+    }
+    out->clear();
+    if (huffman) {
+        if (!Hpack::HuffmanDecode(*p, len, out)) {
+            return false;
+        }
+    } else {
+        out->assign(reinterpret_cast<const char*>(*p), len);
+    }
+    *p += len;
+    return true;
+}
+
+bool HpackDecoder::decode(const char* data, size_t len, const Emit& emit,
+                          size_t maxListSize) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = p + len;
+    bool fieldSeen = false;
+    size_t listSize = 0;
+    auto exceed = [&](const StringPiece& name, const StringPiece& value) {
+        listSize += name.size() + value.size() + HpackTable::kEntryOverhead;
+        return maxListSize && listSize > maxListSize;
+    };
+    while (p < end) {
+        uint8_t b = *p;
+        uint64_t index;
+        StringPiece name, value;
+        if (b & 0x80) {
+            // 索引字段
+            if (!Hpack::DecodeInteger(&p, end, 7, &index) ||
+                !table_.get(index, &name, &value) || exceed(name, value)) {
+                return false;
+            }
+            emit(name, value);
+            fieldSeen = true;
+            continue;
+        }
+        if ((b & 0xE0) == 0x20) {
+            // 表大小更新只能出现在头部块开头
+            if (fieldSeen || !Hpack::DecodeInteger(&p, end, 5, &index) ||
+                index > maxTableSize_) {
+                return false;
+            }
+            table_.setMaxSize(index);
+            continue;
+        }
+        bool incremental = b & 0x40;
+        if (!Hpack::DecodeInteger(&p, end, incremental ? 6 : 4, &index)) {
+            return false;
+        }
+        if (index == 0) {
+            if (!readString(&p, end, &name_)) {
+                return false;
+            }
+            name = name_;
+        } else if (!table_.get(index, &name, &value)) {
+            return false;
+        }
+        if (!readString(&p, end, &value_) || exceed(name, value_)) {
+            return false;
+        }
+        emit(name, value_);
+        if (incremental) {
+            table_.add(name, value_);
+        }
+        fieldSeen = true;
+    }
+    return true;
+}
+
+HpackEncoder::HpackEncoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      limit_(maxTableSize),
+      pendingMin_(maxTableSize) {
+}
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+    size = std::min(size, limit_);
+    // 每个 SETTINGS 都会调用，大小没变时不需要发出更新
+    if (!pending_ && size == table_.getMaxSize()) {
+        return;
+    }
+    if (!pending_) {
+        pendingMin_ = size;
+    } else {
+        pendingMin_ = std::min(pendingMin_, size);
+    }
+    pending_ = true;
+    table_.setMaxSize(size);
+}
+
+void HpackEncoder::begin(std::string* out) {
+    if (!pending_) {
+        return;
+    }
+    if (pendingMin_ < table_.getMaxSize()) {
+        Hpack::EncodeInteger(pendingMin_, 5, 0x20, out);
+    }
+    Hpack::EncodeInteger(table_.getMaxSize(), 5, 0x20, out);
+    pending_ = false;
+}
+
+void HpackEncoder::encode(const StringPiece& name, const StringPiece& value,
+                          std::string* out, Indexing indexing) {
+    bool exact;
+    size_t index = table_.find(name, value, &exact);
+    if (exact) {
+        Hpack::EncodeInteger(index, 7, 0x80, out);
+        return;
+    }
+    if (indexing == INCREMENTAL) {
+        Hpack::EncodeInteger(index, 6, 0x40, out);
+    } else {
+        Hpack::EncodeInteger(index, 4, indexing == NEVER ? 0x10 : 0, out);
+    }
+    if (index == 0) {
+        Hpack::EncodeString(name, out);
+    }
+    Hpack::EncodeString(value, out);
+    if (indexing == INCREMENTAL) {
+        table_.add(name, value);
+    }
+}
+
+} // namespace reyao
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "reyao/stringpiece.h"
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+namespace reyao {
+
+// RFC 7541 的基本编码：前缀整数、字符串字面量和静态 Huffman 码表
+class Hpack {
+public:
+    static const int kHuffmanSymbols = 257;     // 最后一项是 EOS
+
+    // flags 是第一个字节中前缀之外的高位
+    static void EncodeInteger(uint64_t value, int prefix, uint8_t flags, std::string* out);
+    // 数据不完整或超过 32 位时返回 false
+    static bool DecodeInteger(const uint8_t** p, const uint8_t* end, int prefix,
+                              uint64_t* value);
+    // Huffman 编码更短时使用 Huffman
+    static void EncodeString(const StringPiece& str, std::string* out);
+
+    static size_t HuffmanSize(const StringPiece& str);
+    static void HuffmanEncode(const StringPiece& str, std::string* out);
+    // 码长不超过 8 位的符号查表，其余按码长逐个比较（码表是规范 Huffman 码）；
+    // 解出 EOS 或结尾填充超过 7 位、不全是 1 时返回 false
+    static bool HuffmanDecode(const uint8_t* data, size_t len, std::string* out);
+    static uint32_t HuffmanCode(int sym);
+    static uint8_t HuffmanLength(int sym);
+};
+
+// 静态表加动态表，下标从 1 开始，1~61 是静态表，之后是动态表（最新加入的在前）；
+// 条目大小按 RFC 计为 name + value + 32，超过 maxSize 时从最旧的开始淘汰
+class HpackTable {
+public:
+    static const size_t kStaticCount = 61;
+    static const size_t kEntryOverhead = 32;
+
+    explicit HpackTable(size_t maxSize = 4096) : maxSize_(maxSize) {}
+
+    // 下标不存在时返回 false，视图在下一次 add 之前有效
+    bool get(size_t index, StringPiece* name, StringPiece* value) const;
+    void add(const StringPiece& name, const StringPiece& value);
+    // 返回完全匹配的下标（exact 为 true），否则返回名字匹配的下标，都没有时返回 0
+    size_t find(const StringPiece& name, const StringPiece& value, bool* exact) const;
+
+    void setMaxSize(size_t size);
+    size_t getMaxSize() const { return maxSize_; }
+    size_t getSize() const { return size_; }
+    size_t getCount() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+
+    void evict(size_t limit);
+
+    std::deque<Entry> entries_;
+    size_t size_ = 0;
+    size_t maxSize_;
+};
+
+class HpackDecoder {
+public:
+    // 视图只在回调期间有效
+    typedef std::function<void(const StringPiece& name, const StringPiece& value)> Emit;
+
+    // maxTableSize 是本端 SETTINGS_HEADER_TABLE_SIZE，对端的表大小更新不能超过它
+    explicit HpackDecoder(size_t maxTableSize = 4096);
+
+    // 解码一个完整的头部块，字段按顺序交给 emit；
+    // 格式错误时返回 false，对应连接错误 COMPRESSION_ERROR，之后不能再使用。
+    // maxListSize 不为 0 时，展开后的头部（按 name + value + 32 计）超过它就停止解码并返回 false：
+    // 一个字节的索引可以引用动态表中很长的条目，不限制时很小的头部块能展开成任意大
+    bool decode(const char* data, size_t len, const Emit& emit, size_t maxListSize = 0);
+    const HpackTable& getTable() const { return table_; }
+
+private:
+    bool readString(const uint8_t** p, const uint8_t* end, std::string* out);
+
+    HpackTable table_;
+    size_t maxTableSize_;
+    std::string name_;
+    std::string value_;
+};
+
+class HpackEncoder {
+public:
+    enum Indexing {
+        INCREMENTAL,        // 加入动态表
+        WITHOUT,            // 不加入动态表，如每次都不同的 content-length
+        NEVER               // 中间节点也不能加入，用于敏感字段
+    };
+
+    explicit HpackEncoder(size_t maxTableSize = 4096);
+
+    // 对端 SETTINGS_HEADER_TABLE_SIZE 变化时调用，不超过构造时的大小；
+    // 更新在下一个头部块开头发出
+    void setMaxTableSize(size_t size);
+    // 每个头部块开始时调用，输出待发送的表大小更新
+    void begin(std::string* out);
+    // name 必须是小写
+    void encode(const StringPiece& name, const StringPiece& value, std::string* out,
+                Indexing indexing = INCREMENTAL);
+    const HpackTable& getTable() const { return table_; }
+
+private:
+    HpackTable table_;
+    size_t limit_;
+    // 两个头部块之间表大小可能先变小再变大，要先发出最小值
+    size_t pendingMin_;
+    bool pending_ = false;
+};
+
+} // namespace reyao
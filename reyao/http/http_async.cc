@@ -0,0 +1,121 @@
+#include "reyao/http/http_async.h"
+#include "reyao/worker.h"
+#include "reyao/log.h"
+
+namespace reyao {
+
+AsyncResponse::AsyncResponse(uint8_t version, bool keepAlive)
+    : rsp_(version, keepAlive) {
+}
+
+AsyncResponse::~AsyncResponse() {
+    // 还有 DETACHED 状态说明 servlet 丢掉了句柄，连接只能关闭
+    if (state_ == DETACHED && abandon_) {
+        LOG_WARN << "async response released without complete";
+        worker_->addTask(abandon_);
+    }
+}
+
+bool AsyncResponse::complete() {
+    int state = state_;
+    while (true) {
+        switch (state) {
+            case RUNNING:
+                if (state_.compare_exchange_weak(state, COMPLETED)) {
+                    return true;
+                }
+                break;
+            case WAITING:
+                if (state_.compare_exchange_weak(state, COMPLETED)) {
+                    if (latch_) {
+                        latch_->countDown();
+                    } else {
+                        worker_->addTask(co_);
+                    }
+                    return true;
+                }
+                break;
+            case DETACHED:
+                if (state_.compare_exchange_weak(state, COMPLETED)) {
+                    worker_->addTask(std::bind(resume_, shared_from_this()));
+                    return true;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+}
+
+void AsyncResponse::wait() {
+    Worker* worker = Worker::GetWorker();
+    if (!worker) {
+        // latch 在进入 WAITING 之前创建，complete 看到 WAITING 时一定能看到它
+        latch_.reset(new CountDownLatch(1));
+        int state = RUNNING;
+        if (state_.compare_exchange_strong(state, WAITING)) {
+            latch_->wait();
+        }
+        return;
+    }
+    worker_ = worker;
+    co_ = Coroutine::GetCurCoroutine();
+    int state = RUNNING;
+    if (state_.compare_exchange_strong(state, WAITING)) {
+        // 唤醒任务加在本 worker 的队列上，挂起之前不会被调度
+        Coroutine::YieldToSuspend();
+    }
+    co_.reset();
+}
+
+bool AsyncResponse::detach(Worker* worker, ResumeFunc resume, std::function<void()> abandon) {
+    worker_ = worker;
+    resume_ = resume;
+    abandon_ = abandon;
+    int state = RUNNING;
+    return state_.compare_exchange_strong(state, DETACHED);
+}
+
+bool AsyncResponse::close() {
+    int state = DETACHED;
+    return state_.compare_exchange_strong(state, CLOSED);
+}
+
+AsyncServlet::AsyncServlet(const std::string& name)
+    : Servlet(name) {
+    async_ = true;
+}
+
+int32_t AsyncServlet::handle(const HttpRequest& req,
+                             HttpResponse* rsp,
+                             const HttpSession& session) {
+    AsyncResponse::SPtr async(new AsyncResponse(rsp->getVersion(), rsp->isKeepAlive()));
+    HttpResponse* out = async->getResponse();
+    out->setDefaultHeaders(rsp->getDefaultHeaders());
+    out->setDate(rsp->getDate());
+    handleAsync(req, async);
+    async->wait();
+    // 等待期间可能过了很久，Date 按完成的时间重新取
+    if (!rsp->getDate().empty()) {
+        rsp->setDate(HttpResponse::DateHeader());
+    }
+    rsp->setStatus(out->getStatus());
+    rsp->setReason(out->getReason());
+    rsp->setHeaders(out->getHeaders());
+    rsp->setBody(out->getBody());
+    if (!out->isKeepAlive()) {
+        rsp->setKeepAlive(false);
+    }
+    return 0;
+}
+
+FunctionAsyncServlet::FunctionAsyncServlet(CallBackFunc func)
+    : AsyncServlet("FunctionAsyncServlet"),
+      func_(func) {
+}
+
+void FunctionAsyncServlet::handleAsync(const HttpRequest& req, AsyncResponse::SPtr rsp) {
+    func_(req, rsp);
+}
+
+} // namespace reyao
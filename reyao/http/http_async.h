@@ -0,0 +1,91 @@
+#pragma once
+
+#include "reyao/http/http_servlet.h"
+#include "reyao/coroutine.h"
+#include "reyao/mutex.h"
+#include "reyao/nocopyable.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace reyao {
+
+class Worker;
+class HttpServer;
+
+// 异步响应的句柄：servlet 保存下来，等事件到达后在任意线程填好响应并调用 complete。
+// 由 HttpServer 分发时，handleAsync 返回后连接脱离协程，只保留这个句柄和 epoll 上的
+// 关闭检测，complete 之后回到连接所在的 worker 上新建协程发送响应并继续处理连接
+class AsyncResponse : public NoCopyable,
+                      public std::enable_shared_from_this<AsyncResponse> {
+public:
+    typedef std::shared_ptr<AsyncResponse> SPtr;
+    ~AsyncResponse();
+
+    // 没有绑定连接，不能使用流式响应；complete 之后不能再访问
+    HttpResponse* getResponse() { return &rsp_; }
+    // 只能调用一次，连接已经关闭或已经完成时返回 false
+    bool complete();
+    // 客户端在等待期间关闭了连接，fan-out 的 servlet 可以据此清理订阅者
+    bool isClosed() const { return state_ == CLOSED; }
+    bool isCompleted() const { return state_ == COMPLETED; }
+
+private:
+    friend class AsyncServlet;
+    friend class HttpServer;
+
+    enum State {
+        RUNNING,        // handleAsync 还没返回
+        WAITING,        // 在协程中等待
+        DETACHED,       // 连接已经脱离协程
+        COMPLETED,
+        CLOSED,
+    };
+    typedef std::function<void(const SPtr&)> ResumeFunc;
+
+    AsyncResponse(uint8_t version, bool keepAlive);
+
+    // 挂起当前协程直到 complete，不在 worker 线程中时阻塞在 latch 上
+    void wait();
+    // 之后 complete 在 worker 上调用 resume；handle 没有 complete 就被释放时调用 abandon。
+    // 已经完成时返回 false
+    bool detach(Worker* worker, ResumeFunc resume, std::function<void()> abandon);
+    // 连接关闭，只有 DETACHED 状态下成功
+    bool close();
+
+    std::atomic<int> state_{RUNNING};
+    HttpResponse rsp_;
+    Worker* worker_ = nullptr;
+    Coroutine::SPtr co_;
+    std::unique_ptr<CountDownLatch> latch_;
+    ResumeFunc resume_;
+    std::function<void()> abandon_;
+};
+
+// 异步 servlet：HttpServer 调用 handleAsync，servlet 保存 AsyncResponse 后立即返回
+class AsyncServlet : public Servlet {
+public:
+    typedef std::shared_ptr<AsyncServlet> SPtr;
+    AsyncServlet(const std::string& name);
+
+    virtual void handleAsync(const HttpRequest& req, AsyncResponse::SPtr rsp) = 0;
+    // 被其他 servlet 包装（不经过 HttpServer 分发）时在当前协程中等待完成
+    virtual int32_t handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) override;
+};
+
+class FunctionAsyncServlet : public AsyncServlet {
+public:
+    typedef std::shared_ptr<FunctionAsyncServlet> SPtr;
+    typedef std::function<void(const HttpRequest&, AsyncResponse::SPtr)> CallBackFunc;
+
+    FunctionAsyncServlet(CallBackFunc func);
+    virtual void handleAsync(const HttpRequest& req, AsyncResponse::SPtr rsp) override;
+
+private:
+    CallBackFunc func_;
+};
+
+} // namespace reyao
@@ -0,0 +1,226 @@
+#include "reyao/http/http_cache_servlet.h"
+#include "reyao/worker.h"
+#include "reyao/util.h"
+
+#include <functional>
+
+namespace reyao {
+
+static const char kClose[] = "Connection: Close\r\n";
+
+CachingServlet::CachingServlet(Servlet::SPtr inner)
+    : CachingServlet(inner, Options()) {
+}
+
+CachingServlet::CachingServlet(Servlet::SPtr inner, const Options& options)
+    : Servlet("CachingServlet"),
+      inner_(inner),
+      options_(options) {
+    if (options_.shards == 0) {
+        options_.shards = 1;
+    }
+    shards_.reset(new Shard[options_.shards]);
+    maxShardBytes_ = options_.maxBytes / options_.shards;
+    streamBody_ = inner_->isStreamBody();
+}
+
+int32_t CachingServlet::handle(const HttpRequest& req,
+                               HttpResponse* rsp,
+                               const HttpSession& session) {
+    // 缓存的是编码好的 HTTP/1.1 响应，没有绑定连接（如 HTTP/2 的流）时不经过缓存
+    if (req.getMethod() != HttpMethod::GET || !rsp->isBound()) {
+        return inner_->handle(req, rsp, session);
+    }
+    const std::string key = makeKey(req);
+    Shard& shard = shards_[std::hash<std::string>()(key) % options_.shards];
+    Worker* worker = Worker::GetWorker();
+    int64_t now = GetCurrentMs();
+    EntryPtr entry;
+    PendingPtr pending;
+    bool leader = false;
+    {
+        MutexGuard lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            if (it->second->second->expire > now) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                entry = it->second->second;
+            } else {
+                erase(&shard, it->second);
+            }
+        }
+        if (!entry) {
+            auto p = shard.pending.find(key);
+            if (p == shard.pending.end()) {
+                pending.reset(new Pending);
+                shard.pending[key] = pending;
+                leader = true;
+            } else if (worker) {
+                pending = p->second;
+                pending->waiters.push_back(std::make_pair(worker, Coroutine::GetCurCoroutine()));
+            }
+        }
+    }
+    if (entry) {
+        ++hits_;
+        Send(*entry, rsp);
+        return 0;
+    }
+    if (pending && !leader) {
+        ++coalesced_;
+        // 唤醒任务加在本 worker 的队列上，挂起之前不会被调度，不会丢失唤醒
+        Coroutine::YieldToSuspend();
+        if (pending->result) {
+            Send(*pending->result, rsp);
+            return 0;
+        }
+    }
+
+    ++misses_;
+    HttpResponse tmp(rsp->getVersion(), true);
+    // 缓存的响应带的是生成时的 Date
+    tmp.setDefaultHeaders(rsp->getDefaultHeaders());
+    tmp.setDate(rsp->getDate());
+    int32_t rt = inner_->handle(req, &tmp, session);
+    EntryPtr result;
+    if (IsCacheable(&tmp)) {
+        result = Encode(&tmp, GetCurrentMs() + options_.ttl);
+    } else {
+        ++uncacheable_;
+    }
+    if (leader) {
+        std::vector<std::pair<Worker*, Coroutine::SPtr>> waiters;
+        {
+            MutexGuard lock(shard.mutex);
+            shard.pending.erase(key);
+            if (result) {
+                insert(&shard, key, result);
+            }
+            pending->result = result;
+            waiters.swap(pending->waiters);
+        }
+        for (auto& waiter : waiters) {
+            waiter.first->addTask(waiter.second);
+        }
+    }
+    if (result) {
+        Send(*result, rsp);
+        return rt;
+    }
+    rsp->setStatus(tmp.getStatus());
+    rsp->setReason(tmp.getReason());
+    rsp->setHeaders(tmp.getHeaders());
+    rsp->setBody(tmp.getBody());
+    if (!tmp.isKeepAlive()) {
+        rsp->setKeepAlive(false);
+    }
+    return rt;
+}
+
+CachingServlet::Stats CachingServlet::getStats() {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.coalesced = coalesced_;
+    stats.uncacheable = uncacheable_;
+    for (size_t i = 0; i < options_.shards; i++) {
+        MutexGuard lock(shards_[i].mutex);
+        stats.entries += shards_[i].entries.size();
+        stats.bytes += shards_[i].bytes;
+    }
+    return stats;
+}
+
+std::string CachingServlet::makeKey(const HttpRequest& req) const {
+    std::string key = HttpMethodToString(req.getMethod());
+    // 缓存的是编码好的状态行，不同 HTTP 版本的请求分开缓存
+    key.push_back(' ');
+    key.push_back('0' + (req.getVersion() >> 4));
+    key.push_back('.');
+    key.push_back('0' + (req.getVersion() & 0x0f));
+    key.push_back(' ');
+    key.append(req.getPath().data(), req.getPath().size());
+    if (!req.getQuery().empty()) {
+        key.push_back('?');
+        key.append(req.getQuery().data(), req.getQuery().size());
+    }
+    for (auto& name : options_.keyHeaders) {
+        StringPiece value = req.getHeaderView(name);
+        key.push_back('\n');
+        key.append(value.data(), value.size());
+    }
+    return key;
+}
+
+void CachingServlet::insert(Shard* shard, const std::string& key, EntryPtr entry) {
+    size_t size = key.size() + entry->bytes.size();
+    if (size > maxShardBytes_) {
+        return;
+    }
+    auto it = shard->entries.find(key);
+    if (it != shard->entries.end()) {
+        erase(shard, it->second);
+    }
+    shard->lru.push_front(std::make_pair(key, entry));
+    shard->entries[key] = shard->lru.begin();
+    shard->bytes += size;
+    while (shard->bytes > maxShardBytes_) {
+        erase(shard, --shard->lru.end());
+    }
+}
+
+void CachingServlet::erase(Shard* shard, LruList::iterator it) {
+    // 正在发送的请求持有 EntryPtr，这里只是从缓存中摘掉
+    shard->bytes -= it->first.size() + it->second->bytes.size();
+    shard->entries.erase(it->first);
+    shard->lru.erase(it);
+}
+
+bool CachingServlet::IsCacheable(HttpResponse* rsp) {
+    if (rsp->getStatus() != HttpStatus::OK || rsp->isStreaming()) {
+        return false;
+    }
+    const HttpResponse::HeaderMap& headers = rsp->getHeaders();
+    if (headers.find("Set-Cookie") != headers.end()) {
+        return false;
+    }
+    auto it = headers.find("Cache-Control");
+    if (it != headers.end()) {
+        const std::string& value = it->second;
+        if (value.find("no-store") != std::string::npos ||
+            value.find("no-cache") != std::string::npos ||
+            value.find("private") != std::string::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CachingServlet::EntryPtr CachingServlet::Encode(HttpResponse* rsp, int64_t expire) {
+    std::shared_ptr<Entry> entry(new Entry);
+    rsp->setKeepAlive(true);
+    const std::string& body = rsp->getBody();
+    std::string& bytes = entry->bytes;
+    bytes.resize(rsp->getHeaderSize() + body.size());
+    size_t len = rsp->encodeHeader(&bytes[0]);
+    memcpy(&bytes[len], body.data(), body.size());
+    bytes.resize(len + body.size());
+    // encodeHeader 先写状态行，紧接着是 Connection 行
+    entry->connPos = bytes.find("\r\n") + 2;
+    entry->connLen = bytes.find("\r\n", entry->connPos) + 2 - entry->connPos;
+    entry->expire = expire;
+    return entry;
+}
+
+bool CachingServlet::Send(const Entry& entry, HttpResponse* rsp) {
+    const std::string& bytes = entry.bytes;
+    if (rsp->isKeepAlive()) {
+        return rsp->sendEncoded(bytes);
+    }
+    size_t tail = entry.connPos + entry.connLen;
+    rsp->sendEncoded(StringPiece(bytes.data(), entry.connPos), false);
+    rsp->sendEncoded(StringPiece(kClose, sizeof(kClose) - 1), false);
+    return rsp->sendEncoded(StringPiece(bytes.data() + tail, bytes.size() - tail));
+}
+
+} // namespace reyao
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "reyao/http/http_servlet.h"
+#include "reyao/coroutine.h"
+#include "reyao/mutex.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reyao {
+
+class Worker;
+
+// 缓存被包装 servlet 的 GET 响应，key 由 method、path、query 和指定的请求头组成。
+// 缓存的是编码好的完整响应，命中时一次 writev 发出，不再经过 HttpResponse；
+// 同一个 key 同时有多个请求未命中时只有第一个调用被包装的 servlet，其余挂起协程等待共享结果。
+// 被包装的 servlet 拿到的是没有绑定连接的 HttpResponse，不能使用流式响应；
+// 只缓存 200、没有 Set-Cookie、Cache-Control 不含 no-store/no-cache/private 的响应
+class CachingServlet : public Servlet {
+public:
+    typedef std::shared_ptr<CachingServlet> SPtr;
+
+    struct Options {
+        int64_t ttl = 1000;                     // 毫秒
+        size_t maxBytes = 64 * 1024 * 1024;     // 所有分片合计
+        size_t shards = 16;                     // 分片数，减少不同 worker 之间的锁竞争
+        std::vector<std::string> keyHeaders;    // 参与 key 的请求头，如 Accept-Language
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t coalesced = 0;                 // 等待其他请求计算结果的次数
+        uint64_t uncacheable = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit CachingServlet(Servlet::SPtr inner);
+    CachingServlet(Servlet::SPtr inner, const Options& options);
+
+    virtual int32_t handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) override;
+
+    Stats getStats();
+
+private:
+    struct Entry {
+        std::string bytes;                      // keep-alive 版本的完整响应
+        size_t connPos = 0;                     // Connection 行的位置，非 keep-alive 时替换
+        size_t connLen = 0;
+        int64_t expire = 0;
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    // 正在计算的 key，等待者在这里登记，计算完成后被逐个唤醒
+    struct Pending {
+        std::vector<std::pair<Worker*, Coroutine::SPtr>> waiters;
+        EntryPtr result;                        // 结果不能缓存时为空
+    };
+    typedef std::shared_ptr<Pending> PendingPtr;
+    typedef std::list<std::pair<std::string, EntryPtr>> LruList;
+
+    struct Shard {
+        Mutex mutex;
+        LruList lru;                            // 队头是最近使用的
+        std::unordered_map<std::string, LruList::iterator> entries;
+        std::unordered_map<std::string, PendingPtr> pending;
+        size_t bytes = 0;
+    };
+
+    std::string makeKey(const HttpRequest& req) const;
+    void insert(Shard* shard, const std::string& key, EntryPtr entry);
+    void erase(Shard* shard, LruList::iterator it);
+
+    static bool IsCacheable(HttpResponse* rsp);
+    static EntryPtr Encode(HttpResponse* rsp, int64_t expire);
+    static bool Send(const Entry& entry, HttpResponse* rsp);
+
+    Servlet::SPtr inner_;
+    Options options_;
+    std::unique_ptr<Shard[]> shards_;
+    size_t maxShardBytes_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> uncacheable_{0};
+};
+
+} // namespace reyao
@@ -0,0 +1,77 @@
+#include "reyao/http/http_client.h"
+#include "reyao/http/http_session.h"
+#include "reyao/log.h"
+
+#include <strings.h>
+
+namespace reyao {
+
+HttpClient::HttpClient(Address::SPtr addr, ConnectionPool::SPtr pool)
+    : addr_(addr),
+      pool_(pool) {
+}
+
+HttpResponse::SPtr HttpClient::request(HttpRequest& req) {
+    Socket::SPtr conn;
+    if (pool_) {
+        conn = pool_->borrow(addr_);
+    } else {
+        conn = Socket::CreateStream(*addr_);
+        if (!conn->connect(*addr_)) {
+            conn.reset();
+        }
+    }
+    if (!conn) {
+        LOG_ERROR << "HttpClient connect " << addr_->toString() << " fail";
+        return nullptr;
+    }
+
+    req.setKeepAlive(pool_ != nullptr);
+    if (req.getHeaderView(HttpRequest::HOST).empty()) {
+        req.addHeader("Host", addr_->toString());
+    }
+
+    HttpResponse::SPtr rsp = std::make_shared<HttpResponse>();
+    bool ok = false;
+    {
+        // session 不持有 socket，连接的关闭由连接池或下面的 close 负责
+        HttpSession session(conn, false);
+        ok = session.sendRequest(&req) && session.recvResponse(rsp.get());
+    }
+    if (pool_) {
+        // HTTP/1.1 默认保持连接，除非对端发了 "Connection: close"；HTTP/1.0 需要显式的 keep-alive
+        bool keepAlive = false;
+        if (ok) {
+            auto it = rsp->getHeaders().find("Connection");
+            const char* value = it != rsp->getHeaders().end() ? it->second.c_str() : "";
+            keepAlive = rsp->getVersion() == 0x11 ? strcasecmp(value, "close") != 0
+                                                  : strcasecmp(value, "keep-alive") == 0;
+        }
+        pool_->giveBack(addr_, conn, keepAlive);
+    } else {
+        conn->close();
+    }
+    if (!ok) {
+        LOG_ERROR << "HttpClient request " << req.getPath() 
+                  << " to " << addr_->toString() << " fail";
+        return nullptr;
+    }
+    return rsp;
+}
+
+HttpResponse::SPtr HttpClient::get(const std::string& path) {
+    HttpRequest req;
+    req.setMethod(HttpMethod::GET);
+    req.setPath(path);
+    return request(req);
+}
+
+HttpResponse::SPtr HttpClient::post(const std::string& path, const std::string& body) {
+    HttpRequest req;
+    req.setMethod(HttpMethod::POST);
+    req.setPath(path);
+    req.setBody(body);
+    return request(req);
+}
+
+} // namespace reyao
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "reyao/http/http_request.h"
+#include "reyao/http/http_response.h"
+#include "reyao/connection_pool.h"
+#include "reyao/address.h"
+#include "reyao/nocopyable.h"
+
+#include <memory>
+#include <string>
+
+namespace reyao {
+
+// 同步的 http/1.1 客户端，需要在 worker 协程中调用
+// 设置了连接池时使用 keep-alive 连接，响应没有要求关闭时把连接还回连接池
+class HttpClient : public NoCopyable {
+public:
+    typedef std::shared_ptr<HttpClient> SPtr;
+    explicit HttpClient(Address::SPtr addr, ConnectionPool::SPtr pool = nullptr);
+
+    // 失败（连接、发送或解析出错）时返回 nullptr
+    HttpResponse::SPtr request(HttpRequest& req);
+    HttpResponse::SPtr get(const std::string& path);
+    HttpResponse::SPtr post(const std::string& path, const std::string& body);
+
+    Address::SPtr getAddr() const { return addr_; }
+
+private:
+    Address::SPtr addr_;
+    ConnectionPool::SPtr pool_;
+};
+
+} // namespace reyao
@@ -0,0 +1,175 @@
+#include "reyao/http/http_gzip.h"
+#include "reyao/log.h"
+
+#include <zlib.h>
+
+namespace reyao {
+
+namespace {
+
+// 线程退出时释放 z_stream
+struct Deflater {
+    z_stream zs;
+    bool inited = false;
+    int level = 0;
+
+    ~Deflater() {
+        if (inited) {
+            deflateEnd(&zs);
+        }
+    }
+
+    bool reset(int lv) {
+        if (inited && level == lv) {
+            return deflateReset(&zs) == Z_OK;
+        }
+        if (inited) {
+            deflateEnd(&zs);
+            inited = false;
+        }
+        memset(&zs, 0, sizeof(zs));
+        // windowBits 加 16 输出 gzip 格式
+        if (deflateInit2(&zs, lv, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        inited = true;
+        level = lv;
+        return true;
+    }
+};
+
+thread_local Deflater t_deflater;
+
+} // namespace
+
+bool Gzip::Compress(const void* data, size_t len, std::string* out, int level) {
+    Deflater& deflater = t_deflater;
+    if (!deflater.reset(level)) {
+        LOG_ERROR << "deflateInit fail, level=" << level;
+        return false;
+    }
+    z_stream& zs = deflater.zs;
+    // deflateBound 已经算上了 gzip 头尾，一次 deflate 就能完成
+    out->resize(deflateBound(&zs, len));
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = len;
+    zs.next_out = (Bytef*)&(*out)[0];
+    zs.avail_out = out->size();
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        out->clear();
+        return false;
+    }
+    out->resize(zs.total_out);
+    return true;
+}
+
+bool Gzip::IsAccepted(const StringPiece& acceptEncoding) {
+    StringPiece rest = acceptEncoding;
+    while (!rest.empty()) {
+        const char* comma = static_cast<const char*>(memchr(rest.data(), ',', rest.size()));
+        size_t len = comma ? comma - rest.data() : rest.size();
+        StringPiece item(rest.data(), len);
+        rest.removePrefix(comma ? len + 1 : len);
+        while (!item.empty() && item[0] == ' ') {
+            item.removePrefix(1);
+        }
+        const char* semi = static_cast<const char*>(memchr(item.data(), ';', item.size()));
+        StringPiece coding(item.data(), semi ? semi - item.data() : item.size());
+        while (!coding.empty() && coding[coding.size() - 1] == ' ') {
+            coding.removeSuffix(1);
+        }
+        if (!coding.caseEqual("gzip") && coding != "*") {
+            continue;
+        }
+        if (!semi) {
+            return true;
+        }
+        // q=0、q=0.0 等表示不接受
+        StringPiece param(semi + 1, item.end() - semi - 1);
+        while (!param.empty() && param[0] == ' ') {
+            param.removePrefix(1);
+        }
+        if (!param.startsWith("q=")) {
+            return true;
+        }
+        param.removePrefix(2);
+        for (size_t i = 0; i < param.size(); i++) {
+            if (param[i] >= '1' && param[i] <= '9') {
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+bool Gzip::IsCompressible(const StringPiece& contentType) {
+    static const char* kTypes[] = {
+        "text/",
+        "application/json",
+        "application/javascript",
+        "application/xml",
+        "image/svg+xml",
+        "application/wasm",
+    };
+    for (const char* type : kTypes) {
+        StringPiece prefix(type);
+        if (contentType.size() >= prefix.size() &&
+            StringPiece(contentType.data(), prefix.size()).caseEqual(prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Gzip::ETag(const std::string& etag) {
+    if (etag.size() >= 2 && etag.back() == '"') {
+        return etag.substr(0, etag.size() - 1) + "-gzip\"";
+    }
+    return etag + "-gzip";
+}
+
+GzipCache::GzipCache(size_t maxSize)
+    : maxSize_(maxSize) {
+}
+
+GzipCache::DataPtr GzipCache::get(const std::string& key) {
+    MutexGuard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++hits_;
+    return it->second->second;
+}
+
+void GzipCache::put(const std::string& key, DataPtr data) {
+    if (data->size() > maxSize_) {
+        return;
+    }
+    MutexGuard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        size_ -= it->second->second->size();
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+    lru_.push_front(std::make_pair(key, data));
+    entries_[key] = lru_.begin();
+    size_ += data->size();
+    while (size_ > maxSize_) {
+        auto last = --lru_.end();
+        size_ -= last->second->size();
+        entries_.erase(last->first);
+        lru_.erase(last);
+    }
+}
+
+size_t GzipCache::getSize() {
+    MutexGuard lock(mutex_);
+    return size_;
+}
+
+} // namespace reyao
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "reyao/stringpiece.h"
+#include "reyao/mutex.h"
+#include "reyao/nocopyable.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace reyao {
+
+struct GzipOptions {
+    bool enable = false;
+    int level = 6;
+    size_t minSize = 1024;                  // 小于该大小的 body 压缩收益不大
+    size_t cacheSize = 16 * 1024 * 1024;    // 预压缩结果缓存的总大小，0 表示不缓存
+};
+
+// gzip 压缩：每个线程（worker）复用一个 z_stream，只在第一次使用时 deflateInit
+class Gzip {
+public:
+    // out 为完整的 gzip 格式数据
+    static bool Compress(const void* data, size_t len, std::string* out, int level = 6);
+    // Accept-Encoding 是否接受 gzip，"gzip;q=0" 表示拒绝
+    static bool IsAccepted(const StringPiece& acceptEncoding);
+    // 只压缩文本类内容，图片、视频等本身已经压缩过
+    static bool IsCompressible(const StringPiece& contentType);
+    // 压缩后的表示需要不同的强 ETag："abc" -> "abc-gzip"
+    static std::string ETag(const std::string& etag);
+};
+
+// 按 key（通常是 ETag）缓存压缩结果，热点资源只压缩一次；LRU，按字节数限制
+class GzipCache : public NoCopyable {
+public:
+    typedef std::shared_ptr<const std::string> DataPtr;
+
+    explicit GzipCache(size_t maxSize);
+
+    DataPtr get(const std::string& key);
+    void put(const std::string& key, DataPtr data);
+
+    size_t getSize();
+    uint64_t getHits() const { return hits_; }
+    uint64_t getMisses() const { return misses_; }
+
+private:
+    typedef std::list<std::pair<std::string, DataPtr>> LruList;
+
+    size_t maxSize_;
+    size_t size_ = 0;
+    Mutex mutex_;
+    LruList lru_;                           // 队头是最近使用的
+    std::unordered_map<std::string, LruList::iterator> entries_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace reyao
@@ -11,84 +11,446 @@
 
 namespace reyao {
 
-static size_t s_maxReqBufferSize = 4 * 1024;
+// 解析头部时每次读的大小，读 body 时用更大的块
+static size_t s_headerReadSize = 4 * 1024;
+static size_t s_bodyReadSize = 64 * 1024;
 static size_t s_maxResBufferSize = 64 * 1024 * 1024;
 
-HttpParser::HttpParser(SocketStream* stream)
+// 直接在缓冲区上解析十进制数字，避免构造临时 std::string
+static bool ParseDecimal(const StringPiece& str, size_t* value) {
+    if (str.empty()) {
+        return false;
+    }
+    size_t res = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        char c = str[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        size_t digit = c - '0';
+        if (res > (SIZE_MAX - digit) / 10) {
+            return false;
+        }
+        res = res * 10 + digit;
+    }
+    *value = res;
+    return true;
+}
+
+// chunk 大小按 64 位解析，溢出或出现非十六进制字符都视为错误，
+// 避免大小被截断后与后续数据错位
+static bool ParseHex(const StringPiece& str, uint64_t* value) {
+    size_t len = str.size();
+    // 允许 chunk 扩展前的空白
+    while (len > 0 && (str[len - 1] == ' ' || str[len - 1] == '\t')) {
+        len--;
+    }
+    if (len == 0) {
+        return false;
+    }
+    uint64_t res = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = str[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        if (res > (UINT64_MAX >> 4)) {
+            return false;
+        }
+        res = (res << 4) | digit;
+    }
+    *value = res;
+    return true;
+}
+
+static const char* FindCRLF(const char* begin, const char* end) {
+    const char* crlf = std::search(begin, end, ByteArray::kCRLF, ByteArray::kCRLF + 2);
+    return crlf == end ? nullptr : crlf;
+}
+
+HttpParser::HttpParser(SocketStream* stream, ByteArray* buf)
     : stream_(stream),
-      ba_(),
+      ba_(buf),
       contentLen_(0) {
 }
 
-HttpRequestParser::HttpRequestParser(SocketStream* stream, HttpRequest* req)
-    : HttpParser(stream),
-      req_(req) {
+void HttpParser::resetState() {
+    parsed_ = 0;
+    parseState_ = PARSE_FIRST_LINE;
+    headerOnly_ = false;
+    error_ = false;
+    errorCode_ = ERROR_NONE;
+    finish_ = false;
+    body_.clear();
+    contentLen_ = 0;
+    hasContentLen_ = false;
+    chunked_ = false;
+    chunkSize_ = 0;
+    chunkState_ = PARSE_CHUNK_SIZE;
 }
 
-bool HttpRequestParser::parseRequest() {
-    while (!finish_ && !error_) {
-        if (readSize_ == s_maxReqBufferSize) {
-            return false;
+void HttpParser::parseBuffered() {
+    while (!error_ && !finish_) {
+        if (parseState_ == PARSE_BODY && headerOnly_) {
+            break;
         }
-        int len = stream_->read(&ba_, s_maxReqBufferSize);
+        if (parseState_ == PARSE_FIRST_LINE || parseState_ == PARSE_HEADER) {
+            const char* start = cursor();
+            const char* end = FindCRLF(start, bufEnd());
+            if (end == nullptr) {
+                break;
+            }
+            parsed_ += end - start + 2;
+            if (parseState_ == PARSE_FIRST_LINE) {
+                parseFirstLine(start, end);
+            } else {
+                parseHeader(start, end);
+            }
+            if (limits_.maxHeaderSize && parsed_ > limits_.maxHeaderSize) {
+                setError(ERROR_HEADER_TOO_LARGE);
+            }
+        } else {
+            if (chunked_) {
+                parseChunkedBody();
+            } else {
+                parseFixedBody();
+            }
+            //finish or read more
+            break;
+        }
+    }
+}
+
+bool HttpParser::readMore(size_t size) {
+    if (stream_->getPendingSize() > 0 && stream_->flush() < 0) {
+        return false;
+    }
+    const char* oldBegin = ba_->peek();
+    const char* oldEnd = bufEnd();
+    if (stream_->read(ba_, size) <= 0) {
+        return false;
+    }
+    if (parsed_ > 0 && ba_->peek() != oldBegin) {
+        relocate(oldBegin, oldEnd, ba_->peek());
+    }
+    return true;
+}
 
-        if (len <= 0) {
+bool HttpParser::parseUntil(bool headerOnly) {
+    headerOnly_ = headerOnly;
+    while (true) {
+        parseBuffered();
+        if (error_) {
+            if (errorCode_ == ERROR_NONE) {
+                errorCode_ = ERROR_BAD_REQUEST;
+            }
             return false;
         }
+        if (parseState_ != PARSE_BODY) {
+            if (limits_.maxHeaderSize && ba_->getReadSize() > limits_.maxHeaderSize) {
+                setError(ERROR_HEADER_TOO_LARGE);
+                return false;
+            }
+        } else if (headerOnly) {
+            return true;
+        } else if (limits_.maxBodySize &&
+                   (contentLen_ > limits_.maxBodySize ||
+                    body_.size() > limits_.maxBodySize)) {
+            setError(ERROR_BODY_TOO_LARGE);
+            return false;
+        }
+        if (finish_) {
+            return true;
+        }
+        if (!readMore(parseState_ == PARSE_BODY ? s_bodyReadSize : s_headerReadSize)) {
+            setError(ERROR_CLOSED);
+            return false;
+        }
+    }
+}
 
-        while (!error_) {
-            if (parseState_ == PARSE_FIRST_LINE) {
-                LOG_INFO << "parse";
-                const char* start = ba_.peek();
-                const char* end = ba_.findCRLF();
-                if (end == nullptr) {
-                    break;
-                }
-                ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-                parseFirstLine(start, end);
+void HttpParser::consume() {
+    ba_->setReadPos(ba_->getReadPos() + parsed_);
+    parsed_ = 0;
+}
 
-            } else if (parseState_ == PARSE_HEADER) {
-                const char* start = ba_.peek();
-                const char* end = ba_.findCRLF();
-                if (end == nullptr) {
+bool HttpParser::parseHeaderLine(const char* begin, const char* end,
+                                 StringPiece* name, StringPiece* value) {
+    const char* temp = std::find(begin, end, ':');
+    if (temp == end || temp + 2 == end) {
+        error_ = true;
+        return false;
+    }
+    name->set(begin, temp - begin);
+    value->set(temp + 2, end - temp - 2);
+    if (name->caseEqual("transfer-encoding") &&
+        value->caseEqual("chunked")) {
+        chunked_ = true;
+    }
+    if (!chunked_ && name->caseEqual("content-length")) {
+        // 重复的 Content-Length 只接受相同的值，否则无法确定 body 的边界
+        size_t len = 0;
+        if (!ParseDecimal(*value, &len) ||
+            (hasContentLen_ && len != contentLen_)) {
+            error_ = true;
+            return false;
+        }
+        contentLen_ = len;
+        hasContentLen_ = true;
+    }
+    return true;
+}
+
+void HttpParser::parseChunkedBody() {
+    while (!error_) {
+        if (chunkState_ == PARSE_CHUNK_SIZE) {
+            const char* start = cursor();
+            const char* end = FindCRLF(start, bufEnd());
+            if (end == nullptr) {
+                break;
+            }
+            parsed_ += end - start + 2;
+            // 忽略 chunk 扩展 "size;name=value"
+            const char* ext = std::find(start, end, ';');
+            uint64_t size = 0;
+            if (!ParseHex(StringPiece(start, ext - start), &size)) {
+                error_ = true;
+                break;
+            }
+            // 声明的大小一出现就按上限检查，不等数据读进缓冲区
+            if (limits_.maxBodySize && size > limits_.maxBodySize - body_.size()) {
+                setError(ERROR_BODY_TOO_LARGE);
+                break;
+            }
+            chunkSize_ = size;
+            chunkState_ = chunkSize_ == 0 ? PARSE_CHUNK_TRAILER : PARSE_CHUNK_CONTENT;
+        } else if (chunkState_ == PARSE_CHUNK_CONTENT) {
+            if (chunkSize_ + 2 <= (size_t)(bufEnd() - cursor())) {
+                const char* data = cursor();
+                if (data[chunkSize_] != '\r' || data[chunkSize_ + 1] != '\n') {
+                    error_ = true;
                     break;
                 }
-                ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-                parseHeader(start, end);
-            } else if (parseState_ == PARSE_BODY) {
-                if (!chunked_ && !contentLen_) {
-                    finish_ = true;
-                }
-                if (chunked_) {
-                    parseChunkedBody();
-                } else {
-                    parseFixedBody();
-                }
-                //finish or read more
+                body_.append(data, chunkSize_);
+                parsed_ += chunkSize_ + 2;
+                chunkSize_ = 0;
+                chunkState_ = PARSE_CHUNK_SIZE;
+            } else {
                 break;
             }
+        } else {
+            // 最后一个 chunk 之后是可选的 trailer，以空行结束
+            const char* start = cursor();
+            const char* end = FindCRLF(start, bufEnd());
+            if (end == nullptr) {
+                break;
+            }
+            parsed_ += end - start + 2;
+            if (start == end) {
+                onChunkedBody(body_);
+                finish_ = true;
+                break;
+            }
+        }
+    }
+}
+
+void HttpParser::parseFixedBody() {
+    if (contentLen_ == 0) {
+        //body为chunk或没有body
+        finish_ = true;
+    } else if ((size_t)(bufEnd() - cursor()) >= contentLen_) {
+        onFixedBody(StringPiece(cursor(), contentLen_));
+        parsed_ += contentLen_;
+        finish_ = true;
+    }
+}
+
+HttpRequestParser::HttpRequestParser(SocketStream* stream, ByteArray* buf)
+    : HttpParser(stream, buf) {
+}
+
+bool HttpRequestParser::parseRequest(HttpRequest* req) {
+    return parseRequestHeader(req) && parseRequestBody();
+}
+
+bool HttpRequestParser::parseRequestHeader(HttpRequest* req) {
+    req_ = req;
+    resetState();
+    streaming_ = false;
+    streamEnd_ = false;
+    chunkDataEnd_ = false;
+    bodyRead_ = 0;
+    return parseUntil(true);
+}
+
+bool HttpRequestParser::parseRequestBody() {
+    if (!parseUntil(false)) {
+        return false;
+    }
+    consume();
+    return true;
+}
+
+void HttpRequestParser::beginBodyStream() {
+    // 读 body 时缓冲区会被整理，头部视图先拷贝出来
+    req_->detach(ba_->peek(), ba_->peek() + parsed_);
+    consume();
+    streaming_ = true;
+    streamEnd_ = !hasBody();
+    req_->setBodyReader(this);
+}
+
+int HttpRequestParser::readRaw(void* buf, size_t len) {
+    size_t buffered = ba_->getReadSize();
+    if (buffered > 0) {
+        size_t n = std::min(len, buffered);
+        memcpy(buf, ba_->peek(), n);
+        ba_->setReadPos(ba_->getReadPos() + n);
+        return n;
+    }
+    if (stream_->getPendingSize() > 0 && stream_->flush() < 0) {
+        return -1;
+    }
+    return stream_->read(buf, len);
+}
+
+bool HttpRequestParser::nextChunk() {
+    while (chunkState_ != PARSE_CHUNK_CONTENT) {
+        const char* start = ba_->peek();
+        const char* end = ba_->findCRLF();
+        if (end == nullptr) {
+            // 不允许没有换行的超长 chunk 头
+            if (ba_->getReadSize() > s_headerReadSize) {
+                setError(ERROR_BAD_REQUEST);
+                return false;
+            }
+            if (!readMore(s_headerReadSize)) {
+                setError(ERROR_CLOSED);
+                return false;
+            }
+            continue;
+        }
+        ba_->setReadPos(ba_->getReadPos() + end - start + 2);
+        if (chunkState_ == PARSE_CHUNK_TRAILER) {
+            if (start == end) {
+                streamEnd_ = true;
+                return false;
+            }
+            continue;
+        }
+        if (chunkDataEnd_) {
+            chunkDataEnd_ = false;
+            if (start != end) {
+                setError(ERROR_BAD_REQUEST);
+                return false;
+            }
+            continue;
+        }
+        const char* ext = std::find(start, end, ';');
+        uint64_t size = 0;
+        if (!ParseHex(StringPiece(start, ext - start), &size)) {
+            setError(ERROR_BAD_REQUEST);
+            return false;
+        }
+        if (limits_.maxStreamBodySize && size > limits_.maxStreamBodySize - bodyRead_) {
+            setError(ERROR_BODY_TOO_LARGE);
+            return false;
+        }
+        chunkSize_ = size;
+        chunkState_ = chunkSize_ == 0 ? PARSE_CHUNK_TRAILER : PARSE_CHUNK_CONTENT;
+    }
+    return true;
+}
+
+int HttpRequestParser::read(void* buf, size_t len) {
+    if (!streaming_ || error_) {
+        return -1;
+    }
+    if (streamEnd_ || len == 0) {
+        return 0;
+    }
+    size_t want = 0;
+    if (chunked_) {
+        if (!nextChunk()) {
+            return error_ ? -1 : 0;
+        }
+        want = std::min(len, chunkSize_);
+    } else {
+        want = std::min((uint64_t)len, (uint64_t)(contentLen_ - bodyRead_));
+    }
+    if (limits_.maxStreamBodySize && bodyRead_ + want > limits_.maxStreamBodySize) {
+        setError(ERROR_BODY_TOO_LARGE);
+        return -1;
+    }
+    int n = readRaw(buf, want);
+    if (n <= 0) {
+        setError(ERROR_CLOSED);
+        return -1;
+    }
+    bodyRead_ += n;
+    if (chunked_) {
+        chunkSize_ -= n;
+        if (chunkSize_ == 0) {
+            chunkState_ = PARSE_CHUNK_SIZE;
+            chunkDataEnd_ = true;
+        }
+    } else if (bodyRead_ == contentLen_) {
+        streamEnd_ = true;
+    }
+    return n;
+}
+
+bool HttpRequestParser::discardBody(uint64_t maxDiscard) {
+    char buf[4096];
+    uint64_t discarded = 0;
+    while (true) {
+        int n = read(buf, sizeof(buf));
+        if (n <= 0) {
+            return n == 0;
+        }
+        discarded += n;
+        if (maxDiscard && discarded > maxDiscard) {
+            return false;
         }
     }
-    return !error_;
 }
 
 void HttpRequestParser::parseFirstLine(const char* begin, const char* end) {
 //method scheme://host:port/path?query#fragment version'\0''\0'
-    LOG_INFO << "parseline";
     const char* space  = std::find(begin, end, ' ');
     if (space == end) {
         error_ = true;
         return;
     }
 
-    req_->setMethod(StringToHttpMethod(std::string(begin, space - begin)));
+    StringPiece method(begin, space - begin);
+    req_->setMethod(StringToHttpMethod(method));
     begin = space + 1;
     space = std::find(begin, end, ' ');
     if (space == end) {
         error_ = true;
         return;
     }
-    std::string version(space + 1, end - space - 1);
+    StringPiece version(space + 1, end - space - 1);
+    if (version == "HTTP/2.0") {
+        // h2c prior knowledge 的连接前言 "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"，
+        // 前半部分按请求头解析，由 HttpServer 交给 HTTP/2 处理
+        if (method != "PRI" || StringPiece(begin, space - begin) != "*") {
+            error_ = true;
+            return;
+        }
+        req_->setVersion(0x20);
+        parseState_ = PARSE_HEADER;
+        return;
+    }
     if (version == "HTTP/1.0") {
         req_->setVersion(0x10);
     } else if (version == "HTTP/1.1") {
@@ -105,155 +467,59 @@ void HttpRequestParser::parseFirstLine(const char* begin, const char* end) {
         return;
     }
     end = space;
-    end = parseURI(begin, end, '#');
-    end = parseURI(begin, end, '?');
-    end = parseURI(begin, end, '/');
+    const char* temp = std::find(begin, end, '#');
+    if (temp != end) {
+        req_->setFragmentView(StringPiece(temp + 1, end - temp - 1));
+        end = temp;
+    }
+    temp = std::find(begin, end, '?');
+    if (temp != end) {
+        req_->setQueryView(StringPiece(temp + 1, end - temp - 1));
+        end = temp;
+    }
+    req_->setPathView(StringPiece(begin, end - begin));
 
     parseState_ = PARSE_HEADER;
 }
 
 void HttpRequestParser::parseHeader(const char* begin, const char* end) {
-    if (*begin == '\r') {
+    if (begin == end) {
         parseState_ = PARSE_BODY;
         return;
     }
-    const char* temp = std::find(begin, end, ':');
-    if (temp != end && temp + 2 != end) {
-        std::string title(begin, temp - begin);
-        std::string value(temp + 2, end - temp -2); 
-        if (!strcasecmp(title.c_str(), "transfer-encoding") &&
-            !strcasecmp(value.c_str(), "chunked")) {
-            chunked_ = true;
-        }
-        if (!chunked_) {
-            if (!strcasecmp(title.c_str(), "content-length")) {
-                contentLen_ = std::stoi(value);
-            }
-        }
-        req_->addHeader(title, value);
-        return;
+    StringPiece name, value;
+    if (parseHeaderLine(begin, end, &name, &value)) {
+        req_->appendHeader(name, value);
     }
-    error_ = true;
 }
 
-void HttpRequestParser::parseChunkedBody() {
-    while (!error_) {
-        if (chunkSize_ == PARSE_CHUNK_SIZE) {
-            const char* start = ba_.peek();
-            const char* end = ba_.findCRLF();
-            if (end == nullptr) {
-                break;
-            }
-            ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-            std::string hex(start, end - start);
-            chunkSize_ = HexToDec(hex);
-            if (chunkSize_ == (size_t)-1) {
-                error_ = true;
-                break;
-            } 
-            if (chunkSize_ == 0) {
-                req_->setBody(body_);
-                finish_ = true;
-                break;
-            }
-            chunkState_ = PARSE_CHUNK_CONTENT;
-        } else if (chunkState_ == PARSE_CHUNK_CONTENT) {
-                if (chunkSize_ + 2 <= ba_.getReadSize()) {
-                    body_ += std::string(ba_.peek(), chunkSize_ + 2);
-                    ba_.setReadPos(ba_.getReadPos() + chunkSize_ + 2);
-                    chunkSize_ = 0;
-                    chunkState_ = PARSE_CHUNK_SIZE;
-                } else {
-                    break;
-                }
-        }
-    }
+void HttpRequestParser::onFixedBody(const StringPiece& body) {
+    req_->setBodyView(body);
 }
 
-void HttpRequestParser::parseFixedBody() {
-    if (contentLen_ == 0) {
-        //body为chunk或没有body
-        finish_ = true;
-    } else if (ba_.getReadSize() >= contentLen_) {
-        req_->setBody(std::string(ba_.peek(), contentLen_));
-        ba_.setReadPos(ba_.getReadPos() + contentLen_);
-        finish_ = true;
-    }
+void HttpRequestParser::onChunkedBody(std::string& body) {
+    req_->setBody(std::move(body));
 }
 
-const char* HttpRequestParser::parseURI(const char* begin, const char* end, const char& des) {
-    const char* temp = std::find(begin, end, des);
-    if (temp != end) {
-        switch (des) {
-            case '#': {
-                req_->setFragment(std::string(temp + 1, end - temp - 1));
-            break;
-            }
-            case '?': {
-                req_->setQuery(std::string(temp + 1, end - temp - 1));
-            break;
-            }
-            case  '/': {
-                req_->setPath(std::string(temp, end - temp));
-            break;
-            }
-            default: {
-            break;
-            }
-        }
-    }
-    return temp;
+void HttpRequestParser::relocate(const char* oldBegin, const char* oldEnd,
+                                 const char* newBegin) {
+    req_->relocate(oldBegin, oldEnd, newBegin);
 }
 
-HttpResponseParser::HttpResponseParser(SocketStream* stream, HttpResponse* rsp)
-    : HttpParser(stream),
-      rsp_(rsp) {
+HttpResponseParser::HttpResponseParser(SocketStream* stream, ByteArray* buf)
+    : HttpParser(stream, buf) {
+    limits_.maxHeaderSize = 0;
+    limits_.maxBodySize = s_maxResBufferSize;
 }
 
-bool HttpResponseParser::parseResponse() {
-    while (!finish_ && !error_) {
-        if (readSize_ == s_maxResBufferSize) {
-            return false;
-        }
-        int len = stream_->read(&ba_, s_maxResBufferSize);
-
-        if (len <= 0) {
-            return false;
-        }
-
-        while (!error_) {
-            if (parseState_ == PARSE_FIRST_LINE) {
-                const char* start = ba_.peek();
-                const char* end = ba_.findCRLF();
-                if (end == nullptr) {
-                    break;
-                }
-                ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-                parseFirstLine(start, end);
-
-            } else if (parseState_ == PARSE_HEADER) {
-                const char* start = ba_.peek();
-                const char* end = ba_.findCRLF();
-                if (end == nullptr) {
-                    break;
-                }
-                ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-                parseHeader(start, end);
-            } else if (parseState_ == PARSE_BODY) {
-                if (!chunked_ && !contentLen_) {
-                    finish_ = true;
-                }
-                if (chunked_) {
-                    parseChunkedBody();
-                } else {
-                    parseFixedBody();
-                }
-                //finish or read more
-                break;
-            }
-        }
+bool HttpResponseParser::parseResponse(HttpResponse* rsp) {
+    rsp_ = rsp;
+    resetState();
+    if (!parseUntil(false)) {
+        return false;
     }
-    return !error_;
+    consume();
+    return true;
 }
 
 void HttpResponseParser::parseFirstLine(const char* begin, const char* end) {
@@ -263,7 +529,7 @@ void HttpResponseParser::parseFirstLine(const char* begin, const char* end) {
         error_ = true;
         return;
     }
-    std::string version(begin, space - begin);
+    StringPiece version(begin, space - begin);
     if (version == "HTTP/1.0") {
        rsp_->setVersion(0x10);
     } else if (version == "HTTP/1.1") {
@@ -279,85 +545,36 @@ void HttpResponseParser::parseFirstLine(const char* begin, const char* end) {
         error_ = true;
         return;
     }
-    int status_code = stoi(std::string(begin, space - begin));
-    if (!isHttpStatus(status_code)) {
+    size_t status_code = 0;
+    if (!ParseDecimal(StringPiece(begin, space - begin), &status_code) ||
+        !isHttpStatus(status_code)) {
         error_ = true;
         return;
     }
     rsp_->setStatus((HttpStatus)status_code);
-    rsp_->setReason(std::string(space, end - space));
+    rsp_->setReason(std::string(space + 1, end - space - 1));
 
 
     parseState_ = PARSE_HEADER;
 }
 
 void HttpResponseParser::parseHeader(const char* begin, const char* end) {
-    if (*begin == '\r') {
+    if (begin == end) {
         parseState_ = PARSE_BODY;
         return;
     }
-    const char* temp = std::find(begin, end, ':');
-    if (temp != end && temp + 2 != end) {
-        std::string title(begin, temp - begin);
-        std::string value(temp + 2, end - temp -2); 
-        if (!strcasecmp(title.c_str(), "transfer-encoding") &&
-            !strcasecmp(value.c_str(), "chunked")) {
-            chunked_ = true;
-        }
-        if (!chunked_) {
-            if (!strcasecmp(title.c_str(), "content-length")) {
-                contentLen_ = std::stoi(value);
-            }
-        }
-        rsp_->addHeader(title, value);
-        return;
+    StringPiece name, value;
+    if (parseHeaderLine(begin, end, &name, &value)) {
+        rsp_->addHeader(name.toString(), value.toString());
     }
-    error_ = true;
 }
 
-void HttpResponseParser::parseChunkedBody() {
-    while (!error_) {
-        if (chunkSize_ == PARSE_CHUNK_SIZE) {
-            const char* start = ba_.peek();
-            const char* end = ba_.findCRLF();
-            if (end == nullptr) {
-                break;
-            }
-            ba_.setReadPos(ba_.getReadPos() + end - start + 2);
-            std::string hex(start, end - start);
-            chunkSize_ = HexToDec(hex);
-            if (chunkSize_ == (size_t)-1) {
-                error_ = true;
-                break;
-            } 
-            if (chunkSize_ == 0) {
-                rsp_->setBody(body_);
-                finish_ = true;
-                break;
-            }
-            chunkState_ = PARSE_CHUNK_CONTENT;
-        } else if (chunkState_ == PARSE_CHUNK_CONTENT) {
-                    if (chunkSize_ + 2 <= ba_.getReadSize()) {
-                    body_ += std::string(ba_.peek(), chunkSize_ + 2);
-                    ba_.setReadPos(ba_.getReadPos() + chunkSize_ + 2);
-                    chunkSize_ = 0;
-                    chunkState_ = PARSE_CHUNK_SIZE;
-                } else {
-                    break;
-                }
-        }
-    }
+void HttpResponseParser::onFixedBody(const StringPiece& body) {
+    rsp_->setBody(body.toString());
 }
 
-void HttpResponseParser::parseFixedBody() {
-    if (contentLen_ == 0) {
-        //body is chunk or no body
-        finish_ = true;
-    } else if (ba_.getReadSize() >= contentLen_) {
-        rsp_->setBody(std::string(ba_.peek(), contentLen_));
-        ba_.setReadPos(ba_.getReadPos() + contentLen_);
-        finish_ = true;
-    }
+void HttpResponseParser::onChunkedBody(std::string& body) {
+    rsp_->setBody(body);
 }
 
-} // namespace reyao
\ No newline at end of file
+} // namespace reyao
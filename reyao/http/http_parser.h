@@ -1,7 +1,12 @@
 #pragma once
-#include "reyao/http/http_session.h"
+#include "reyao/socket_stream.h"
+#include "reyao/bytearray.h"
+#include "reyao/stringpiece.h"
+
+#include <stdint.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace reyao {
@@ -9,6 +14,20 @@ namespace reyao {
 class HttpRequest;
 class HttpResponse;
 
+// 请求大小限制，0 表示不限制
+struct HttpLimits {
+    size_t maxHeaderSize = 8 * 1024;            // 请求行加头部
+    uint64_t maxBodySize = 8 * 1024 * 1024;     // 缓冲模式下整个 body 放在内存中
+    uint64_t maxStreamBodySize = 0;             // 流式模式下 body 不进内存，默认不限制
+};
+
+// 流式 body：servlet 按需拉取，read 返回读到的字节数，0 表示 body 结束，-1 表示出错
+class HttpBodyReader {
+public:
+    virtual ~HttpBodyReader() {}
+    virtual int read(void* buf, size_t len) = 0;
+};
+
 class HttpParser {
 public:
     enum ParseState {
@@ -17,73 +36,145 @@ public:
         PARSE_BODY
     };
 
+    enum ParseError {
+        ERROR_NONE,
+        ERROR_CLOSED,               // 读失败或对端关闭
+        ERROR_BAD_REQUEST,
+        ERROR_HEADER_TOO_LARGE,
+        ERROR_BODY_TOO_LARGE
+    };
+
     enum ParseChunkState {
         PARSE_CHUNK_SIZE,
-        PARSE_CHUNK_CONTENT
+        PARSE_CHUNK_CONTENT,
+        PARSE_CHUNK_TRAILER
     };
 
     typedef std::shared_ptr<HttpParser> SPtr;
-    explicit HttpParser(SocketStream* stream);
+    // buf 为连接持有的输入缓冲区，解析完一条消息后剩余的数据留给下一条消息
+    HttpParser(SocketStream* stream, ByteArray* buf);
     virtual ~HttpParser() {}
 
+    // 清空解析状态，准备解析下一条消息，不清空输入缓冲区
+    void resetState();
+
+    void setLimits(const HttpLimits& limits) { limits_ = limits; }
+    const HttpLimits& getLimits() const { return limits_; }
+    ParseError getError() const { return errorCode_; }
+    bool hasBody() const { return chunked_ || contentLen_ > 0; }
+    bool isChunked() const { return chunked_; }
+    uint64_t getContentLength() const { return contentLen_; }
 
 protected:
+    // 尽可能解析缓冲区中已有的数据。消息解析完成之前不移动缓冲区的读位置，
+    // 已解析的部分用 parsed_ 记录，解析出的视图都指向缓冲区中的这条消息
+    void parseBuffered();
+    // 解析到头部结束（headerOnly）或整条消息结束，按 limits_ 检查大小
+    bool parseUntil(bool headerOnly);
+    void setError(ParseError code) { error_ = true; errorCode_ = code; }
+    // 缓冲区中的数据不足以完成解析时从 socket 读取，读之前先发出排队的响应，
+    // 避免流水线的对端在等待响应时双方互相等待
+    bool readMore(size_t size);
+    // 消息解析完成，读位置移到消息末尾
+    void consume();
 
     virtual void parseFirstLine(const char* start, const char* end) = 0;
     virtual void parseHeader(const char* start, const char* end) = 0;
-    virtual void parseChunkedBody() = 0;
-    virtual void parseFixedBody() = 0;
+    // 定长 body 是缓冲区中的视图，chunked body 已解码到 body 中
+    virtual void onFixedBody(const StringPiece& body) = 0;
+    virtual void onChunkedBody(std::string& body) = 0;
+    // 读 socket 时缓冲区被整理或扩容，已解析的视图需要从 [oldBegin, oldEnd) 挪到 newBegin
+    virtual void relocate(const char* oldBegin, const char* oldEnd,
+                          const char* newBegin) {}
+
+    // 解析 "name: value"，识别 Transfer-Encoding 和 Content-Length
+    bool parseHeaderLine(const char* begin, const char* end,
+                         StringPiece* name, StringPiece* value);
+
+private:
+    void parseChunkedBody();
+    void parseFixedBody();
+    const char* bufEnd() const { return ba_->peek() + ba_->getReadSize(); }
+    const char* cursor() const { return ba_->peek() + parsed_; }
 
 protected:
     SocketStream* stream_;
-    ByteArray ba_;
-    size_t readSize_ = 0;
+    ByteArray* ba_;
+    // 当前消息已解析的字节数，相对于缓冲区的读位置
+    size_t parsed_ = 0;
 
+    HttpLimits limits_;
     ParseState parseState_ = PARSE_FIRST_LINE;
+    bool headerOnly_ = false;
     bool error_ = false;
+    ParseError errorCode_ = ERROR_NONE;
     bool finish_ = false;
     std::string body_;
 
     size_t contentLen_;
+    bool hasContentLen_ = false;
     bool chunked_ = false;
     size_t chunkSize_ = 0;
     ParseChunkState chunkState_ = PARSE_CHUNK_SIZE;
 };
 
-class HttpRequestParser : public HttpParser {
+class HttpRequestParser : public HttpParser, public HttpBodyReader {
 public:
-    HttpRequestParser(SocketStream* stream, HttpRequest* req);
-    
-    bool parseRequest();
+    HttpRequestParser(SocketStream* stream, ByteArray* buf);
+
+    // 解析一条请求到 req，缓冲区中已有完整请求时不读 socket；
+    // req 中的字段是缓冲区的视图，在下一次 parseRequest 之前有效
+    bool parseRequest(HttpRequest* req);
+
+    // 分两步解析：先解析到头部结束，由调用方决定 body 是缓冲还是流式读取
+    bool parseRequestHeader(HttpRequest* req);
+    // 缓冲模式：把整个 body 读进来放到 req 中
+    bool parseRequestBody();
+    // 流式模式：头部拷贝到 req 自己的内存中，之后用 read 逐段读取 body，
+    // 缓冲区中没有剩余数据时直接从 socket 读到调用方的内存
+    void beginBodyStream();
+    int read(void* buf, size_t len) override;
+    // 丢弃流式 body 中未读的部分，以便继续处理连接上的下一个请求；
+    // 超过 maxDiscard 字节时放弃并返回 false，调用方应关闭连接
+    bool discardBody(uint64_t maxDiscard);
 
 protected:
     virtual void parseFirstLine(const char* start, const char* end) override;
     virtual void parseHeader(const char* start, const char* end) override;
-    virtual void parseChunkedBody() override;
-    virtual void parseFixedBody() override;
-
-private:
-    const char* parseURI(const char* begin, const char* end, const char& des);
+    virtual void onFixedBody(const StringPiece& body) override;
+    virtual void onChunkedBody(std::string& body) override;
+    virtual void relocate(const char* oldBegin, const char* oldEnd,
+                          const char* newBegin) override;
 
 private:
-    HttpRequest* req_;
+    // 流式模式下读取 body 原始数据，优先使用缓冲区中剩余的数据
+    int readRaw(void* buf, size_t len);
+    // 流式 chunked：读到下一个 chunk 的数据部分，body 结束时返回 false
+    bool nextChunk();
+
+    HttpRequest* req_ = nullptr;
+    bool streaming_ = false;
+    bool streamEnd_ = false;
+    // chunk 数据读完，还要跳过后面的 CRLF
+    bool chunkDataEnd_ = false;
+    uint64_t bodyRead_ = 0;
 };
 
 
 class HttpResponseParser : public HttpParser {
 public:
-    HttpResponseParser(SocketStream* stream, HttpResponse* rsp);
+    HttpResponseParser(SocketStream* stream, ByteArray* buf);
 
-    bool parseResponse();
+    bool parseResponse(HttpResponse* rsp);
 
 protected:
     virtual void parseFirstLine(const char* start, const char* end) override;
     virtual void parseHeader(const char* start, const char* end) override;
-    virtual void parseChunkedBody() override;
-    virtual void parseFixedBody() override;
+    virtual void onFixedBody(const StringPiece& body) override;
+    virtual void onChunkedBody(std::string& body) override;
 
 private:
-    HttpResponse* rsp_;
+    HttpResponse* rsp_ = nullptr;
 };
 
 } // namespace reyao
\ No newline at end of file
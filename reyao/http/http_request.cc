@@ -1,12 +1,16 @@
 #include "reyao/http/http_request.h"
 
+#include <ctype.h>
+#include <stdint.h>
+
+#include <algorithm>
+
 
 namespace reyao {
 
-HttpMethod StringToHttpMethod(const std::string& str) {
-    const char* s = str.c_str();
+HttpMethod StringToHttpMethod(const StringPiece& s) {
 #define XX(num, name, string) \
-    if (strcmp(#string, s) == 0) { \
+    if (s == #string) { \
         return HttpMethod::name; \
     }
     HTTP_METHOD_MAP(XX);
@@ -29,50 +33,318 @@ const char* HttpMethodToString(const HttpMethod& m) {
 }
 
 
+static const char* s_known_headers[HttpRequest::KNOWN_HEADER_COUNT] = {
+    "Host",
+    "Content-Length",
+    "Connection",
+    "Transfer-Encoding",
+    "Content-Type",
+    "Cookie",
+    "Accept-Encoding",
+    "Upgrade",
+};
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = toupper(c);
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// 解码 application/x-www-form-urlencoded，非法的 %XX 原样保留
+static std::string UrlDecode(const StringPiece& str) {
+    std::string res;
+    res.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        char c = str[i];
+        if (c == '+') {
+            res.push_back(' ');
+        } else if (c == '%' && i + 2 < str.size() &&
+                   HexValue(str[i + 1]) >= 0 && HexValue(str[i + 2]) >= 0) {
+            res.push_back((char)(HexValue(str[i + 1]) * 16 + HexValue(str[i + 2])));
+            i += 2;
+        } else {
+            res.push_back(c);
+        }
+    }
+    return res;
+}
+
+static StringPiece Trim(StringPiece str) {
+    while (!str.empty() && str[0] == ' ') {
+        str.removePrefix(1);
+    }
+    while (!str.empty() && str[str.size() - 1] == ' ') {
+        str.removeSuffix(1);
+    }
+    return str;
+}
+
+static void Relocate(StringPiece* piece, uintptr_t oldBegin,
+                     uintptr_t oldEnd, const char* newBegin) {
+    uintptr_t ptr = (uintptr_t)piece->data();
+    if (ptr >= oldBegin && ptr < oldEnd) {
+        piece->set(newBegin + (ptr - oldBegin), piece->size());
+    }
+}
+
 HttpRequest::HttpRequest(uint8_t version, bool keepAlive) 
     : method_(HttpMethod::GET),
       version_(version),
       keepAlive_(keepAlive),
       path_("/") {
+    for (int i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        known_[i] = -1;
+    }
+}
+
+void HttpRequest::setQuery(const std::string& query) {
+    setQueryView(own(query));
+}
+
+void HttpRequest::setQueryView(const StringPiece& query) {
+    query_ = query;
+    params_.clear();
+    paramsParsed_ = false;
+}
+
+void HttpRequest::setBody(std::string&& body) {
+    storage_.push_back(std::move(body));
+    body_ = storage_.back();
+}
+
+void HttpRequest::appendHeader(const StringPiece& name, const StringPiece& value) {
+    if (headerCount_ < kInlineHeaders) {
+        headers_[headerCount_].name = name;
+        headers_[headerCount_].value = value;
+    } else {
+        moreHeaders_.push_back(Header{name, value});
+    }
+    for (int i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        if (name.caseEqual(s_known_headers[i])) {
+            known_[i] = headerCount_;
+            if (i == COOKIE) {
+                cookies_.clear();
+                cookiesParsed_ = false;
+            }
+            break;
+        }
+    }
+    ++headerCount_;
+    headerMapValid_ = false;
+}
+
+StringPiece HttpRequest::getHeaderView(KnownHeader key) const {
+    int index = known_[key];
+    return index < 0 ? StringPiece() : getHeaderAt(index).value;
+}
+
+StringPiece HttpRequest::getHeaderView(const StringPiece& key) const {
+    int index = findHeader(key);
+    return index < 0 ? StringPiece() : getHeaderAt(index).value;
+}
+
+int HttpRequest::findHeader(const StringPiece& key) const {
+    for (size_t i = headerCount_; i > 0; i--) {
+        if (getHeaderAt(i - 1).name.caseEqual(key)) {
+            return i - 1;
+        }
+    }
+    return -1;
+}
 
+void HttpRequest::reindexHeaders() {
+    for (int i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        known_[i] = -1;
+    }
+    for (size_t i = 0; i < headerCount_; i++) {
+        for (int j = 0; j < KNOWN_HEADER_COUNT; j++) {
+            if (getHeaderAt(i).name.caseEqual(s_known_headers[j])) {
+                known_[j] = i;
+                break;
+            }
+        }
+    }
+    headerMapValid_ = false;
+    cookies_.clear();
+    cookiesParsed_ = false;
+}
+
+void HttpRequest::relocate(const char* oldBegin, const char* oldEnd,
+                           const char* newBegin) {
+    uintptr_t begin = (uintptr_t)oldBegin;
+    uintptr_t end = (uintptr_t)oldEnd;
+    Relocate(&path_, begin, end, newBegin);
+    Relocate(&query_, begin, end, newBegin);
+    Relocate(&fragment_, begin, end, newBegin);
+    Relocate(&body_, begin, end, newBegin);
+    for (size_t i = 0; i < headerCount_; i++) {
+        Header& header = headerAt(i);
+        Relocate(&header.name, begin, end, newBegin);
+        Relocate(&header.value, begin, end, newBegin);
+    }
 }
 
-std::string HttpRequest::getHeader(const std::string& key) {
-    auto it = headers_.find(key);
-    return it == headers_.end() ? "header not found" : it->second;
+void HttpRequest::detach(const char* begin, const char* end) {
+    storage_.push_back(std::string(begin, end - begin));
+    relocate(begin, end, storage_.back().data());
 }
 
-std::string HttpRequest::getParam(const std::string& key) {
+StringPiece HttpRequest::own(const std::string& str) {
+    storage_.push_back(str);
+    return storage_.back();
+}
+
+void HttpRequest::parseParams() const {
+    if (paramsParsed_) {
+        return;
+    }
+    paramsParsed_ = true;
+    // a=1&b=2，没有 '=' 的参数值为空
+    const char* begin = query_.begin();
+    const char* end = query_.end();
+    while (begin < end) {
+        const char* amp = std::find(begin, end, '&');
+        const char* eq = std::find(begin, amp, '=');
+        if (eq != begin) {
+            std::string key = UrlDecode(StringPiece(begin, eq - begin));
+            std::string val = eq == amp ? "" :
+                              UrlDecode(StringPiece(eq + 1, amp - eq - 1));
+            params_.insert(std::make_pair(std::move(key), std::move(val)));
+        }
+        begin = amp + 1;
+    }
+}
+
+void HttpRequest::parseCookies() const {
+    if (cookiesParsed_) {
+        return;
+    }
+    cookiesParsed_ = true;
+    // a=1; b=2
+    StringPiece cookie = getHeaderView(COOKIE);
+    const char* begin = cookie.begin();
+    const char* end = cookie.end();
+    while (begin < end) {
+        const char* semi = std::find(begin, end, ';');
+        const char* eq = std::find(begin, semi, '=');
+        StringPiece key = Trim(StringPiece(begin, eq - begin));
+        if (!key.empty() && eq != semi) {
+            StringPiece val = Trim(StringPiece(eq + 1, semi - eq - 1));
+            cookies_.insert(std::make_pair(key.toString(), val.toString()));
+        }
+        begin = semi + 1;
+    }
+}
+
+const HttpRequest::StrMap& HttpRequest::getHeaders() const {
+    if (!headerMapValid_) {
+        headerMap_.clear();
+        for (size_t i = 0; i < headerCount_; i++) {
+            const Header& header = getHeaderAt(i);
+            headerMap_[header.name.toString()] = header.value.toString();
+        }
+        headerMapValid_ = true;
+    }
+    return headerMap_;
+}
+
+const HttpRequest::StrMap& HttpRequest::getParams() const {
+    parseParams();
+    return params_;
+}
+
+const HttpRequest::StrMap& HttpRequest::getCookies() const {
+    parseCookies();
+    return cookies_;
+}
+
+void HttpRequest::setHeaders(const StrMap& headers) {
+    headerCount_ = 0;
+    moreHeaders_.clear();
+    for (auto& it : headers) {
+        appendHeader(own(it.first), own(it.second));
+    }
+    reindexHeaders();
+}
+
+void HttpRequest::setParams(const StrMap& params) {
+    params_ = params;
+    paramsParsed_ = true;
+}
+
+void HttpRequest::setCookies(const StrMap& cookies) {
+    cookies_ = cookies;
+    cookiesParsed_ = true;
+}
+
+std::string HttpRequest::getHeader(const std::string& key) const {
+    int index = findHeader(key);
+    return index < 0 ? "header not found" : getHeaderAt(index).value.toString();
+}
+
+std::string HttpRequest::getParam(const std::string& key) const {
+    parseParams();
     auto it = params_.find(key);
     return it == params_.end() ? "param not found" : it->second;
 }
 
-std::string HttpRequest::getCookie(const std::string& key) {
+std::string HttpRequest::getCookie(const std::string& key) const {
+    parseCookies();
     auto it = cookies_.find(key);
     return it == cookies_.end() ? "cookie not found" : it->second;
 }
 
 void HttpRequest::addHeader(const std::string& key, const std::string& val) {
-    headers_[key] = val;
+    int index = findHeader(key);
+    if (index < 0) {
+        appendHeader(own(key), own(val));
+        return;
+    }
+    headerAt(index).value = own(val);
+    headerMapValid_ = false;
+    if (index == known_[COOKIE]) {
+        cookies_.clear();
+        cookiesParsed_ = false;
+    }
 }
 
 void HttpRequest::addParam(const std::string& key, const std::string& val) {
+    parseParams();
     params_[key] = val;
 }
 
 void HttpRequest::addCookie(const std::string& key, const std::string& val) {
+    parseCookies();
     cookies_[key] = val;
 }
 
 void HttpRequest::delHeader(const std::string& key) {
-    headers_.erase(key);
+    size_t count = 0;
+    for (size_t i = 0; i < headerCount_; i++) {
+        if (getHeaderAt(i).name.caseEqual(key)) {
+            continue;
+        }
+        headerAt(count++) = getHeaderAt(i);
+    }
+    headerCount_ = count;
+    if (moreHeaders_.size() > 0) {
+        moreHeaders_.resize(count > kInlineHeaders ? count - kInlineHeaders : 0);
+    }
+    reindexHeaders();
 }
 
 void HttpRequest::delParam(const std::string& key) {
+    parseParams();
     params_.erase(key);
 }
 
 void HttpRequest::delCookie(const std::string& key) {
+    parseCookies();
     cookies_.erase(key);
 }
 
@@ -84,11 +356,12 @@ std::ostream& HttpRequest::dump(std::ostream& os) const {
        << "." << (uint32_t)(version_ & 0x0F) << "\r\n"; 
 
     os << "connection: " << (keepAlive_ ? "keep-alive" : "close") << "\r\n";
-    for (auto& it : headers_) {
-        if (strcasecmp(it.first.c_str(), "connection") == 0) {
+    for (size_t i = 0; i < headerCount_; i++) {
+        const Header& header = getHeaderAt(i);
+        if (header.name.caseEqual("connection")) {
             continue;
         }
-        os << it.first << ": " << it.second << "\r\n";
+        os << header.name << ": " << header.value << "\r\n";
     }
 
     if (body_.empty()) {
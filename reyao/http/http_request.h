@@ -1,9 +1,14 @@
 #pragma once 
 
+#include "reyao/stringpiece.h"
+#include "reyao/nocopyable.h"
+
 #include <string.h>
 
 #include <string>
 #include <map>
+#include <list>
+#include <vector>
 #include <iostream>
 #include <sstream>
 #include <memory>
@@ -24,11 +29,40 @@ enum class HttpMethod {
     INVALID_METHOD
 };
 
-HttpMethod StringToHttpMethod(const std::string& s);
+HttpMethod StringToHttpMethod(const StringPiece& s);
 
 const char* HttpMethodToString(const HttpMethod& m);
 
-class HttpRequest {
+class HttpBodyReader;
+
+// 路由匹配出的路径参数，name 指向路由表，value 指向请求路径，都不拷贝
+struct RouteParams {
+    struct Param {
+        StringPiece name;
+        StringPiece value;
+    };
+    static const size_t kMaxParams = 8;
+
+    // 不存在时返回空视图
+    StringPiece get(const StringPiece& name) const {
+        for (size_t i = 0; i < size; i++) {
+            if (params[i].name == name) {
+                return params[i].value;
+            }
+        }
+        return StringPiece();
+    }
+    void clear() { size = 0; }
+
+    Param params[kMaxParams];
+    size_t size = 0;
+};
+
+// 解析得到的字段都是指向连接输入缓冲区的视图，不拷贝，
+// 在同一连接上的下一次 recvRequest 之前有效；setXxx/addXxx 传入的字符串由请求自己保存。
+// header 按到达顺序存放在扁平数组中，常用 header 解析时记录下标；
+// params 和 cookies 第一次访问时才解码
+class HttpRequest : public NoCopyable {
 public:
     class CaseInsensitiveLess {
     public:
@@ -36,37 +70,90 @@ public:
             return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
         }
     };
-    
+
+    enum KnownHeader {
+        HOST,
+        CONTENT_LENGTH,
+        CONNECTION,
+        TRANSFER_ENCODING,
+        CONTENT_TYPE,
+        COOKIE,
+        ACCEPT_ENCODING,
+        UPGRADE,
+        KNOWN_HEADER_COUNT
+    };
+
+    struct Header {
+        StringPiece name;
+        StringPiece value;
+    };
+
     typedef std::shared_ptr<HttpRequest> SPtr;
     typedef std::map<std::string, std::string,
                      CaseInsensitiveLess> StrMap;
+    // 超过 kInlineHeaders 个 header 时才分配内存
+    static const size_t kInlineHeaders = 16;
+
     HttpRequest(uint8_t version = 0x11, bool keepAlive = false);
 
     HttpMethod getMethod() const { return method_; }
     int8_t getVersion() const { return version_; }
     bool isKeepAlive() const { return keepAlive_; }
-    const std::string& getPath() const { return path_; }
-    const std::string& getQuery() const { return query_; }
-    const std::string& getFragment() const { return fragment_; }
-    const std::string& getBody() const { return body_; }
-    const StrMap& getHeaders() const { return headers_; }
-    const StrMap& getParams() const { return params_; }
-    const StrMap& getCookies() const { return cookies_; }
+    const StringPiece& getPath() const { return path_; }
+    const StringPiece& getQuery() const { return query_; }
+    const StringPiece& getFragment() const { return fragment_; }
+    const StringPiece& getBody() const { return body_; }
 
     void setMethod(HttpMethod method) { method_ = method; }
     void setVersion(uint8_t version) { version_ = version; }
     void setKeepAlive(bool v) { keepAlive_ = v; }
-    void setPath(const std::string& path) { path_ = path; }
-    void setQuery(const std::string& query) { query_ = query; }
-    void setFragment(const std::string& fragment) { fragment_ = fragment; }
-    void setBody(const std::string& body) { body_ = body; }
-    void setHeaders(const StrMap& headers) { headers_ = headers; }
-    void setParams(const StrMap& params) { params_ = params; }
-    void setCookies(const StrMap& cookies) { cookies_ = cookies; }
-
-    std::string getHeader(const std::string& key);
-    std::string getParam(const std::string& key);
-    std::string getCookie(const std::string& key);
+    void setPath(const std::string& path) { path_ = own(path); }
+    void setQuery(const std::string& query);
+    void setFragment(const std::string& fragment) { fragment_ = own(fragment); }
+    void setBody(const std::string& body) { body_ = own(body); }
+    void setBody(std::string&& body);
+
+    // 不拷贝，调用方保证底层内存的有效期
+    void setPathView(const StringPiece& path) { path_ = path; }
+    void setQueryView(const StringPiece& query);
+    void setFragmentView(const StringPiece& fragment) { fragment_ = fragment; }
+    void setBodyView(const StringPiece& body) { body_ = body; }
+    void appendHeader(const StringPiece& name, const StringPiece& value);
+
+    size_t getHeaderCount() const { return headerCount_; }
+    const Header& getHeaderAt(size_t i) const {
+        return i < kInlineHeaders ? headers_[i] : moreHeaders_[i - kInlineHeaders];
+    }
+    // 同名 header 取最后一个，不存在时返回空视图
+    StringPiece getHeaderView(KnownHeader key) const;
+    StringPiece getHeaderView(const StringPiece& key) const;
+    bool hasHeader(const StringPiece& key) const { return findHeader(key) >= 0; }
+
+    // 缓冲区被整理或扩容后，把落在 [oldBegin, oldEnd) 中的视图挪到 newBegin
+    void relocate(const char* oldBegin, const char* oldEnd, const char* newBegin);
+    // 把落在 [begin, end) 中的视图拷贝到请求自己的内存，之后不再依赖输入缓冲区
+    void detach(const char* begin, const char* end);
+
+    // 流式 body 模式下由 servlet 拉取 body，缓冲模式下为 nullptr，body 用 getBody 读取
+    HttpBodyReader* getBodyReader() const { return bodyReader_; }
+    void setBodyReader(HttpBodyReader* reader) { bodyReader_ = reader; }
+
+    // 路由中 ":name" 捕获的路径段，结尾 "*" 匹配的剩余部分名为 "*"
+    StringPiece getRouteParam(const StringPiece& name) const { return routeParams_.get(name); }
+    const RouteParams& getRouteParams() const { return routeParams_; }
+    RouteParams* getRouteParams() { return &routeParams_; }
+
+    // 兼容接口：第一次调用时构造 map，之后修改请求会使其失效
+    const StrMap& getHeaders() const;
+    const StrMap& getParams() const;
+    const StrMap& getCookies() const;
+    void setHeaders(const StrMap& headers);
+    void setParams(const StrMap& params);
+    void setCookies(const StrMap& cookies);
+
+    std::string getHeader(const std::string& key) const;
+    std::string getParam(const std::string& key) const;
+    std::string getCookie(const std::string& key) const;
 
     void addHeader(const std::string& key, const std::string& val);
     void addParam(const std::string& key, const std::string& val);
@@ -80,19 +167,39 @@ public:
     std::string toString();
 
 private:
+    StringPiece own(const std::string& str);
+    Header& headerAt(size_t i) {
+        return i < kInlineHeaders ? headers_[i] : moreHeaders_[i - kInlineHeaders];
+    }
+    int findHeader(const StringPiece& key) const;
+    void reindexHeaders();
+    void parseParams() const;
+    void parseCookies() const;
+
     HttpMethod method_;
     uint8_t version_;
     bool keepAlive_;
 
-    std::string path_;
-    std::string query_;
-    std::string fragment_;
-    std::string body_;
-
-    StrMap headers_;
-    StrMap params_;
-    StrMap cookies_;
-
+    StringPiece path_;
+    StringPiece query_;
+    StringPiece fragment_;
+    StringPiece body_;
+    HttpBodyReader* bodyReader_ = nullptr;
+    RouteParams routeParams_;
+
+    Header headers_[kInlineHeaders];
+    std::vector<Header> moreHeaders_;
+    size_t headerCount_ = 0;
+    int16_t known_[KNOWN_HEADER_COUNT];
+    // setXxx/addXxx 传入的字符串，list 保证元素地址不变
+    std::list<std::string> storage_;
+
+    mutable StrMap headerMap_;
+    mutable bool headerMapValid_ = false;
+    mutable StrMap params_;
+    mutable bool paramsParsed_ = false;
+    mutable StrMap cookies_;
+    mutable bool cookiesParsed_ = false;
 };
 
 
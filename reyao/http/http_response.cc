@@ -1,4 +1,10 @@
 #include "reyao/http/http_response.h"
+#include "reyao/http/http_session.h"
+#include "reyao/log.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 
 
 namespace reyao {
@@ -47,27 +53,295 @@ void HttpResponse::delHeader(const std::string& key) {
     headers_.erase(key);
 }
 
+void HttpResponse::HeaderBlock::add(const std::string& key, const std::string& val) {
+    size_t begin = data_.size();
+    data_.append(key).append(": ").append(val).append("\r\n");
+    lines_.push_back(std::make_pair(key, std::make_pair(begin, data_.size())));
+}
+
+char* HttpResponse::HeaderBlock::encode(char* p, const HeaderMap& headers) const {
+    if (headers.empty()) {
+        memcpy(p, data_.data(), data_.size());
+        return p + data_.size();
+    }
+    for (auto& line : lines_) {
+        if (headers.find(line.first) == headers.end()) {
+            size_t len = line.second.second - line.second.first;
+            memcpy(p, data_.data() + line.second.first, len);
+            p += len;
+        }
+    }
+    return p;
+}
+
+StringPiece HttpResponse::DateHeader() {
+    struct DateCache {
+        time_t sec;
+        size_t len;
+        char buf[64];
+    };
+    static thread_local DateCache cache = {-1, 0, {0}};
+    time_t now = ::time(nullptr);
+    if (now != cache.sec) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        cache.len = strftime(cache.buf, sizeof(cache.buf),
+                             "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        cache.sec = now;
+    }
+    return StringPiece(cache.buf, cache.len);
+}
+
 std::ostream& HttpResponse::dump(std::ostream& os) const {
-    os << "HTTP/" << ((uint32_t)(version_ >> 4))
-       << "." << ((uint32_t)(version_ & 0x0F))
-       << " " << (uint32_t)status_ << " "
-       << (reason_.empty() ? HttpStatusToString(status_) 
-          : reason_) << "\r\n";
-    os << "Connection: " << (keepAlive_ ? 
-          "Keep-Alive" : "Close") << "\r\n";
+    return dumpHeader(os) << body_;
+}
+
+std::ostream& HttpResponse::dumpHeader(std::ostream& os) const {
+    std::string buf(getHeaderSize(), '\0');
+    return os.write(&buf[0], encodeHeader(&buf[0]));
+}
+
+// HTTP/1.0 和 HTTP/1.1 的状态行，其他版本返回空
+static StringPiece StatusLine(HttpStatus s, uint8_t version) {
+#define LINE(v, code, string) \
+    StringPiece("HTTP/" v " " #code " " #string "\r\n", \
+                sizeof("HTTP/" v " " #code " " #string "\r\n") - 1)
+    if (version != 0x10 && version != 0x11) {
+        return StringPiece();
+    }
+    bool v10 = version == 0x10;
+    switch (s) {
+#define XX(code, name, string) \
+        case HttpStatus::name: \
+            return v10 ? LINE("1.0", code, string) : LINE("1.1", code, string);
+        HTTP_STATUS_MAP(XX);
+#undef XX
+#undef LINE
+    default:
+        return StringPiece();
+    }
+}
+
+static const size_t kMaxUintLen = 20;
+static const char kKeepAlive[] = "Connection: Keep-Alive\r\n";
+static const char kClose[] = "Connection: Close\r\n";
+static const char kUpgrade[] = "Connection: Upgrade\r\n";
+static const char kContentLength[] = "Content-Length: ";
+static const char kChunked[] = "Transfer-Encoding: chunked\r\n";
+static const char kLastChunk[] = "0\r\n\r\n";
+static const size_t kInlineFileSize = 16 * 1024;
+
+static char* Append(char* p, const char* str, size_t len) {
+    memcpy(p, str, len);
+    return p + len;
+}
+
+static char* AppendUint(char* p, uint64_t value) {
+    char tmp[kMaxUintLen];
+    char* end = tmp + kMaxUintLen;
+    char* begin = end;
+    do {
+        *--begin = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    return Append(p, begin, end - begin);
+}
+
+size_t HttpResponse::getHeaderSize() const {
+    // "HTTP/x.y ddd " + reason + CRLF
+    size_t size = 13 + kMaxUintLen + 2 +
+                  (reason_.empty() ? strlen(HttpStatusToString(status_)) : reason_.size());
+    size += sizeof(kKeepAlive) + date_.size();
+    if (defaultHeaders_) {
+        size += defaultHeaders_->size();
+    }
+    for (auto& it : headers_) {
+        size += it.first.size() + it.second.size() + 4;
+    }
+    size += sizeof(kContentLength) + sizeof(kChunked) + kMaxUintLen + 4;
+    return size;
+}
+
+size_t HttpResponse::encodeHeader(char* buf) const {
+    char* p = buf;
+    StringPiece line;
+    if (reason_.empty()) {
+        line = StatusLine(status_, version_);
+    }
+    if (!line.empty()) {
+        p = Append(p, line.data(), line.size());
+    } else {
+        p = Append(p, "HTTP/", 5);
+        *p++ = '0' + (version_ >> 4);
+        *p++ = '.';
+        *p++ = '0' + (version_ & 0x0F);
+        *p++ = ' ';
+        p = AppendUint(p, (uint32_t)status_);
+        *p++ = ' ';
+        const char* reason = reason_.empty() ? HttpStatusToString(status_)
+                                             : reason_.c_str();
+        p = Append(p, reason, reason_.empty() ? strlen(reason) : reason_.size());
+        p = Append(p, "\r\n", 2);
+    }
+    if (status_ == HttpStatus::SWITCHING_PROTOCOLS) {
+        p = Append(p, kUpgrade, sizeof(kUpgrade) - 1);
+    } else if (keepAlive_) {
+        p = Append(p, kKeepAlive, sizeof(kKeepAlive) - 1);
+    } else {
+        p = Append(p, kClose, sizeof(kClose) - 1);
+    }
+    if (!date_.empty() && (headers_.empty() || headers_.find("Date") == headers_.end())) {
+        p = Append(p, date_.data(), date_.size());
+    }
+    if (defaultHeaders_) {
+        p = defaultHeaders_->encode(p, headers_);
+    }
     for (auto& it : headers_) {
-        if (strcasecmp(it.first.c_str(), "connection") == 0) {
+        if (strcasecmp(it.first.c_str(), "connection") == 0 ||
+            strcasecmp(it.first.c_str(), "content-length") == 0 ||
+            strcasecmp(it.first.c_str(), "transfer-encoding") == 0) {
             continue;
         }
-        os << it.first << ": " << it.second << "\r\n";
+        p = Append(p, it.first.data(), it.first.size());
+        p = Append(p, ": ", 2);
+        p = Append(p, it.second.data(), it.second.size());
+        p = Append(p, "\r\n", 2);
+    }
+    if (chunked_) {
+        p = Append(p, kChunked, sizeof(kChunked) - 1);
+    } else if (status_ != HttpStatus::NOT_MODIFIED &&
+               status_ != HttpStatus::SWITCHING_PROTOCOLS &&
+               (!streaming_ || streamLength_ >= 0)) {
+        // 没有 body 时也带上 Content-Length: 0，keep-alive 的对端才能确定响应结束；
+        // 304 的 Content-Length 表示的是完整响应的长度，干脆不带；101 之后不再是 HTTP
+        p = Append(p, kContentLength, sizeof(kContentLength) - 1);
+        p = AppendUint(p, streaming_ ? streamLength_ : body_.size());
+        p = Append(p, "\r\n", 2);
+    }
+    p = Append(p, "\r\n", 2);
+    return p - buf;
+}
+
+bool HttpResponse::beginStream(int64_t contentLength, bool flush) {
+    if (streaming_ || !session_) {
+        return false;
+    }
+    streaming_ = true;
+    streamLength_ = contentLength;
+    if (contentLength < 0) {
+        if (version_ >= 0x11) {
+            chunked_ = true;
+        } else {
+            // HTTP/1.0 不支持 chunked，以关闭连接表示响应结束
+            keepAlive_ = false;
+        }
+    }
+    char* buf = session_->prepareAppend(getHeaderSize());
+    session_->commitAppend(encodeHeader(buf));
+    // 同一连接上排在前面的流水线响应随头部一起发出
+    if (flush && session_->flush() < 0) {
+        streamError_ = true;
+    }
+    return !streamError_;
+}
+
+bool HttpResponse::write(const void* data, size_t len) {
+    if (!streaming_ || streamEnded_ || streamError_) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+    if (streamLength_ >= 0 && streamed_ + len > (uint64_t)streamLength_) {
+        LOG_ERROR << "stream body exceeds Content-Length " << streamLength_;
+        streamError_ = true;
+        return false;
+    }
+    if (chunked_) {
+        char size[kMaxUintLen + 2];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", len);
+        session_->append(size, n);
+        session_->appendRef(data, len);
+        session_->append("\r\n", 2);
+    } else {
+        session_->appendRef(data, len);
+    }
+    // data 按引用排队，必须在返回前发出
+    if (session_->flush() < 0) {
+        streamError_ = true;
+        return false;
+    }
+    streamed_ += len;
+    return true;
+}
+
+bool HttpResponse::sendFile(int fd, off_t offset, size_t len) {
+    if (!streaming_ || streamEnded_ || streamError_ || chunked_) {
+        return false;
+    }
+    if (streamLength_ >= 0 && streamed_ + len > (uint64_t)streamLength_) {
+        LOG_ERROR << "stream body exceeds Content-Length " << streamLength_;
+        streamError_ = true;
+        return false;
+    }
+    int64_t n;
+    if (len <= kInlineFileSize) {
+        char* buf = session_->prepareAppend(len);
+        n = ::pread(fd, buf, len, offset);
+        session_->commitAppend(n > 0 ? n : 0);
+        if (n == (int64_t)len && session_->flush() < 0) {
+            n = -1;
+        }
+    } else {
+        n = session_->sendFile(fd, offset, len);
+    }
+    if (n != (int64_t)len) {
+        // 文件被截断时已经发出的部分无法撤回，只能关闭连接
+        streamError_ = true;
+        return false;
+    }
+    streamed_ += len;
+    return true;
+}
+
+bool HttpResponse::sendEncoded(const StringPiece& data, bool last) {
+    if (!session_ || streamEnded_ || streamError_) {
+        return false;
+    }
+    streaming_ = true;
+    session_->appendRef(data.data(), data.size());
+    if (last) {
+        streamEnded_ = true;
+        if (session_->flush() < 0) {
+            streamError_ = true;
+        }
+    }
+    return !streamError_;
+}
+
+bool HttpResponse::endStream() {
+    if (!streaming_ || streamEnded_) {
+        return streaming_ && !streamError_;
+    }
+    streamEnded_ = true;
+    if (streamError_) {
+        return false;
+    }
+    if (chunked_) {
+        session_->append(kLastChunk, sizeof(kLastChunk) - 1);
+        if (session_->flush() < 0) {
+            streamError_ = true;
+        }
+    } else if (streamLength_ >= 0 && streamed_ != (uint64_t)streamLength_) {
+        LOG_ERROR << "stream body " << streamed_ << " bytes, Content-Length "
+                  << streamLength_;
+        streamError_ = true;
     }
-    if (body_.empty()) {
-        os << "\r\n";
-    } else { //TODO: add chunked
-        os << "Content-Length: " << body_.size()
-           << "\r\n\r\n" << body_;
+    // beginStream 没有 flush 且 body 为空时头部还在发送队列中
+    if (!streamError_ && session_->getPendingSize() > 0 && session_->flush() < 0) {
+        streamError_ = true;
     }
-    return os;
+    return !streamError_;
 }
 
 std::string HttpResponse::toString() {
@@ -1,23 +1,35 @@
 #pragma once 
 
+#include "reyao/stringpiece.h"
+
 #include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include <string>
 #include <map>
+#include <vector>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <functional>
 
 namespace reyao {
 
 
 /* Status Codes */
 #define HTTP_STATUS_MAP(XX)                                                 \
+  XX(101, SWITCHING_PROTOCOLS,             Switching Protocols)             \
   XX(200, OK,                              OK)                              \
+  XX(206, PARTIAL_CONTENT,                 Partial Content)                 \
   XX(301, MOVED_PERMANENTLY,               Moved Permanently)               \
+  XX(304, NOT_MODIFIED,                    Not Modified)                    \
   XX(400, BAD_REQUEST,                     Bad Request)                     \
   XX(401, UNAUTHORIZED,                    Unauthorized)                    \
   XX(404, NOT_FOUND,                       Not Found)                       \
+  XX(413, PAYLOAD_TOO_LARGE,               Payload Too Large)               \
+  XX(416, RANGE_NOT_SATISFIABLE,           Range Not Satisfiable)           \
+  XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
   XX(500, INTERNAL_SERVER_ERROR,           Internal Server Error)           \
 
 
@@ -32,6 +44,19 @@ const char* HttpStatusToString(const HttpStatus& s);
 
 bool isHttpStatus(int status);
 
+class HttpSession;
+class Socket;
+class Worker;
+
+// 被 servlet 接管的连接（SSE、协议升级等）：HttpServer 发出响应头部后不再读写，
+// 连接交给 handler 持有。close 关闭连接并释放连接计数，只能在 worker 上调用一次
+struct HttpTakeover {
+    std::shared_ptr<Socket> client;
+    Worker* worker = nullptr;
+    std::string buffered;           // 已经读入但不属于这个请求的数据，如升级后对端紧接着发的帧
+    std::function<void()> close;
+};
+
 class HttpResponse {
 public:
     class CaseInsensitiveLess {
@@ -44,6 +69,31 @@ public:
     typedef std::shared_ptr<HttpResponse> SPtr;
     typedef std::map<std::string, std::string,
                      CaseInsensitiveLess> HeaderMap;
+
+    // 预先编码好的一组头部（如服务器级的默认头部），每个响应整块拷贝，不再逐个格式化；
+    // 响应自己设置了同名头部时跳过对应的行
+    class HeaderBlock {
+    public:
+        void add(const std::string& key, const std::string& val);
+        bool empty() const { return data_.empty(); }
+        size_t size() const { return data_.size(); }
+        char* encode(char* p, const HeaderMap& headers) const;
+        // 按顺序对每一行调用 func(name, value)
+        template <typename Func>
+        void forEach(const Func& func) const {
+            for (auto& line : lines_) {
+                size_t begin = line.second.first + line.first.size() + 2;
+                func(line.first, StringPiece(data_.data() + begin,
+                                             line.second.second - begin - 2));
+            }
+        }
+
+    private:
+        std::string data_;
+        // 每一行的头部名和在 data_ 中的 [begin, end)
+        std::vector<std::pair<std::string, std::pair<size_t, size_t>>> lines_;
+    };
+
     HttpResponse(uint8_t version = 0x11, bool keepAlive = false);
 
     HttpStatus getStatus() const { return status_; }
@@ -65,7 +115,52 @@ public:
     void addHeader(const std::string& key, const std::string& val);
     void delHeader(const std::string& key);
 
+    // 由 HttpServer 设置，block 的生命周期由调用方保证
+    void setDefaultHeaders(const HeaderBlock* block) { defaultHeaders_ = block; }
+    const HeaderBlock* getDefaultHeaders() const { return defaultHeaders_; }
+    // date 是完整的 "Date: ...\r\n" 行，通常来自 DateHeader()
+    void setDate(const StringPiece& date) { date_ = date; }
+    const StringPiece& getDate() const { return date_; }
+    // 当前线程缓存的 Date 头部行，每秒最多格式化一次；
+    // 返回的内容在同一线程下一秒会被改写，只能在编码前使用
+    static StringPiece DateHeader();
+
     std::ostream& dump(std::ostream& os) const;
+    // 只输出状态行和头部（包括 Content-Length 和空行），body 由调用方单独发送
+    std::ostream& dumpHeader(std::ostream& os) const;
+
+    // 编码后头部长度的上界
+    size_t getHeaderSize() const;
+    // 把状态行和头部直接编码到 buf，buf 至少有 getHeaderSize() 字节，返回实际长度；
+    // 标准原因短语的状态行是预先拼好的常量
+    size_t encodeHeader(char* buf) const;
+
+    // 流式响应：HttpServer 在分发前绑定连接，servlet 调用 beginStream 先发出头部，
+    // 之后每次 write 直接写 socket，发送缓冲区满时由 hook 挂起协程，内存占用与 body 大小无关。
+    // contentLength 已知时使用 Content-Length，否则使用 chunked（HTTP/1.0 改为发完关闭连接）；
+    // servlet 返回后未结束的流由 HttpServer 调用 endStream 结束
+    void bindSession(HttpSession* session) { session_ = session; }
+    bool isBound() const { return session_ != nullptr; }
+    // flush 为 false 时头部留在发送队列，随第一次 write/sendFile 一起发出
+    bool beginStream(int64_t contentLength = -1, bool flush = true);
+    bool write(const void* data, size_t len);
+    bool write(const StringPiece& data) { return write(data.data(), data.size()); }
+    // 用 sendfile 发送文件的 [offset, offset + len)，只能用于已知长度的流；
+    // 小块直接 pread 进发送缓冲区，和排队的头部一起 writev，省一次系统调用
+    bool sendFile(int fd, off_t offset, size_t len);
+    // 已知长度时写入的字节数必须与 contentLength 一致，否则返回 false，连接应关闭
+    bool endStream();
+    // 直接发送已经编码好的完整响应（如缓存的响应），data 按引用排队，
+    // last 为 true 时把排队的各段一次 writev 发出；之后 HttpServer 不再发送这个响应
+    bool sendEncoded(const StringPiece& data, bool last = true);
+    bool isChunked() const { return chunked_; }
+    // 设置后 servlet 返回时 HttpServer 发出响应（流式响应只 flush 头部），
+    // 然后在当前协程中调用 func 把连接交出去
+    typedef std::function<void(HttpTakeover&)> TakeoverFunc;
+    void setTakeover(TakeoverFunc func) { takeover_ = func; }
+    const TakeoverFunc& getTakeover() const { return takeover_; }
+    bool isStreaming() const { return streaming_; }
+    bool isStreamEnded() const { return streamEnded_; }
     std::string toString();
 
 private:
@@ -76,6 +171,17 @@ private:
     std::string body_;
     std::string reason_;
     HeaderMap headers_;
+    const HeaderBlock* defaultHeaders_ = nullptr;
+    StringPiece date_;
+    TakeoverFunc takeover_;
+
+    HttpSession* session_ = nullptr;
+    bool streaming_ = false;
+    bool streamEnded_ = false;
+    bool streamError_ = false;
+    bool chunked_ = false;
+    int64_t streamLength_ = -1;
+    uint64_t streamed_ = 0;
 
 };
 
@@ -0,0 +1,278 @@
+#include "reyao/http/http_router.h"
+#include "reyao/http/http_servlet.h"
+#include "reyao/mutex.h"
+
+#include <unordered_set>
+
+namespace reyao {
+
+struct RadixRouter::Node {
+    std::string prefix;                         // 压缩后的静态片段
+    std::string indices;                        // 各静态子节点 prefix 的首字符
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;                // ":name" 子节点
+    StringPiece paramName;                      // 只在参数和通配节点上有效，指向驻留表或字面量
+    std::unique_ptr<Node> wildcard;             // 结尾 "*" 子节点
+    ServletPtr servlet;
+
+    Node() = default;
+    Node(const Node& rhs)
+        : prefix(rhs.prefix),
+          indices(rhs.indices),
+          paramName(rhs.paramName),
+          servlet(rhs.servlet) {
+        for (auto& child : rhs.children) {
+            children.emplace_back(new Node(*child));
+        }
+        if (rhs.param) {
+            param.reset(new Node(*rhs.param));
+        }
+        if (rhs.wildcard) {
+            wildcard.reset(new Node(*rhs.wildcard));
+        }
+    }
+
+    Node* child(char c) const {
+        size_t i = indices.find(c);
+        return i == std::string::npos ? nullptr : children[i].get();
+    }
+};
+
+// 参数名种类很少，驻留后永不释放
+static StringPiece InternName(const std::string& name) {
+    static Mutex mutex;
+    static std::unordered_set<std::string> names;
+    MutexGuard lock(mutex);
+    return *names.insert(name).first;
+}
+
+static bool IsParamStart(const std::string& pattern, size_t i) {
+    return pattern[i] == ':' && (i == 0 || pattern[i - 1] == '/');
+}
+
+static bool IsWildcard(const std::string& pattern, size_t i) {
+    return pattern[i] == '*' && i + 1 == pattern.size();
+}
+
+static size_t CommonPrefix(const StringPiece& lhs, const StringPiece& rhs) {
+    size_t n = std::min(lhs.size(), rhs.size());
+    size_t i = 0;
+    while (i < n && lhs[i] == rhs[i]) {
+        ++i;
+    }
+    return i;
+}
+
+RadixRouter::RadixRouter()
+    : root_(new Node) {
+}
+
+RadixRouter::RadixRouter(const RadixRouter& rhs)
+    : root_(new Node(*rhs.root_)),
+      size_(rhs.size_) {
+}
+
+RadixRouter::~RadixRouter() {
+}
+
+bool RadixRouter::IsRoutable(const std::string& pattern) {
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        if (c == '?' || c == '[' || (c == '*' && !IsWildcard(pattern, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RadixRouter::Node* RadixRouter::insertStatic(Node* node, const StringPiece& str) {
+    StringPiece rest = str;
+    while (!rest.empty()) {
+        Node* child = node->child(rest[0]);
+        if (!child) {
+            std::unique_ptr<Node> leaf(new Node);
+            leaf->prefix = rest.toString();
+            Node* res = leaf.get();
+            node->indices.push_back(rest[0]);
+            node->children.push_back(std::move(leaf));
+            return res;
+        }
+        size_t common = CommonPrefix(child->prefix, rest);
+        if (common < child->prefix.size()) {
+            // 拆分边：child 变成新中间节点的子节点
+            size_t i = node->indices.find(rest[0]);
+            std::unique_ptr<Node> mid(new Node);
+            mid->prefix = child->prefix.substr(0, common);
+            std::unique_ptr<Node> old = std::move(node->children[i]);
+            old->prefix.erase(0, common);
+            mid->indices.push_back(old->prefix[0]);
+            mid->children.push_back(std::move(old));
+            node->children[i] = std::move(mid);
+            child = node->children[i].get();
+        }
+        node = child;
+        rest.removePrefix(common);
+    }
+    return node;
+}
+
+bool RadixRouter::add(const std::string& pattern, ServletPtr servlet) {
+    if (pattern.find('*') < pattern.size() - 1) {
+        return false;
+    }
+    Node* node = root_.get();
+    size_t params = 0;
+    size_t i = 0;
+    while (i < pattern.size()) {
+        if (IsParamStart(pattern, i)) {
+            size_t end = pattern.find('/', i);
+            if (end == std::string::npos) {
+                end = pattern.size();
+            }
+            std::string name = pattern.substr(i + 1, end - i - 1);
+            if (name.empty() || ++params > RouteParams::kMaxParams) {
+                return false;
+            }
+            if (!node->param) {
+                node->param.reset(new Node);
+                node->param->paramName = InternName(name);
+            } else if (node->param->paramName != name) {
+                return false;
+            }
+            node = node->param.get();
+            i = end;
+        } else if (IsWildcard(pattern, i)) {
+            if (++params > RouteParams::kMaxParams) {
+                return false;
+            }
+            if (!node->wildcard) {
+                node->wildcard.reset(new Node);
+                node->wildcard->paramName = "*";
+            }
+            node = node->wildcard.get();
+            ++i;
+        } else {
+            size_t j = i;
+            while (j < pattern.size() &&
+                   !IsParamStart(pattern, j) && !IsWildcard(pattern, j)) {
+                ++j;
+            }
+            node = insertStatic(node, StringPiece(pattern.data() + i, j - i));
+            i = j;
+        }
+    }
+    if (!node->servlet) {
+        ++size_;
+    }
+    node->servlet = servlet;
+    return true;
+}
+
+RadixRouter::Node* RadixRouter::lookup(const std::string& pattern) const {
+    Node* node = root_.get();
+    size_t i = 0;
+    while (node && i < pattern.size()) {
+        if (IsParamStart(pattern, i)) {
+            size_t end = pattern.find('/', i);
+            if (end == std::string::npos) {
+                end = pattern.size();
+            }
+            if (!node->param ||
+                node->param->paramName !=
+                StringPiece(pattern.data() + i + 1, end - i - 1)) {
+                return nullptr;
+            }
+            node = node->param.get();
+            i = end;
+        } else if (IsWildcard(pattern, i)) {
+            node = node->wildcard.get();
+            ++i;
+        } else {
+            Node* child = node->child(pattern[i]);
+            if (!child || pattern.compare(i, child->prefix.size(), child->prefix) != 0) {
+                return nullptr;
+            }
+            node = child;
+            i += child->prefix.size();
+        }
+    }
+    return node;
+}
+
+bool RadixRouter::remove(const std::string& pattern) {
+    Node* node = lookup(pattern);
+    if (!node || !node->servlet) {
+        return false;
+    }
+    // 只摘掉 servlet，不回收节点
+    node->servlet.reset();
+    --size_;
+    return true;
+}
+
+RadixRouter::ServletPtr RadixRouter::find(const std::string& pattern) const {
+    Node* node = lookup(pattern);
+    return node ? node->servlet : nullptr;
+}
+
+const RadixRouter::Node* RadixRouter::match(const Node* node, StringPiece path,
+                                            RouteParams* params) const {
+    if (path.empty() && node->servlet) {
+        return node;
+    }
+    if (!path.empty()) {
+        const Node* child = node->child(path[0]);
+        if (child && path.startsWith(child->prefix)) {
+            StringPiece rest = path;
+            rest.removePrefix(child->prefix.size());
+            const Node* res = match(child, rest, params);
+            if (res) {
+                return res;
+            }
+        }
+        if (node->param && path[0] != '/') {
+            size_t len = 0;
+            while (len < path.size() && path[len] != '/') {
+                ++len;
+            }
+            size_t saved = params->size;
+            if (params->size < RouteParams::kMaxParams) {
+                RouteParams::Param& param = params->params[params->size++];
+                param.name = node->param->paramName;
+                param.value.set(path.data(), len);
+            }
+            StringPiece rest = path;
+            rest.removePrefix(len);
+            const Node* res = match(node->param.get(), rest, params);
+            if (res) {
+                return res;
+            }
+            params->size = saved;
+        }
+    }
+    if (node->wildcard && node->wildcard->servlet) {
+        if (params->size < RouteParams::kMaxParams) {
+            RouteParams::Param& param = params->params[params->size++];
+            param.name = node->wildcard->paramName;
+            param.value = path;
+        }
+        return node->wildcard.get();
+    }
+    return nullptr;
+}
+
+RadixRouter::ServletPtr RadixRouter::match(const StringPiece& path, RouteParams* params,
+                                           bool* wildcard) const {
+    RouteParams local;
+    if (!params) {
+        params = &local;
+    }
+    params->clear();
+    const Node* node = match(root_.get(), path, params);
+    if (wildcard) {
+        *wildcard = node && node->paramName == "*";
+    }
+    return node ? node->servlet : nullptr;
+}
+
+} // namespace reyao
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "reyao/http/http_request.h"
+#include "reyao/stringpiece.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reyao {
+
+class Servlet;
+
+// 压缩前缀树路由，支持三种路径片段：
+//   静态片段      /api/users
+//   ":name"      捕获一个路径段（到下一个 '/' 为止），不能为空
+//   结尾的 "*"   匹配剩余的全部路径（可以为空），捕获的参数名为 "*"
+// 匹配优先级为静态 > 参数 > 通配，失败时回溯；匹配过程不分配内存。
+// 参数名驻留在进程级的表中，路由树被替换或析构后 RouteParams 的 name 仍然有效。
+// 拷贝是深拷贝，ServletDispatch 用它做写时复制
+class RadixRouter {
+public:
+    typedef std::shared_ptr<Servlet> ServletPtr;
+
+    RadixRouter();
+    RadixRouter(const RadixRouter& rhs);
+    RadixRouter& operator=(const RadixRouter&) = delete;
+    ~RadixRouter();
+
+    // 同一位置的参数名不一致、参数过多或 '*' 不在结尾时返回 false
+    bool add(const std::string& pattern, ServletPtr servlet);
+    bool remove(const std::string& pattern);
+    // 按注册时的 pattern 精确查找
+    ServletPtr find(const std::string& pattern) const;
+    // params 可以为空；wildcard 返回是否是通过结尾 "*" 匹配上的
+    ServletPtr match(const StringPiece& path, RouteParams* params,
+                     bool* wildcard = nullptr) const;
+    size_t size() const { return size_; }
+
+    // pattern 能否放进路由树：只有结尾可以是 '*'
+    static bool IsRoutable(const std::string& pattern);
+
+private:
+    struct Node;
+
+    Node* insertStatic(Node* node, const StringPiece& str);
+    Node* lookup(const std::string& pattern) const;
+    const Node* match(const Node* node, StringPiece path, RouteParams* params) const;
+
+    std::unique_ptr<Node> root_;
+    size_t size_ = 0;
+};
+
+} // namespace reyao
@@ -1,45 +1,355 @@
 #include "reyao/http/http_server.h"
+#include "reyao/hook.h"
+#include "reyao/util.h"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
 
 namespace reyao {
 
 HttpServer::HttpServer(Scheduler* sche,
-                       IPv4Address::SPtr addr,
+                       Address::SPtr addr,
                        bool keepAlive) 
     : TcpServer(sche, addr, "HttpServer"),
       keepAlive_(keepAlive) {
     dispatch_.reset(new ServletDispatch);
+    defaultHeaders_.add("Server", "Reyao");
+}
+
+// 流式 body 的 servlet 没读完的部分，超过这个大小就直接关闭连接
+static const uint64_t kMaxDiscardBody = 64 * 1024;
+static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+// RFC 7540 3.2：Upgrade 中有 h2c，Connection 中列出了 HTTP2-Settings，
+// HTTP2-Settings 是 base64url 编码的 SETTINGS payload
+static bool IsHttp2Upgrade(const HttpRequest& req, std::string* settings) {
+    return HasToken(req.getHeaderView(HttpRequest::UPGRADE), "h2c") &&
+           HasToken(req.getHeaderView(HttpRequest::CONNECTION), "HTTP2-Settings") &&
+           req.hasHeader("HTTP2-Settings") &&
+           Base64Decode(req.getHeaderView("HTTP2-Settings"), settings);
 }
 
 void HttpServer::handleClient(Socket::SPtr client) {
-    HttpSession session(client);
+    // session 不持有连接，park 之后连接还要继续使用
+    HttpSession session(client, false);
+    session.setLimits(limits_);
     do {
         HttpRequest req;
-        if (!session.recvRequest(&req)) {
-            LOG_WARN << "recv http request fail, client="
-                     << client->toString();
+        if (!session.recvRequestHeader(&req)) {
+            sendError(&session, session.getParseError());
             break;
         }
-        std::string con_info = req.getHeader("Connection");
-        if (!strcasecmp(con_info.c_str(), "Keep-Alive")) {
+        if (req.getVersion() == 0x20) {
+            // prior knowledge：连接前言的前半部分，剩下的交给 HTTP/2 处理
+            if (!http2_.enable || !session.recvRequestBody() ||
+                !handOver(&session, client, [this](HttpTakeover& conn) {
+                    Http2Connection(this, conn, http2_).run();
+                })) {
+                break;
+            }
+            return;
+        }
+        if (req.getHeaderView(HttpRequest::CONNECTION).caseEqual("Keep-Alive")) {
             req.setKeepAlive(true);
         }
 
+        // 先匹配 servlet，再决定 body 是读进内存还是交给 servlet 流式读取
+        Servlet::SPtr servlet = dispatch_->getMatchServlet(req.getPath(),
+                                                           req.getRouteParams());
+        bool streamBody = servlet->isStreamBody();
+        if (session.hasRequestBody()) {
+            const HttpRequestParser& parser = session.getRequestParser();
+            // chunked 没有总长度，由 parser 在读到每个 chunk 的大小行时检查
+            uint64_t limit = streamBody ? limits_.maxStreamBodySize : limits_.maxBodySize;
+            if (limit && !parser.isChunked() && parser.getContentLength() > limit) {
+                sendError(&session, HttpParser::ERROR_BODY_TOO_LARGE);
+                break;
+            }
+            if (req.getHeaderView("Expect").caseEqual("100-continue") &&
+                session.write(kContinue, sizeof(kContinue) - 1) < 0) {
+                break;
+            }
+        }
+        if (streamBody) {
+            session.beginBodyStream();
+        } else if (!session.recvRequestBody()) {
+            sendError(&session, session.getParseError());
+            break;
+        }
+        std::string settings;
+        if (http2_.enable && !streamBody && IsHttp2Upgrade(req, &settings)) {
+            // 回复 101 后这个请求作为 HTTP/2 的 stream 1 处理
+            HttpResponse rsp(0x11, true);
+            rsp.setStatus(HttpStatus::SWITCHING_PROTOCOLS);
+            rsp.addHeader("Upgrade", "h2c");
+            rsp.setTakeover([this, &req, &settings](HttpTakeover& conn) {
+                Http2Connection(this, conn, http2_).run(&req, settings);
+            });
+            if (takeover(&session, client, &rsp)) {
+                return;
+            }
+            break;
+        }
+
         HttpResponse rsp(req.getVersion(),
                          req.isKeepAlive() && keepAlive_);
-  
-        dispatch_->handle(req, &rsp, session);
-        // rsp.addHeader("Server", "reyao");
-        // rsp.addHeader("Conetnt-Type", "text/plain");
-        // rsp.setBody("hello, world!\n");
- 
-        session.sendResponse(&rsp);
-
-        if (!keepAlive_ || !req.isKeepAlive()) {
+        if (servlet->isAsync()) {
+            AsyncResponse::SPtr async(new AsyncResponse(rsp.getVersion(), rsp.isKeepAlive()));
+            prepare(async->getResponse());
+            static_cast<AsyncServlet*>(servlet.get())->handleAsync(req, async);
+            // 输入缓冲区里还有流水线请求或 body 没读完时不能丢掉 session，只能在协程中等待
+            if (!streamBody && !session.hasBufferedInput() &&
+                detachAsync(req, client, async)) {
+                return;
+            }
+            async->wait();
+            rsp = std::move(*async->getResponse());
+            rsp.bindSession(&session);
+        } else {
+            rsp.bindSession(&session);
+            prepare(&rsp);
+            servlet->handle(req, &rsp, session);
+        }
+        if (streamBody && !session.discardBody(kMaxDiscardBody)) {
+            rsp.setKeepAlive(false);
+        }
+
+        if (rsp.getTakeover()) {
+            if (takeover(&session, client, &rsp)) {
+                return;
+            }
             break;
         }
+        if (rsp.isStreaming()) {
+            // 流式响应已经边生成边发出，这里只补上结束标记
+            if (!rsp.endStream() || !rsp.isKeepAlive()) {
+                break;
+            }
+        } else {
+            if (gzip_.enable) {
+                compress(req.getPath(), req.getHeaderView(HttpRequest::ACCEPT_ENCODING), &rsp);
+            }
+            bool keepAlive = rsp.isKeepAlive();
+            // 流水线：缓冲区里还有请求时响应先排队，整批一次 writev 发出
+            session.sendResponse(&rsp, keepAlive && session.hasBufferedInput());
+            if (!keepAlive) {
+                break;
+            }
+        }
+        if (session.hasBufferedInput()) {
+            continue;
+        }
+        // 请求之间连接空闲，交给 epoller 等待可读，释放当前协程和解析器
+        if (parkIdle_ && park(client)) {
+            return;
+        }
     } while (true);
-    
+
+    // 后面的流水线请求解析失败时，前面排队的响应仍要发出
+    if (session.getPendingSize() > 0) {
+        session.flush();
+    }
     session.close();
 }
 
+void HttpServer::prepare(HttpResponse* rsp) const {
+    if (!defaultHeaders_.empty()) {
+        rsp->setDefaultHeaders(&defaultHeaders_);
+    }
+    if (dateHeader_) {
+        rsp->setDate(HttpResponse::DateHeader());
+    }
+}
+
+void HttpServer::setGzip(const GzipOptions& options) {
+    gzip_ = options;
+    gzipCache_.reset(options.enable && options.cacheSize > 0 ?
+                     new GzipCache(options.cacheSize) : nullptr);
+}
+
+bool HttpServer::detachAsync(const HttpRequest& req, Socket::SPtr client,
+                             const AsyncResponse::SPtr& async) {
+    int index = getWorkerIndex();
+    int fd = client->getSockfd();
+    if (index < 0 || !client->isConnected()) {
+        return false;
+    }
+    std::weak_ptr<AsyncResponse> weak(async);
+    if (!Worker::AddEvent(fd, EPOLLIN, std::bind(&HttpServer::watchAsync, this,
+                                                 weak, client, index))) {
+        return false;
+    }
+    std::string acceptEncoding;
+    if (gzip_.enable) {
+        acceptEncoding = req.getHeaderView(HttpRequest::ACCEPT_ENCODING).toString();
+    }
+    auto resume = std::bind(&HttpServer::resumeAsync, this, std::placeholders::_1,
+                            client, index, req.getPath().toString(), acceptEncoding);
+    auto abandon = std::bind(&HttpServer::closeAsync, this, client, index);
+    if (!async->detach(Worker::GetWorker(), resume, abandon)) {
+        // handleAsync 里已经 complete，直接在当前协程发送
+        Worker::DelEvent(fd, EPOLLIN);
+        return false;
+    }
+    detach();
+    return true;
+}
+
+void HttpServer::resumeAsync(const AsyncResponse::SPtr& async, Socket::SPtr client,
+                             int index, const std::string& path,
+                             const std::string& acceptEncoding) {
+    Worker::DelEvent(client->getSockfd(), EPOLLIN);
+    Worker::DelEvent(client->getSockfd(), EPOLLRDHUP);
+    HttpResponse* rsp = async->getResponse();
+    // Date 是请求开始时取的，按完成的时间更新
+    if (dateHeader_) {
+        rsp->setDate(HttpResponse::DateHeader());
+    }
+    HttpSession session(client, false);
+    rsp->bindSession(&session);
+    if (gzip_.enable) {
+        compress(path, acceptEncoding, rsp);
+    }
+    bool keepAlive = rsp->isKeepAlive();
+    if (!session.sendResponse(rsp) || !keepAlive) {
+        closeDetached(client, index);
+        return;
+    }
+    resumeDetached(client, index, parkIdle_);
+}
+
+void HttpServer::watchAsync(std::weak_ptr<AsyncResponse> weak, Socket::SPtr client,
+                            int index) {
+    auto async = weak.lock();
+    if (!async || async->state_ != AsyncResponse::DETACHED) {
+        return;
+    }
+    char c;
+    ssize_t n = recv_origin(client->getSockfd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n > 0) {
+        // 客户端提前发来了下一个请求，留在内核缓冲区，连接恢复后再读；
+        // 数据一直可读，改为只在对端关闭时触发
+        Worker::AddEvent(client->getSockfd(), EPOLLRDHUP,
+                         std::bind(&HttpServer::closeWatchedAsync, this, weak, client, index));
+        return;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        Worker::AddEvent(client->getSockfd(), EPOLLIN,
+                         std::bind(&HttpServer::watchAsync, this, weak, client, index));
+        return;
+    }
+    if (async->close()) {
+        closeDetached(client, index);
+    }
+}
+
+bool HttpServer::takeover(HttpSession* session, Socket::SPtr client, HttpResponse* rsp) {
+    // 流式响应的头部可能还在发送队列里，由 handOver 发出
+    if (!rsp->isStreaming() && !session->sendResponse(rsp)) {
+        return false;
+    }
+    return handOver(session, client, rsp->getTakeover());
+}
+
+bool HttpServer::handOver(HttpSession* session, Socket::SPtr client,
+                          const HttpResponse::TakeoverFunc& func) {
+    int index = getWorkerIndex();
+    if (index < 0) {
+        return false;
+    }
+    if (session->getPendingSize() > 0 && session->flush() < 0) {
+        return false;
+    }
+    HttpTakeover conn;
+    conn.client = client;
+    conn.worker = Worker::GetWorker();
+    conn.buffered = session->takeBufferedInput();
+    conn.close = std::bind(&HttpServer::closeDetached, this, client, index);
+    detach();
+    func(conn);
+    return true;
+}
+
+void HttpServer::closeWatchedAsync(std::weak_ptr<AsyncResponse> weak, Socket::SPtr client,
+                                   int index) {
+    auto async = weak.lock();
+    if (async && async->close()) {
+        closeDetached(client, index);
+    }
+}
+
+void HttpServer::closeAsync(Socket::SPtr client, int index) {
+    Worker::DelEvent(client->getSockfd(), EPOLLIN);
+    Worker::DelEvent(client->getSockfd(), EPOLLRDHUP);
+    closeDetached(client, index);
+}
+
+void HttpServer::compress(const StringPiece& path, const StringPiece& acceptEncoding,
+                          HttpResponse* rsp) {
+    const std::string& body = rsp->getBody();
+    if (rsp->getStatus() != HttpStatus::OK || body.size() < gzip_.minSize) {
+        return;
+    }
+    const HttpResponse::HeaderMap& headers = rsp->getHeaders();
+    auto type = headers.find("Content-Type");
+    if (type == headers.end() || !Gzip::IsCompressible(type->second) ||
+        headers.find("Content-Encoding") != headers.end()) {
+        return;
+    }
+    // 同一个 url 有两种表示，中间缓存需要按 Accept-Encoding 区分
+    rsp->addHeader("Vary", "Accept-Encoding");
+    if (!Gzip::IsAccepted(acceptEncoding)) {
+        return;
+    }
+    auto etag = headers.find("ETag");
+    std::string key;
+    GzipCache::DataPtr data;
+    if (gzipCache_ && etag != headers.end()) {
+        // 不同资源的 ETag 可能相同，带上路径
+        key = path.toString() + " " + etag->second;
+        data = gzipCache_->get(key);
+    }
+    if (!data) {
+        std::shared_ptr<std::string> out(new std::string);
+        if (!Gzip::Compress(body.data(), body.size(), out.get(), gzip_.level) ||
+            out->size() >= body.size()) {
+            return;
+        }
+        data = out;
+        if (!key.empty()) {
+            gzipCache_->put(key, data);
+        }
+    }
+    if (etag != headers.end()) {
+        rsp->addHeader("ETag", Gzip::ETag(etag->second));
+    }
+    rsp->addHeader("Content-Encoding", "gzip");
+    rsp->setBody(*data);
+}
+
+void HttpServer::sendError(HttpSession* session, HttpParser::ParseError error) {
+    HttpStatus status;
+    switch (error) {
+        case HttpParser::ERROR_BAD_REQUEST:
+            status = HttpStatus::BAD_REQUEST;
+            break;
+        case HttpParser::ERROR_HEADER_TOO_LARGE:
+            status = HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE;
+            break;
+        case HttpParser::ERROR_BODY_TOO_LARGE:
+            status = HttpStatus::PAYLOAD_TOO_LARGE;
+            break;
+        default:
+            LOG_WARN << "recv http request fail, client="
+                     << session->getSock()->toString();
+            return;
+    }
+    LOG_WARN << "bad http request, status=" << (int)status << " client="
+             << session->getSock()->toString();
+    HttpResponse rsp(0x11, false);
+    rsp.setStatus(status);
+    prepare(&rsp);
+    session->sendResponse(&rsp);
+}
+
 } // namespace reyaop
\ No newline at end of file
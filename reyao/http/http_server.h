@@ -3,6 +3,9 @@
 #include "reyao/tcp_server.h"
 #include "reyao/http/http_session.h"
 #include "reyao/http/http_servlet.h"
+#include "reyao/http/http_gzip.h"
+#include "reyao/http/http_async.h"
+#include "reyao/http/http2_connection.h"
 
 namespace reyao {
 
@@ -10,17 +13,69 @@ class HttpServer : public TcpServer {
 public:
     typedef std::shared_ptr<HttpServer> SPtr;
     HttpServer(Scheduler* sche,
-               IPv4Address::SPtr addr,
+               Address::SPtr addr,
                bool keepAlive = false);
 
     void handleClient(Socket::SPtr client) override;
 
     ServletDispatch::SPtr getDispatch() const { return dispatch_; }
     void setServletDispatch(ServletDispatch::SPtr dispatch) { dispatch_ = dispatch; }
+    // keep-alive 连接在两个请求之间是否 park，默认开启
+    void setParkIdle(bool v) { parkIdle_ = v; }
+    bool isParkIdle() const { return parkIdle_; }
+    // 请求头部和 body 的大小限制，超过时回复 431/413 并关闭连接
+    void setLimits(const HttpLimits& limits) { limits_ = limits; }
+    const HttpLimits& getLimits() const { return limits_; }
+    // 按 Accept-Encoding 对非流式响应做 gzip 压缩，带 ETag 的响应压缩结果按 ETag 缓存；
+    // 需要在 start 之前设置
+    void setGzip(const GzipOptions& options);
+    const GzipOptions& getGzip() const { return gzip_; }
+    GzipCache* getGzipCache() const { return gzipCache_.get(); }
+    // 每个响应都带上的头部，启动时编码一次，默认有 "Server: Reyao"；需要在 start 之前设置
+    void addDefaultHeader(const std::string& key, const std::string& val) {
+        defaultHeaders_.add(key, val);
+    }
+    void clearDefaultHeaders() { defaultHeaders_ = HttpResponse::HeaderBlock(); }
+    // 是否带 Date 头部，默认开启，每个 worker 每秒格式化一次
+    void setDateHeader(bool v) { dateHeader_ = v; }
+    // h2c：客户端以连接前言开头（prior knowledge）或发送 "Upgrade: h2c" 时切换到 HTTP/2，
+    // 同一连接上的多个请求并发交给 servlet；默认关闭，需要在 start 之前设置
+    void setHttp2(const Http2Options& options) { http2_ = options; }
+    const Http2Options& getHttp2() const { return http2_; }
 
 private:
+    friend class Http2Connection;
+
+    // 解析失败时按原因回复错误状态码
+    void sendError(HttpSession* session, HttpParser::ParseError error);
+    // path 和 acceptEncoding 来自请求，异步响应发送时请求已经释放
+    void compress(const StringPiece& path, const StringPiece& acceptEncoding,
+                  HttpResponse* rsp);
+    void prepare(HttpResponse* rsp) const;
+    // 异步响应：连接脱离协程等待 complete，期间监听可读以发现客户端关闭
+    bool detachAsync(const HttpRequest& req, Socket::SPtr client,
+                     const AsyncResponse::SPtr& async);
+    void resumeAsync(const AsyncResponse::SPtr& async, Socket::SPtr client, int index,
+                     const std::string& path, const std::string& acceptEncoding);
+    void watchAsync(std::weak_ptr<AsyncResponse> weak, Socket::SPtr client, int index);
+    // 等待期间对端关闭了连接
+    void closeWatchedAsync(std::weak_ptr<AsyncResponse> weak, Socket::SPtr client, int index);
+    void closeAsync(Socket::SPtr client, int index);
+    // 响应设置了 takeover 时发出响应并交出连接，失败时返回 false，由调用方关闭连接
+    bool takeover(HttpSession* session, Socket::SPtr client, HttpResponse* rsp);
+    // 发出排队的数据后把连接连同输入缓冲区里剩余的数据交给 func
+    bool handOver(HttpSession* session, Socket::SPtr client,
+                  const HttpResponse::TakeoverFunc& func);
+
     bool keepAlive_;
+    HttpLimits limits_;
+    bool parkIdle_ = true;
     ServletDispatch::SPtr dispatch_;
+    GzipOptions gzip_;
+    std::unique_ptr<GzipCache> gzipCache_;
+    HttpResponse::HeaderBlock defaultHeaders_;
+    bool dateHeader_ = true;
+    Http2Options http2_;
 };
 
 } // namespace reyao
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "reyao/http/http_servlet.h"
+#include "reyao/log.h"
 
 #include "fnmatch.h"
 
@@ -22,8 +23,9 @@ int32_t FunctionServlet::handle(const HttpRequest& req,
 }
 
 ServletDispatch::ServletDispatch()
-    : Servlet("ServletDispatch") {
-    default_.reset(new NoFoundServlet("Reyao"));
+    : Servlet("ServletDispatch"),
+      table_(new RouteTable) {
+    setDefault(Servlet::SPtr(new NoFoundServlet("Reyao")));
 }
 
 int32_t ServletDispatch::handle(const HttpRequest& req,
@@ -37,23 +39,87 @@ int32_t ServletDispatch::handle(const HttpRequest& req,
 }
 
 void ServletDispatch::addServlet(const std::string& uri, Servlet::SPtr servlet) {
-    WriteLock lock(rwlock_);
-    servlets_[uri] = servlet;
+    MutexGuard lock(mutex_);
+    std::unique_ptr<RouteTable> table(copyTable());
+    if (!table->router.add(uri, servlet)) {
+        LOG_ERROR << "addServlet invalid route " << uri;
+        return;
+    }
+    table_.update(table.release());
 }
 
 void ServletDispatch::addServlet(const std::string& uri, FunctionServlet::CallBackFunc func) {
-    WriteLock lock(rwlock_);
-    servlets_[uri].reset(new FunctionServlet(func));
+    addServlet(uri, FunctionServlet::SPtr(new FunctionServlet(func)));
+}
+
+// 只有结尾一个 '*' 的全局模式等价于前缀匹配，可以放进路由树；
+// ':' 在 fnmatch 中是普通字符、'\\' 是转义，含这两者的模式仍按 fnmatch 处理
+static bool IsPrefixGlob(const std::string& uri) {
+    return uri.find_first_of(":\\") == std::string::npos &&
+           !uri.empty() && uri.back() == '*' &&
+           RadixRouter::IsRoutable(uri);
+}
+
+namespace {
+
+// 全局路由树上挂的是这个记录：该前缀实际生效的全局路由及其注册顺序
+class GlobalRoute : public Servlet {
+public:
+    GlobalRoute(size_t index, Servlet::SPtr servlet)
+        : Servlet("GlobalRoute"),
+          index(index),
+          servlet(servlet) {}
+
+    int32_t handle(const HttpRequest& req,
+                   HttpResponse* rsp,
+                   const HttpSession& session) override {
+        return servlet->handle(req, rsp, session);
+    }
+
+    size_t index;           // 在 globals 中的下标
+    Servlet::SPtr servlet;
+};
+
+} // namespace
+
+void ServletDispatch::RebuildGlobals(RouteTable* table) {
+    std::shared_ptr<RadixRouter> router = std::make_shared<RadixRouter>();
+    table->globs.clear();
+    const ServletVec& globals = table->globals;
+    for (size_t i = 0; i < globals.size(); i++) {
+        const std::string& uri = globals[i].first;
+        if (!IsPrefixGlob(uri)) {
+            table->globs.push_back(i);
+            continue;
+        }
+        // 能被这个前缀匹配的路径，也能被它的更短前缀匹配，其中最早注册的生效
+        size_t first = i;
+        for (size_t j = 0; j < i; j++) {
+            const std::string& prefix = globals[j].first;
+            size_t len = prefix.size() - 1;
+            if (IsPrefixGlob(prefix) && uri.compare(0, len, prefix, 0, len) == 0) {
+                first = j;
+                break;
+            }
+        }
+        router->add(uri, std::make_shared<GlobalRoute>(first, globals[first].second));
+    }
+    table->globalRouter = router;
 }
 
 void ServletDispatch::addGlobalServlet(const std::string& uri, Servlet::SPtr servlet) {
-    WriteLock lock(rwlock_);
-    for (auto it = globals_.begin(); it != globals_.end(); it++) {
+    MutexGuard lock(mutex_);
+    std::unique_ptr<RouteTable> table(copyTable());
+    ServletVec& globals = table->globals;
+    for (auto it = globals.begin(); it != globals.end(); it++) {
         if (it->first == uri) {
-            globals_.erase(it);
+            globals.erase(it);
+            break;
         }
     }
-    globals_.push_back(std::make_pair(uri, servlet));
+    globals.push_back(std::make_pair(uri, servlet));
+    RebuildGlobals(table.get());
+    table_.update(table.release());
 }
 
 void ServletDispatch::addGlobalServlet(const std::string& uri, FunctionServlet::CallBackFunc func) {
@@ -61,48 +127,90 @@ void ServletDispatch::addGlobalServlet(const std::string& uri, FunctionServlet::
 }
 
 void ServletDispatch::delServlet(const std::string& uri) {
-    WriteLock lock(rwlock_);
-    servlets_.erase(uri);
+    MutexGuard lock(mutex_);
+    std::unique_ptr<RouteTable> table(copyTable());
+    if (table->router.remove(uri)) {
+        table_.update(table.release());
+    }
 }
 
 void ServletDispatch::delGlobalServlet(const std::string& uri) {
-    WriteLock lock(rwlock_);
-    for (auto it = globals_.begin(); it != globals_.end(); it++) {
-        if (it->first == uri) {
-            globals_.erase(it);
-            break;
-        }
+    MutexGuard lock(mutex_);
+    std::unique_ptr<RouteTable> table(copyTable());
+    ServletVec& globals = table->globals;
+    auto it = globals.begin();
+    while (it != globals.end() && it->first != uri) {
+        ++it;
     }
+    if (it == globals.end()) {
+        return;
+    }
+    globals.erase(it);
+    RebuildGlobals(table.get());
+    table_.update(table.release());
 }
 
 Servlet::SPtr ServletDispatch::getServlet(const std::string& uri) {
-    ReadLock lock(rwlock_);
-    auto it = servlets_.find(uri);
-    return it == servlets_.end() ? nullptr : it->second;
+    RcuReadGuard guard;
+    return table_.get()->router.find(uri);
+}
+
+Servlet::SPtr ServletDispatch::MatchGlobal(const RouteTable* table,
+                                           const StringPiece& uri,
+                                           RouteParams* params) {
+    Servlet::SPtr servlet;
+    size_t end = table->globals.size();
+    auto route = table->globalRouter->match(uri, params);
+    if (route) {
+        GlobalRoute* global = static_cast<GlobalRoute*>(route.get());
+        servlet = global->servlet;
+        end = global->index;
+    }
+    // 比前缀模式先注册的 fnmatch 模式优先
+    if (!table->globs.empty() && table->globs[0] < end) {
+        // fnmatch 需要以 '\0' 结尾的字符串
+        std::string path = uri.toString();
+        for (size_t i : table->globs) {
+            if (i >= end) {
+                break;
+            }
+            if (!fnmatch(table->globals[i].first.c_str(), path.c_str(), 0)) {
+                if (params) {
+                    params->clear();
+                }
+                return table->globals[i].second;
+            }
+        }
+    }
+    return servlet;
 }
 
 Servlet::SPtr ServletDispatch::getGlobalServlet(const std::string& uri) {
-    ReadLock lock(rwlock_);
-    for (auto it = globals_.begin(); it != globals_.end(); it++) {
-        if (!fnmatch(it->first.c_str(), uri.c_str(), 0)) {
-            return it->second;
-        }
-    }
-    return nullptr;
+    RcuReadGuard guard;
+    return MatchGlobal(table_.get(), uri, nullptr);
 }
 
-Servlet::SPtr ServletDispatch::getMatchServlet(const std::string& uri) {
-    ReadLock lock(rwlock_);
-    auto it = servlets_.find(uri);
-    if (it != servlets_.end()) {
-        return it->second;
-    }
-    for (auto it = globals_.begin(); it != globals_.end(); it++) {
-        if (!fnmatch(it->first.c_str(), uri.c_str(), 0)) {
-            return it->second;
-        }
+Servlet::SPtr ServletDispatch::getMatchServlet(const StringPiece& uri, RouteParams* params) {
+    RcuReadGuard guard;
+    const RouteTable* table = table_.get();
+    auto servlet = table->router.match(uri, params);
+    if (servlet) {
+        return servlet;
     }
-    return default_;
+    servlet = MatchGlobal(table, uri, params);
+    return servlet ? servlet : table->def;
+}
+
+Servlet::SPtr ServletDispatch::getDefault() const {
+    RcuReadGuard guard;
+    return table_.get()->def;
+}
+
+void ServletDispatch::setDefault(Servlet::SPtr s) {
+    MutexGuard lock(mutex_);
+    std::unique_ptr<RouteTable> table(copyTable());
+    table->def = s;
+    table_.update(table.release());
 }
 
 NoFoundServlet::NoFoundServlet(const std::string& server_name)
@@ -116,7 +224,6 @@ int32_t NoFoundServlet::handle(const HttpRequest& req,
                                HttpResponse* rsp,
                                const HttpSession& session) {
     rsp->setStatus(HttpStatus::NOT_FOUND);
-    rsp->addHeader("Server", "Reyao");
     rsp->addHeader("Content-Type", "text/html");
     rsp->setBody(content_);
     return 0;
@@ -3,12 +3,14 @@
 #include "reyao/http/http_request.h"
 #include "reyao/http/http_response.h"
 #include "reyao/http/http_session.h"
+#include "reyao/http/http_router.h"
 #include "reyao/mutex.h"
+#include "reyao/rcu.h"
 
 #include <memory>
 #include <functional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 namespace reyao {
 
@@ -22,9 +24,17 @@ public:
                            HttpResponse* rsp,
                            const HttpSession& session) = 0;
     const std::string& getName() const { return name_; }
+    // 为 true 时 HttpServer 只解析完头部就调用 handle，body 由 servlet
+    // 通过 req.getBodyReader() 边读边处理，不在内存中缓冲
+    void setStreamBody(bool v) { streamBody_ = v; }
+    bool isStreamBody() const { return streamBody_; }
+    // AsyncServlet 为 true，HttpServer 改为调用 handleAsync
+    bool isAsync() const { return async_; }
 
 protected:
      std::string name_;
+     bool streamBody_ = false;
+     bool async_ = false;
 };
 
 class FunctionServlet : public Servlet {
@@ -42,10 +52,11 @@ private:
     CallBackFunc func_;
 };
 
+// 路由表通过 RcuPtr 发布，匹配时不加锁；增删路由时复制整张表修改后替换，
+// 旧表等正在匹配的线程离开后再释放，运行期间也可以热更新路由
 class ServletDispatch : public Servlet {
 public:
     typedef std::shared_ptr<ServletDispatch> SPtr;
-    typedef std::unordered_map<std::string, Servlet::SPtr> ServletMap;
     typedef std::vector<std::pair<std::string, Servlet::SPtr>> ServletVec;
 
     ServletDispatch();
@@ -54,28 +65,49 @@ public:
                            HttpResponse* rsp,
                            const HttpSession& session) override;
 
+    // uri 中的 ":name" 和结尾的 "*" 按路由规则匹配，见 RadixRouter
     void addServlet(const std::string& uri, Servlet::SPtr servlet);
     void addServlet(const std::string& uri, FunctionServlet::CallBackFunc func);
+    // 按 fnmatch 语义匹配，多个模式都能匹配时先注册的优先，重复注册的模式移到最后。
+    // 只有结尾一个 '*' 的前缀模式另外放进路由树，不用逐个 fnmatch
     void addGlobalServlet(const std::string& uri, Servlet::SPtr servlet);
     void addGlobalServlet(const std::string& uri, FunctionServlet::CallBackFunc func);
 
+    // 两类路由互不影响，del 只删除对应 add 注册的路由
     void delServlet(const std::string& uri);
     void delGlobalServlet(const std::string& uri);
 
     Servlet::SPtr getServlet(const std::string& uri);
     Servlet::SPtr getGlobalServlet(const std::string& uri);
-    Servlet::SPtr getMatchServlet(const std::string& uri);
+    // addServlet 注册的路由（包括其中的 "*"）优先于全局路由，都没有时返回 default；
+    // params 不为空时填入路径参数
+    Servlet::SPtr getMatchServlet(const StringPiece& uri, RouteParams* params = nullptr);
 
-    Servlet::SPtr getDefault() const { return default_; }
-    void setDefault(Servlet::SPtr s) { default_ = s; } 
+    Servlet::SPtr getDefault() const;
+    void setDefault(Servlet::SPtr s);
 
 private:
-    //url(/xxx/xxx) --> servlet
-    ServletMap servlets_;
-    //url(/xxx/*) --> servlet
-    ServletVec globals_;
-    Servlet::SPtr default_;
-    RWLock rwlock_;
+    struct RouteTable {
+        //url(/xxx/:id, /xxx/*) --> servlet
+        RadixRouter router;
+        //全局模式，按注册顺序
+        ServletVec globals;
+        //globals 中的前缀模式(/xxx/*)，修改全局模式时重建，各个表之间共享
+        std::shared_ptr<const RadixRouter> globalRouter = std::make_shared<RadixRouter>();
+        //globals 中其余 fnmatch 模式的下标
+        std::vector<size_t> globs;
+        Servlet::SPtr def;
+    };
+
+    static void RebuildGlobals(RouteTable* table);
+    // 前缀模式匹配上时 params 中是 "*" 匹配的部分
+    static Servlet::SPtr MatchGlobal(const RouteTable* table, const StringPiece& uri,
+                                     RouteParams* params);
+    // 写者之间用 mutex_ 互斥，返回当前表的副本
+    RouteTable* copyTable() const { return new RouteTable(*table_.get()); }
+
+    RcuPtr<RouteTable> table_;
+    Mutex mutex_;
 };
 
 class NoFoundServlet : public Servlet {
@@ -6,21 +6,44 @@
 namespace reyao {
 
 HttpSession::HttpSession(std::shared_ptr<Socket> sock, bool owner)
-    : SocketStream(sock, owner) {
+    : SocketStream(sock, owner),
+      reqParser_(this, &inBuf_),
+      rspParser_(this, &inBuf_) {
 
 }
 
 bool HttpSession::recvRequest(HttpRequest* req) { 
-    HttpRequestParser parser(this, req);
-    return parser.parseRequest();
+    return reqParser_.parseRequest(req);
 }
 
-bool HttpSession::sendResponse(HttpResponse* rsp) {
+bool HttpSession::sendResponse(HttpResponse* rsp, bool more) {
+    // 头部直接编码进发送缓冲区，不经过 stringstream
+    char* buf = prepareAppend(rsp->getHeaderSize());
+    commitAppend(rsp->encodeHeader(buf));
+    const std::string& body = rsp->getBody();
+    if (more) {
+        // rsp 在 flush 之前就会析构，只能拷贝
+        append(body.data(), body.size());
+        return true;
+    }
+    // body 不拷贝，rsp 在 flush 之前必须保持有效
+    appendRef(body.data(), body.size());
+    if (isCork()) {
+        return true;
+    }
+    // 拷贝的数据超过上限时 append 内部会提前发送，这里可能已经没有剩余数据
+    return flush() >= 0;
+}
+
+bool HttpSession::sendRequest(HttpRequest* req) {
     std::stringstream ss;
-    rsp->dump(ss);
-    std::string msg = ss.str();
-    return write(msg.c_str(), msg.size());
+    req->dump(ss);
+    append(ss.str());
+    return flush() >= 0;
 }
 
+bool HttpSession::recvResponse(HttpResponse* rsp) {
+    return rspParser_.parseResponse(rsp);
+}
 
 } // namespace reyao
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "reyao/socket_stream.h"
 #include "reyao/http/http_request.h"
 #include "reyao/http/http_response.h"
+#include "reyao/http/http_parser.h"
 #include "reyao/socket.h"
 
 #include <memory>
@@ -13,12 +14,37 @@ class HttpSession : public SocketStream {
 public:
     HttpSession(std::shared_ptr<Socket> sock, bool owner = true);
     
+    // 解析器和输入缓冲区跨请求保留，一次读到的多个流水线请求依次取出，
+    // 缓冲区中已有完整请求时不读 socket
     bool recvRequest(HttpRequest* req);
-    bool sendResponse(HttpResponse* rsp);
+    // 分两步接收请求：先收头部，再按 servlet 的需要缓冲或流式读取 body
+    bool recvRequestHeader(HttpRequest* req) { return reqParser_.parseRequestHeader(req); }
+    bool recvRequestBody() { return reqParser_.parseRequestBody(); }
+    // 之后 req.getBodyReader() 可用，见 HttpRequestParser::beginBodyStream
+    void beginBodyStream() { reqParser_.beginBodyStream(); }
+    bool discardBody(uint64_t maxDiscard) { return reqParser_.discardBody(maxDiscard); }
+    bool hasRequestBody() const { return reqParser_.hasBody(); }
+    const HttpRequestParser& getRequestParser() const { return reqParser_; }
+    HttpParser::ParseError getParseError() const { return reqParser_.getError(); }
+    void setLimits(const HttpLimits& limits) { reqParser_.setLimits(limits); }
+    // 头部拷贝进发送队列，body 按引用排队，一次 writev 发出；
+    // cork 模式下只排队，由调用方 flush；
+    // more 为 true 表示后面还有流水线请求，body 也拷贝进发送队列，
+    // 响应留到这一批处理完（或下一次读 socket 之前）一起发出
+    bool sendResponse(HttpResponse* rsp, bool more = false);
+    // 输入缓冲区中是否还有未处理的数据
+    bool hasBufferedInput() const { return inBuf_.getReadSize() > 0; }
+    // 取出输入缓冲区中剩余的数据，连接交给其他协议时使用
+    std::string takeBufferedInput() { return inBuf_.readView(inBuf_.getReadSize()).toString(); }
+
+    // 客户端使用
+    bool sendRequest(HttpRequest* req);
+    bool recvResponse(HttpResponse* rsp);
 
 private:
-    Socket::SPtr sock_;
-    bool owner_;
+    ByteArray inBuf_;
+    HttpRequestParser reqParser_;
+    HttpResponseParser rspParser_;
 };
 
 
@@ -0,0 +1,313 @@
+#include "reyao/http/http_sse.h"
+#include "reyao/worker.h"
+#include "reyao/hook.h"
+#include "reyao/log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+
+namespace reyao {
+
+static const int kMaxIov = 64;
+
+SseHub::SseHub()
+    : SseHub(Options()) {
+}
+
+SseHub::SseHub(const Options& options)
+    : options_(options) {
+    if (options_.maxQueue == 0) {
+        options_.maxQueue = 1;
+    }
+}
+
+SseHub::EventPtr SseHub::Encode(const StringPiece& data, const StringPiece& event,
+                                const StringPiece& id) {
+    std::string body;
+    body.reserve(data.size() + event.size() + id.size() + 32);
+    if (!id.empty()) {
+        body.append("id: ").append(id.data(), id.size()).push_back('\n');
+    }
+    if (!event.empty()) {
+        body.append("event: ").append(event.data(), event.size()).push_back('\n');
+    }
+    const char* p = data.data();
+    const char* end = p + data.size();
+    // 单独的 CR 也是行结束符，原样发出会被客户端当成新的一行
+    do {
+        const char* eol = p;
+        while (eol < end && *eol != '\n' && *eol != '\r') {
+            eol++;
+        }
+        body.append("data: ").append(p, eol - p).push_back('\n');
+        p = eol + 1;
+        if (eol + 1 < end && eol[0] == '\r' && eol[1] == '\n') {
+            p++;
+        }
+    } while (p < end);
+    body.push_back('\n');
+
+    std::shared_ptr<Event> ev(new Event);
+    char size[24];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", body.size());
+    ev->data.reserve(n + body.size() + 2);
+    ev->data.append(size, n).append(body).append("\r\n");
+    ev->begin = n;
+    ev->end = n + body.size();
+    return ev;
+}
+
+size_t SseHub::publish(const std::string& topic, const StringPiece& data,
+                       const StringPiece& event, const StringPiece& id) {
+    std::vector<GroupPtr> groups;
+    {
+        MutexGuard lock(mutex_);
+        auto it = topics_.find(topic);
+        if (it != topics_.end()) {
+            groups = it->second;
+        }
+    }
+    ++published_;
+    if (groups.empty()) {
+        return 0;
+    }
+    EventPtr ev = Encode(data, event, id);
+    for (auto& group : groups) {
+        group->worker->addTask(std::bind(&SseHub::deliver, this, group, ev));
+    }
+    return groups.size();
+}
+
+void SseHub::subscribe(const std::string& topic, HttpTakeover& conn, bool chunked) {
+    GroupPtr group;
+    {
+        MutexGuard lock(mutex_);
+        auto& groups = topics_[topic];
+        for (auto& g : groups) {
+            if (g->worker == conn.worker) {
+                group = g;
+                break;
+            }
+        }
+        if (!group) {
+            group.reset(new Group);
+            group->topic = topic;
+            group->worker = conn.worker;
+            groups.push_back(group);
+        }
+    }
+    SubscriberPtr sub(new Subscriber);
+    sub->conn = conn;
+    sub->chunked = chunked;
+    sub->group = group.get();
+    sub->index = group->subscribers.size();
+    group->subscribers.push_back(sub);
+    ++subscribers_;
+    // 客户端不会再发数据，可读说明连接关闭
+    if (!Worker::AddEvent(conn.client->getSockfd(), EPOLLIN,
+                          std::bind(&SseHub::onReadable, this, sub))) {
+        close(sub);
+    }
+}
+
+SseHub::Stats SseHub::getStats() const {
+    Stats stats;
+    stats.published = published_;
+    stats.delivered = delivered_;
+    stats.dropped = dropped_;
+    stats.disconnected = disconnected_;
+    stats.subscribers = subscribers_;
+    return stats;
+}
+
+void SseHub::deliver(GroupPtr group, EventPtr event) {
+    auto& subs = group->subscribers;
+    // 从后往前遍历，close 把最后一个换到当前位置，不影响还没处理的部分
+    for (size_t i = subs.size(); i-- > 0;) {
+        SubscriberPtr sub = subs[i];
+        if (sub->queue.size() >= options_.maxQueue) {
+            if (options_.policy == DISCONNECT) {
+                ++disconnected_;
+                dropped_ += sub->queue.size() + 1;
+                close(sub);
+                continue;
+            }
+            // 队头可能已经发出一部分，不能丢
+            if (sub->offset == 0) {
+                sub->queue.pop_front();
+            } else if (sub->queue.size() > 1) {
+                sub->queue.erase(sub->queue.begin() + 1);
+            } else {
+                ++dropped_;
+                continue;
+            }
+            ++dropped_;
+        }
+        sub->queue.push_back(event);
+        if (!sub->writing) {
+            flush(sub);
+        }
+    }
+}
+
+bool SseHub::flush(const SubscriberPtr& sub) {
+    int fd = sub->conn.client->getSockfd();
+    while (!sub->queue.empty()) {
+        iovec iov[kMaxIov];
+        int count = 0;
+        for (auto it = sub->queue.begin(); it != sub->queue.end() && count < kMaxIov; ++it) {
+            const Event& ev = **it;
+            size_t begin = sub->chunked ? 0 : ev.begin;
+            size_t end = sub->chunked ? ev.data.size() : ev.end;
+            if (count == 0) {
+                begin += sub->offset;
+            }
+            iov[count].iov_base = const_cast<char*>(ev.data.data() + begin);
+            iov[count].iov_len = end - begin;
+            count++;
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        // 连接不属于任何协程，直接用非阻塞的原始调用
+        ssize_t n = sendmsg_origin(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                if (!Worker::AddEvent(fd, EPOLLOUT, std::bind(&SseHub::onWritable, this, sub))) {
+                    close(sub);
+                    return false;
+                }
+                sub->writing = true;
+                return true;
+            }
+            close(sub);
+            return false;
+        }
+        for (int i = 0; i < count && n > 0; i++) {
+            if ((size_t)n < iov[i].iov_len) {
+                sub->offset += n;
+                break;
+            }
+            n -= iov[i].iov_len;
+            sub->offset = 0;
+            sub->queue.pop_front();
+            ++delivered_;
+        }
+    }
+    return true;
+}
+
+void SseHub::onWritable(SubscriberPtr sub) {
+    sub->writing = false;
+    if (!sub->closed) {
+        flush(sub);
+    }
+}
+
+void SseHub::onReadable(SubscriberPtr sub) {
+    if (sub->closed) {
+        return;
+    }
+    int fd = sub->conn.client->getSockfd();
+    char buf[1024];
+    while (true) {
+        ssize_t n = recv_origin(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN &&
+            Worker::AddEvent(fd, EPOLLIN, std::bind(&SseHub::onReadable, this, sub))) {
+            return;
+        }
+        close(sub);
+        return;
+    }
+}
+
+void SseHub::close(SubscriberPtr sub) {
+    if (sub->closed) {
+        return;
+    }
+    sub->closed = true;
+    int fd = sub->conn.client->getSockfd();
+    Worker::DelEvent(fd, EPOLLIN);
+    if (sub->writing) {
+        Worker::DelEvent(fd, EPOLLOUT);
+        sub->writing = false;
+    }
+    auto& subs = sub->group->subscribers;
+    subs[sub->index] = subs.back();
+    subs[sub->index]->index = sub->index;
+    subs.pop_back();
+    if (subs.empty()) {
+        removeGroup(sub->group);
+    }
+    sub->queue.clear();
+    --subscribers_;
+    sub->conn.close();
+}
+
+void SseHub::removeGroup(Group* group) {
+    // 移除之后 publish 不再向这个 worker 投递，已经投递的任务持有 GroupPtr，看到的是空分组
+    MutexGuard lock(mutex_);
+    auto it = topics_.find(group->topic);
+    if (it == topics_.end()) {
+        return;
+    }
+    auto& groups = it->second;
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (groups[i].get() == group) {
+            groups[i] = groups.back();
+            groups.pop_back();
+            break;
+        }
+    }
+    if (groups.empty()) {
+        topics_.erase(it);
+    }
+}
+
+SseServlet::SseServlet(SseHub::SPtr hub, TopicFunc func)
+    : Servlet("SseServlet"),
+      hub_(hub),
+      func_(func) {
+}
+
+int32_t SseServlet::handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) {
+    std::string topic;
+    if (func_) {
+        topic = func_(req);
+    } else {
+        StringPiece param = req.getRouteParam("topic");
+        topic = param.empty() ? req.getPath().toString() : param.toString();
+    }
+    rsp->addHeader("Content-Type", "text/event-stream");
+    rsp->addHeader("Cache-Control", "no-cache");
+    // 头部留在发送队列，交出连接之前一起发出
+    if (!rsp->beginStream(-1, false)) {
+        rsp->setStatus(HttpStatus::INTERNAL_SERVER_ERROR);
+        return -1;
+    }
+    SseHub::SPtr hub = hub_;
+    bool chunked = rsp->isChunked();
+    rsp->setTakeover([hub, topic, chunked](HttpTakeover& conn) {
+        hub->subscribe(topic, conn, chunked);
+    });
+    return 0;
+}
+
+} // namespace reyao
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "reyao/http/http_servlet.h"
+#include "reyao/mutex.h"
+#include "reyao/nocopyable.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reyao {
+
+class Worker;
+
+// Server-Sent Events 的广播中心：订阅者按 topic 和所在 worker 分组，
+// publish 把事件序列化一次放进共享的只读缓冲区，每个有订阅者的 worker 投递一个任务，
+// 由该 worker 把缓冲区写给自己的订阅者。连接已经脱离协程，写不完的事件排在订阅者的队列里，
+// 等 EPOLLOUT 再写；队列超过上限的慢消费者按 policy 断开或丢弃旧事件。
+// hub 的生命周期需要覆盖使用它的 HttpServer
+class SseHub : public NoCopyable {
+public:
+    typedef std::shared_ptr<SseHub> SPtr;
+
+    enum SlowPolicy {
+        DISCONNECT,     // 关闭连接，客户端可以带 Last-Event-ID 重连
+        DROP_OLDEST,    // 丢弃最旧的未发送事件
+    };
+
+    struct Options {
+        size_t maxQueue = 256;          // 每个订阅者排队的事件数上限
+        SlowPolicy policy = DISCONNECT;
+    };
+
+    struct Stats {
+        uint64_t published = 0;
+        uint64_t delivered = 0;         // 完整写进 socket 的事件数
+        uint64_t dropped = 0;           // 因为慢被丢弃的事件数
+        uint64_t disconnected = 0;      // 因为慢被断开的订阅者数
+        int64_t subscribers = 0;
+    };
+
+    SseHub();
+    explicit SseHub(const Options& options);
+
+    // 任意线程调用，返回投递到的 worker 数；data 按 "\r\n"、"\r"、"\n" 拆成多行 "data:"
+    size_t publish(const std::string& topic, const StringPiece& data,
+                   const StringPiece& event = StringPiece(),
+                   const StringPiece& id = StringPiece());
+    // 在 conn.worker 上调用，之后连接归 hub 所有；chunked 为 true 时事件按 chunk 编码
+    void subscribe(const std::string& topic, HttpTakeover& conn, bool chunked);
+
+    Stats getStats() const;
+    int64_t getSubscriberCount() const { return subscribers_; }
+
+private:
+    // 一个事件：chunk 头 + 事件文本 + "\r\n"，不用 chunked 的订阅者只发中间部分
+    struct Event {
+        std::string data;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+    typedef std::shared_ptr<const Event> EventPtr;
+
+    struct Group;
+    struct Subscriber {
+        HttpTakeover conn;
+        bool chunked = false;
+        Group* group = nullptr;
+        size_t index = 0;               // 在 group->subscribers 中的位置
+        std::deque<EventPtr> queue;
+        size_t offset = 0;              // 队头事件已经发出的字节
+        bool writing = false;           // 是否在等 EPOLLOUT
+        bool closed = false;
+    };
+    typedef std::shared_ptr<Subscriber> SubscriberPtr;
+
+    // 同一 topic 在同一 worker 上的订阅者，只在这个 worker 上访问；
+    // 最后一个订阅者离开时从 topics_ 中移除
+    struct Group {
+        std::string topic;
+        Worker* worker = nullptr;
+        std::vector<SubscriberPtr> subscribers;
+    };
+    typedef std::shared_ptr<Group> GroupPtr;
+
+    static EventPtr Encode(const StringPiece& data, const StringPiece& event,
+                           const StringPiece& id);
+
+    void deliver(GroupPtr group, EventPtr event);
+    // 尽量把队列写进 socket，返回 false 表示连接已关闭
+    bool flush(const SubscriberPtr& sub);
+    void onWritable(SubscriberPtr sub);
+    void onReadable(SubscriberPtr sub);
+    void close(SubscriberPtr sub);
+    void removeGroup(Group* group);
+
+    Options options_;
+    mutable Mutex mutex_;
+    // topic -> 各 worker 上的分组
+    std::unordered_map<std::string, std::vector<GroupPtr>> topics_;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> disconnected_{0};
+    std::atomic<int64_t> subscribers_{0};
+};
+
+// SSE 端点：回复 text/event-stream 头部后把连接交给 hub。
+// topic 默认取路由参数 ":topic"，没有时使用请求路径
+class SseServlet : public Servlet {
+public:
+    typedef std::shared_ptr<SseServlet> SPtr;
+    typedef std::function<std::string(const HttpRequest&)> TopicFunc;
+
+    SseServlet(SseHub::SPtr hub, TopicFunc func = nullptr);
+    virtual int32_t handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) override;
+
+private:
+    SseHub::SPtr hub_;
+    TopicFunc func_;
+};
+
+} // namespace reyao
@@ -0,0 +1,499 @@
+#include "reyao/http/http_static_servlet.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace reyao {
+
+static const struct {
+    const char* ext;
+    const char* type;
+} kMimeTypes[] = {
+    {"html",  "text/html"},
+    {"htm",   "text/html"},
+    {"css",   "text/css"},
+    {"js",    "application/javascript"},
+    {"json",  "application/json"},
+    {"txt",   "text/plain"},
+    {"xml",   "text/xml"},
+    {"png",   "image/png"},
+    {"jpg",   "image/jpeg"},
+    {"jpeg",  "image/jpeg"},
+    {"gif",   "image/gif"},
+    {"svg",   "image/svg+xml"},
+    {"ico",   "image/x-icon"},
+    {"webp",  "image/webp"},
+    {"woff",  "font/woff"},
+    {"woff2", "font/woff2"},
+    {"wasm",  "application/wasm"},
+    {"pdf",   "application/pdf"},
+    {"mp4",   "video/mp4"},
+};
+
+static const char* MimeType(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+        const char* ext = path.c_str() + dot + 1;
+        for (auto& mime : kMimeTypes) {
+            if (strcasecmp(ext, mime.ext) == 0) {
+                return mime.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+static std::string HttpDate(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+static bool ParseHttpDate(const StringPiece& str, time_t* t) {
+    std::string date = str.toString();
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return false;
+    }
+    *t = timegm(&tm);
+    return true;
+}
+
+static bool ParseOffset(const StringPiece& str, off_t* value) {
+    if (str.empty() || str.size() > 18) {
+        return false;
+    }
+    off_t v = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return false;
+        }
+        v = v * 10 + (str[i] - '0');
+    }
+    *value = v;
+    return true;
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 解码路径中的 %XX，拒绝 '\0' 和 ".." 路径段，防止访问 root 之外的文件
+static bool DecodePath(const StringPiece& str, std::string* path) {
+    path->reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        char c = str[i];
+        if (c == '%' && i + 2 < str.size() &&
+            HexValue(str[i + 1]) >= 0 && HexValue(str[i + 2]) >= 0) {
+            c = (char)(HexValue(str[i + 1]) * 16 + HexValue(str[i + 2]));
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        path->push_back(c);
+    }
+    size_t begin = 0;
+    while (begin <= path->size()) {
+        size_t end = path->find('/', begin);
+        if (end == std::string::npos) {
+            end = path->size();
+        }
+        if (path->compare(begin, end - begin, "..") == 0) {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+static StringPiece Trim(StringPiece str) {
+    while (!str.empty() && str[0] == ' ') {
+        str.removePrefix(1);
+    }
+    while (!str.empty() && str[str.size() - 1] == ' ') {
+        str.removeSuffix(1);
+    }
+    return str;
+}
+
+StaticFileServlet::File::~File() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+StaticFileServlet::StaticFileServlet(const std::string& root)
+    : StaticFileServlet(root, Options()) {
+}
+
+StaticFileServlet::StaticFileServlet(const std::string& root, const Options& options)
+    : Servlet("StaticFileServlet"),
+      root_(root),
+      options_(options),
+      notFound_("Reyao") {
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+int32_t StaticFileServlet::handle(const HttpRequest& req,
+                                  HttpResponse* rsp,
+                                  const HttpSession& session) {
+    StringPiece uri = req.getPath();
+    const RouteParams& params = req.getRouteParams();
+    for (size_t i = 0; i < params.size; i++) {
+        if (params.params[i].name == "*") {
+            uri = params.params[i].value;
+        }
+    }
+    std::string rel;
+    if (!DecodePath(uri, &rel)) {
+        return notFound_.handle(req, rsp, session);
+    }
+    std::string path = root_;
+    if (rel.empty() || rel[0] != '/') {
+        path.push_back('/');
+    }
+    path += rel;
+    if (path.back() == '/') {
+        path += options_.indexFile;
+    }
+
+    FilePtr file = getFile(path);
+    if (!file) {
+        return notFound_.handle(req, rsp, session);
+    }
+    rsp->addHeader("Content-Type", file->contentType);
+    rsp->addHeader("Last-Modified", file->lastModified);
+    rsp->addHeader("Accept-Ranges", "bytes");
+    StringPiece range = req.getHeaderView("Range");
+
+    // Range 针对的是原始内容，有 Range 时不压缩
+    std::shared_ptr<const std::string> gzip;
+    if (file->gzipable) {
+        rsp->addHeader("Vary", "Accept-Encoding");
+        if (range.empty() &&
+            Gzip::IsAccepted(req.getHeaderView(HttpRequest::ACCEPT_ENCODING))) {
+            gzip = getGzip(file);
+        }
+    }
+    const std::string& etag = gzip ? file->gzipETag : file->etag;
+    rsp->addHeader("ETag", etag);
+    if (IsNotModified(req, etag, file->mtime)) {
+        ++notModified_;
+        rsp->setStatus(HttpStatus::NOT_MODIFIED);
+        return 0;
+    }
+    if (gzip) {
+        ++gzipHits_;
+        rsp->addHeader("Content-Encoding", "gzip");
+        if (rsp->beginStream(gzip->size(), false)) {
+            rsp->write(gzip->data(), gzip->size());
+        } else if (!rsp->isStreaming()) {
+            rsp->setBody(*gzip);
+        }
+        return 0;
+    }
+
+    off_t begin = 0;
+    off_t end = file->size;
+    StringPiece ifRange = Trim(req.getHeaderView("If-Range"));
+    // If-Range 与当前版本不一致时忽略 Range，返回完整文件
+    if (!range.empty() &&
+        (ifRange.empty() || ifRange == file->etag || ifRange == file->lastModified)) {
+        int rt = ParseRange(range, file->size, &begin, &end);
+        if (rt < 0) {
+            rsp->setStatus(HttpStatus::RANGE_NOT_SATISFIABLE);
+            rsp->addHeader("Content-Range", "bytes */" + std::to_string(file->size));
+            return 0;
+        }
+        if (rt > 0) {
+            ++partial_;
+            rsp->setStatus(HttpStatus::PARTIAL_CONTENT);
+            rsp->addHeader("Content-Range", "bytes " + std::to_string(begin) + "-" +
+                           std::to_string(end - 1) + "/" + std::to_string(file->size));
+        }
+    }
+
+    size_t len = end - begin;
+    // 头部随 body 一起发出，小文件一个响应只需要一次 writev
+    if (!rsp->beginStream(len, false)) {
+        if (rsp->isStreaming()) {
+            return 0;
+        }
+        // 没有绑定连接（直接调用 handle）时退回到普通响应
+        std::string body(len, '\0');
+        if (file->memory) {
+            body.assign(file->content, begin, len);
+        } else if (len > 0 && ::pread(file->fd, &body[0], len, begin) != (ssize_t)len) {
+            body.clear();
+        }
+        rsp->setBody(body);
+        return 0;
+    }
+    if (file->memory) {
+        ++memoryHits_;
+        rsp->write(file->content.data() + begin, len);
+    } else if (len > 0) {
+        rsp->sendFile(file->fd, begin, len);
+    }
+    return 0;
+}
+
+StaticFileServlet::FilePtr StaticFileServlet::getFile(const std::string& path) {
+    int64_t now = GetCurrentMs();
+    FilePtr cached;
+    {
+        MutexGuard lock(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            cached = it->second->second;
+            if (now - cached->checked < options_.ttl) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                ++hits_;
+                return cached;
+            }
+        }
+    }
+    // 缓存过期时先 stat，文件没变就继续用原来的 fd
+    if (cached) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && st.st_dev == cached->dev &&
+            st.st_ino == cached->ino && st.st_mtime == cached->mtime &&
+            st.st_size == cached->size) {
+            MutexGuard lock(mutex_);
+            cached->checked = now;
+            ++hits_;
+            return cached;
+        }
+    }
+    ++misses_;
+    FilePtr file = openFile(path);
+    MutexGuard lock(mutex_);
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+        erase(it->second);
+    }
+    if (file) {
+        insert(path, file);
+    }
+    return file;
+}
+
+StaticFileServlet::FilePtr StaticFileServlet::openFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    FilePtr file(new File);
+    file->fd = fd;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return nullptr;
+    }
+    file->size = st.st_size;
+    file->mtime = st.st_mtime;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (long)st.st_mtime, (long)st.st_size);
+    file->etag = etag;
+    file->lastModified = HttpDate(st.st_mtime);
+    file->contentType = MimeType(path);
+    file->gzipable = options_.gzip.enable && Gzip::IsCompressible(file->contentType) &&
+                     (size_t)file->size >= options_.gzip.minSize &&
+                     (size_t)file->size <= options_.maxGzipFileSize;
+    if (file->gzipable) {
+        file->gzipETag = Gzip::ETag(file->etag);
+    }
+    file->checked = GetCurrentMs();
+
+    if (options_.maxMemoryFileSize > 0 &&
+        (size_t)file->size <= options_.maxMemoryFileSize) {
+        file->content.resize(file->size);
+        off_t offset = 0;
+        while (offset < file->size) {
+            ssize_t n = ::pread(fd, &file->content[offset], file->size - offset, offset);
+            if (n <= 0) {
+                break;
+            }
+            offset += n;
+        }
+        if (offset == file->size) {
+            file->memory = true;
+        } else {
+            file->content.clear();
+        }
+    }
+    return file;
+}
+
+void StaticFileServlet::insert(const std::string& path, FilePtr file) {
+    if (file->memory && memorySize_ + file->content.size() > options_.maxMemorySize) {
+        // 内存层已满，这个文件退回到 sendfile
+        file->memory = false;
+        std::string().swap(file->content);
+    }
+    lru_.push_front(std::make_pair(path, file));
+    files_[path] = lru_.begin();
+    file->cached = true;
+    memorySize_ += file->content.size();
+    while (lru_.size() > options_.maxFiles) {
+        erase(--lru_.end());
+    }
+}
+
+void StaticFileServlet::erase(LruList::iterator it) {
+    // 正在发送的请求仍持有 FilePtr，fd 在最后一个引用释放时关闭
+    File& file = *it->second;
+    file.cached = false;
+    memorySize_ -= file.content.size() + (file.gzip ? file.gzip->size() : 0);
+    files_.erase(it->first);
+    lru_.erase(it);
+}
+
+std::shared_ptr<const std::string> StaticFileServlet::getGzip(const FilePtr& file) {
+    {
+        MutexGuard lock(mutex_);
+        if (file->gzipDone) {
+            return file->gzip;
+        }
+    }
+    // 第一次请求时压缩，之后直接用缓存的结果；并发的第一次请求可能重复压缩，结果相同
+    std::string buf;
+    const std::string* content = &file->content;
+    if (!file->memory) {
+        buf.resize(file->size);
+        if (::pread(file->fd, &buf[0], buf.size(), 0) != (ssize_t)buf.size()) {
+            return nullptr;
+        }
+        content = &buf;
+    }
+    std::shared_ptr<std::string> out(new std::string);
+    if (!Gzip::Compress(content->data(), content->size(), out.get(), options_.gzip.level) ||
+        out->size() >= content->size()) {
+        out.reset();
+    }
+    MutexGuard lock(mutex_);
+    if (file->gzipDone) {
+        return file->gzip;
+    }
+    if (out && file->cached) {
+        // 超出内存预算时从队尾淘汰占用内存的文件，仍放不下就不缓存，下次请求重新压缩
+        auto it = lru_.end();
+        while (memorySize_ + out->size() > options_.maxMemorySize && it != lru_.begin()) {
+            --it;
+            const File& f = *it->second;
+            if (it->second != file && (f.memory || f.gzip)) {
+                erase(it++);
+            }
+        }
+        if (memorySize_ + out->size() > options_.maxMemorySize) {
+            return out;
+        }
+        memorySize_ += out->size();
+    }
+    file->gzipDone = true;
+    file->gzip = out;
+    return out;
+}
+
+StaticFileServlet::Stats StaticFileServlet::getStats() {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.memoryHits = memoryHits_;
+    stats.notModified = notModified_;
+    stats.partial = partial_;
+    stats.gzipHits = gzipHits_;
+    MutexGuard lock(mutex_);
+    stats.files = lru_.size();
+    stats.memorySize = memorySize_;
+    return stats;
+}
+
+bool StaticFileServlet::IsNotModified(const HttpRequest& req, const std::string& etag,
+                                      time_t mtime) {
+    // If-None-Match 优先于 If-Modified-Since
+    StringPiece inm = req.getHeaderView("If-None-Match");
+    if (!inm.empty()) {
+        while (!inm.empty()) {
+            const char* comma = static_cast<const char*>(memchr(inm.data(), ',', inm.size()));
+            size_t len = comma ? comma - inm.data() : inm.size();
+            StringPiece tag = Trim(StringPiece(inm.data(), len));
+            // 比较时忽略弱校验前缀
+            if (tag.startsWith("W/")) {
+                tag.removePrefix(2);
+            }
+            if (tag == "*" || tag == etag) {
+                return true;
+            }
+            inm.removePrefix(comma ? len + 1 : len);
+        }
+        return false;
+    }
+    StringPiece ims = Trim(req.getHeaderView("If-Modified-Since"));
+    time_t since;
+    return !ims.empty() && ParseHttpDate(ims, &since) && mtime <= since;
+}
+
+int StaticFileServlet::ParseRange(const StringPiece& range, off_t size,
+                                  off_t* begin, off_t* end) {
+    StringPiece spec = Trim(range);
+    if (!spec.startsWith("bytes=")) {
+        return 0;
+    }
+    spec.removePrefix(6);
+    // 多个区间需要 multipart/byteranges，按规范可以直接返回完整文件
+    if (memchr(spec.data(), ',', spec.size())) {
+        return 0;
+    }
+    const char* dash = static_cast<const char*>(memchr(spec.data(), '-', spec.size()));
+    if (!dash) {
+        return 0;
+    }
+    StringPiece first(spec.data(), dash - spec.data());
+    StringPiece last(dash + 1, spec.end() - dash - 1);
+    off_t a = 0;
+    off_t b = 0;
+    if (first.empty()) {
+        // "-n" 表示最后 n 个字节
+        if (!ParseOffset(last, &b)) {
+            return 0;
+        }
+        if (b == 0 || size == 0) {
+            return -1;
+        }
+        *begin = b < size ? size - b : 0;
+        *end = size;
+        return 1;
+    }
+    if (!ParseOffset(first, &a)) {
+        return 0;
+    }
+    if (last.empty()) {
+        b = size - 1;
+    } else if (!ParseOffset(last, &b) || b < a) {
+        return 0;
+    }
+    if (a >= size) {
+        return -1;
+    }
+    *begin = a;
+    *end = (b < size ? b : size - 1) + 1;
+    return 1;
+}
+
+} // namespace reyao
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "reyao/http/http_servlet.h"
+#include "reyao/http/http_gzip.h"
+#include "reyao/mutex.h"
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace reyao {
+
+// 把 root 目录下的文件作为静态资源发送：
+// 路由中结尾 "*" 匹配到的部分作为相对路径，没有时使用整个请求路径；
+// 打开的 fd 和 stat 结果按 LRU 缓存，超过 ttl 后重新 stat，文件被替换时重新打开；
+// 支持 ETag/Last-Modified 条件请求（304）和单个 Range（206），
+// 文件内容用 sendfile 发出，小文件可以整个缓存在内存中；
+// 开启 gzip 时文本文件第一次被请求时压缩，压缩结果随文件缓存
+class StaticFileServlet : public Servlet {
+public:
+    typedef std::shared_ptr<StaticFileServlet> SPtr;
+
+    struct Options {
+        size_t maxFiles = 1024;             // 缓存的打开文件数
+        int64_t ttl = 5 * 1000;             // 毫秒，超过后重新 stat 检查文件是否变化
+        size_t maxMemoryFileSize = 0;       // 不超过该大小的文件内容缓存在内存中，0 表示关闭
+        size_t maxMemorySize = 64 * 1024 * 1024;
+        std::string indexFile = "index.html";
+        GzipOptions gzip;                   // cacheSize 不使用，压缩结果计入 maxMemorySize
+        size_t maxGzipFileSize = 1024 * 1024;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t memoryHits = 0;
+        uint64_t notModified = 0;
+        uint64_t partial = 0;
+        uint64_t gzipHits = 0;
+        size_t files = 0;
+        size_t memorySize = 0;
+    };
+
+    explicit StaticFileServlet(const std::string& root);
+    StaticFileServlet(const std::string& root, const Options& options);
+
+    virtual int32_t handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) override;
+
+    Stats getStats();
+
+private:
+    struct File : public NoCopyable {
+        ~File();
+
+        int fd = -1;
+        off_t size = 0;
+        time_t mtime = 0;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        std::string etag;
+        std::string lastModified;
+        const char* contentType = nullptr;
+        std::string content;                // 内存层，memory 为 true 时有效
+        bool memory = false;
+        int64_t checked = 0;                // 上次 stat 的时间
+        bool gzipable = false;
+        std::string gzipETag;
+        // 以下三项由 mutex_ 保护
+        bool cached = false;                // 是否还在 LRU 中
+        bool gzipDone = false;
+        std::shared_ptr<const std::string> gzip;    // 压缩率不够时为空
+    };
+    typedef std::shared_ptr<File> FilePtr;
+    typedef std::list<std::pair<std::string, FilePtr>> LruList;
+
+    // 返回 nullptr 表示文件不存在或不可读
+    FilePtr getFile(const std::string& path);
+    FilePtr openFile(const std::string& path);
+    void insert(const std::string& path, FilePtr file);
+    void erase(LruList::iterator it);
+    std::shared_ptr<const std::string> getGzip(const FilePtr& file);
+
+    static bool IsNotModified(const HttpRequest& req, const std::string& etag, time_t mtime);
+    // 解析 "bytes=a-b"，只支持单个区间；返回 -1 表示无法满足，0 表示忽略 Range
+    static int ParseRange(const StringPiece& range, off_t size, off_t* begin, off_t* end);
+
+    std::string root_;
+    Options options_;
+    NoFoundServlet notFound_;
+
+    Mutex mutex_;
+    LruList lru_;                           // 队头是最近使用的
+    std::unordered_map<std::string, LruList::iterator> files_;
+    size_t memorySize_ = 0;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> memoryHits_{0};
+    std::atomic<uint64_t> notModified_{0};
+    std::atomic<uint64_t> partial_{0};
+    std::atomic<uint64_t> gzipHits_{0};
+};
+
+} // namespace reyao
@@ -0,0 +1,344 @@
+#include "reyao/http/http_websocket.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <random>
+
+namespace reyao {
+
+static const char kGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+int WsCodec::ParseHeader(const char* data, size_t len, WsFrameHeader* header) {
+    if (len < 2) {
+        return 0;
+    }
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    // 没有协商扩展，RSV 必须为 0
+    if (p[0] & 0x70) {
+        return -1;
+    }
+    header->fin = p[0] & 0x80;
+    uint8_t opcode = p[0] & 0x0F;
+    if ((opcode > 0x2 && opcode < 0x8) || opcode > 0xA) {
+        return -1;
+    }
+    header->opcode = static_cast<WsOpcode>(opcode);
+    header->masked = p[1] & 0x80;
+    uint64_t payloadLen = p[1] & 0x7F;
+    size_t pos = 2;
+    if (payloadLen == 126) {
+        if (len < 4) {
+            return 0;
+        }
+        payloadLen = (uint64_t)p[2] << 8 | p[3];
+        pos = 4;
+    } else if (payloadLen == 127) {
+        if (len < 10) {
+            return 0;
+        }
+        payloadLen = 0;
+        for (int i = 0; i < 8; i++) {
+            payloadLen = payloadLen << 8 | p[2 + i];
+        }
+        pos = 10;
+    }
+    // 控制帧不能分片，长度不超过 125
+    if (opcode >= 0x8 && (!header->fin || payloadLen > 125)) {
+        return -1;
+    }
+    if (header->masked) {
+        if (len < pos + 4) {
+            return 0;
+        }
+        memcpy(header->mask, p + pos, 4);
+        pos += 4;
+    }
+    header->payloadLen = payloadLen;
+    return pos;
+}
+
+size_t WsCodec::EncodeHeader(char* buf, bool fin, WsOpcode opcode, uint64_t len,
+                             const uint8_t* mask) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(buf);
+    p[0] = (fin ? 0x80 : 0) | static_cast<uint8_t>(opcode);
+    uint8_t maskBit = mask ? 0x80 : 0;
+    size_t pos;
+    if (len < 126) {
+        p[1] = maskBit | len;
+        pos = 2;
+    } else if (len <= 0xFFFF) {
+        p[1] = maskBit | 126;
+        p[2] = len >> 8;
+        p[3] = len;
+        pos = 4;
+    } else {
+        p[1] = maskBit | 127;
+        for (int i = 0; i < 8; i++) {
+            p[2 + i] = len >> ((7 - i) * 8);
+        }
+        pos = 10;
+    }
+    if (mask) {
+        memcpy(p + pos, mask, 4);
+        pos += 4;
+    }
+    return pos;
+}
+
+void WsCodec::Mask(char* data, size_t len, const uint8_t* mask, size_t offset) {
+    // 按 data 的起点对齐掩码，之后每个字节异或 key[i % 4]
+    uint8_t key[8];
+    for (int i = 0; i < 8; i++) {
+        key[i] = mask[(offset + i) % 4];
+    }
+    uint64_t key64;
+    memcpy(&key64, key, 8);
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i key128 = _mm_set1_epi64x(key64);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, key128));
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= key64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < len; i++) {
+        data[i] ^= key[i % 4];
+    }
+}
+
+std::string WsCodec::AcceptKey(const StringPiece& key) {
+    std::string str = key.toString() + kGuid;
+    uint8_t digest[20];
+    Sha1(str.data(), str.size(), digest);
+    return Base64Encode(digest, sizeof(digest));
+}
+
+WebSocket::WebSocket(Socket::SPtr sock, bool owner, const std::string& buffered,
+                     bool client)
+    : SocketStream(sock, owner),
+      client_(client) {
+    if (!buffered.empty()) {
+        inBuf_.write(buffered.data(), buffered.size());
+    }
+}
+
+WebSocket::SPtr WebSocket::Connect(Address::SPtr addr, const std::string& path,
+                                   const std::string& host, int64_t timeout) {
+    Socket::SPtr sock = Socket::CreateTcp();
+    if (!sock->connect(*addr, timeout)) {
+        return nullptr;
+    }
+    uint8_t nonce[16];
+    static thread_local std::mt19937 rng(std::random_device{}());
+    for (auto& b : nonce) {
+        b = rng();
+    }
+    std::string key = Base64Encode(nonce, sizeof(nonce));
+    std::string req = "GET " + path + " HTTP/1.1\r\n"
+                      "Host: " + host + "\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: " + key + "\r\n"
+                      "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (sock->send(req.data(), req.size()) != (int)req.size()) {
+        return nullptr;
+    }
+    // 握手响应不经过 HttpResponseParser，读到空行即可，多读的部分交给 WebSocket
+    std::string data;
+    char buf[1024];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        if (data.size() > 8192) {
+            return nullptr;
+        }
+        int n = sock->recv(buf, sizeof(buf));
+        if (n <= 0) {
+            return nullptr;
+        }
+        data.append(buf, n);
+    }
+    std::string expect = "Sec-WebSocket-Accept: " + WsCodec::AcceptKey(key) + "\r\n";
+    if (data.compare(0, 12, "HTTP/1.1 101") != 0 ||
+        data.find(expect) == std::string::npos) {
+        LOG_WARN << "websocket handshake fail: " << data.substr(0, end);
+        return nullptr;
+    }
+    return std::make_shared<WebSocket>(sock, true, data.substr(end + 4), true);
+}
+
+bool WebSocket::readFrame(WsFrameHeader* header) {
+    while (true) {
+        int n = WsCodec::ParseHeader(inBuf_.peek(), inBuf_.getReadSize(), header);
+        if (n < 0 || (n > 0 && header->masked == client_)) {
+            // 客户端发来的帧必须加掩码，服务端发来的不能加
+            return fail(1002);
+        }
+        size_t need = WsCodec::kMaxHeaderSize;
+        if (n > 0) {
+            if (header->payloadLen > maxMessageSize_) {
+                return fail(1009);
+            }
+            if (inBuf_.getReadSize() >= n + header->payloadLen) {
+                inBuf_.readView(n);
+                return true;
+            }
+            need = n + header->payloadLen - inBuf_.getReadSize();
+        }
+        if (read(&inBuf_, std::max<size_t>(need, 4096)) <= 0) {
+            return false;
+        }
+    }
+}
+
+bool WebSocket::fail(uint16_t code) {
+    sendClose(code);
+    return false;
+}
+
+bool WebSocket::recvMessage(std::string* msg, WsOpcode* opcode) {
+    msg->clear();
+    bool inMessage = false;
+    WsOpcode type = WsOpcode::TEXT;
+    while (true) {
+        WsFrameHeader header;
+        if (!readFrame(&header)) {
+            return false;
+        }
+        // 在输入缓冲区中原地去掩码，数据帧再拷贝进 msg
+        char* payload = const_cast<char*>(inBuf_.peek());
+        size_t len = header.payloadLen;
+        if (header.masked) {
+            WsCodec::Mask(payload, len, header.mask);
+        }
+        StringPiece data = inBuf_.readView(len);
+        switch (header.opcode) {
+            case WsOpcode::PING:
+                if (!sendFrame(data, WsOpcode::PONG, true)) {
+                    return false;
+                }
+                continue;
+            case WsOpcode::PONG:
+                continue;
+            case WsOpcode::CLOSE:
+                closeCode_ = len >= 2 ? (uint8_t)data[0] << 8 | (uint8_t)data[1] : 1005;
+                // 回应对端的 close 后结束
+                sendClose(len >= 2 ? closeCode_ : 1000);
+                return false;
+            case WsOpcode::TEXT:
+            case WsOpcode::BINARY:
+                if (inMessage) {
+                    return fail(1002);
+                }
+                inMessage = true;
+                type = header.opcode;
+                break;
+            case WsOpcode::CONTINUATION:
+                if (!inMessage) {
+                    return fail(1002);
+                }
+                break;
+            default:
+                return fail(1002);
+        }
+        if (msg->size() + len > maxMessageSize_) {
+            return fail(1009);
+        }
+        msg->append(data.data(), len);
+        if (header.fin) {
+            if (opcode) {
+                *opcode = type;
+            }
+            return true;
+        }
+    }
+}
+
+bool WebSocket::sendFrame(const StringPiece& data, WsOpcode opcode, bool fin) {
+    if (closeSent_ && opcode != WsOpcode::CLOSE) {
+        return false;
+    }
+    char* buf = prepareAppend(WsCodec::kMaxHeaderSize);
+    if (!client_) {
+        commitAppend(WsCodec::EncodeHeader(buf, fin, opcode, data.size()));
+        // 服务端的 payload 不加掩码，按引用和头部一起 writev
+        appendRef(data.data(), data.size());
+        return flush() >= 0;
+    }
+    static thread_local std::mt19937 rng(std::random_device{}());
+    uint32_t key32 = rng();
+    uint8_t mask[4];
+    memcpy(mask, &key32, 4);
+    commitAppend(WsCodec::EncodeHeader(buf, fin, opcode, data.size(), mask));
+    // 客户端必须加掩码，拷贝进发送缓冲区后原地异或
+    char* payload = prepareAppend(data.size());
+    memcpy(payload, data.data(), data.size());
+    WsCodec::Mask(payload, data.size(), mask);
+    commitAppend(data.size());
+    return flush() >= 0;
+}
+
+bool WebSocket::sendClose(uint16_t code, const StringPiece& reason) {
+    if (closeSent_) {
+        return true;
+    }
+    char payload[125];
+    payload[0] = code >> 8;
+    payload[1] = code;
+    size_t len = std::min<size_t>(reason.size(), sizeof(payload) - 2);
+    memcpy(payload + 2, reason.data(), len);
+    bool ok = sendFrame(StringPiece(payload, len + 2), WsOpcode::CLOSE, true);
+    closeSent_ = true;
+    return ok;
+}
+
+WebSocketServlet::WebSocketServlet(Handler handler)
+    : Servlet("WebSocketServlet"),
+      handler_(handler) {
+}
+
+bool WebSocketServlet::IsUpgrade(const HttpRequest& req) {
+    return req.getMethod() == HttpMethod::GET &&
+           req.getHeaderView(HttpRequest::UPGRADE).caseEqual("websocket") &&
+           HasToken(req.getHeaderView(HttpRequest::CONNECTION), "upgrade") &&
+           req.getHeaderView("Sec-WebSocket-Version") == "13" &&
+           !req.getHeaderView("Sec-WebSocket-Key").empty();
+}
+
+int32_t WebSocketServlet::handle(const HttpRequest& req,
+                                 HttpResponse* rsp,
+                                 const HttpSession& session) {
+    if (!IsUpgrade(req)) {
+        rsp->setStatus(HttpStatus::BAD_REQUEST);
+        rsp->setKeepAlive(false);
+        return -1;
+    }
+    rsp->setStatus(HttpStatus::SWITCHING_PROTOCOLS);
+    rsp->addHeader("Upgrade", "websocket");
+    rsp->addHeader("Sec-WebSocket-Accept",
+                   WsCodec::AcceptKey(req.getHeaderView("Sec-WebSocket-Key")));
+    Handler handler = handler_;
+    size_t maxMessageSize = maxMessageSize_;
+    // takeover 在 handleClient 返回之前同步调用，req 仍然有效
+    const HttpRequest* request = &req;
+    rsp->setTakeover([handler, maxMessageSize, request](HttpTakeover& conn) {
+        WebSocket::SPtr ws = std::make_shared<WebSocket>(conn.client, false, conn.buffered);
+        ws->setMaxMessageSize(maxMessageSize);
+        handler(*request, ws);
+        ws->sendClose(1000);
+        conn.close();
+    });
+    return 0;
+}
+
+} // namespace reyao
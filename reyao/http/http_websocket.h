@@ -0,0 +1,114 @@
+#pragma once
+
+#include "reyao/http/http_servlet.h"
+#include "reyao/socket_stream.h"
+#include "reyao/bytearray.h"
+#include "reyao/address.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace reyao {
+
+enum class WsOpcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA,
+};
+
+struct WsFrameHeader {
+    bool fin = true;
+    WsOpcode opcode = WsOpcode::TEXT;
+    bool masked = false;
+    uint8_t mask[4] = {0};
+    uint64_t payloadLen = 0;
+};
+
+// RFC 6455 的帧编解码，与连接无关
+class WsCodec {
+public:
+    static const size_t kMaxHeaderSize = 14;
+
+    // 解析帧头：数据不够时返回 0，帧不合法返回 -1，否则返回帧头长度
+    static int ParseHeader(const char* data, size_t len, WsFrameHeader* header);
+    // buf 至少 kMaxHeaderSize 字节，mask 为空表示不加掩码，返回帧头长度
+    static size_t EncodeHeader(char* buf, bool fin, WsOpcode opcode, uint64_t len,
+                               const uint8_t* mask = nullptr);
+    // 原地异或掩码（加掩码和去掩码相同），offset 是 data 在 payload 中的位置；
+    // 按 16 字节（SSE2）或 8 字节一次处理，剩下的逐字节
+    static void Mask(char* data, size_t len, const uint8_t* mask, size_t offset = 0);
+    // 握手时 Sec-WebSocket-Accept 的值
+    static std::string AcceptKey(const StringPiece& key);
+};
+
+// 升级之后的 WebSocket 连接，在协程中使用：recvMessage 阻塞时由 hook 挂起协程。
+// 收到 ping 自动回复 pong，分片消息拼接后返回；同一连接的收发需在同一个协程（或 worker）中
+class WebSocket : public SocketStream {
+public:
+    typedef std::shared_ptr<WebSocket> SPtr;
+
+    // buffered 是握手时多读的数据；client 为 true 时发出的帧加掩码，收到的帧不能有掩码
+    WebSocket(Socket::SPtr sock, bool owner, const std::string& buffered = "",
+              bool client = false);
+
+    // 客户端：连接 addr 并完成握手，失败返回 nullptr
+    static SPtr Connect(Address::SPtr addr, const std::string& path,
+                        const std::string& host = "localhost", int64_t timeout = 5000);
+
+    // 收到一个完整的数据消息时返回 true；对端关闭、出错或协议错误时返回 false，
+    // 协议错误时已经发出 close 帧
+    bool recvMessage(std::string* msg, WsOpcode* opcode = nullptr);
+    bool sendMessage(const StringPiece& data, WsOpcode opcode = WsOpcode::TEXT) {
+        return sendFrame(data, opcode, true);
+    }
+    // 分片发送：第一片用 TEXT/BINARY，后续用 CONTINUATION，最后一片 fin 为 true
+    bool sendFrame(const StringPiece& data, WsOpcode opcode, bool fin);
+    bool ping(const StringPiece& data = StringPiece()) {
+        return sendFrame(data, WsOpcode::PING, true);
+    }
+    // 发出 close 帧，只发一次
+    bool sendClose(uint16_t code = 1000, const StringPiece& reason = StringPiece());
+
+    void setMaxMessageSize(size_t size) { maxMessageSize_ = size; }
+    // 对端 close 帧中的状态码，没有收到时为 0
+    uint16_t getCloseCode() const { return closeCode_; }
+
+private:
+    // 读到一个完整的帧，帧头已消费，payload 在 inBuf_ 的读位置
+    bool readFrame(WsFrameHeader* header);
+    bool fail(uint16_t code);
+
+    ByteArray inBuf_;
+    bool client_;
+    bool closeSent_ = false;
+    uint16_t closeCode_ = 0;
+    size_t maxMessageSize_ = 16 * 1024 * 1024;
+};
+
+// 升级请求交给 handler，handler 在连接的协程中运行，返回后连接关闭；
+// 不是合法的升级请求时回复 400
+class WebSocketServlet : public Servlet {
+public:
+    typedef std::shared_ptr<WebSocketServlet> SPtr;
+    typedef std::function<void(const HttpRequest&, WebSocket::SPtr)> Handler;
+
+    WebSocketServlet(Handler handler);
+    virtual int32_t handle(const HttpRequest& req,
+                           HttpResponse* rsp,
+                           const HttpSession& session) override;
+
+    void setMaxMessageSize(size_t size) { maxMessageSize_ = size; }
+    static bool IsUpgrade(const HttpRequest& req);
+
+private:
+    Handler handler_;
+    size_t maxMessageSize_ = 16 * 1024 * 1024;
+};
+
+} // namespace reyao
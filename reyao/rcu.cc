@@ -0,0 +1,151 @@
+#include "reyao/rcu.h"
+#include "reyao/mutex.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <new>
+#include <vector>
+
+namespace reyao {
+
+namespace {
+
+static const size_t kCacheLine = 64;
+
+// 每个线程一个槽位，epoch 为 0 表示不在临界区；线程退出后槽位可以被复用。
+// 槽位独占一个缓存行，不同线程登记 epoch 时不会互相使缓存行失效
+struct alignas(kCacheLine) Slot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> inUse{false};
+    Slot* next = nullptr;
+};
+
+struct Retired {
+    void* ptr;
+    Rcu::Deleter deleter;
+    uint64_t epoch;
+};
+
+std::atomic<uint64_t> s_epoch{1};
+std::atomic<Slot*> s_slots{nullptr};
+std::atomic<size_t> s_pending{0};
+std::atomic<bool> s_reclaiming{false};
+
+Mutex& retiredMutex() {
+    static Mutex mutex;
+    return mutex;
+}
+
+std::vector<Retired>& retiredList() {
+    static std::vector<Retired> retired;
+    return retired;
+}
+
+Slot* acquireSlot() {
+    for (Slot* slot = s_slots.load(); slot; slot = slot->next) {
+        bool expected = false;
+        if (!slot->inUse.load() && slot->inUse.compare_exchange_strong(expected, true)) {
+            return slot;
+        }
+    }
+    // 槽位只增不删，遍历时不需要加锁；C++11 的 new 不保证按缓存行对齐
+    void* mem = nullptr;
+    if (posix_memalign(&mem, kCacheLine, sizeof(Slot)) != 0) {
+        throw std::bad_alloc();
+    }
+    Slot* slot = new (mem) Slot;
+    slot->inUse = true;
+    slot->next = s_slots.load();
+    while (!s_slots.compare_exchange_weak(slot->next, slot)) {
+    }
+    return slot;
+}
+
+struct LocalSlot {
+    Slot* slot = nullptr;
+    int depth = 0;
+
+    ~LocalSlot() {
+        if (slot) {
+            slot->epoch = 0;
+            slot->inUse = false;
+        }
+    }
+};
+
+thread_local LocalSlot t_local;
+
+} // namespace
+
+void Rcu::ReadLock() {
+    if (t_local.depth++ > 0) {
+        return;
+    }
+    if (!t_local.slot) {
+        t_local.slot = acquireSlot();
+    }
+    // 先登记再读指针：写者替换指针后看不到这里的登记时，读到的一定是新指针
+    t_local.slot->epoch.store(s_epoch.load());
+}
+
+void Rcu::ReadUnlock() {
+    if (--t_local.depth > 0) {
+        return;
+    }
+    t_local.slot->epoch.store(0, std::memory_order_release);
+    // 有等待回收的对象时顺手回收，写者更新时有读者在临界区也不会一直挂着
+    if (s_pending.load(std::memory_order_relaxed) > 0 &&
+        !s_reclaiming.exchange(true, std::memory_order_acquire)) {
+        Reclaim();
+        s_reclaiming.store(false, std::memory_order_release);
+    }
+}
+
+void Rcu::Retire(void* ptr, Deleter deleter) {
+    {
+        MutexGuard lock(retiredMutex());
+        // 替换指针之后才推进 epoch，登记了新 epoch 的读者不会再读到 ptr
+        uint64_t epoch = s_epoch.fetch_add(1) + 1;
+        retiredList().push_back(Retired{ptr, deleter, epoch});
+        ++s_pending;
+    }
+    Reclaim();
+}
+
+size_t Rcu::Reclaim() {
+    std::vector<Retired> ready;
+    size_t pending;
+    {
+        MutexGuard lock(retiredMutex());
+        std::vector<Retired>& retired = retiredList();
+        if (retired.empty()) {
+            return 0;
+        }
+        uint64_t minEpoch = UINT64_MAX;
+        for (Slot* slot = s_slots.load(); slot; slot = slot->next) {
+            uint64_t epoch = slot->epoch.load();
+            if (epoch != 0 && epoch < minEpoch) {
+                minEpoch = epoch;
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].epoch <= minEpoch) {
+                ready.push_back(retired[i]);
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+        pending = kept;
+        s_pending = kept;
+    }
+    // 在锁外析构，deleter 里可能再次 Retire
+    for (auto& r : ready) {
+        r.deleter(r.ptr);
+    }
+    return pending;
+}
+
+} // namespace reyao
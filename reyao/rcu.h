@@ -0,0 +1,58 @@
+#pragma once
+
+#include "reyao/nocopyable.h"
+
+#include <stddef.h>
+
+#include <atomic>
+
+namespace reyao {
+
+// 基于 epoch 的延迟回收，用于读多写极少的共享数据：
+// 读者进入临界区时登记当前 epoch，只写自己线程的槽位，不碰共享计数；
+// 写者原子替换指针后把旧对象交给 Retire，等所有读者都离开旧 epoch 后再删除。
+// 临界区内不能切换协程，也不能保存读到的裸指针到临界区之外。
+class Rcu {
+public:
+    typedef void (*Deleter)(void*);
+
+    // 可以嵌套，只有最外层登记 epoch
+    static void ReadLock();
+    static void ReadUnlock();
+    // 写者调用：ptr 已经对新读者不可见，由 deleter 在安全时释放
+    static void Retire(void* ptr, Deleter deleter);
+    // 释放已经没有读者引用的对象，返回还在等待的数量
+    static size_t Reclaim();
+};
+
+class RcuReadGuard : public NoCopyable {
+public:
+    RcuReadGuard() { Rcu::ReadLock(); }
+    ~RcuReadGuard() { Rcu::ReadUnlock(); }
+};
+
+// 通过原子指针发布的只读对象，更新时整体替换（写时复制）；
+// 多个写者之间需要调用方自己互斥
+template <typename T>
+class RcuPtr : public NoCopyable {
+public:
+    explicit RcuPtr(T* ptr = nullptr) : ptr_(ptr) {}
+    ~RcuPtr() { delete ptr_.load(); }
+
+    // 必须在 RcuReadGuard 范围内使用返回值
+    const T* get() const { return ptr_.load(); }
+
+    void update(T* ptr) {
+        T* old = ptr_.exchange(ptr);
+        if (old) {
+            Rcu::Retire(old, &RcuPtr::Delete);
+        }
+    }
+
+private:
+    static void Delete(void* ptr) { delete static_cast<T*>(ptr); }
+
+    std::atomic<T*> ptr_;
+};
+
+} // namespace reyao
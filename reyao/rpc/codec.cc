@@ -39,21 +39,34 @@ void ProtobufCodec::send(MessageSPtr msg) {
     ss_.write(&ba);
 }
 
+static int32_t asInt32(const char* buf) {
+    int32_t be32 = 0;
+    ::memcpy(&be32, buf, sizeof(be32));
+    return byteSwapOnLittleEndian(be32);
+}
+
 ProtobufCodec::ErrMsg::SPtr ProtobufCodec::receive(MessageSPtr& msg) {
-    ByteArray ba;
-    while (ss_.read(&ba, 4096) > 0) {
-        if (ba.getReadSize() > kHeaderLen + kMinMessageLen) {
-            const int32_t len = ba.readInt32();
+    while (true) {
+        // 长度字段只查看不取出，整个消息到齐后才消费，多读的字节留给下一次 receive
+        if (buf_.getReadSize() >= kHeaderLen) {
+            const int32_t len = asInt32(buf_.peek());
             if (len > kMaxMessageLen || len < kMinMessageLen) {
                 return std::make_shared<ErrMsg>(ErrorCode::kInvalidLength, "invalid length len= " + std::to_string(len));
-            } else if (ba.getReadSize() >= static_cast<size_t>(len)) {
+            }
+            if (buf_.getReadSize() >= kHeaderLen + static_cast<size_t>(len)) {
+                buf_.setReadPos(buf_.getReadPos() + kHeaderLen);
+                size_t end = buf_.getReadPos() + len;
                 auto errMsg = std::make_shared<ErrMsg>(ErrorCode::kNoError, "no error");
-                msg = Parse(ba, len, errMsg);
+                msg = Parse(buf_, len, errMsg);
+                // 解析失败时也跳过整个消息
+                buf_.setReadPos(end);
                 return errMsg;
             }
         }
+        if (ss_.read(&buf_, 4096) <= 0) {
+            return std::make_shared<ErrMsg>(ErrorCode::kServerClosed, "closed by peer");
+        }
     }
-    return std::make_shared<ErrMsg>(ErrorCode::kServerClosed, "closed by peer");
 }
 
 
@@ -73,12 +86,6 @@ google::protobuf::Message* ProtobufCodec::CreateMessage(const std::string& typeN
     return msg;
 }
 
-int32_t asInt32(const char* buf) {
-	int32_t be32 = 0;
-	::memcpy(&be32, buf, sizeof(be32));
-	return byteSwapOnLittleEndian(be32);
-}
-
 MessageSPtr ProtobufCodec::Parse(ByteArray& ba, int len, ErrMsg::SPtr errMsg) {
     int32_t nameLen = ba.readInt32();
 
@@ -88,25 +95,25 @@ MessageSPtr ProtobufCodec::Parse(ByteArray& ba, int len, ErrMsg::SPtr errMsg) {
         errMsg->errstr = "invalid name length = " + std::to_string(nameLen);
         return msg;
     }
-    std::string name = std::string(ba.peek(), nameLen - 1);
-    ba.setReadPos(ba.getReadPos() + nameLen - 1);
+    // 类型名和 payload 都直接在 ba 上原地解析，视图在 ba 下一次写入前有效
+    StringPiece name = ba.readView(nameLen - 1);
     if (static_cast<char>(ba.readInt8()) != '\0') {
         errMsg->errcode = ErrorCode::kParseError;
         errMsg->errstr = "invalid type name";
         return msg;
     }
-    msg.reset(CreateMessage(name));
+    msg.reset(CreateMessage(name.toString()));
     if (!msg) {
         errMsg->errcode = ErrorCode::kUnknownMessageType;
-        errMsg->errstr = "type name = " + name;
+        errMsg->errstr = "type name = " + name.toString();
         return msg;
     }
 
-    const char* payload = ba.peek();
     int32_t payloadLen = len - kHeaderLen - nameLen;
-    if (!msg->ParseFromArray(payload, payloadLen)) {
+    StringPiece payload = ba.readView(payloadLen);
+    if (!msg->ParseFromArray(payload.data(), payload.size())) {
         errMsg->errcode = ErrorCode::kParseError;
-        errMsg->errstr = "message " + name + " parse error";
+        errMsg->errstr = "message " + name.toString() + " parse error";
         return msg;
     }
 
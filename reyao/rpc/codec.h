@@ -3,6 +3,7 @@
 #include "reyao/tcp_client.h"
 #include "reyao/socket.h"
 #include "reyao/socket_stream.h"
+#include "reyao/bytearray.h"
 
 #include <google/protobuf/message.h>
 
@@ -45,6 +46,7 @@ public:
     ~ProtobufCodec() {}
 
     void send(MessageSPtr msg);
+    // 一个连接上的多次 receive 要使用同一个 codec，读多的数据留在 buf_ 中
     ErrMsg::SPtr receive(MessageSPtr& msg);
 
 private:
@@ -60,6 +62,7 @@ private:
     const static int kMaxMessageLen = 64 * 1024 * 1024;
 
     SocketStream ss_;
+    ByteArray buf_;
 };
 
 } // namespace rpc
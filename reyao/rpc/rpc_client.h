@@ -4,6 +4,7 @@
 #include "reyao/log.h"
 #include "reyao/nocopyable.h"
 #include "reyao/tcp_client.h"
+#include "reyao/connection_pool.h"
 #include "reyao/scheduler.h"
 
 
@@ -24,10 +25,36 @@ public:
 class RpcClient : public NoCopyable {
 public:
     typedef std::shared_ptr<RpcClient> SPtr;
-    RpcClient(Scheduler* sche, IPv4Address::SPtr addr): client_(sche, addr) {}
+    RpcClient(Scheduler* sche, Address::SPtr addr)
+        : sche_(sche), addr_(addr), client_(sche, addr) {}
+    // 从连接池借连接，请求完成后归还，同一连接可以被后续调用复用
+    RpcClient(Scheduler* sche, Address::SPtr addr, ConnectionPool::SPtr pool)
+        : sche_(sche), addr_(addr), client_(sche, addr), pool_(pool) {}
 
     template<typename RspMessage>
     void Call(MessageSPtr req, typename TypeTraits<RspMessage>::ResponseHandler handler) {
+        if (pool_) {
+            sche_->addTask([this, req, handler]() {
+                Socket::SPtr conn = pool_->borrow(addr_);
+                if (!conn) {
+                    LOG_ERROR << "RpcClient borrow connection to "
+                              << addr_->toString() << " fail";
+                    return;
+                }
+                ProtobufCodec codec(conn);
+                codec.send(req);
+                MessageSPtr rsp = nullptr;
+                auto errMsg = codec.receive(rsp);
+                bool ok = errMsg->errcode == ProtobufCodec::kNoError && rsp;
+                pool_->giveBack(addr_, conn, ok);
+                if (ok) {
+                    handler(std::static_pointer_cast<RspMessage>(rsp));
+                } else {
+                    LOG_ERROR << "receive response error: " << errMsg->errstr;
+                }
+            });
+            return;
+        }
         client_.setConnectCallBack([this, req, handler](Socket::SPtr conn) {
             // LOG_DEBUG << "RpcClient connect to " << client_.getConn()->getPeerAddr()->toString();
             ProtobufCodec codec(conn);
@@ -51,7 +78,10 @@ public:
     }
 
 private:
+    Scheduler* sche_;
+    Address::SPtr addr_;
     TcpClient client_;
+    ConnectionPool::SPtr pool_;
 };
 
 } // namespace rpc
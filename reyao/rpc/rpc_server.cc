@@ -4,33 +4,37 @@
 namespace reyao {
 namespace rpc {
 
+// 一个连接上可以连续处理多个请求，客户端用连接池复用连接时不必每次握手
 void RpcServer::handleClient(Socket::SPtr client) {
     ProtobufCodec codec(client);
 
-    MessageSPtr msg;
-    auto err_msg = codec.receive(msg);
-    if (err_msg->errcode != ProtobufCodec::ErrorCode::kNoError || !msg) {
-        LOG_ERROR << "RpcServer recevie error: " << err_msg->errstr;
-        client->close();
-        return;
+    while (true) {
+        MessageSPtr msg;
+        auto err_msg = codec.receive(msg);
+        if (err_msg->errcode == ProtobufCodec::ErrorCode::kServerClosed) {
+            break;
+        }
+        if (err_msg->errcode != ProtobufCodec::ErrorCode::kNoError || !msg) {
+            LOG_ERROR << "RpcServer recevie error: " << err_msg->errstr;
+            break;
+        }
+        bool is_register = false;
+        HandlerMap::const_iterator it;
+        const google::protobuf::Descriptor* descriptor = msg->GetDescriptor();
+        {
+            MutexGuard lock(mutex_);
+            it = handlers_.find(descriptor);
+            is_register = it != handlers_.end();
+        }
+
+        if (!is_register) {
+            LOG_ERROR << "RpcServer unknown message";
+            break;
+        }
+
+        MessageSPtr rsp = it->second->onMessage(msg);
+        codec.send(rsp);
     }
-    bool is_register = false;
-    HandlerMap::const_iterator it;
-    const google::protobuf::Descriptor* descriptor = msg->GetDescriptor();
-    {
-        MutexGuard lock(mutex_);
-        it = handlers_.find(descriptor);
-        is_register = it != handlers_.end();
-    }
-
-    if (!is_register) {
-        LOG_ERROR << "RpcServer unknown message";
-        client->close();
-        return;
-    }
-
-    MessageSPtr rsp = it->second->onMessage(msg);
-    codec.send(rsp);
 
     client->close();
 }
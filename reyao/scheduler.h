@@ -48,6 +48,8 @@ public:
     void joinThread();
     Worker* getNextWorker();
     Worker* getMainWorker() { return &mainWorker_; }
+    // 执行任务的 worker 列表，多线程时需要在 startAsync 之后调用
+    const std::vector<Worker*>& getWorkers() const { return workers_; }
 
     virtual void timerInsertAtFront() override;
 
@@ -2,15 +2,31 @@
 #include "reyao/log.h"
 #include "reyao/fdmanager.h"
 #include "reyao/hook.h"
+#include "reyao/util.h"
 
 #include <time.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <sys/stat.h>
 
 namespace reyao {
 
-Socket::Socket(int type, int family, int protocol)
+std::string SocketProfile::toString() const {
+    std::stringstream ss;
+    ss << "deferAccept=" << deferAccept
+       << " fastOpenQueue=" << fastOpenQueue
+       << " fastOpenConnect=" << fastOpenConnect
+       << " quickAck=" << quickAck
+       << " busyPoll=" << busyPoll
+       << " sendBuf=" << sendBuf
+       << " recvBuf=" << recvBuf
+       << " notSentLowat=" << notSentLowat
+       << " incomingCpu=" << incomingCpu;
+    return ss.str();
+}
+
+Socket::Socket(int family, int type, int protocol)
     : type_(type),
       family_(family),
       protocol_(protocol) {
@@ -21,25 +37,33 @@ Socket::~Socket() {
     close();
 }
 
-IPv4Address::SPtr Socket::getLocalAddr() { 
+Address::SPtr Socket::getLocalAddr() { 
     if (!local_) {
-        IPv4Address::SPtr addr = std::make_shared<IPv4Address>();
+        Address::SPtr addr = Address::Create(family_);
+        if (!addr) {
+            return nullptr;
+        }
         socklen_t addrlen = addr->getAddrLen();
         if (::getsockname(sockfd_, addr->getAddr(), &addrlen)) {
             return nullptr;
         }
+        addr->setAddrLen(addrlen);
         local_ = addr;
     }
     return local_;
 }
 
-IPv4Address::SPtr Socket::getPeerAddr() { 
+Address::SPtr Socket::getPeerAddr() { 
     if (!peer_) {
-        IPv4Address::SPtr addr = std::make_shared<IPv4Address>();
+        Address::SPtr addr = Address::Create(family_);
+        if (!addr) {
+            return nullptr;
+        }
         socklen_t addrlen = addr->getAddrLen();
         if (::getpeername(sockfd_, addr->getAddr(), &addrlen)) {
             return nullptr;
         }
+        addr->setAddrLen(addrlen);
         peer_ = addr;
     }
     return peer_;
@@ -47,8 +71,8 @@ IPv4Address::SPtr Socket::getPeerAddr() {
 
 std::string Socket::toString() const {
     std::stringstream ss;
-    ss << "sockfd=" << sockfd_ << " type=" << type_ 
-        << " protocol=" << protocol_;
+    ss << "sockfd=" << sockfd_ << " family=" << family_
+        << " type=" << type_ << " protocol=" << protocol_;
     if (state_ == State::LISTEN) {
         ss << " state=LISTEN";
         if (local_) {
@@ -157,13 +181,96 @@ void Socket::setReuseAddr() {
 
 void Socket::setNoDelay() {
     int val = 1;
-    if (type_ == SOCK_STREAM) {
+    if (isTcp()) {
         setOption(IPPROTO_TCP, TCP_NODELAY, val);
     }
 }
 
+void Socket::setReusePort() {
+    int val = 1;
+    setOption(SOL_SOCKET, SO_REUSEPORT, val);
+}
+
+void Socket::applyProfile(const SocketProfile& profile, ProfileStage stage) {
+    if (!isValid()) {
+        return;
+    }
+    // 缓冲区大小需要在 listen/connect 之前设置才会影响窗口扩大因子，
+    // accept 出来的 socket 继承 listen socket 的设置
+    if (stage != ACCEPT_STAGE) {
+        if (profile.sendBuf > 0) {
+            setOption(SOL_SOCKET, SO_SNDBUF, profile.sendBuf);
+        }
+        if (profile.recvBuf > 0) {
+            setOption(SOL_SOCKET, SO_RCVBUF, profile.recvBuf);
+        }
+        if (profile.busyPoll > 0) {
+            setOption(SOL_SOCKET, SO_BUSY_POLL, profile.busyPoll);
+        }
+    }
+    if (stage == LISTEN_STAGE && profile.incomingCpu >= 0) {
+        setOption(SOL_SOCKET, SO_INCOMING_CPU, profile.incomingCpu);
+    }
+    if (!isTcp()) {
+        return;
+    }
+
+    switch (stage) {
+        case LISTEN_STAGE:
+            if (profile.deferAccept > 0) {
+                setOption(IPPROTO_TCP, TCP_DEFER_ACCEPT, profile.deferAccept);
+            }
+            if (profile.fastOpenQueue > 0) {
+                setOption(IPPROTO_TCP, TCP_FASTOPEN, profile.fastOpenQueue);
+            }
+            break;
+        case CONNECT_STAGE:
+            if (profile.fastOpenConnect) {
+                int val = 1;
+                setOption(IPPROTO_TCP, TCP_FASTOPEN_CONNECT, val);
+            }
+            break;
+        case ACCEPT_STAGE:
+            break;
+    }
+    if (stage != LISTEN_STAGE) {
+        if (profile.quickAck) {
+            int val = 1;
+            setOption(IPPROTO_TCP, TCP_QUICKACK, val);
+        }
+        if (profile.notSentLowat > 0) {
+            setOption(IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile.notSentLowat);
+        }
+    }
+}
+
+SocketProfile Socket::getAppliedProfile() {
+    SocketProfile profile;
+    if (!isValid()) {
+        return profile;
+    }
+    // 注意内核读回的 SO_SNDBUF/SO_RCVBUF 是设置值的两倍
+    getOption(SOL_SOCKET, SO_SNDBUF, profile.sendBuf);
+    getOption(SOL_SOCKET, SO_RCVBUF, profile.recvBuf);
+    getOption(SOL_SOCKET, SO_BUSY_POLL, profile.busyPoll);
+    getOption(SOL_SOCKET, SO_INCOMING_CPU, profile.incomingCpu);
+    if (isTcp()) {
+        int val = 0;
+        getOption(IPPROTO_TCP, TCP_DEFER_ACCEPT, profile.deferAccept);
+        getOption(IPPROTO_TCP, TCP_FASTOPEN, profile.fastOpenQueue);
+        if (getOption(IPPROTO_TCP, TCP_FASTOPEN_CONNECT, val)) {
+            profile.fastOpenConnect = val != 0;
+        }
+        if (getOption(IPPROTO_TCP, TCP_QUICKACK, val)) {
+            profile.quickAck = val != 0;
+        }
+        getOption(IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile.notSentLowat);
+    }
+    return profile;
+}
+
 void Socket::newSock() {
-    sockfd_ = ::socket(type_, family_, protocol_);
+    sockfd_ = ::socket(family_, type_, protocol_);
     if (sockfd_ == -1) {
         LOG_ERROR << "newSock error=" 
                   << strerror(errno);
@@ -173,13 +280,36 @@ void Socket::newSock() {
     }
 }
 
-bool Socket::bind(const IPv4Address& addr) {
+// 清理上次进程残留的 socket 文件：只删除 socket 类型且已经没有进程监听的文件，
+// 避免抢占正在使用的地址
+static void RemoveStaleUnixSocket(const UnixAddress& addr, int type) {
+    std::string path = addr.getPath();
+    struct stat st;
+    if (addr.isAbstract() || path.empty() ||
+        ::lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return;
+    }
+    int fd = socket_origin(AF_UNIX, type | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return;
+    }
+    if (connect_origin(fd, addr.getAddr(), addr.getAddrLen()) == -1 &&
+        errno == ECONNREFUSED) {
+        ::unlink(path.c_str());
+    }
+    close_origin(fd);
+}
+
+bool Socket::bind(const Address& addr) {
     if (!isValid()) {
         newSock();
         if (!isValid()) {
             return false;
         }
     }
+    if (addr.getFamily() == AF_UNIX) {
+        RemoveStaleUnixSocket(static_cast<const UnixAddress&>(addr), type_);
+    }
     if (::bind(sockfd_, addr.getAddr(), addr.getAddrLen())) {
         return false;
     }
@@ -204,7 +334,7 @@ Socket::SPtr Socket::accept() {
     if (new_conn_fd == -1) {
         return nullptr; 
     }
-    Socket::SPtr new_conn(new Socket(type_, family_, protocol_));
+    Socket::SPtr new_conn(new Socket(family_, type_, protocol_));
     if (new_conn->init(new_conn_fd)) {
         return new_conn;
     }
@@ -221,7 +351,7 @@ bool Socket::close() {
     return true;
 }
 
-bool Socket::connect(const IPv4Address& addr, int64_t timeout) {
+bool Socket::connect(const Address& addr, int64_t timeout) {
     if (!isValid()) {
         newSock();
     }
@@ -239,6 +369,7 @@ bool Socket::connect(const IPv4Address& addr, int64_t timeout) {
         }
     }
     state_ = State::CONNECTED;
+    connectTime_ = GetCurrentMs();
     getLocalAddr();
     getPeerAddr();
     return true;
@@ -251,8 +382,16 @@ int Socket::send(const void *buf, size_t len, int flags) {
     return -1;
 }
 
-int Socket::sendTo(const void *buf, size_t len, const IPv4Address& to, int flags) {
+int Socket::sendv(const iovec* iov, int iovcnt) {
     if (isConnected()) {
+        return ::writev(sockfd_, iov, iovcnt);
+    }
+    return -1;
+}
+
+// 数据报 socket 不需要 connect，只要求 fd 有效
+int Socket::sendTo(const void *buf, size_t len, const Address& to, int flags) {
+    if (isValid()) {
         return ::sendto(sockfd_, buf, len, flags, 
                         to.getAddr(), to.getAddrLen());
     }
@@ -266,11 +405,29 @@ int Socket::recv(void *buf, size_t len, int flags) {
     return -1;
 }
  
-int Socket::recvFrom(void *buf, size_t len, const IPv4Address& from, int flags) {
-    if (isConnected()) {
+int Socket::recvFrom(void *buf, size_t len, Address& from, int flags) {
+    if (isValid()) {
         socklen_t addrlen = from.getAddrLen();
-        return ::recvfrom(sockfd_, buf, len, flags, 
-                          (sockaddr*)from.getAddr(), &addrlen);
+        int n = ::recvfrom(sockfd_, buf, len, flags, 
+                           from.getAddr(), &addrlen);
+        if (n >= 0) {
+            from.setAddrLen(addrlen);
+        }
+        return n;
+    }
+    return -1;
+}
+
+int Socket::sendMsgs(mmsghdr* msgs, unsigned int vlen, int flags) {
+    if (isValid()) {
+        return ::sendmmsg(sockfd_, msgs, vlen, flags);
+    }
+    return -1;
+}
+
+int Socket::recvMsgs(mmsghdr* msgs, unsigned int vlen, int flags) {
+    if (isValid()) {
+        return ::recvmmsg(sockfd_, msgs, vlen, flags, nullptr);
     }
     return -1;
 }
@@ -291,5 +448,25 @@ Socket::SPtr Socket::CreateTcp() {
     Socket::SPtr sock(new Socket(AF_INET, SOCK_STREAM, 0));
     return sock;
 }
+
+Socket::SPtr Socket::CreateUdp() {
+    Socket::SPtr sock(new Socket(AF_INET, SOCK_DGRAM, 0));
+    return sock;
+}
+
+Socket::SPtr Socket::CreateUnixStream() {
+    Socket::SPtr sock(new Socket(AF_UNIX, SOCK_STREAM, 0));
+    return sock;
+}
+
+Socket::SPtr Socket::CreateUnixDgram() {
+    Socket::SPtr sock(new Socket(AF_UNIX, SOCK_DGRAM, 0));
+    return sock;
+}
+
+Socket::SPtr Socket::CreateStream(const Address& addr) {
+    Socket::SPtr sock(new Socket(addr.getFamily(), SOCK_STREAM, 0));
+    return sock;
+}
     
 } // namespace reyao
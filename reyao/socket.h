@@ -5,12 +5,29 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <memory>
 #include <sstream>
 
 namespace reyao {
 
+// socket 调优参数，0 表示不设置、保持系统默认值
+// 由 TcpServer/TcpClient 在 listen、accept、connect 时应用
+struct SocketProfile {
+    int deferAccept = 0;            // TCP_DEFER_ACCEPT，单位秒，数据到达后才唤醒 accept
+    int fastOpenQueue = 0;          // TCP_FASTOPEN，服务端 fast open 队列长度
+    bool fastOpenConnect = false;   // TCP_FASTOPEN_CONNECT，客户端第一次写随 SYN 发出
+    bool quickAck = false;          // TCP_QUICKACK，内核可能在之后的收包中重新进入延迟确认
+    int busyPoll = 0;               // SO_BUSY_POLL，单位微秒
+    int sendBuf = 0;                // SO_SNDBUF
+    int recvBuf = 0;                // SO_RCVBUF
+    int notSentLowat = 0;           // TCP_NOTSENT_LOWAT
+    int incomingCpu = -1;           // SO_INCOMING_CPU，-1 表示不设置
+
+    std::string toString() const;
+};
+
 class Socket : public NoCopyable,
                public std::enable_shared_from_this<Socket> {
 public:
@@ -21,17 +38,26 @@ public:
         CLOSE
     };
 
+    // 应用 SocketProfile 的时机，不同阶段只设置该阶段有意义的选项
+    enum ProfileStage {
+        LISTEN_STAGE,   // newSock 之后、bind 之前
+        ACCEPT_STAGE,   // accept 返回之后
+        CONNECT_STAGE   // newSock 之后、connect 之前
+    };
+
     typedef std::shared_ptr<Socket> SPtr;
-    Socket(int type, int family, int protocol = 0);
+    Socket(int family, int type, int protocol = 0);
     ~Socket();
 
     int getType() const { return type_; }
     int getFamily() const { return family_; }
     int getProtocol() const { return protocol_; }
     int getSockfd() const { return sockfd_; }
-    IPv4Address::SPtr getLocalAddr();
-    IPv4Address::SPtr getPeerAddr();
+    Address::SPtr getLocalAddr();
+    Address::SPtr getPeerAddr();
     bool isConnected() const { return state_ == State::CONNECTED; }
+    // connect 成功的时间（毫秒），没有通过 connect 建立连接时为 0
+    int64_t getConnectTime() const { return connectTime_; }
     bool isValid() const { return sockfd_ != -1; }
     std::string toString() const;
     int64_t getRecvTimeout() const;
@@ -56,31 +82,50 @@ public:
     bool init(int sockfd);
     void setReuseAddr();
     void setNoDelay();
+    void setReusePort();
+    // 设置失败的选项只记录日志，实际生效的值用 getAppliedProfile 读回
+    void applyProfile(const SocketProfile& profile, ProfileStage stage);
+    SocketProfile getAppliedProfile();
     void newSock();
-    bool bind(const IPv4Address& addr);
+    bool bind(const Address& addr);
     bool listen(int backlog = SOMAXCONN);
     Socket::SPtr accept();
     bool close();
-    bool connect(const IPv4Address& addr, int64_t timeout = -1);
+    bool connect(const Address& addr, int64_t timeout = -1);
     int send(const void* buf, size_t len, int flags = 0);
-    int sendTo(const void* buf, size_t len, const IPv4Address& to, int flags = 0);
+    int sendv(const iovec* iov, int iovcnt);
+    int sendTo(const void* buf, size_t len, const Address& to, int flags = 0);
     int recv(void* buf, size_t len, int flags = 0);
-    int recvFrom(void* buf, size_t len, const IPv4Address& from, int flags = 0);
+    int recvFrom(void* buf, size_t len, Address& from, int flags = 0);
+    // 批量收发数据报，返回处理的消息个数
+    int sendMsgs(mmsghdr* msgs, unsigned int vlen, int flags = 0);
+    int recvMsgs(mmsghdr* msgs, unsigned int vlen, int flags = 0);
 
     bool cancelRead();
     bool cancelWrite();
     bool cancelAll();
 
     static Socket::SPtr CreateTcp();
+    static Socket::SPtr CreateUdp();
+    static Socket::SPtr CreateUnixStream();
+    static Socket::SPtr CreateUnixDgram();
+    // 按地址的协议族创建流式 socket（AF_INET 为 tcp，AF_UNIX 为 unix stream）
+    static Socket::SPtr CreateStream(const Address& addr);
 
 private:
+    bool isTcp() const {
+        return (family_ == AF_INET || family_ == AF_INET6) &&
+               type_ == SOCK_STREAM;
+    }
+
     int type_ = 0;
     int family_ = 0;
     int protocol_ = 0;
     int sockfd_ = -1;
     State state_ = State::INIT;
-    IPv4Address::SPtr local_;
-    IPv4Address::SPtr peer_;
+    int64_t connectTime_ = 0;
+    Address::SPtr local_;
+    Address::SPtr peer_;
 };
 
 } // namespace reyao
\ No newline at end of file
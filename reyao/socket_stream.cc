@@ -1,8 +1,14 @@
 #include "reyao/socket_stream.h"
 
 #include <assert.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
 
 #include <vector>
+#include <algorithm>
 
 namespace reyao {
 
@@ -16,13 +22,19 @@ SocketStream::~SocketStream() {
     if (owner_) {
         close();
     }
+    closePipe();
 }
 
 int SocketStream::read(void* buf, size_t size) {
     if (!sock_->isConnected()) {
         return -1;
     }
-    return sock_->recv(buf, size);
+    int rt = sock_->recv(buf, size);
+    ++stats_.readCalls;
+    if (rt > 0) {
+        stats_.bytesRead += rt;
+    }
+    return rt;
 }
 
 int SocketStream::read(ByteArray* ba, size_t size) {
@@ -32,7 +44,9 @@ int SocketStream::read(ByteArray* ba, size_t size) {
     const char* buf = ba->getWriteArea(size);
     assert(buf);
     int rt = sock_->recv((void*)buf, size);
+    ++stats_.readCalls;
     if (rt > 0) {
+        stats_.bytesRead += rt;
         ba->setWritePos(ba->getWritePos() + rt);
     }
     return rt;
@@ -42,7 +56,20 @@ int SocketStream::write(const void* buf, size_t size) {
     if (!sock_->isConnected()) {
         return -1;
     }
-    return sock_->send(buf, size);
+    if (cork_ || !pieces_.empty()) {
+        // 已有排队数据时也必须排队，保证字节序
+        append(buf, size);
+        if (cork_) {
+            return size;
+        }
+        return flush() < 0 ? -1 : size;
+    }
+    int rt = sock_->send(buf, size);
+    ++stats_.writeCalls;
+    if (rt > 0) {
+        stats_.bytesWritten += rt;
+    }
+    return rt;
 }
 
 int SocketStream::write(ByteArray* ba, size_t size) {
@@ -51,7 +78,7 @@ int SocketStream::write(ByteArray* ba, size_t size) {
     }
     const char* buf = ba->getReadArea(&size);
     assert(buf);
-    int rt = sock_->send(buf, size);
+    int rt = write(buf, size);
     if (rt > 0) {
         ba->setReadPos(ba->getReadPos() + rt);
     }
@@ -72,4 +99,179 @@ bool SocketStream::isConnected() const {
     return sock_ && sock_->isConnected();
 }
 
-} // namespace reyao
\ No newline at end of file
+void SocketStream::append(const void* buf, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    memcpy(prepareAppend(size), buf, size);
+    commitAppend(size);
+}
+
+char* SocketStream::prepareAppend(size_t size) {
+    prepared_ = wbuf_.size();
+    wbuf_.resize(prepared_ + size);
+    return &wbuf_[prepared_];
+}
+
+void SocketStream::commitAppend(size_t len) {
+    wbuf_.resize(prepared_ + len);
+    if (len == 0) {
+        return;
+    }
+    // 与上一段拷贝数据相邻时直接合并成一段
+    if (!pieces_.empty() && !pieces_.back().ref &&
+        pieces_.back().offset + pieces_.back().len == prepared_) {
+        pieces_.back().len += len;
+    } else {
+        pieces_.push_back(Piece{nullptr, prepared_, len});
+    }
+    pendingSize_ += len;
+    if (wbuf_.size() >= kMaxPendingCopy) {
+        // 拷贝的数据过多时提前发送，限制每条连接的内存占用
+        flush();
+    }
+}
+
+void SocketStream::appendRef(const void* buf, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    pieces_.push_back(Piece{static_cast<const char*>(buf), 0, size});
+    pendingSize_ += size;
+    if (pieces_.size() >= IOV_MAX) {
+        flush();
+    }
+}
+
+int64_t SocketStream::flush() {
+    if (pieces_.empty()) {
+        return 0;
+    }
+    if (!sock_->isConnected()) {
+        return -1;
+    }
+    // iovs_ 跨 flush 复用，避免每次发送都分配
+    std::vector<iovec>& iovs = iovs_;
+    iovs.resize(pieces_.size());
+    for (size_t i = 0; i < pieces_.size(); i++) {
+        const Piece& p = pieces_[i];
+        iovs[i].iov_base = (void*)(p.ref ? p.ref : &wbuf_[p.offset]);
+        iovs[i].iov_len = p.len;
+    }
+
+    size_t total = 0;
+    size_t idx = 0;
+    int rt = 0;
+    while (idx < iovs.size()) {
+        int cnt = std::min(iovs.size() - idx, (size_t)IOV_MAX);
+        int n = sock_->sendv(&iovs[idx], cnt);
+        ++stats_.writeCalls;
+        if (n <= 0) {
+            rt = -1;
+            break;
+        }
+        stats_.bytesWritten += n;
+        total += n;
+        // 处理部分写：跳过已发完的 iovec，并调整发了一半的那一段
+        size_t left = n;
+        while (left > 0 && left >= iovs[idx].iov_len) {
+            left -= iovs[idx].iov_len;
+            ++idx;
+        }
+        if (left > 0) {
+            iovs[idx].iov_base = (char*)iovs[idx].iov_base + left;
+            iovs[idx].iov_len -= left;
+        }
+    }
+
+    pieces_.clear();
+    wbuf_.clear();
+    pendingSize_ = 0;
+    return rt == -1 ? -1 : (int64_t)total;
+}
+
+int64_t SocketStream::sendFile(int fd, off_t offset, size_t len) {
+    if (!isConnected()) {
+        return -1;
+    }
+    // 响应头等排队数据必须先于文件内容发出
+    if (flush() < 0) {
+        return -1;
+    }
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = ::sendfile(sock_->getSockfd(), fd, &offset, len - total);
+        ++stats_.writeCalls;
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            // 文件比预期的短
+            break;
+        }
+        total += n;
+        stats_.bytesWritten += n;
+    }
+    return total;
+}
+
+int64_t SocketStream::spliceTo(SocketStream* out, size_t len) {
+    if (!isConnected() || !out->isConnected()) {
+        return -1;
+    }
+    if (out->flush() < 0) {
+        return -1;
+    }
+    if (pipe_[0] == -1 && pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) == -1) {
+        return -1;
+    }
+    int in = sock_->getSockfd();
+    int outfd = out->getSock()->getSockfd();
+    size_t total = 0;
+    while (total < len) {
+        size_t chunk = std::min(len - total, kMaxSpliceChunk);
+        ssize_t n = ::splice(in, nullptr, pipe_[1], nullptr, chunk,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        ++stats_.readCalls;
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        stats_.bytesRead += n;
+        // 每轮都把管道排空，保证下一轮读 socket 时管道不会因为满而返回 EAGAIN
+        ssize_t left = n;
+        while (left > 0) {
+            ssize_t m = ::splice(pipe_[0], nullptr, outfd, nullptr, left,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            ++out->stats_.writeCalls;
+            if (m <= 0) {
+                // 管道里残留的数据已无法发出，丢弃管道
+                closePipe();
+                return -1;
+            }
+            out->stats_.bytesWritten += m;
+            left -= m;
+        }
+        total += n;
+    }
+    return total;
+}
+
+void SocketStream::closePipe() {
+    if (pipe_[0] != -1) {
+        ::close(pipe_[0]);
+        ::close(pipe_[1]);
+        pipe_[0] = pipe_[1] = -1;
+    }
+}
+
+void SocketStream::setCork(bool on) {
+    cork_ = on;
+    if (!cork_) {
+        flush();
+    }
+}
+
+} // namespace reyao
@@ -3,7 +3,13 @@
 #include "reyao/socket.h"
 #include "reyao/bytearray.h"
 
+#include <sys/uio.h>
+
+#include <stdint.h>
+
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace reyao {
 
@@ -11,21 +17,81 @@ namespace reyao {
 class SocketStream {
 public:
     typedef std::shared_ptr<SocketStream> SPtr;
+
+    // 每条连接的读写统计
+    struct Stats {
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t readCalls = 0;
+        uint64_t writeCalls = 0;
+    };
+
     SocketStream(Socket::SPtr sock, bool owner = false);
+    // 析构时不会 flush：发送队列中还没发出的数据（包括 cork 模式下排队的）直接丢弃，
+    // 因为 appendRef 引用的数据此时可能已经失效。需要发出的数据要在析构前显式 flush
     ~SocketStream();
 
     int read(void* buf, size_t size);
     int read(ByteArray* ba, size_t size);
+    // cork 模式下 write 只把数据拷贝进发送队列，返回入队的字节数
     int write(const void* buf, size_t size);
     int write(ByteArray* ba, size_t size);
     int write(ByteArray* ba);
     void close(); 
 
+    // 缓冲写：append 拷贝数据，appendRef 只记录指针和长度，
+    // appendRef 的数据必须在 flush 返回前保持有效
+    void append(const void* buf, size_t size);
+    void append(const std::string& str) { append(str.data(), str.size()); }
+    void appendRef(const void* buf, size_t size);
+    // 在发送队列的拷贝缓冲区中预留 size 字节供调用方直接编码，
+    // 写完后用 commitAppend 提交实际长度，省去临时缓冲区和一次拷贝；
+    // 两次调用之间不能有其他写操作
+    char* prepareAppend(size_t size);
+    void commitAppend(size_t len);
+    // 用 writev 把发送队列里的所有数据合并发出，返回发出的字节数，出错返回 -1
+    int64_t flush();
+    size_t getPendingSize() const { return pendingSize_; }
+
+    // 开启 cork 后所有写操作都先排队，直到 flush 或关闭 cork 才真正发送
+    void setCork(bool on);
+    bool isCork() const { return cork_; }
+
+    // 先 flush 发送队列，再用 sendfile 把文件 [offset, offset + len) 直接从内核发出，
+    // 返回发送的字节数，出错返回 -1
+    int64_t sendFile(int fd, off_t offset, size_t len);
+    // 经由内核管道把本连接最多 len 字节转发到 out，数据不进入用户态，用于 socket 间代理；
+    // 遇到对端关闭时提前返回，返回转发的字节数，出错返回 -1
+    int64_t spliceTo(SocketStream* out, size_t len = SIZE_MAX);
+
+    const Stats& getStats() const { return stats_; }
     Socket::SPtr getSock() const { return sock_; }
     bool isConnected() const;
+
 private:
+    // 发送队列中的一段数据，ref 为空时表示 wbuf_ 中 [offset, offset + len)
+    struct Piece {
+        const char* ref;
+        size_t offset;
+        size_t len;
+    };
+
+    static const size_t kMaxPendingCopy = 64 * 1024;
+    static const size_t kMaxSpliceChunk = 64 * 1024;
+
+    void closePipe();
+
     Socket::SPtr sock_;
     bool owner_;
+    bool cork_ = false;
+    std::string wbuf_;
+    std::vector<Piece> pieces_;
+    std::vector<iovec> iovs_;
+    size_t prepared_ = 0;
+    size_t pendingSize_ = 0;
+    Stats stats_;
+    // splice 用的管道，第一次 spliceTo 时创建
+    int pipe_[2] = {-1, -1};
 };
 
-} // namespace reyao
\ No newline at end of file
+} // namespace reyao
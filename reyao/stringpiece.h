@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+#include <iostream>
+
+namespace reyao {
+
+// 只保存指针和长度的字符串视图，不拥有内存
+// 视图的有效期由底层内存决定，调用方需要保证底层内存在使用期间不被修改或释放
+class StringPiece {
+public:
+    StringPiece()
+        : ptr_(nullptr), len_(0) {}
+    StringPiece(const char* str)
+        : ptr_(str), len_(str ? strlen(str) : 0) {}
+    StringPiece(const char* ptr, size_t len)
+        : ptr_(ptr), len_(len) {}
+    StringPiece(const std::string& str)
+        : ptr_(str.data()), len_(str.size()) {}
+
+    const char* data() const { return ptr_; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    const char* begin() const { return ptr_; }
+    const char* end() const { return ptr_ + len_; }
+
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    void clear() { ptr_ = nullptr; len_ = 0; }
+    void set(const char* ptr, size_t len) { ptr_ = ptr; len_ = len; }
+    void removePrefix(size_t n) { ptr_ += n; len_ -= n; }
+    void removeSuffix(size_t n) { len_ -= n; }
+
+    bool operator==(const StringPiece& rhs) const {
+        return len_ == rhs.len_ &&
+               (len_ == 0 || memcmp(ptr_, rhs.ptr_, len_) == 0);
+    }
+    bool operator!=(const StringPiece& rhs) const {
+        return !(*this == rhs);
+    }
+
+    // 忽略大小写比较，用于 http header 等场景
+    bool caseEqual(const StringPiece& rhs) const {
+        return len_ == rhs.len_ &&
+               (len_ == 0 || strncasecmp(ptr_, rhs.ptr_, len_) == 0);
+    }
+
+    bool startsWith(const StringPiece& x) const {
+        return len_ >= x.len_ && memcmp(ptr_, x.ptr_, x.len_) == 0;
+    }
+
+    int compare(const StringPiece& rhs) const {
+        int r = memcmp(ptr_, rhs.ptr_, len_ < rhs.len_ ? len_ : rhs.len_);
+        if (r == 0) {
+            if (len_ < rhs.len_) r = -1;
+            else if (len_ > rhs.len_) r = +1;
+        }
+        return r;
+    }
+
+    std::string toString() const { return std::string(ptr_, len_); }
+    void copyTo(std::string* target) const { target->assign(ptr_, len_); }
+
+private:
+    const char* ptr_;
+    size_t len_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StringPiece& piece) {
+    return os.write(piece.data(), piece.size());
+}
+
+} // namespace reyao
@@ -4,7 +4,7 @@ namespace reyao {
 
 static const int s_ConnectMaxTimeOut = 10 * 1000;
 
-TcpClient::TcpClient(Scheduler* sche, IPv4Address::SPtr addr)
+TcpClient::TcpClient(Scheduler* sche, Address::SPtr addr)
     : sche_(sche),
       addr_(addr) {
 
@@ -12,7 +12,9 @@ TcpClient::TcpClient(Scheduler* sche, IPv4Address::SPtr addr)
 
 void TcpClient::start() {
     sche_->getMainWorker()->addTask([this]() {
-       conn_ = Socket::CreateTcp();
+       conn_ = Socket::CreateStream(*addr_);
+       conn_->newSock();
+       conn_->applyProfile(profile_, Socket::CONNECT_STAGE);
        if (conn_->connect(*addr_, s_ConnectMaxTimeOut)) {
            handleConnect(conn_);
        } else {
@@ -11,7 +11,7 @@ class TcpClient : public NoCopyable {
 public:
     typedef std::function<void(Socket::SPtr)> ConnectCallBack;
 
-    TcpClient(Scheduler* sche, IPv4Address::SPtr addr);
+    TcpClient(Scheduler* sche, Address::SPtr addr);
     ~TcpClient() { LOG_DEBUG << "~TcpCLient"; }
 
     void start();
@@ -19,6 +19,8 @@ public:
     Socket::SPtr getConn() { return conn_; }
 
     void setConnectCallBack(ConnectCallBack cb) { cb_ = cb; }
+    void setProfile(const SocketProfile& profile) { profile_ = profile; }
+    const SocketProfile& getProfile() const { return profile_; }
 
 private:
     void handleConnect(Socket::SPtr conn);
@@ -27,9 +29,10 @@ private:
     //TODO: retry & reconnect
 
     Scheduler* sche_;
-    IPv4Address::SPtr addr_;
+    Address::SPtr addr_;
     Socket::SPtr conn_;
     ConnectCallBack cb_;
+    SocketProfile profile_;
 
 };
 
@@ -2,13 +2,21 @@
 #include "reyao/hook.h"
 
 #include <assert.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+
+#include <algorithm>
 
 namespace reyao {
 
 static uint64_t s_maxRecvTimeout = 30 * 1000;
 
+// handleClient 在返回前调用了 park，连接由 epoller 接管，不能释放连接计数
+// park 之后到 handleClient 返回之间不会切换协程，所以用线程局部变量传递即可
+static thread_local bool t_parked = false;
+
 TcpServer::TcpServer(Scheduler* sche, 
-                     IPv4Address::SPtr addr,
+                     Address::SPtr addr,
                      const std::string& name)
     : sche_(sche),
       addr_(addr),
@@ -19,25 +27,55 @@ TcpServer::TcpServer(Scheduler* sche,
 
 TcpServer::~TcpServer() {
     running_ = false;
-    listenSock_->close();
+    if (listenSock_) {
+        listenSock_->close();
+    }
+    // 只删除自己 bind 出来的 socket 文件：bind 失败时路径属于别的进程，
+    // 文件被替换成了别的 inode 时也不删
+    if (!boundPath_.empty()) {
+        struct stat st;
+        if (::stat(boundPath_.c_str(), &st) == 0 &&
+            st.st_dev == boundDev_ && st.st_ino == boundIno_) {
+            ::unlink(boundPath_.c_str());
+        }
+    }
 }
 
 void TcpServer::listenAndAccpet() {
-    listenSock_ = Socket::CreateTcp();
+    listenSock_ = Socket::CreateStream(*addr_);
+    listenSock_->newSock();
+    listenSock_->applyProfile(profile_, Socket::LISTEN_STAGE);
     int rt = listenSock_->bind(*addr_);
     LOG_DEBUG << addr_->toString();
     if (!rt) {
         LOG_ERROR << "bind error addr=" << addr_->toString()
                   << " error=" << strerror(errno);
+    } else if (addr_->getFamily() == AF_UNIX) {
+        auto uaddr = std::static_pointer_cast<UnixAddress>(addr_);
+        struct stat st;
+        if (!uaddr->isAbstract() && ::stat(uaddr->getPath().c_str(), &st) == 0) {
+            boundPath_ = uaddr->getPath();
+            boundDev_ = st.st_dev;
+            boundIno_ = st.st_ino;
+        }
     }
     rt = listenSock_->listen();
     if (!rt) {
         LOG_ERROR << "listen error addr=" << addr_->toString()
                   << " error=" << strerror(errno);       
     }
+    LOG_INFO << name_ << " listen on " << addr_->toString()
+             << " applied profile: " << getAppliedProfile().toString();
     accept();
 }
 
+SocketProfile TcpServer::getAppliedProfile() const {
+    if (!listenSock_) {
+        return SocketProfile();
+    }
+    return listenSock_->getAppliedProfile();
+}
+
 // TODO: combine TcpServer::listen to start
 void TcpServer::start() {
     if (running_) {
@@ -53,12 +91,30 @@ void TcpServer::handleClient(Socket::SPtr client) {
 }
 
 void TcpServer::accept() {
+    auto& workers = sche_->getWorkers();
+    workerConns_.reset(new std::atomic<int64_t>[workers.size()]());
     while (running_) {
+        if (maxConns_ && conns_ >= (int64_t)maxConns_) {
+            pauseAccept();
+            continue;
+        }
         Socket::SPtr client = listenSock_->accept();
         if (client) {
+            int index = pickWorker();
+            if (index < 0) {
+                reject(client);
+                continue;
+            }
+            workerConns_[index]++;
+            int64_t conns = ++conns_;
+            int64_t peak = peakConns_;
+            while (conns > peak && 
+                   !peakConns_.compare_exchange_weak(peak, conns)) {
+            }
             client->setRecvTimeout(recvTimeout_);
-            sche_->addTask(std::bind(&TcpServer::handleClient, 
-                                     this, client));
+            client->applyProfile(profile_, Socket::ACCEPT_STAGE);
+            workers[index]->addTask(std::bind(&TcpServer::runClient, 
+                                              this, client, index));
             // LOG_DEBUG << "accept:" << client->toString();
         } else {
             LOG_ERROR << "accept error=" << strerror(errno);
@@ -66,4 +122,145 @@ void TcpServer::accept() {
     }
 }
 
+int TcpServer::pickWorker() {
+    auto& workers = sche_->getWorkers();
+    size_t count = workers.size();
+    for (size_t i = 0; i < count; i++) {
+        size_t index = nextWorker_;
+        nextWorker_ = (nextWorker_ + 1) % count;
+        if (maxConnsPerWorker_ && 
+            workerConns_[index] >= (int64_t)maxConnsPerWorker_) {
+            continue;
+        }
+        if (maxQueueDepth_ && 
+            workers[index]->getTaskCount() >= maxQueueDepth_) {
+            continue;
+        }
+        return index;
+    }
+    return -1;
+}
+
+void TcpServer::runClient(Socket::SPtr client, int index) {
+    t_parked = false;
+    handleClient(client);
+    if (t_parked) {
+        t_parked = false;
+        return;
+    }
+    releaseConnection(index);
+}
+
+int TcpServer::getWorkerIndex() const {
+    auto& workers = sche_->getWorkers();
+    auto it = std::find(workers.begin(), workers.end(), Worker::GetWorker());
+    return it == workers.end() ? -1 : it - workers.begin();
+}
+
+bool TcpServer::park(Socket::SPtr client) {
+    int index = getWorkerIndex();
+    if (index < 0 || !client->isConnected()) {
+        return false;
+    }
+
+    ParkRecordSPtr record = std::make_shared<ParkRecord>();
+    record->client = client;
+    record->worker = Worker::GetWorker();
+    record->index = index;
+    if (!Worker::AddEvent(client->getSockfd(), EPOLLIN,
+                          std::bind(&TcpServer::resumeParked, this, record))) {
+        return false;
+    }
+    if (recvTimeout_ > 0) {
+        std::weak_ptr<ParkRecord> weak(record);
+        // 定时器可能在任意 worker 上触发，超时处理需要回到挂起连接的 worker 上执行
+        record->timer = sche_->addConditonTimer(recvTimeout_, [this, weak]() {
+            auto record = weak.lock();
+            if (record) {
+                record->worker->addTask(std::bind(&TcpServer::expireParked,
+                                                  this, record));
+            }
+        }, weak);
+    }
+    ++parked_;
+    t_parked = true;
+    return true;
+}
+
+void TcpServer::resumeParked(ParkRecordSPtr record) {
+    if (record->done) {
+        return;
+    }
+    record->done = true;
+    --parked_;
+    if (record->timer) {
+        record->timer->cancel();
+    }
+    runClient(record->client, record->index);
+}
+
+void TcpServer::expireParked(ParkRecordSPtr record) {
+    if (record->done) {
+        return;
+    }
+    record->done = true;
+    --parked_;
+    Worker::DelEvent(record->client->getSockfd(), EPOLLIN);
+    record->client->close();
+    releaseConnection(record->index);
+}
+
+void TcpServer::detach() {
+    ++detached_;
+    t_parked = true;
+}
+
+void TcpServer::resumeDetached(Socket::SPtr client, int index, bool idle) {
+    --detached_;
+    if (idle && park(client)) {
+        t_parked = false;
+        return;
+    }
+    runClient(client, index);
+}
+
+void TcpServer::closeDetached(Socket::SPtr client, int index) {
+    --detached_;
+    client->close();
+    releaseConnection(index);
+}
+
+void TcpServer::releaseConnection(int index) {
+    workerConns_[index]--;
+    int64_t conns = --conns_;
+    if (maxConns_ && conns < (int64_t)maxConns_ && paused_.exchange(false)) {
+        Coroutine::SPtr co;
+        co.swap(pausedCo_);
+        // accept 协程在 main worker 上，被 yield 之前不会被 main worker 重新调度
+        sche_->getMainWorker()->addTask(co);
+    }
+}
+
+void TcpServer::reject(Socket::SPtr client) {
+    ++rejected_;
+    // SO_LINGER 为 0 时 close 直接发送 RST，不保留 TIME_WAIT 状态
+    linger lg;
+    lg.l_onoff = 1;
+    lg.l_linger = 0;
+    client->setOption(SOL_SOCKET, SO_LINGER, lg);
+    client->close();
+}
+
+void TcpServer::pauseAccept() {
+    pausedCo_ = Coroutine::GetCurCoroutine();
+    paused_ = true;
+    // 设置标志之后再检查一次，避免连接在此之前全部结束导致无人唤醒
+    if (conns_ < (int64_t)maxConns_ && paused_.exchange(false)) {
+        pausedCo_.reset();
+        return;
+    }
+    ++pauses_;
+    Coroutine::YieldToSuspend();
+}
+
 } // namespace reyao
@@ -4,15 +4,18 @@
 #include "reyao/address.h"
 #include "reyao/scheduler.h"
 
+#include <sys/types.h>
+
 #include <memory>
 #include <functional>
+#include <atomic>
 
 namespace reyao {
 
 class TcpServer : public NoCopyable {
 public:
     TcpServer(Scheduler* sche, 
-              IPv4Address::SPtr addr,
+              Address::SPtr addr,
               const std::string& name = "TcpServer");
     virtual ~TcpServer();
 
@@ -25,18 +28,94 @@ public:
     bool isStop() const { return !running_; }
     uint64_t getRecvTimeout() const { return recvTimeout_; }
     void setRecvTimeout(uint64_t timeout) { recvTimeout_ = timeout; }
+    // 需要在 start 之前设置
+    void setProfile(const SocketProfile& profile) { profile_ = profile; }
+    const SocketProfile& getProfile() const { return profile_; }
+    // listen socket 上实际生效的参数
+    SocketProfile getAppliedProfile() const;
+
+    // 准入控制，0 表示不限制，需要在 start 之前设置
+    // 连接总数达到上限时暂停 accept，新连接留在内核的 backlog 中
+    void setMaxConnections(size_t max) { maxConns_ = max; }
+    // 单个 worker 上的连接数或任务队列长度达到上限时换下一个 worker，
+    // 所有 worker 都满时直接关闭新连接，不创建协程
+    void setMaxConnectionsPerWorker(size_t max) { maxConnsPerWorker_ = max; }
+    void setMaxQueueDepth(size_t depth) { maxQueueDepth_ = depth; }
+
+    int64_t getConnectionCount() const { return conns_; }
+    int64_t getParkedCount() const { return parked_; }
+    int64_t getDetachedCount() const { return detached_; }
+    int64_t getPeakConnectionCount() const { return peakConns_; }
+    uint64_t getRejectedCount() const { return rejected_; }
+    uint64_t getPauseCount() const { return pauses_; }
 
 protected:
     virtual void handleClient(Socket::SPtr client);
     virtual void accept();
 
+    // 把没有待处理输入的空闲连接挂到当前 worker 的 epoller 上，调用后 handleClient
+    // 应立即返回，协程随之结束；连接可读时在同一个 worker 上新建协程再次调用
+    // handleClient，超过 recvTimeout 仍不可读则关闭连接。失败时返回 false，
+    // 调用方继续在当前协程中处理连接
+    bool park(Socket::SPtr client);
+
+    // 连接交给其他对象持有（如等待完成的异步响应），调用后 handleClient 应立即返回，
+    // 连接计数保留。之后持有者在 getWorkerIndex() 对应的 worker 上调用
+    // resumeDetached 继续处理连接（idle 为 true 时先 park 等待可读），或 closeDetached 关闭
+    void detach();
+    void resumeDetached(Socket::SPtr client, int index, bool idle);
+    void closeDetached(Socket::SPtr client, int index);
+    // 当前 worker 的下标，不是本 server 的 worker 时返回 -1
+    int getWorkerIndex() const;
+
+private:
+    // 挂起期间只保留这个小记录，不占用协程栈
+    struct ParkRecord {
+        Socket::SPtr client;
+        Worker* worker;
+        int index;
+        bool done = false;
+        Timer::SPtr timer;
+    };
+    typedef std::shared_ptr<ParkRecord> ParkRecordSPtr;
+
+    void resumeParked(ParkRecordSPtr record);
+    void expireParked(ParkRecordSPtr record);
+    void releaseConnection(int index);
+
+    // 选出一个未超过限制的 worker，返回下标，都满时返回 -1
+    int pickWorker();
+    void runClient(Socket::SPtr client, int index);
+    void reject(Socket::SPtr client);
+    void pauseAccept();
+
 private:
     Scheduler* sche_;
-    IPv4Address::SPtr addr_;
+    Address::SPtr addr_;
     std::string name_;
     bool running_;
     Socket::SPtr listenSock_;
+    // bind 成功的 unix socket 文件，析构时删除
+    std::string boundPath_;
+    dev_t boundDev_ = 0;
+    ino_t boundIno_ = 0;
     uint64_t recvTimeout_;
+    SocketProfile profile_;
+
+    size_t maxConns_ = 0;
+    size_t maxConnsPerWorker_ = 0;
+    size_t maxQueueDepth_ = 0;
+    size_t nextWorker_ = 0;
+    std::atomic<int64_t> conns_{0};
+    std::atomic<int64_t> peakConns_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> pauses_{0};
+    std::atomic<int64_t> parked_{0};
+    std::atomic<int64_t> detached_{0};
+    std::unique_ptr<std::atomic<int64_t>[]> workerConns_;
+    // accept 暂停时挂起的协程，由连接结束的线程唤醒
+    std::atomic<bool> paused_{false};
+    Coroutine::SPtr pausedCo_;
 };
 
 
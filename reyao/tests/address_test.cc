@@ -2,6 +2,11 @@
 #include "reyao/log.h"
 #include "reyao/scheduler.h"
 
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
 #include <iostream>
 
 using namespace reyao;
@@ -11,6 +16,62 @@ void ipv4_test() {
     LOG_INFO << addr.toString();
 }
 
+void unix_test() {
+    const socklen_t offset = offsetof(sockaddr_un, sun_path);
+    UnixAddress path("/tmp/reyao.sock");
+    assert(path.getFamily() == AF_UNIX);
+    assert(!path.isAbstract());
+    assert(path.getPath() == "/tmp/reyao.sock");
+    assert(path.getAddrLen() == offset + strlen("/tmp/reyao.sock") + 1);
+    assert(path.toString() == "unix:/tmp/reyao.sock");
+
+    // 抽象地址 sun_path[0] 为 '\0'，长度包含开头的 '\0'，不含结尾的 '\0'
+    UnixAddress abstract("@reyao");
+    assert(abstract.isAbstract());
+    assert(abstract.getPath() == "@reyao");
+    assert(abstract.getAddrLen() == offset + 1 + strlen("reyao"));
+    assert(abstract.getAddr()->sa_family == AF_UNIX);
+    assert(((const sockaddr_un*)abstract.getAddr())->sun_path[0] == '\0');
+
+    // 未绑定的 socket，getsockname 只回写 sun_family
+    UnixAddress unnamed;
+    unnamed.setAddrLen(offset);
+    assert(!unnamed.isAbstract());
+    assert(unnamed.toString() == "unix:(unnamed)");
+
+    // bind 抽象地址后 getsockname 回写的长度能还原出同一个名字
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int rt = bind(fd, abstract.getAddr(), abstract.getAddrLen());
+    assert(rt == 0);
+    Address::SPtr local = Address::Create(AF_UNIX);
+    socklen_t len = local->getAddrLen();
+    rt = getsockname(fd, local->getAddr(), &len);
+    assert(rt == 0);
+    (void)rt;
+    local->setAddrLen(len);
+    assert(local->toString() == abstract.toString());
+    close(fd);
+
+    // 超过 sun_path 的路径不截断，得到无效地址，CreateAddress 返回 nullptr
+    const size_t maxPath = sizeof(sockaddr_un::sun_path) - 1;
+    std::string longest = "/" + std::string(maxPath - 1, 'a');
+    UnixAddress fits(longest);
+    assert(fits.isValid() && fits.getPath() == longest);
+    UnixAddress tooLong(longest + "a");
+    assert(!tooLong.isValid());
+    assert(tooLong.getAddrLen() == 0);
+    assert(!UnixAddress::CreateAddress(longest + "a"));
+    assert(UnixAddress::CreateAddress("@" + std::string(maxPath, 'b')));
+    assert(!UnixAddress::CreateAddress("@" + std::string(maxPath + 1, 'b')));
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    rt = bind(fd, tooLong.getAddr(), tooLong.getAddrLen());
+    assert(rt == -1 && errno == EINVAL);
+    close(fd);
+    LOG_INFO << path.toString() << " " << abstract.toString() << " ok";
+}
+
 void getHostName(const char* addr) {
 
     auto ipaddr = IPv4Address::CreateByName(addr, 80);
@@ -24,6 +85,8 @@ int main(int argc, char** argv) {
         printf("usage: ./address_test addr");
     }
 
+    unix_test();
+
     Scheduler sh;
     sh.addTask(std::bind(getHostName, argv[1]));
     sh.startAsync();
@@ -1,8 +1,13 @@
 #include "reyao/asynclog.h"
 
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <dirent.h>
+#include <assert.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <vector>
 #include <iostream>
 
@@ -10,9 +15,31 @@ using namespace reyao;
 
 AsyncLog logger;
 
-static int total = 0;
+// 多个线程同时累加
+static std::atomic<int> total(0);
+
+// 目录下所有日志文件的总大小，读完后删除
+static size_t consumeLogs(const std::string& dir) {
+    size_t size = 0;
+    DIR* d = opendir(dir.c_str());
+    assert(d);
+    while (struct dirent* ent = readdir(d)) {
+        std::string path = dir + "/" + ent->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            size += st.st_size;
+            unlink(path.c_str());
+        }
+    }
+    closedir(d);
+    return size;
+}
 
 void asynclog_test() {
+    // 日志文件写在当前目录，换到一个空目录里统计写入的字节数
+    char dir[] = "/tmp/reyao_asynclog_XXXXXX";
+    bool ok = mkdtemp(dir) && chdir(dir) == 0;
+    assert(ok);
     logger.start();
 
     std::vector<Thread::SPtr> threads;
@@ -39,7 +66,14 @@ void asynclog_test() {
 	double sec = (e.tv_sec - s.tv_sec) + (e.tv_usec - s.tv_usec) / 1000000.0;
 	double speed = total / sec / 1024 / 1024;
 	std::cout << "time=" << sec << "s " << "total=" << (total / 1024 / 1024) << "mb " << "speed=" << speed << "mb/s" << "\n";
+    // stop 返回时后台线程已经退出，最后一批日志也已写入文件
     logger.stop();
+    size_t written = consumeLogs(dir);
+    std::cout << "written=" << written << "\n";
+    assert(written == (size_t)total);
+    rmdir(dir);
+    (void)ok;
+    (void)written;
 }
 
 int main(int argc, char** argv) {   
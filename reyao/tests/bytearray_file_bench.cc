@@ -0,0 +1,99 @@
+#include "reyao/bytearray.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include <fstream>
+#include <iostream>
+
+using namespace reyao;
+
+// 模拟启动时加载快照文件：读文件 + 顺序解析所有 uint64
+// ./bytearray_file_bench [size_mb] [path]
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static uint64_t parse(ByteArray& ba) {
+    uint64_t sum = 0;
+    while (ba.getReadSize() >= sizeof(uint64_t)) {
+        sum += ba.readUint64();
+    }
+    return sum;
+}
+
+// 旧实现：ifstream 每次读 1KB 再写入 ByteArray
+static bool legacyRead(ByteArray& ba, const std::string& name) {
+    std::ifstream ifs(name, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    char buf[ByteArray::kInitSize];
+    while (!ifs.eof()) {
+        ifs.read(buf, sizeof(buf));
+        ba.write(buf, ifs.gcount());
+    }
+    return true;
+}
+
+static void legacyWrite(ByteArray& ba, const std::string& name) {
+    std::ofstream ofs(name, std::ios::binary | std::ios::trunc);
+    ofs.write(ba.peek(), ba.getReadSize());
+}
+
+int main(int argc, char** argv) {
+    size_t mb = argc > 1 ? atoi(argv[1]) : 256;
+    std::string path = argc > 2 ? argv[2] : "./bytearray_file_bench.dat";
+
+    ByteArray src;
+    for (size_t i = 0; i < mb * 1024 * 1024 / sizeof(uint64_t); i++) {
+        src.writeUint64(i);
+    }
+
+    double start = now();
+    legacyWrite(src, path);
+    std::cout << "ofstream write:        " << now() - start << "s\n";
+
+    start = now();
+    src.writeToFile(path);
+    std::cout << "writeToFile:           " << now() - start << "s\n";
+
+    start = now();
+    src.writeToFile(path, true);
+    std::cout << "writeToFile(O_DIRECT): " << now() - start << "s\n";
+
+    uint64_t expect = 0;
+    {
+        ByteArray ba;
+        start = now();
+        legacyRead(ba, path);
+        expect = parse(ba);
+        std::cout << "ifstream 1KB load:     " << now() - start << "s\n";
+    }
+    {
+        ByteArray ba;
+        start = now();
+        ba.readFromFile(path);
+        uint64_t sum = parse(ba);
+        assert(sum == expect);
+        std::cout << "readFromFile load:     " << now() - start << "s\n";
+    }
+    {
+        ByteArray ba;
+        start = now();
+        ba.mapFile(path);
+        assert(ba.isMapped());
+        uint64_t sum = parse(ba);
+        assert(sum == expect);
+        std::cout << "mapFile load:          " << now() - start << "s\n";
+    }
+
+    unlink(path.c_str());
+    return 0;
+}
@@ -69,8 +69,30 @@ void test2() {
 #undef XX   
 }
 
+void test_view() {
+    ByteArray b;
+    b.writeString16("hello");
+    b.writeString32("reyao");
+    b.writeString64("world");
+    StringPiece s16 = b.readStringView16();
+    StringPiece s32 = b.readStringView32();
+    StringPiece s64 = b.readStringView64();
+    // 视图在下一次写入前有效
+    assert(s16 == "hello");
+    assert(s32 == "reyao");
+    assert(s64 == "world");
+    assert(b.getReadSize() == 0);
+
+    b.writeString("GET / HTTP/1.1");
+    assert(b.peekView().size() == 14);
+    assert(b.readView(3) == "GET");
+    assert(b.peekView() == " / HTTP/1.1");
+    LOG_INFO << "string view read ok";
+}
+
 int main(int argc, char** argv) {
     test1();
+    test_view();
     // test2();
     return 0;
 }
\ No newline at end of file
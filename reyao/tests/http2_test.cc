@@ -0,0 +1,436 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http2_client.h"
+#include "reyao/http/http2_hpack.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace reyao;
+
+// HTTP/2：HPACK 的 Huffman 码表、RFC 7541 附录 C 的示例、编解码往返和动态表淘汰；
+// h2c 服务端的 prior knowledge 和 Upgrade、多路复用、流控、请求 body、错误前言，
+// 以及同一连接上 HTTP/1.1 keep-alive 与 HTTP/2 多路复用的对比（包括慢后端）
+// ./http2_test [count] [slow_count]
+
+static const int kPort = 8022;
+static const int kSlowMs = 20;
+static std::atomic<bool> s_done(false);
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static std::string fromHex(const char* hex) {
+    std::string out;
+    for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+        out.push_back(strtol(std::string(hex + i, 2).c_str(), nullptr, 16));
+    }
+    return out;
+}
+
+typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+static Fields decode(HpackDecoder* decoder, const std::string& block) {
+    Fields fields;
+    bool ok = decoder->decode(block.data(), block.size(),
+                              [&](const StringPiece& name, const StringPiece& value) {
+        fields.push_back(std::make_pair(name.toString(), value.toString()));
+    });
+    assert(ok);
+    return fields;
+}
+
+static void testHuffmanTable() {
+    // 完全二叉树：所有码长满足 Kraft 等式，按 (码长, 符号) 排序后是规范 Huffman 码
+    std::vector<std::pair<int, int>> order;
+    uint64_t kraft = 0;
+    for (int sym = 0; sym < Hpack::kHuffmanSymbols; sym++) {
+        int len = Hpack::HuffmanLength(sym);
+        assert(len >= 5 && len <= 30);
+        kraft += 1ULL << (30 - len);
+        order.push_back(std::make_pair(len, sym));
+    }
+    assert(kraft == 1ULL << 30);
+    std::sort(order.begin(), order.end());
+    uint32_t code = Hpack::HuffmanCode(order[0].second);
+    assert(code == 0);
+    for (size_t i = 1; i < order.size(); i++) {
+        code = (code + 1) << (order[i].first - order[i - 1].first);
+        assert(Hpack::HuffmanCode(order[i].second) == code);
+    }
+    assert(Hpack::HuffmanCode(256) == 0x3fffffff);
+
+    // RFC 7541 C.4.1
+    std::string out;
+    Hpack::HuffmanEncode("www.example.com", &out);
+    assert(out == fromHex("f1e3c2e5f23a6ba0ab90f4ff"));
+    assert(Hpack::HuffmanSize("www.example.com") == 12);
+    std::string all;
+    for (int i = 0; i < 256; i++) {
+        all.push_back(i);
+    }
+    all += all;
+    out.clear();
+    Hpack::HuffmanEncode(all, &out);
+    std::string back;
+    assert(Hpack::HuffmanDecode((const uint8_t*)out.data(), out.size(), &back) && back == all);
+    // 填充超过 7 位，或填充不全是 1
+    back.clear();
+    assert(!Hpack::HuffmanDecode((const uint8_t*)"\xff\xff", 2, &back));
+    back.clear();
+    out = fromHex("f1e3c2e5f23a6ba0ab90f4fe");
+    assert(!Hpack::HuffmanDecode((const uint8_t*)out.data(), out.size(), &back));
+}
+
+static void testHpack() {
+    // RFC 7541 C.2 的整数表示
+    std::string out;
+    Hpack::EncodeInteger(1337, 5, 0, &out);
+    assert(out == fromHex("1f9a0a"));
+    const uint8_t* p = (const uint8_t*)out.data();
+    uint64_t value = 0;
+    assert(Hpack::DecodeInteger(&p, p + out.size(), 5, &value) && value == 1337);
+    p = (const uint8_t*)out.data();
+    assert(!Hpack::DecodeInteger(&p, p + 2, 5, &value));
+
+    // C.3.1 不用 Huffman，C.4.1~C.4.3 使用 Huffman，同一个解码器连续解码
+    HpackDecoder plain;
+    Fields fields = decode(&plain, fromHex("828684410f7777772e6578616d706c652e636f6d"));
+    assert(fields.size() == 4 && fields[3].first == ":authority" &&
+           fields[3].second == "www.example.com");
+    assert(plain.getTable().getSize() == 57);
+
+    HpackDecoder decoder;
+    fields = decode(&decoder, fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"));
+    assert(fields.size() == 4 && fields[0] == std::make_pair(std::string(":method"),
+                                                             std::string("GET")));
+    assert(decoder.getTable().getSize() == 57);
+    fields = decode(&decoder, fromHex("828684be5886a8eb10649cbf"));
+    assert(fields.size() == 5 && fields[3].second == "www.example.com" &&
+           fields[4].first == "cache-control" && fields[4].second == "no-cache");
+    assert(decoder.getTable().getSize() == 110);
+    fields = decode(&decoder,
+                    fromHex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"));
+    assert(fields.size() == 5 && fields[1].second == "https" &&
+           fields[2].second == "/index.html" && fields[4].first == "custom-key" &&
+           fields[4].second == "custom-value");
+    assert(decoder.getTable().getSize() == 164 && decoder.getTable().getCount() == 3);
+
+    // C.6.1：表大小 256 的响应
+    HpackDecoder small(256);
+    fields = decode(&small, fromHex("488264025885aec3771a4b6196d07abe941054d444a8200595040b81"
+                                    "66e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3"));
+    assert(fields.size() == 4 && fields[0].second == "302" && fields[1].second == "private" &&
+           fields[2].second == "Mon, 21 Oct 2013 20:13:21 GMT" &&
+           fields[3].second == "https://www.example.com");
+    assert(small.getTable().getSize() == 222);
+
+    // 编解码往返：重复的字段第二次只占一个字节，表满后淘汰最旧的条目
+    HpackEncoder encoder(256);
+    HpackDecoder peer(256);
+    std::string block;
+    encoder.begin(&block);
+    encoder.encode("x-request-id", "0123456789abcdef", &block);
+    encoder.encode("set-cookie", "secret", &block, HpackEncoder::NEVER);
+    fields = decode(&peer, block);
+    assert(fields.size() == 2 && fields[1].second == "secret");
+    block.clear();
+    encoder.begin(&block);
+    encoder.encode("x-request-id", "0123456789abcdef", &block);
+    assert(block.size() == 1);
+    assert(decode(&peer, block)[0].second == "0123456789abcdef");
+    for (int i = 0; i < 50; i++) {
+        block.clear();
+        encoder.begin(&block);
+        std::string name = "x-field-" + std::to_string(i);
+        encoder.encode(name, std::string(i % 7 * 10, 'v'), &block);
+        fields = decode(&peer, block);
+        assert(fields.size() == 1 && fields[0].first == name);
+        assert(encoder.getTable().getSize() <= 256);
+        assert(encoder.getTable().getSize() == peer.getTable().getSize());
+    }
+    // 表先缩小再变大：下一个头部块开头是两次大小更新，动态表被清空
+    encoder.setMaxTableSize(0);
+    encoder.setMaxTableSize(128);
+    block.clear();
+    encoder.begin(&block);
+    encoder.encode("x-request-id", "0123456789abcdef", &block);
+    assert((uint8_t)block[0] == 0x20);
+    fields = decode(&peer, block);
+    assert(fields.size() == 1 && fields[0].second == "0123456789abcdef");
+    assert(peer.getTable().getMaxSize() == 128 && peer.getTable().getCount() == 1);
+    // 大小更新超过 SETTINGS 中的上限
+    HpackDecoder limited(64);
+    assert(!limited.decode("\x3f\xe1\x1f", 3, [](const StringPiece&, const StringPiece&) {}));
+    // 展开后的头部列表超过上限时停止解码
+    HpackDecoder bomb;
+    block.clear();
+    block.push_back(0x40);
+    Hpack::EncodeString("x-big", &block);
+    Hpack::EncodeString(std::string(1000, 'a'), &block);
+    block.append(100, '\xbe');
+    size_t emitted = 0;
+    assert(!bomb.decode(block.data(), block.size(),
+                        [&](const StringPiece&, const StringPiece&) { ++emitted; }, 16 * 1024));
+    assert(emitted == 15);
+    // 下标越界
+    HpackDecoder empty;
+    assert(!empty.decode("\xbe", 1, [](const StringPiece&, const StringPiece&) {}));
+}
+
+// 在同一个连接上发 keep-alive 请求并读完响应，返回状态行开头和 body
+static std::string httpGet(Socket::SPtr sock, const std::string& path) {
+    std::string req = "GET " + path + " HTTP/1.1\r\nConnection: Keep-Alive\r\n\r\n";
+    assert(sock->send(req.data(), req.size()) == (int)req.size());
+    std::string data;
+    char buf[4096];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        int n = sock->recv(buf, sizeof(buf));
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    size_t pos = data.find("Content-Length: ");
+    size_t length = pos == std::string::npos ? 0 : atol(data.c_str() + pos + 16);
+    while (data.size() < end + 4 + length) {
+        int n = sock->recv(buf, sizeof(buf));
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    return data.substr(0, 12) + data.substr(end + 4);
+}
+
+// 直接发送 data，读到连接关闭，返回服务端 GOAWAY 的错误码，没有 GOAWAY 时返回 -1
+static int rawGoaway(Address::SPtr addr, const std::string& data) {
+    Socket::SPtr raw = Socket::CreateTcp();
+    assert(raw->connect(*addr));
+    assert(raw->send(data.data(), data.size()) == (int)data.size());
+    std::string in;
+    char buf[4096];
+    int n;
+    while ((n = raw->recv(buf, sizeof(buf))) > 0) {
+        in.append(buf, n);
+    }
+    int error = -1;
+    for (size_t pos = 0; pos + Http2Codec::kFrameHeaderSize <= in.size();) {
+        Http2FrameHeader header;
+        Http2Codec::ParseHeader(in.data() + pos, &header);
+        if (header.type == Http2FrameType::GOAWAY) {
+            error = Http2Codec::ReadUint32(in.data() + pos + 13);
+        }
+        pos += Http2Codec::kFrameHeaderSize + header.length;
+    }
+    return error;
+}
+
+// 在一个 h2 连接上保持 window 个请求在途，返回全部完成的耗时
+static int64_t h2Run(Http2Client::SPtr h2, const std::string& path, int count, int window,
+                     const std::string& expect) {
+    int64_t start = nowUs();
+    int sent = 0;
+    int received = 0;
+    Http2Client::Response rsp;
+    while (received < count) {
+        while (sent < count && sent - received < window) {
+            assert(h2->sendRequest("GET", path));
+            ++sent;
+        }
+        assert(h2->recvResponse(&rsp));
+        assert(rsp.status == 200 && rsp.body == expect);
+        ++received;
+    }
+    return nowUs() - start;
+}
+
+static void client(int count, int slowCount) {
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", kPort);
+    Http2Client::SPtr h2 = Http2Client::Connect(addr);
+    assert(h2);
+    Http2Client::Response rsp;
+
+    uint32_t id = h2->sendRequest("GET", "/hello?h2");
+    assert(id == 1);
+    assert(h2->recvResponse(&rsp));
+    assert(rsp.streamId == 1 && rsp.status == 200 && rsp.body == "hello h2");
+    assert(rsp.getHeader("server") == "Reyao" && rsp.getHeader("content-length") == "8");
+    assert(!rsp.getHeader("date").empty());
+
+    // HEAD 只有头部，content-length 是完整 body 的长度
+    h2->sendRequest("HEAD", "/hello");
+    assert(h2->recvResponse(&rsp) && rsp.status == 200 && rsp.body.empty());
+    assert(rsp.getHeader("content-length") == "6");
+
+    h2->sendRequest("GET", "/nothing");
+    assert(h2->recvResponse(&rsp) && rsp.status == 404);
+
+    // 请求 body 超过默认的 65535 窗口，等服务端的 WINDOW_UPDATE 继续发
+    std::string big(300 * 1000, 'p');
+    for (size_t i = 0; i < big.size(); i += 1000) {
+        big[i] = 'a' + i % 26;
+    }
+    h2->sendRequest("POST", "/echo", {{"content-type", "text/plain"}}, big);
+    assert(h2->recvResponse(&rsp) && rsp.status == 200 && rsp.body == big);
+
+    // 缓存的请求 body 超过连接的上限时拒绝这个流，连接继续可用
+    h2->sendRequest("POST", "/echo", {}, std::string(2 * 1024 * 1024, 'q'));
+    assert(h2->recvResponse(&rsp) && rsp.error == Http2Error::REFUSED_STREAM);
+
+    // 拆开的 cookie 合并，:authority 变成 host
+    h2->sendRequest("GET", "/headers", {{"host", "example.com"}, {"cookie", "a=1"},
+                                       {"x-token", "t0"}, {"cookie", "b=2"}});
+    assert(h2->recvResponse(&rsp) && rsp.body == "example.com|a=1; b=2|t0");
+    // 连接专用的头部不合法，重置这个流，连接继续可用
+    h2->sendRequest("GET", "/hello", {{"connection", "keep-alive"}});
+    assert(h2->recvResponse(&rsp) && rsp.error == Http2Error::PROTOCOL_ERROR);
+    // 接管连接的 servlet 不能用于 HTTP/2
+    h2->sendRequest("GET", "/takeover");
+    assert(h2->recvResponse(&rsp) && rsp.error == Http2Error::HTTP_1_1_REQUIRED);
+
+    // 100 个慢请求同时在一个连接上，总耗时接近一个请求
+    int64_t start = nowUs();
+    for (int i = 0; i < 100; i++) {
+        assert(h2->sendRequest("GET", "/slow"));
+    }
+    for (int i = 0; i < 100; i++) {
+        assert(h2->recvResponse(&rsp) && rsp.status == 200 && rsp.body == "slow");
+    }
+    int64_t cost = nowUs() - start;
+    printf("100 concurrent %dms requests on one connection: %.1fms\n", kSlowMs, cost / 1000.0);
+    assert(cost < kSlowMs * 1000 * 10);
+
+    // 1MB 响应，客户端窗口只有 65535，服务端发完窗口后等待 WINDOW_UPDATE；
+    // 同时在途的小请求不被大响应堵住
+    h2->sendRequest("GET", "/big");
+    h2->sendRequest("GET", "/hello");
+    assert(h2->recvResponse(&rsp) && rsp.body == "hello ");
+    assert(h2->recvResponse(&rsp) && rsp.status == 200 && rsp.body.size() == 1024 * 1024);
+    assert(rsp.body == std::string(1024 * 1024, 'b'));
+
+    // Upgrade：升级请求的响应在 stream 1 上，之后的请求从 3 开始
+    Http2Client::SPtr up = Http2Client::Upgrade(addr, "/hello?upgrade");
+    assert(up);
+    assert(up->recvResponse(&rsp) && rsp.streamId == 1 && rsp.body == "hello upgrade");
+    assert(up->sendRequest("GET", "/hello?again") == 3);
+    assert(up->recvResponse(&rsp) && rsp.body == "hello again");
+
+    // 前言不对：回复 GOAWAY(PROTOCOL_ERROR) 后关闭
+    assert(rawGoaway(addr, "PRI * HTTP/2.0\r\n\r\nXX\r\n\r\n") ==
+           static_cast<int>(Http2Error::PROTOCOL_ERROR));
+    // HPACK 炸弹：一个 4000 字节的条目加入动态表后被一字节的索引引用上百次，
+    // 展开超过上限时停止解码并关闭连接
+    std::string block;
+    block.push_back(0x40);
+    Hpack::EncodeString("x-big", &block);
+    Hpack::EncodeString(std::string(4000, 'a'), &block);
+    block.append(200, '\xbe');
+    std::string bomb(Http2Codec::kPreface, Http2Codec::kPrefaceSize);
+    Http2Codec::AppendFrame(&bomb, Http2FrameType::SETTINGS, 0, 0, StringPiece());
+    Http2Codec::AppendFrame(&bomb, Http2FrameType::HEADERS, H2_END_HEADERS | H2_END_STREAM,
+                            1, block);
+    assert(rawGoaway(addr, bomb) == static_cast<int>(Http2Error::COMPRESSION_ERROR));
+
+    // 同一连接上的对比：HTTP/1.1 keep-alive 只能一问一答，HTTP/2 同时有 100 个请求在途
+    Socket::SPtr http = Socket::CreateTcp();
+    assert(http->connect(*addr));
+    start = nowUs();
+    for (int i = 0; i < count; i++) {
+        assert(httpGet(http, "/hello").compare(12, 6, "hello ") == 0);
+    }
+    int64_t http1Cost = nowUs() - start;
+    int64_t h2SerialCost = h2Run(h2, "/hello", count, 1, "hello ");
+    int64_t h2Cost = h2Run(h2, "/hello", count, 100, "hello ");
+    printf("%d requests on one connection: http/1.1 keep-alive %.1fus/req, "
+           "h2 serial %.1fus/req, h2 x100 in flight %.1fus/req\n", count,
+           (double)http1Cost / count, (double)h2SerialCost / count, (double)h2Cost / count);
+
+    // 慢后端：HTTP/1.1 的请求在一个连接上排队，HTTP/2 的请求并发等待
+    start = nowUs();
+    for (int i = 0; i < slowCount; i++) {
+        assert(httpGet(http, "/slow").compare(12, 4, "slow") == 0);
+    }
+    http1Cost = nowUs() - start;
+    h2Cost = h2Run(h2, "/slow", slowCount, 100, "slow");
+    printf("%d requests to a %dms backend on one connection: http/1.1 %.0fms, h2 %.0fms\n",
+           slowCount, kSlowMs, http1Cost / 1000.0, h2Cost / 1000.0);
+    s_done = true;
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::ERROR);
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    int slowCount = argc > 2 ? atoi(argv[2]) : 100;
+    testHuffmanTable();
+    testHpack();
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    Http2Options http2;
+    http2.enable = true;
+    http2.maxBufferedBytes = 1024 * 1024;
+    server.setHttp2(http2);
+    auto dispatch = server.getDispatch();
+    dispatch->addServlet("/hello", [](const HttpRequest& req,
+                                      HttpResponse* rsp,
+                                      const HttpSession& session) {
+        rsp->addHeader("Content-Type", "text/plain");
+        rsp->setBody("hello " + req.getQuery().toString());
+        return 0;
+    });
+    dispatch->addServlet("/echo", [](const HttpRequest& req,
+                                     HttpResponse* rsp,
+                                     const HttpSession& session) {
+        rsp->setBody(req.getBody().toString());
+        return 0;
+    });
+    dispatch->addServlet("/headers", [](const HttpRequest& req,
+                                        HttpResponse* rsp,
+                                        const HttpSession& session) {
+        rsp->setBody(req.getHeaderView(HttpRequest::HOST).toString() + "|" +
+                     req.getHeaderView(HttpRequest::COOKIE).toString() + "|" +
+                     req.getHeaderView("x-token").toString());
+        return 0;
+    });
+    dispatch->addServlet("/slow", [](const HttpRequest& req,
+                                     HttpResponse* rsp,
+                                     const HttpSession& session) {
+        usleep(kSlowMs * 1000);
+        rsp->setBody("slow");
+        return 0;
+    });
+    dispatch->addServlet("/big", [](const HttpRequest& req,
+                                    HttpResponse* rsp,
+                                    const HttpSession& session) {
+        rsp->setBody(std::string(1024 * 1024, 'b'));
+        return 0;
+    });
+    dispatch->addServlet("/takeover", [](const HttpRequest& req,
+                                         HttpResponse* rsp,
+                                         const HttpSession& session) {
+        rsp->setTakeover([](HttpTakeover& conn) { conn.close(); });
+        return 0;
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    sh.addTask(std::bind(client, count, slowCount));
+    while (!s_done) {
+        usleep(10 * 1000);
+    }
+    printf("http2 test passed\n");
+    fflush(stdout);
+    _exit(0);
+}
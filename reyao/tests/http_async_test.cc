@@ -0,0 +1,278 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_async.h"
+#include "reyao/mutex.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace reyao;
+
+// 长轮询：N 个请求同时挂起，协程中等待（/block）与 AsyncServlet（/poll）的内存对比，
+// 以及客户端中途关闭、同步完成、完成后 keep-alive 连接继续使用
+// ./http_async_test [count]
+
+static const int kPort = 8019;
+
+static Mutex s_mutex;
+static std::vector<AsyncResponse::SPtr> s_waiters;
+static std::atomic<int> s_blocking(0);
+static std::atomic<bool> s_release(false);
+
+static long rssKB() {
+    long pages = 0, resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int connectServer() {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+static void sendRequest(int fd, const std::string& path) {
+    std::string req = "GET " + path + " HTTP/1.1\r\nConnection: Keep-Alive\r\n\r\n";
+    assert(::send(fd, req.data(), req.size(), 0) == (ssize_t)req.size());
+}
+
+// 响应都很小，读到空行后按 Content-Length 读完 body
+static std::string recvBody(int fd, std::string* header = nullptr) {
+    std::string data;
+    char buf[4096];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    size_t pos = data.find("Content-Length: ");
+    assert(pos != std::string::npos);
+    size_t length = atol(data.c_str() + pos + 16);
+    while (data.size() < end + 4 + length) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    if (header) {
+        *header = data.substr(0, end + 2);
+    }
+    return data.substr(end + 4, length);
+}
+
+static time_t dateOf(const std::string& header) {
+    size_t pos = header.find("Date: ");
+    assert(pos != std::string::npos);
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    assert(strptime(header.c_str() + pos + 6, "%a, %d %b %Y %H:%M:%S GMT", &tm));
+    return timegm(&tm);
+}
+
+static AsyncResponse::SPtr takeWaiter() {
+    MutexGuard lock(s_mutex);
+    assert(s_waiters.size() == 1);
+    AsyncResponse::SPtr waiter = s_waiters.back();
+    s_waiters.clear();
+    return waiter;
+}
+
+template <class Cond>
+static void waitUntil(Cond cond) {
+    for (int i = 0; i < 5000 && !cond(); i++) {
+        usleep(1000);
+    }
+    assert(cond());
+}
+
+static void client(HttpServer* server, int count) {
+    std::vector<int> fds;
+
+    // 异步：连接脱离协程，只剩 AsyncResponse
+    long base = rssKB();
+    for (int i = 0; i < count; i++) {
+        fds.push_back(connectServer());
+        sendRequest(fds.back(), "/poll");
+    }
+    waitUntil([server, count]() { return server->getDetachedCount() == count; });
+    long asyncRss = rssKB() - base;
+
+    // 等待期间客户端关闭连接，连接被回收，句柄标记为关闭
+    int closed = count / 10;
+    for (int i = 0; i < closed; i++) {
+        ::close(fds[i]);
+    }
+    waitUntil([server, count, closed]() {
+        return server->getDetachedCount() == count - closed;
+    });
+
+    // 在非 worker 线程上完成所有请求
+    std::vector<AsyncResponse::SPtr> waiters;
+    {
+        MutexGuard lock(s_mutex);
+        waiters.swap(s_waiters);
+    }
+    int dropped = 0;
+    for (auto& waiter : waiters) {
+        waiter->getResponse()->setBody("event");
+        if (!waiter->complete()) {
+            assert(waiter->isClosed());
+            dropped++;
+        }
+    }
+    assert(dropped == closed);
+    waiters.clear();
+    for (int i = closed; i < count; i++) {
+        assert(recvBody(fds[i]) == "event");
+    }
+    waitUntil([server]() { return server->getDetachedCount() == 0; });
+
+    // 完成之后连接继续处理下一个请求；handleAsync 中直接完成的走同步路径
+    int fd = fds[closed];
+    sendRequest(fd, "/now");
+    assert(recvBody(fd) == "now");
+    sendRequest(fd, "/poll");
+    waitUntil([server]() { return server->getDetachedCount() == 1; });
+    {
+        MutexGuard lock(s_mutex);
+        s_waiters.back()->getResponse()->setBody("again");
+        s_waiters.back()->complete();
+        s_waiters.clear();
+    }
+    assert(recvBody(fd) == "again");
+
+    // 延迟完成的响应带的是完成时的 Date
+    sendRequest(fd, "/poll");
+    waitUntil([server]() { return server->getDetachedCount() == 1; });
+    sleep(2);
+    time_t completed = time(nullptr);
+    AsyncResponse::SPtr waiter = takeWaiter();
+    waiter->getResponse()->setBody("late");
+    waiter->complete();
+    std::string header;
+    assert(recvBody(fd, &header) == "late");
+    assert(dateOf(header) >= completed);
+
+    // 等待期间客户端先发来下一个请求再关闭，连接仍然被回收
+    waitUntil([server]() { return server->getDetachedCount() == 0; });
+    int pipelined = connectServer();
+    sendRequest(pipelined, "/poll");
+    waitUntil([server]() { return server->getDetachedCount() == 1; });
+    sendRequest(pipelined, "/now");
+    usleep(50 * 1000);
+    ::close(pipelined);
+    waitUntil([server]() { return server->getDetachedCount() == 0; });
+    waiter = takeWaiter();
+    assert(!waiter->complete() && waiter->isClosed());
+    waiter.reset();
+
+    // servlet 丢掉句柄时连接被关闭
+    sendRequest(fd, "/drop");
+    char c;
+    assert(::recv(fd, &c, 1, 0) == 0);
+    waitUntil([server]() { return server->getDetachedCount() == 0; });
+
+    for (int i = closed; i < count; i++) {
+        ::close(fds[i]);
+    }
+    waitUntil([server]() { return server->getConnectionCount() == 0; });
+    fds.clear();
+
+    // 协程中等待：每个挂起的请求占着一个协程栈
+    base = rssKB();
+    for (int i = 0; i < count; i++) {
+        fds.push_back(connectServer());
+        sendRequest(fds.back(), "/block");
+    }
+    waitUntil([count]() { return s_blocking == count; });
+    long blockRss = rssKB() - base;
+    s_release = true;
+    for (int fd : fds) {
+        assert(recvBody(fd) == "released");
+        ::close(fd);
+    }
+
+    // 不在 worker 线程中调用 handle 时阻塞到 complete
+    FunctionAsyncServlet later([](const HttpRequest& req, AsyncResponse::SPtr rsp) {
+        Thread thread([rsp]() {
+            usleep(50 * 1000);
+            rsp->getResponse()->setBody("later");
+            rsp->complete();
+        }, "async_complete");
+        thread.start();
+        thread.join();
+    });
+    HttpRequest req;
+    HttpResponse rsp;
+    HttpSession session(nullptr, false);
+    later.handle(req, &rsp, session);
+    assert(rsp.getBody() == "later");
+
+    printf("%d pending: block +%ldKB (%ldB/req), async +%ldKB (%ldB/req)\n", count,
+           blockRss, blockRss * 1024 / count, asyncRss, asyncRss * 1024 / count);
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::ERROR);
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    auto dispatch = server.getDispatch();
+    dispatch->addServlet("/block", [](const HttpRequest& req,
+                                      HttpResponse* rsp,
+                                      const HttpSession& session) {
+        ++s_blocking;
+        while (!s_release) {
+            usleep(10 * 1000);
+        }
+        rsp->setBody("released");
+        return 0;
+    });
+    dispatch->addServlet("/poll", std::make_shared<FunctionAsyncServlet>(
+                         [](const HttpRequest& req, AsyncResponse::SPtr rsp) {
+        MutexGuard lock(s_mutex);
+        s_waiters.push_back(rsp);
+    }));
+    dispatch->addServlet("/now", std::make_shared<FunctionAsyncServlet>(
+                         [](const HttpRequest& req, AsyncResponse::SPtr rsp) {
+        rsp->getResponse()->setBody("now");
+        rsp->complete();
+    }));
+    dispatch->addServlet("/drop", std::make_shared<FunctionAsyncServlet>(
+                         [](const HttpRequest& req, AsyncResponse::SPtr rsp) {
+    }));
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, &server, count), "async_client");
+    thread.start();
+    thread.join();
+    printf("async test passed\n");
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,203 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_cache_servlet.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace reyao;
+
+// CachingServlet：并发未命中合并为一次计算、TTL、按请求头区分 key、命中时的吞吐
+// ./http_cache_test [count]
+
+static const int kPort = 8018;
+static const int kClients = 8;
+
+static std::atomic<int> s_computed(0);
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int connectServer() {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+static std::string headerValue(const std::string& header, const char* key) {
+    std::string k = std::string("\r\n") + key + ": ";
+    size_t pos = header.find(k);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += k.size();
+    return header.substr(pos, header.find("\r\n", pos) - pos);
+}
+
+// 返回 body，header 存到 header 中
+static std::string request(int fd, const std::string& path, const std::string& extra,
+                           std::string* header = nullptr) {
+    std::string req = "GET " + path + " HTTP/1.1\r\n" + extra + "\r\n";
+    assert(::send(fd, req.data(), req.size(), 0) == (ssize_t)req.size());
+    char buf[16 * 1024];
+    std::string data;
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    std::string head = data.substr(0, end + 2);
+    size_t length = atol(headerValue(head, "Content-Length").c_str());
+    std::string body = data.substr(end + 4);
+    while (body.size() < length) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        body.append(buf, n);
+    }
+    if (header) {
+        *header = head;
+    }
+    return body;
+}
+
+static const char kKeepAlive[] = "Connection: Keep-Alive\r\n";
+
+static void client(CachingServlet* cache, int count) {
+    // 同时发出 kClients 个相同的请求，只有一个会调用被包装的 servlet
+    std::vector<int> fds;
+    for (int i = 0; i < kClients; i++) {
+        fds.push_back(connectServer());
+    }
+    std::string req = std::string("GET /slow?id=1 HTTP/1.1\r\n") + kKeepAlive + "\r\n";
+    for (int fd : fds) {
+        ::send(fd, req.data(), req.size(), 0);
+    }
+    for (int fd : fds) {
+        char buf[1024];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        assert(std::string(buf, n).find("slow:/slow?id=1") != std::string::npos);
+    }
+    auto stats = cache->getStats();
+    printf("concurrent: computed=%d misses=%lu coalesced=%lu\n",
+           s_computed.load(), stats.misses, stats.coalesced);
+    assert(s_computed == 1 && stats.misses == 1 && stats.coalesced == kClients - 1);
+
+    int fd = fds[0];
+    // 命中缓存，非 keep-alive 请求的 Connection 行被替换
+    std::string header;
+    assert(request(fd, "/slow?id=1", kKeepAlive, &header) == "slow:/slow?id=1");
+    assert(headerValue(header, "Connection") == "Keep-Alive");
+    int closeFd = connectServer();
+    assert(request(closeFd, "/slow?id=1", "", &header) == "slow:/slow?id=1");
+    assert(headerValue(header, "Connection") == "Close");
+    ::close(closeFd);
+    assert(s_computed == 1);
+
+    // HTTP/1.0 的请求不会拿到缓存的 HTTP/1.1 状态行
+    int oldFd = connectServer();
+    const char oldReq[] = "GET /slow?id=1 HTTP/1.0\r\n\r\n";
+    assert(::send(oldFd, oldReq, sizeof(oldReq) - 1, 0) == sizeof(oldReq) - 1);
+    std::string oldRsp;
+    char buf[1024];
+    ssize_t n;
+    while ((n = ::recv(oldFd, buf, sizeof(buf), 0)) > 0) {
+        oldRsp.append(buf, n);
+    }
+    ::close(oldFd);
+    assert(oldRsp.compare(0, 12, "HTTP/1.0 200") == 0);
+    assert(oldRsp.find("slow:/slow?id=1") != std::string::npos);
+    assert(s_computed == 2);
+
+    // query 和 keyHeaders 不同的请求分别缓存
+    request(fd, "/slow?id=2", kKeepAlive);
+    request(fd, "/slow?id=1", std::string(kKeepAlive) + "Accept-Language: zh\r\n");
+    assert(s_computed == 4);
+    // 不可缓存的响应每次都计算
+    request(fd, "/private", kKeepAlive);
+    request(fd, "/private", kKeepAlive);
+    assert(cache->getStats().uncacheable == 2);
+
+    // TTL 过期后重新计算
+    usleep(600 * 1000);
+    int computed = s_computed;
+    request(fd, "/slow?id=1", kKeepAlive);
+    assert(s_computed == computed + 1);
+
+    int64_t start = nowUs();
+    for (int i = 0; i < count; i++) {
+        request(fd, "/slow?id=1", kKeepAlive);
+    }
+    int64_t hit = nowUs() - start;
+    start = nowUs();
+    for (int i = 0; i < count / 10; i++) {
+        request(fd, "/direct", kKeepAlive);
+    }
+    int64_t direct = nowUs() - start;
+    stats = cache->getStats();
+    printf("hit %.1fus/req, uncached %.1fus/req; hits=%lu misses=%lu coalesced=%lu "
+           "entries=%zu bytes=%zu\n",
+           (double)hit / count, (double)direct / (count / 10), stats.hits,
+           stats.misses, stats.coalesced, stats.entries, stats.bytes);
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    // 每次调用耗时 20ms 的 servlet，sleep 被 hook 成挂起协程
+    auto slow = std::make_shared<FunctionServlet>([](const HttpRequest& req,
+                                                     HttpResponse* rsp,
+                                                     const HttpSession& session) {
+        ++s_computed;
+        usleep(20 * 1000);
+        rsp->addHeader("Content-Type", "text/plain");
+        if (req.getPath() == "/private") {
+            rsp->addHeader("Cache-Control", "private");
+        }
+        rsp->setBody("slow:" + req.getPath().toString() + "?" + req.getQuery().toString());
+        return 0;
+    });
+    CachingServlet::Options options;
+    options.ttl = 500;
+    options.keyHeaders.push_back("Accept-Language");
+    auto cache = std::make_shared<CachingServlet>(slow, options);
+    server.getDispatch()->addServlet("/slow", cache);
+    server.getDispatch()->addServlet("/private", cache);
+    server.getDispatch()->addServlet("/direct", slow);
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, cache.get(), count), "cache_client");
+    thread.start();
+    thread.join();
+    printf("cache test passed\n");
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,120 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_client.h"
+#include "reyao/connection_pool.h"
+#include "reyao/log.h"
+
+#include <assert.h>
+
+using namespace reyao;
+
+// HttpClient 通过连接池复用 keep-alive 连接
+// ./http_client_test [count]
+
+// 不带 Connection 头部的服务端：HTTP/1.1 默认保持连接，
+// "/close" 回复 "Connection: close"，"/old" 回复 HTTP/1.0
+static void rawConn(Socket::SPtr conn) {
+    std::string buf;
+    char data[4096];
+    while (true) {
+        size_t end = buf.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            int n = conn->recv(data, sizeof(data));
+            if (n <= 0) {
+                break;
+            }
+            buf.append(data, n);
+            continue;
+        }
+        std::string line = buf.substr(0, buf.find("\r\n"));
+        buf.erase(0, end + 4);
+        std::string rsp;
+        if (line.find(" /close ") != std::string::npos) {
+            rsp = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok";
+        } else if (line.find(" /old ") != std::string::npos) {
+            rsp = "HTTP/1.0 200 OK\r\nContent-Length: 2\r\n\r\nok";
+        } else {
+            rsp = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+        }
+        conn->send(rsp.data(), rsp.size());
+    }
+    conn->close();
+}
+
+static void rawServer(Address::SPtr addr) {
+    Socket::SPtr sock = Socket::CreateTcp();
+    sock->bind(*addr);
+    sock->listen();
+    while (true) {
+        Socket::SPtr conn = sock->accept();
+        if (conn) {
+            Worker::GetWorker()->addTask(std::bind(rawConn, conn));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 100;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", 8011);
+    HttpServer server(&sh, addr, true);
+    server.getDispatch()->addServlet("/hello", [](const HttpRequest& req,
+                                                  HttpResponse* rsp,
+                                                  const HttpSession& session) {
+        rsp->setBody("hello, world!");
+        return 0;
+    });
+    server.start();
+
+    ConnectionPool::Options options;
+    options.maxIdle = 4;
+    options.idleTimeout = 1000;
+    options.evictInterval = 500;
+    auto pool = std::make_shared<ConnectionPool>(&sh, options);
+    HttpClient client(addr, pool);
+
+    auto rawAddr = IPv4Address::CreateAddress("127.0.0.1", 8012);
+    sh.addTask(std::bind(rawServer, rawAddr));
+    auto rawPool = std::make_shared<ConnectionPool>(&sh, options);
+
+    sh.addTimer(100, [&]() {
+        for (int i = 0; i < count; i++) {
+            auto rsp = client.get("/hello");
+            assert(rsp && rsp->getBody() == "hello, world!");
+        }
+        auto stats = pool->getStats();
+        LOG_INFO << "requests=" << count << " created=" << stats.created
+                 << " reused=" << stats.reused << " idle=" << stats.idle;
+        assert(stats.created == 1);
+        assert(stats.reused == (uint64_t)count - 1);
+
+        // 对端没有发 Connection 头部时按版本判断
+        HttpClient raw(rawAddr, rawPool);
+        for (int i = 0; i < 3; i++) {
+            auto rsp = raw.get("/default");
+            assert(rsp && rsp->getBody() == "ok");
+        }
+        stats = rawPool->getStats();
+        assert(stats.created == 1 && stats.reused == 2 && stats.idle == 1);
+        assert(raw.get("/close") && rawPool->getStats().idle == 0);
+        assert(raw.get("/old") && rawPool->getStats().idle == 0);
+        stats = rawPool->getStats();
+        assert(stats.created == 2 && stats.reused == 3 && stats.closed == 2);
+        LOG_INFO << "default keep-alive ok";
+    });
+
+    // 超过 idleTimeout 后空闲连接被定时器回收
+    sh.addTimer(3000, [&]() {
+        auto stats = pool->getStats();
+        LOG_INFO << "after idle timeout: idle=" << stats.idle
+                 << " closed=" << stats.closed;
+        assert(stats.idle == 0);
+        pool->stop();
+        rawPool->stop();
+        sh.stop();
+    });
+    sh.wait();
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_static_servlet.h"
+#include "reyao/http/http_gzip.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <fstream>
+#include <string>
+
+using namespace reyao;
+
+// gzip 响应压缩：Accept-Encoding 协商、复用 z_stream 的耗时、按 ETag 缓存的压缩结果
+// ./http_gzip_test [count]
+
+static const int kPort = 8017;
+static const char kDir[] = "/tmp/reyao_gzip_test";
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static std::string makeJson(size_t size) {
+    std::string json = "[";
+    for (int i = 0; json.size() < size; i++) {
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user" +
+                std::to_string(i % 97) + "\",\"active\":true},";
+    }
+    json.back() = ']';
+    return json;
+}
+
+static std::string gunzip(const std::string& data) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    assert(inflateInit2(&zs, 15 + 16) == Z_OK);
+    std::string out;
+    char buf[16 * 1024];
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = data.size();
+    int rt;
+    do {
+        zs.next_out = (Bytef*)buf;
+        zs.avail_out = sizeof(buf);
+        rt = inflate(&zs, Z_NO_FLUSH);
+        assert(rt == Z_OK || rt == Z_STREAM_END);
+        out.append(buf, sizeof(buf) - zs.avail_out);
+    } while (rt != Z_STREAM_END);
+    inflateEnd(&zs);
+    return out;
+}
+
+// 每次都 deflateInit/deflateEnd，作为对照
+static bool compressOnce(const std::string& in, std::string* out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out->resize(deflateBound(&zs, in.size()));
+    zs.next_in = (Bytef*)in.data();
+    zs.avail_in = in.size();
+    zs.next_out = (Bytef*)&(*out)[0];
+    zs.avail_out = out->size();
+    bool ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+    out->resize(zs.total_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+struct Response {
+    int status = 0;
+    std::string header;
+    std::string body;
+};
+
+static std::string headerValue(const std::string& header, const char* key) {
+    std::string k = std::string("\r\n") + key + ": ";
+    size_t pos = header.find(k);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += k.size();
+    return header.substr(pos, header.find("\r\n", pos) - pos);
+}
+
+static bool request(int fd, const std::string& path, const std::string& extra,
+                    Response* rsp) {
+    std::string req = "GET " + path + " HTTP/1.1\r\n"
+                      "Connection: Keep-Alive\r\n" + extra + "\r\n";
+    if (::send(fd, req.data(), req.size(), 0) != (ssize_t)req.size()) {
+        return false;
+    }
+    char buf[16 * 1024];
+    std::string data;
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        data.append(buf, n);
+    }
+    rsp->header = data.substr(0, end + 2);
+    rsp->status = atoi(data.c_str() + 9);
+    size_t length = atol(headerValue(rsp->header, "Content-Length").c_str());
+    rsp->body = data.substr(end + 4);
+    while (rsp->body.size() < length) {
+        ssize_t n = ::recv(fd, buf, std::min(sizeof(buf), length - rsp->body.size()), 0);
+        if (n <= 0) {
+            return false;
+        }
+        rsp->body.append(buf, n);
+    }
+    return true;
+}
+
+static void client(HttpServer* server, StaticFileServlet* files, StaticFileServlet* small,
+                   const std::string* json, const std::string* page) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+
+    Response rsp;
+    // 不接受 gzip 时原样返回
+    assert(request(fd, "/api/users", "", &rsp));
+    assert(rsp.status == 200 && rsp.body == *json);
+    assert(headerValue(rsp.header, "Content-Encoding").empty());
+    assert(headerValue(rsp.header, "Vary") == "Accept-Encoding");
+    assert(request(fd, "/api/users", "Accept-Encoding: gzip;q=0, br\r\n", &rsp));
+    assert(headerValue(rsp.header, "Content-Encoding").empty());
+
+    // 第二次请求命中按 ETag 缓存的压缩结果
+    for (int i = 0; i < 2; i++) {
+        assert(request(fd, "/api/users", "Accept-Encoding: gzip, deflate\r\n", &rsp));
+        assert(rsp.status == 200);
+        assert(headerValue(rsp.header, "Content-Encoding") == "gzip");
+        assert(headerValue(rsp.header, "ETag") == "\"v1-gzip\"");
+        assert(gunzip(rsp.body) == *json);
+    }
+    GzipCache* cache = server->getGzipCache();
+    assert(cache->getHits() == 1 && cache->getMisses() == 1);
+    printf("json: %zu -> %zu bytes\n", json->size(), rsp.body.size());
+
+    // 小于 minSize 的响应不压缩
+    assert(request(fd, "/api/small", "Accept-Encoding: gzip\r\n", &rsp));
+    assert(rsp.body == "{}" && headerValue(rsp.header, "Content-Encoding").empty());
+
+    // 静态文件：压缩结果随文件缓存，压缩版本有自己的 ETag
+    assert(request(fd, "/static/page.html", "Accept-Encoding: gzip\r\n", &rsp));
+    assert(headerValue(rsp.header, "Content-Encoding") == "gzip");
+    assert(gunzip(rsp.body) == *page);
+    std::string etag = headerValue(rsp.header, "ETag");
+    assert(request(fd, "/static/page.html",
+                   "Accept-Encoding: gzip\r\nIf-None-Match: " + etag + "\r\n", &rsp));
+    assert(rsp.status == 304);
+    assert(request(fd, "/static/page.html", "Accept-Encoding: gzip\r\nRange: bytes=0-9\r\n", &rsp));
+    assert(rsp.status == 206 && rsp.body == page->substr(0, 10));
+    assert(files->getStats().gzipHits == 1);
+
+    // 压缩结果计入 maxMemorySize：预算只够一份时淘汰较早的文件，不超出预算
+    std::string gz;
+    assert(Gzip::Compress(page->data(), page->size(), &gz));
+    assert(request(fd, "/small/page.html", "Accept-Encoding: gzip\r\n", &rsp));
+    assert(gunzip(rsp.body) == *page);
+    assert(small->getStats().memorySize == gz.size());
+    assert(request(fd, "/small/page2.html", "Accept-Encoding: gzip\r\n", &rsp));
+    assert(gunzip(rsp.body) == *page);
+    auto stats = small->getStats();
+    assert(stats.memorySize == gz.size() && stats.files == 1);
+    ::close(fd);
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+
+    assert(Gzip::IsAccepted("gzip"));
+    assert(Gzip::IsAccepted("deflate, GZIP;q=0.5"));
+    assert(Gzip::IsAccepted("*"));
+    assert(!Gzip::IsAccepted("gzip;q=0, br"));
+    assert(!Gzip::IsAccepted("gzip; q=0.000"));
+    assert(!Gzip::IsAccepted("identity"));
+    assert(Gzip::IsCompressible("text/html; charset=utf-8"));
+    assert(!Gzip::IsCompressible("image/png"));
+
+    const std::string json = makeJson(20 * 1024);
+    std::string out;
+    assert(Gzip::Compress(json.data(), json.size(), &out) && gunzip(out) == json);
+
+    int64_t start = nowUs();
+    for (int i = 0; i < count; i++) {
+        Gzip::Compress(json.data(), json.size(), &out);
+    }
+    int64_t reused = nowUs() - start;
+    start = nowUs();
+    for (int i = 0; i < count; i++) {
+        compressOnce(json, &out);
+    }
+    int64_t once = nowUs() - start;
+    printf("compress %zuB: reused z_stream %.1fus, deflateInit each time %.1fus\n",
+           json.size(), (double)reused / count, (double)once / count);
+
+    mkdir(kDir, 0755);
+    const std::string page = "<html><body>" + makeJson(8 * 1024) + "</body></html>";
+    std::ofstream(std::string(kDir) + "/page.html") << page;
+    std::ofstream(std::string(kDir) + "/page2.html") << page;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    GzipOptions gzip;
+    gzip.enable = true;
+    server.setGzip(gzip);
+    auto dispatch = server.getDispatch();
+    dispatch->addServlet("/api/users", [&json](const HttpRequest& req,
+                                               HttpResponse* rsp,
+                                               const HttpSession& session) {
+        rsp->addHeader("Content-Type", "application/json");
+        rsp->addHeader("ETag", "\"v1\"");
+        rsp->setBody(json);
+        return 0;
+    });
+    dispatch->addServlet("/api/small", [](const HttpRequest& req,
+                                          HttpResponse* rsp,
+                                          const HttpSession& session) {
+        rsp->addHeader("Content-Type", "application/json");
+        rsp->setBody("{}");
+        return 0;
+    });
+    StaticFileServlet::Options options;
+    options.gzip = gzip;
+    auto files = std::make_shared<StaticFileServlet>(kDir, options);
+    dispatch->addServlet("/static/*", files);
+    std::string gz;
+    Gzip::Compress(page.data(), page.size(), &gz);
+    options.maxMemorySize = gz.size() + 64;
+    auto small = std::make_shared<StaticFileServlet>(kDir, options);
+    dispatch->addServlet("/small/*", small);
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, &server, files.get(), small.get(), &json, &page),
+                  "gzip_client");
+    thread.start();
+    thread.join();
+    printf("gzip test passed\n");
+    fflush(stdout);
+    _exit(0);
+}
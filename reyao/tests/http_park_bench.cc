@@ -0,0 +1,92 @@
+#include "reyao/http/http_server.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <vector>
+
+using namespace reyao;
+
+// 大量空闲 keep-alive 连接时的内存占用：park 与协程挂起对比
+// ./http_park_bench [connections] [park]
+
+static const int kPort = 8012;
+static const char kRequest[] = "GET /hello HTTP/1.1\r\n"
+                               "Connection: Keep-Alive\r\n\r\n";
+
+static long rssKB() {
+    std::ifstream ifs("/proc/self/status");
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            return atol(line.c_str() + 6);
+        }
+    }
+    return 0;
+}
+
+// 每个连接发一个请求并读完响应，之后保持空闲
+static void client(int count, std::vector<int>* fds) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char buf[1024];
+    for (int i = 0; i < count; i++) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            LOG_ERROR << "connect error=" << strerror(errno);
+            ::close(fd);
+            break;
+        }
+        ::send(fd, kRequest, sizeof(kRequest) - 1, 0);
+        ::recv(fd, buf, sizeof(buf), 0);
+        fds->push_back(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 5000;
+    bool park = argc > 2 ? atoi(argv[2]) != 0 : true;
+
+    Scheduler sh(3);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    server.setParkIdle(park);
+    server.getDispatch()->addServlet("/hello", [](const HttpRequest& req,
+                                                  HttpResponse* rsp,
+                                                  const HttpSession& session) {
+        rsp->setBody("hello, world!");
+        return 0;
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    long before = rssKB();
+    std::vector<int> fds;
+    Thread thread(std::bind(client, count, &fds), "park_client");
+    thread.start();
+    thread.join();
+    usleep(200 * 1000);
+    long after = rssKB();
+
+    printf("park=%d idle_connections=%zu server_connections=%ld parked=%ld "
+           "rss_delta=%ldKB per_conn=%.2fKB\n",
+           park, fds.size(), server.getConnectionCount(),
+           server.getParkedCount(), after - before,
+           fds.empty() ? 0.0 : (double)(after - before) / fds.size());
+    fflush(stdout);
+
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    _exit(0);
+}
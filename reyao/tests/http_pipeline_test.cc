@@ -0,0 +1,99 @@
+#include "reyao/http/http_server.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace reyao;
+
+// HTTP 流水线：一次发出多个请求，最后一个请求分两次发送
+// ./http_pipeline_test [count]
+
+static const int kPort = 8013;
+static const char kRequest[] = "GET /hello HTTP/1.1\r\n"
+                               "Connection: Keep-Alive\r\n\r\n";
+
+static int countResponses(const std::string& data) {
+    int count = 0;
+    size_t pos = 0;
+    while ((pos = data.find("HTTP/1.1 200", pos)) != std::string::npos) {
+        ++count;
+        ++pos;
+    }
+    return count;
+}
+
+static void client(int count) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        LOG_ERROR << "connect error=" << strerror(errno);
+        ::close(fd);
+        return;
+    }
+
+    std::string batch;
+    for (int i = 0; i < count; i++) {
+        batch.append(kRequest, sizeof(kRequest) - 1);
+    }
+    // 最后一个请求只发一半，服务端要先把前面的响应发出再等剩下的数据
+    size_t half = sizeof(kRequest) / 2;
+    batch.append(kRequest, half);
+    ::send(fd, batch.data(), batch.size(), 0);
+
+    std::string data;
+    char buf[4096];
+    int reads = 0;
+    while (countResponses(data) < count) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        data.append(buf, n);
+        ++reads;
+    }
+    LOG_INFO << "pipelined=" << count << " responses=" << countResponses(data)
+             << " recv_calls=" << reads;
+
+    ::send(fd, kRequest + half, sizeof(kRequest) - 1 - half, 0);
+    while (countResponses(data) < count + 1) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    assert(countResponses(data) == count + 1);
+    LOG_INFO << "split request ok";
+    ::close(fd);
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 16;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    server.getDispatch()->addServlet("/hello", [](const HttpRequest& req,
+                                                  HttpResponse* rsp,
+                                                  const HttpSession& session) {
+        rsp->setBody("hello, world!");
+        return 0;
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, count), "pipeline_client");
+    thread.start();
+    thread.join();
+
+    sh.stop();
+    sh.wait();
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "reyao/http/http_session.h"
+#include "reyao/socket.h"
+#include "reyao/fdmanager.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <new>
+
+using namespace reyao;
+
+// 解析一个常见的 10 个 header 的请求需要的内存分配次数和耗时
+// ./http_request_bench [count]
+
+static size_t s_allocs = 0;
+
+void* operator new(size_t size) {
+    ++s_allocs;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+static const char kRequest[] =
+    "GET /api/v1/users/1024?fields=name,email&lang=zh%2DCN HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+    "Accept: text/html,application/xhtml+xml\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=abcdef0123456789; theme=dark\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Referer: http://www.example.com/index.html\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "\r\n";
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t rt = ::write(fd, data.data() + n, data.size() - n);
+        assert(rt > 0);
+        n += rt;
+    }
+}
+
+// 头部超过一次读取的大小，解析过程中缓冲区会扩容，已解析的视图要跟着移动
+static void largeHeaderTest(HttpSession& session, int fd) {
+    std::string big(6000, 'x');
+    std::string data = "POST /upload?a=1&b=hello+world HTTP/1.1\r\n"
+                       "Host: test\r\n"
+                       "X-Big: " + big + "\r\n"
+                       "Cookie: k1=v1; k2 = v2\r\n"
+                       "Content-Length: 5\r\n\r\nhello";
+    writeAll(fd, data);
+    HttpRequest req;
+    bool ok = session.recvRequest(&req);
+    assert(ok);
+    assert(req.getPath() == "/upload");
+    assert(req.getHeaderView(HttpRequest::HOST) == "test");
+    assert(req.getHeaderView("x-big") == big);
+    assert(req.getBody() == "hello");
+    assert(req.getParam("b") == "hello world");
+    assert(req.getCookie("k2") == "v2");
+    assert(req.getHeaders().size() == 4);
+    LOG_INFO << "large header ok";
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        LOG_ERROR << "socketpair error=" << strerror(errno);
+        return 1;
+    }
+    // 请求总是先写入再解析，非阻塞读不会遇到 EAGAIN，不需要 Scheduler
+    g_fdmanager->addFd(fds[0]);
+    Socket::SPtr sock = Socket::CreateUnixStream();
+    sock->init(fds[0]);
+    HttpSession session(sock);
+    largeHeaderTest(session, fds[1]);
+
+    // 每次写入一批请求再逐个解析，避免写满 socket 缓冲区
+    const int batch = 64;
+    std::string data;
+    for (int i = 0; i < batch; i++) {
+        data.append(kRequest, sizeof(kRequest) - 1);
+    }
+    size_t allocs = 0;
+    int64_t cost = 0;
+    int parsed = 0;
+    while (parsed < count) {
+        writeAll(fds[1], data);
+        for (int i = 0; i < batch; i++) {
+            size_t start = s_allocs;
+            int64_t begin = nowUs();
+            {
+                HttpRequest req;
+                bool ok = session.recvRequest(&req);
+                assert(ok);
+                assert(req.getHeaderView(HttpRequest::CONNECTION) == "keep-alive");
+            }
+            cost += nowUs() - begin;
+            allocs += s_allocs - start;
+        }
+        parsed += batch;
+    }
+    LOG_INFO << "requests=" << parsed << " allocs/request="
+             << (double)allocs / parsed << " avg=" << (double)cost / parsed << "us";
+    ::close(fds[1]);
+    return 0;
+}
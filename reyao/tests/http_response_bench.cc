@@ -0,0 +1,144 @@
+#include "reyao/http/http_session.h"
+#include "reyao/http/http_servlet.h"
+#include "reyao/scheduler.h"
+#include "reyao/fdmanager.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+
+using namespace reyao;
+
+// 响应序列化：ostream 格式化 + stringstream 拷贝 vs 直接编码进发送缓冲区、body 按引用 writev
+// copied 为每个响应在用户态拷贝的字节数（不含写入内核），ns 为 servlet + 序列化 + 发送的平均耗时；
+// manual/prebuilt 对比 servlet 每次 addHeader 加 Server、格式化 Date 与服务器预编码的默认头部
+// ./http_response_bench [count] [body_size]
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void drain(int fd) {
+    char buf[64 * 1024];
+    while (::read(fd, buf, sizeof(buf)) > 0) {
+    }
+}
+
+static void bench(const std::string& name, bool direct, HttpSession* session,
+                  Servlet::SPtr servlet, int count,
+                  const HttpResponse::HeaderBlock* defaults = nullptr) {
+    HttpRequest req;
+    uint64_t copied = 0;
+    int64_t start = nowNs();
+    for (int i = 0; i < count; i++) {
+        HttpResponse rsp(0x11, true);
+        if (defaults) {
+            rsp.setDefaultHeaders(defaults);
+            rsp.setDate(HttpResponse::DateHeader());
+        }
+        servlet->handle(req, &rsp, *session);
+        if (direct) {
+            uint64_t written = session->getStats().bytesWritten;
+            session->sendResponse(&rsp);
+            // 只有头部编码进发送缓冲区，body 按引用发送
+            copied += session->getStats().bytesWritten - written - rsp.getBody().size();
+        } else {
+            std::stringstream ss;
+            rsp.dump(ss);
+            std::string data = ss.str();
+            session->write(data.data(), data.size());
+            // 格式化进 stringstream 一次，str() 再拷贝一次
+            copied += data.size() * 2;
+        }
+    }
+    int64_t cost = nowNs() - start;
+    LOG_INFO << name << " count=" << count << " copied/rsp=" << copied / count
+             << "B ns/rsp=" << cost / count;
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t bodySize = argc > 2 ? atoi(argv[2]) : 1024;
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        LOG_ERROR << "socketpair error=" << strerror(errno);
+        return 1;
+    }
+    // 读端由普通线程阻塞读，写端在协程中发送，发送缓冲区满时由 hook 挂起
+    Thread reader(std::bind(drain, fds[1]), "drain");
+    reader.start();
+
+    std::string body(bodySize, 'x');
+    Servlet::SPtr servlet(new FunctionServlet([&body](const HttpRequest& req,
+                                                      HttpResponse* rsp,
+                                                      const HttpSession& session) {
+        rsp->addHeader("Content-Type", "text/plain");
+        rsp->addHeader("Server", "reyao");
+        rsp->setBody(body);
+        return 0;
+    }));
+
+    Servlet::SPtr manual(new FunctionServlet([&body](const HttpRequest& req,
+                                                     HttpResponse* rsp,
+                                                     const HttpSession& session) {
+        char date[64];
+        time_t now = time(nullptr);
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        rsp->addHeader("Server", "reyao");
+        rsp->addHeader("Date", date);
+        rsp->addHeader("Content-Type", "text/plain");
+        rsp->setBody(body);
+        return 0;
+    }));
+    Servlet::SPtr prebuilt(new FunctionServlet([&body](const HttpRequest& req,
+                                                       HttpResponse* rsp,
+                                                       const HttpSession& session) {
+        rsp->setBody(body);
+        return 0;
+    }));
+    HttpResponse::HeaderBlock defaults;
+    defaults.add("Server", "reyao");
+    defaults.add("Content-Type", "text/plain");
+
+    // 默认头部被响应自己的同名头部覆盖，Date 在 Connection 之后
+    HttpResponse check(0x11, true);
+    check.setDefaultHeaders(&defaults);
+    check.setDate(HttpResponse::DateHeader());
+    check.addHeader("Content-Type", "text/html");
+    std::string encoded = check.toString();
+    assert(encoded.find("Connection: Keep-Alive\r\nDate: ") != std::string::npos);
+    assert(encoded.find("Server: reyao\r\n") != std::string::npos);
+    assert(encoded.find("text/plain") == std::string::npos);
+    assert(encoded.find("Content-Type: text/html\r\n") != std::string::npos);
+
+    Scheduler sh(2);
+    sh.startAsync();
+    sh.addTask([&]() {
+        g_fdmanager->addFd(fds[0]);
+        Socket::SPtr sock = Socket::CreateUnixStream();
+        sock->init(fds[0]);
+        HttpSession session(sock, false);
+        bench("stream", false, &session, servlet, count);
+        bench("direct", true, &session, servlet, count);
+        bench("manual", true, &session, manual, count);
+        bench("prebuilt", true, &session, prebuilt, count, &defaults);
+        sock->close();
+        sh.stop();
+    });
+    sh.wait();
+    reader.join();
+    ::close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "reyao/http/http_servlet.h"
+#include "reyao/mutex.h"
+#include "reyao/thread.h"
+
+#include <sys/time.h>
+#include <assert.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace reyao;
+
+// 1000 条路由（600 静态、300 参数、100 通配）下的单次匹配耗时：
+// 原来的 unordered_map + 线性 fnmatch 与路由树对比；
+// 多线程下对比 RWLock 与 RCU 路由表，以及运行中不断增删路由时的匹配
+// ./http_router_bench [count] [threads]
+
+static size_t s_allocs = 0;
+
+void* operator new(size_t size) {
+    ++s_allocs;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+static const int kStatic = 600;
+static const int kParam = 300;
+static const int kWildcard = 100;
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// 改造前 ServletDispatch::getMatchServlet 的做法
+class LegacyDispatch {
+public:
+    void addServlet(const std::string& uri, Servlet::SPtr servlet) {
+        servlets_[uri] = servlet;
+    }
+    void addGlobalServlet(const std::string& uri, Servlet::SPtr servlet) {
+        globals_.push_back(std::make_pair(uri, servlet));
+    }
+    Servlet::SPtr getMatchServlet(const std::string& uri) {
+        ReadLock lock(rwlock_);
+        auto it = servlets_.find(uri);
+        if (it != servlets_.end()) {
+            return it->second;
+        }
+        for (auto it = globals_.begin(); it != globals_.end(); it++) {
+            if (!fnmatch(it->first.c_str(), uri.c_str(), 0)) {
+                return it->second;
+            }
+        }
+        return default_;
+    }
+
+private:
+    std::unordered_map<std::string, Servlet::SPtr> servlets_;
+    std::vector<std::pair<std::string, Servlet::SPtr>> globals_;
+    Servlet::SPtr default_;
+    RWLock rwlock_;
+};
+
+static int32_t handler(const HttpRequest&, HttpResponse*, const HttpSession&) {
+    return 0;
+}
+
+static std::string num(int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", i);
+    return buf;
+}
+
+template <class Lookup>
+static void bench(const char* name, const std::vector<std::string>& paths,
+                  int count, Lookup lookup) {
+    int64_t start = nowUs();
+    size_t allocs = s_allocs;
+    for (int i = 0; i < count; i++) {
+        lookup(paths[i % paths.size()]);
+    }
+    int64_t cost = nowUs() - start;
+    printf("  %-10s %8.1fns/lookup allocs/lookup=%.2f\n", name,
+           cost * 1000.0 / count, (double)(s_allocs - allocs) / count);
+}
+
+// threads 个线程同时匹配，返回平均每次匹配的墙钟耗时
+template <class Lookup>
+static double concurrent(const std::vector<std::string>& paths, int count,
+                         int threads, Lookup lookup) {
+    std::vector<std::unique_ptr<Thread>> workers;
+    int64_t start = nowUs();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(new Thread([&, t]() {
+            for (int i = 0; i < count; i++) {
+                lookup(paths[(i + t) % paths.size()]);
+            }
+        }, "lookup"));
+        workers.back()->start();
+    }
+    for (auto& worker : workers) {
+        worker->join();
+    }
+    return (nowUs() - start) * 1000.0 / count;
+}
+
+// addServlet 和 addGlobalServlet 是两套路由，互不删除；前者优先，
+// 全局路由按注册顺序匹配，前缀模式和其余 fnmatch 模式一样
+static void testNamespaces() {
+    ServletDispatch dispatch;
+    Servlet::SPtr exact(new FunctionServlet(handler));
+    Servlet::SPtr tree(new FunctionServlet(handler));
+    Servlet::SPtr js(new FunctionServlet(handler));
+    Servlet::SPtr prefix(new FunctionServlet(handler));
+    Servlet::SPtr shadowed(new FunctionServlet(handler));
+    Servlet::SPtr longer(new FunctionServlet(handler));
+    Servlet::SPtr shorter(new FunctionServlet(handler));
+    Servlet::SPtr colon(new FunctionServlet(handler));
+    Servlet::SPtr all(new FunctionServlet(handler));
+    Servlet::SPtr def = dispatch.getDefault();
+
+    // 具体的模式在前，兜底的 "/*" 在最后
+    dispatch.addGlobalServlet("/a/*.js", js);
+    dispatch.addGlobalServlet("/a/*", prefix);
+    dispatch.addGlobalServlet("/a/b/*", shadowed);
+    dispatch.addGlobalServlet("/s/b/*", longer);
+    dispatch.addGlobalServlet("/s/*", shorter);
+    dispatch.addGlobalServlet("/c/:x/*", colon);
+    dispatch.addGlobalServlet("/*", all);
+    dispatch.addServlet("/a/exact", exact);
+    assert(dispatch.getMatchServlet("/a/exact") == exact);
+    assert(dispatch.getMatchServlet("/a/app.js") == js);
+    assert(dispatch.getMatchServlet("/a/b/app.js") == js);
+    assert(dispatch.getMatchServlet("/a/app.css") == prefix);
+    // "/a/b/*" 在 "/a/*" 之后注册，被它挡住
+    assert(dispatch.getMatchServlet("/a/b/app.css") == prefix);
+    assert(dispatch.getMatchServlet("/s/b/x") == longer);
+    assert(dispatch.getMatchServlet("/s/x") == shorter);
+    assert(dispatch.getMatchServlet("/other") == all);
+    assert(dispatch.getGlobalServlet("/a/exact") == prefix);
+    // 全局模式里的 ':' 是普通字符
+    assert(dispatch.getMatchServlet("/c/:x/y") == colon);
+    assert(dispatch.getMatchServlet("/c/1/y") == all);
+    // fnmatch 模式优先时不带前缀模式的 "*" 参数
+    RouteParams params;
+    assert(dispatch.getMatchServlet("/a/app.js", &params) == js);
+    assert(params.size == 0);
+    assert(dispatch.getMatchServlet("/a/app.css", &params) == prefix);
+    assert(params.size == 1 && params.get("*") == "app.css");
+
+    // 同一个 pattern 在两边各注册一份，删除只影响对应的一边
+    dispatch.addServlet("/a/*", tree);
+    assert(dispatch.getMatchServlet("/a/app.js") == tree);
+    dispatch.delServlet("/a/*");
+    assert(dispatch.getMatchServlet("/a/app.js") == js);
+    dispatch.delServlet("/a/*");
+    dispatch.delServlet("/a/b/*");
+    assert(dispatch.getGlobalServlet("/a/b/app.css") == prefix);
+    dispatch.delGlobalServlet("/a/exact");
+    assert(dispatch.getServlet("/a/exact") == exact);
+
+    // 删掉挡住它的模式后 "/a/b/*" 生效，重复注册的模式移到最后
+    dispatch.delGlobalServlet("/a/*");
+    assert(dispatch.getMatchServlet("/a/b/app.css") == shadowed);
+    assert(dispatch.getMatchServlet("/a/app.css") == all);
+    dispatch.addGlobalServlet("/a/*.js", js);
+    assert(dispatch.getMatchServlet("/a/b/app.js") == shadowed);
+    assert(dispatch.getMatchServlet("/a/app.js") == all);
+    dispatch.delGlobalServlet("/*");
+    assert(dispatch.getMatchServlet("/a/app.js") == js);
+    assert(dispatch.getMatchServlet("/other") == def);
+    dispatch.delGlobalServlet("/a/*.js");
+    assert(dispatch.getGlobalServlet("/a/app.js") == nullptr);
+    assert(dispatch.getMatchServlet("/a/exact") == exact);
+    printf("route namespaces ok\n");
+}
+
+int main(int argc, char** argv) {
+    testNamespaces();
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    LegacyDispatch legacy;
+    ServletDispatch dispatch;
+    Servlet::SPtr servlet(new FunctionServlet(handler));
+    int64_t start = nowUs();
+    for (int i = 0; i < kStatic; i++) {
+        // 每条静态路由一个 servlet，多线程时不会都去改同一个引用计数
+        std::string uri = "/api/v" + num(i % 3) + "/res" + num(i) + "/list";
+        Servlet::SPtr own(new FunctionServlet(handler));
+        legacy.addServlet(uri, own);
+        dispatch.addServlet(uri, own);
+    }
+    // 原来的实现只能用 fnmatch 表达参数段
+    for (int i = 0; i < kParam; i++) {
+        legacy.addGlobalServlet("/svc" + num(i) + "/*/detail", servlet);
+        dispatch.addServlet("/svc" + num(i) + "/:id/detail", servlet);
+    }
+    for (int i = 0; i < kWildcard; i++) {
+        std::string uri = "/static" + num(i) + "/*";
+        legacy.addGlobalServlet(uri, servlet);
+        dispatch.addGlobalServlet(uri, servlet);
+    }
+    int64_t buildCost = nowUs() - start;
+
+    std::vector<std::string> staticPaths, paramPaths, wildcardPaths, missPaths;
+    for (int i = 0; i < 64; i++) {
+        int r = rand();
+        staticPaths.push_back("/api/v" + num(r % kStatic % 3) + "/res" +
+                              num(r % kStatic) + "/list");
+        paramPaths.push_back("/svc" + num(r % kParam) + "/" + num(r) + "/detail");
+        wildcardPaths.push_back("/static" + num(r % kWildcard) + "/js/app" +
+                                num(r) + ".js");
+        missPaths.push_back("/unknown/" + num(r));
+    }
+
+    RouteParams params;
+    auto route = [&](const std::string& path) {
+        return dispatch.getMatchServlet(path, &params);
+    };
+    auto old = [&](const std::string& path) {
+        return legacy.getMatchServlet(path);
+    };
+
+    // 先检查结果
+    assert(route(paramPaths[0]) == servlet);
+    assert(params.size == 1 && params.get("id") == paramPaths[0].substr(
+           paramPaths[0].find('/', 1) + 1,
+           paramPaths[0].rfind('/') - paramPaths[0].find('/', 1) - 1));
+    assert(route(wildcardPaths[0]) == servlet);
+    assert(params.size == 1 && params.get("*").startsWith("js/app"));
+    assert(route(missPaths[0]) == dispatch.getDefault());
+
+    printf("routes=%d lookups=%d build=%ldms\n", kStatic + kParam + kWildcard,
+           count, buildCost / 1000);
+    const char* names[] = {"static", "param", "wildcard", "miss"};
+    std::vector<std::string>* groups[] = {&staticPaths, &paramPaths,
+                                          &wildcardPaths, &missPaths};
+    for (int i = 0; i < 4; i++) {
+        printf("%s:\n", names[i]);
+        bench("legacy", *groups[i], count, old);
+        bench("radix", *groups[i], count, route);
+    }
+
+    // 各线程命中不同的路由，只比较路由表本身的同步开销
+    printf("static, %d threads:\n", threads);
+    printf("  %-10s %8.1fns/lookup\n", "rwlock",
+           concurrent(staticPaths, count, threads, old));
+    auto lockFree = [&](const std::string& path) {
+        RouteParams local;
+        return dispatch.getMatchServlet(path, &local);
+    };
+    printf("  %-10s %8.1fns/lookup\n", "rcu",
+           concurrent(staticPaths, count, threads, lockFree));
+
+    // 热更新：写线程不停增删路由，读线程的匹配结果始终有效
+    Servlet::SPtr def = dispatch.getDefault();
+    std::atomic<bool> stop(false);
+    std::atomic<int> updates(0);
+    Thread writer([&]() {
+        while (!stop) {
+            dispatch.addServlet("/hot/:id", servlet);
+            dispatch.delServlet("/hot/:id");
+            ++updates;
+        }
+    }, "writer");
+    writer.start();
+    auto checked = [&](const std::string& path) {
+        RouteParams local;
+        auto s = dispatch.getMatchServlet(path, &local);
+        assert(s && s != def);
+        return s;
+    };
+    double cost = concurrent(staticPaths, count / 10, threads, checked);
+    stop = true;
+    writer.join();
+    printf("  %-10s %8.1fns/lookup updates=%d\n", "rcu+writer", cost, updates.load());
+    return 0;
+}
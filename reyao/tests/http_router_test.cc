@@ -0,0 +1,178 @@
+#include "reyao/http/http_router.h"
+#include "reyao/http/http_servlet.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <string>
+
+using namespace reyao;
+
+// RadixRouter 的匹配优先级、回溯、边拆分、参数冲突和删除
+// ./http_router_test
+
+static int32_t handler(const HttpRequest&, HttpResponse*, const HttpSession&) {
+    return 0;
+}
+
+static Servlet::SPtr makeServlet() {
+    return Servlet::SPtr(new FunctionServlet(handler));
+}
+
+static std::string param(const RouteParams& params, const char* name) {
+    return params.get(name).toString();
+}
+
+// 静态片段优先于同前缀的参数，静态分支走不通时回溯到参数
+static void testBacktrack() {
+    RadixRouter router;
+    Servlet::SPtr user = makeServlet();
+    Servlet::SPtr create = makeServlet();
+    Servlet::SPtr files = makeServlet();
+    assert(router.add("/users/:id/profile", user));
+    assert(router.add("/users/new", create));
+    assert(router.add("/users/*", files));
+
+    RouteParams params;
+    bool wildcard = true;
+    assert(router.match("/users/new", &params, &wildcard) == create);
+    assert(params.size == 0 && !wildcard);
+    assert(router.match("/users/42/profile", &params, &wildcard) == user);
+    assert(params.size == 1 && param(params, "id") == "42" && !wildcard);
+    // "new" 先进入静态分支，后面的 "/profile" 不匹配，回溯到 ":id"
+    assert(router.match("/users/new/profile", &params) == user);
+    assert(params.size == 1 && param(params, "id") == "new");
+    // 静态和参数都走不通，再回溯到 "*"，参数分支留下的捕获被撤销
+    assert(router.match("/users/42/avatar", &params, &wildcard) == files);
+    assert(params.size == 1 && param(params, "*") == "42/avatar" && wildcard);
+    assert(router.match("/users/newer", &params) == files);
+    assert(param(params, "*") == "newer");
+    printf("backtrack ok\n");
+}
+
+// 插入顺序导致已有的边被拆开后，原有路由仍然可以匹配和查找
+static void testEdgeSplit() {
+    RadixRouter router;
+    Servlet::SPtr users = makeServlet();
+    Servlet::SPtr uploads = makeServlet();
+    Servlet::SPtr api = makeServlet();
+    Servlet::SPtr root = makeServlet();
+    assert(router.add("/api/users", users));
+    assert(router.add("/api/uploads", uploads));    // 在 "/api/u" 处拆开
+    assert(router.add("/api", api));                // 在 "/api" 处再拆开
+    assert(router.add("/", root));
+    assert(router.size() == 4);
+
+    assert(router.match("/api/users", nullptr) == users);
+    assert(router.match("/api/uploads", nullptr) == uploads);
+    assert(router.match("/api", nullptr) == api);
+    assert(router.match("/", nullptr) == root);
+    assert(router.match("/api/u", nullptr) == nullptr);
+    assert(router.match("/api/", nullptr) == nullptr);
+    assert(router.match("/api/users/1", nullptr) == nullptr);
+    assert(router.find("/api/users") == users);
+    assert(router.find("/api/u") == nullptr);
+
+    // 重复注册替换 servlet，不增加计数
+    Servlet::SPtr users2 = makeServlet();
+    assert(router.add("/api/users", users2));
+    assert(router.size() == 4);
+    assert(router.match("/api/users", nullptr) == users2);
+    printf("edge split ok\n");
+}
+
+// 同一位置的参数名必须一致，'*' 只能在结尾
+static void testInvalidPatterns() {
+    RadixRouter router;
+    Servlet::SPtr byId = makeServlet();
+    assert(router.add("/u/:id", byId));
+    assert(!router.add("/u/:name/posts", makeServlet()));
+    assert(router.add("/u/:id/posts", makeServlet()));
+    assert(!router.add("/u/:/x", makeServlet()));
+    assert(!router.add("/a/*/b", makeServlet()));
+    assert(!RadixRouter::IsRoutable("/a/*/b"));
+    assert(!RadixRouter::IsRoutable("/a/?"));
+    assert(RadixRouter::IsRoutable("/a/:id/*"));
+    assert(router.size() == 2);
+
+    RouteParams params;
+    assert(router.match("/u/7", &params) == byId);
+    assert(param(params, "id") == "7");
+    assert(router.find("/u/:name") == nullptr);
+    printf("invalid patterns ok\n");
+}
+
+// 参数段不能为空
+static void testEmptyParam() {
+    RadixRouter router;
+    Servlet::SPtr byId = makeServlet();
+    Servlet::SPtr posts = makeServlet();
+    assert(router.add("/u/:id", byId));
+    assert(router.add("/u/:id/posts", posts));
+
+    RouteParams params;
+    assert(router.match("/u/", &params) == nullptr);
+    assert(params.size == 0);
+    assert(router.match("/u//posts", &params) == nullptr);
+    assert(router.match("/u/1/posts", &params) == posts);
+    assert(param(params, "id") == "1");
+    printf("empty param ok\n");
+}
+
+// remove 只摘掉 servlet，拆开的边和其他路由不受影响
+static void testRemove() {
+    RadixRouter router;
+    Servlet::SPtr users = makeServlet();
+    Servlet::SPtr uploads = makeServlet();
+    Servlet::SPtr byId = makeServlet();
+    assert(router.add("/api/users", users));
+    assert(router.add("/api/uploads", uploads));
+    assert(router.add("/api/users/:id", byId));
+
+    assert(router.remove("/api/users"));
+    assert(router.size() == 2);
+    assert(router.find("/api/users") == nullptr);
+    assert(router.match("/api/users", nullptr) == nullptr);
+    assert(!router.remove("/api/users"));
+    assert(!router.remove("/api/u"));
+    assert(!router.remove("/api/users/:name"));
+    assert(router.find("/api/uploads") == uploads);
+    assert(router.find("/api/users/:id") == byId);
+    assert(router.match("/api/users/3", nullptr) == byId);
+
+    // 删除后可以重新注册
+    assert(router.add("/api/users", users));
+    assert(router.size() == 3);
+    assert(router.match("/api/users", nullptr) == users);
+    printf("remove ok\n");
+}
+
+// 结尾的 '*' 可以匹配空串
+static void testEmptyWildcard() {
+    RadixRouter router;
+    Servlet::SPtr files = makeServlet();
+    assert(router.add("/static/*", files));
+
+    RouteParams params;
+    bool wildcard = false;
+    assert(router.match("/static/", &params, &wildcard) == files);
+    assert(wildcard && params.size == 1 && params.get("*").empty());
+    assert(router.match("/static", &params, &wildcard) == nullptr);
+    assert(!wildcard);
+    assert(router.match("/static/a/b", &params) == files);
+    assert(param(params, "*") == "a/b");
+    assert(router.find("/static/*") == files);
+    assert(router.find("/static/") == nullptr);
+    printf("empty wildcard ok\n");
+}
+
+int main(int argc, char** argv) {
+    testBacktrack();
+    testEdgeSplit();
+    testInvalidPatterns();
+    testEmptyParam();
+    testRemove();
+    testEmptyWildcard();
+    printf("http router test passed\n");
+    return 0;
+}
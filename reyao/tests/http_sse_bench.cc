@@ -0,0 +1,186 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_sse.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using namespace reyao;
+
+// SSE 广播：N 个订阅者、M 个事件的投递速率（事件/秒），以及不读数据的慢消费者被断开
+// ./http_sse_bench [subscribers] [events] [event_size]
+
+static const int kPort = 8020;
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int subscribe(const std::string& path, int rcvbuf = 0) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    assert(::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    std::string req = "GET " + path + " HTTP/1.1\r\nConnection: Keep-Alive\r\n\r\n";
+    assert(::send(fd, req.data(), req.size(), 0) == (ssize_t)req.size());
+    // 只读头部，头部之后还没有事件
+    std::string header;
+    char c;
+    while (header.size() < 4 || header.compare(header.size() - 4, 4, "\r\n\r\n") != 0) {
+        assert(::recv(fd, &c, 1, 0) == 1);
+        header.push_back(c);
+    }
+    assert(header.find("text/event-stream") != std::string::npos);
+    assert(header.find("Transfer-Encoding: chunked") != std::string::npos);
+    return fd;
+}
+
+template <class Cond>
+static void waitUntil(Cond cond) {
+    for (int i = 0; i < 10000 && !cond(); i++) {
+        usleep(1000);
+    }
+    assert(cond());
+}
+
+static void client(SseHub* hub, int subscribers, int events, size_t eventSize) {
+    // 事件格式检查
+    int fd = subscribe("/events/check");
+    waitUntil([hub]() { return hub->getSubscriberCount() == 1; });
+    hub->publish("check", "a\nb", "tick", "7");
+    const char expect[] = "23\r\nid: 7\nevent: tick\ndata: a\ndata: b\n\n\r\n";
+    char buf[64 * 1024];
+    std::string got;
+    while (got.size() < sizeof(expect) - 1) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        got.append(buf, n);
+    }
+    assert(got == expect);
+    // 单独的 CR 和 CRLF 都按换行拆开
+    hub->publish("check", "a\r\nb\rc");
+    const char expectCr[] = "19\r\ndata: a\ndata: b\ndata: c\n\n\r\n";
+    got.clear();
+    while (got.size() < sizeof(expectCr) - 1) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n > 0);
+        got.append(buf, n);
+    }
+    assert(got == expectCr);
+    ::close(fd);
+    waitUntil([hub]() { return hub->getSubscriberCount() == 0; });
+    // 最后一个订阅者离开后 topic 被移除，不再投递
+    assert(hub->publish("check", "x") == 0);
+
+    // 慢消费者：接收缓冲区很小且从不读
+    int slow = subscribe("/events/slow", 4096);
+    std::vector<int> fds;
+    for (int i = 0; i < subscribers; i++) {
+        fds.push_back(subscribe("/events/news"));
+    }
+    waitUntil([hub, subscribers]() { return hub->getSubscriberCount() == subscribers + 1; });
+
+    int ep = epoll_create1(0);
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    std::string data(eventSize, 'x');
+    // 每个订阅者收到的字节数：chunk 头 + "data: " + 数据 + "\n\n" + "\r\n"
+    char size[16];
+    int sizeLen = snprintf(size, sizeof(size), "%zx\r\n", eventSize + 8);
+    uint64_t expectBytes = (uint64_t)subscribers * events * (sizeLen + eventSize + 10);
+    uint64_t bytes = 0;
+    int64_t start = nowUs();
+    int published = 0;
+    epoll_event evs[256];
+    while (bytes < expectBytes) {
+        // 边发布边读，发布速度受读的速度限制，正常订阅者不会被当成慢消费者
+        if (published < events &&
+            (published < 16 || bytes * events >= expectBytes * (published - 16))) {
+            hub->publish("news", data);
+            published++;
+            continue;
+        }
+        int n = epoll_wait(ep, evs, 256, 1000);
+        assert(n > 0);
+        for (int i = 0; i < n; i++) {
+            ssize_t r;
+            while ((r = ::recv(evs[i].data.fd, buf, sizeof(buf), 0)) > 0) {
+                bytes += r;
+            }
+        }
+    }
+    int64_t cost = nowUs() - start;
+    assert(bytes == expectBytes);
+
+    // 慢消费者：内核缓冲区写满之后事件排在队列里，超过上限后被断开
+    std::string big(64 * 1024, 'y');
+    for (int i = 0; i < 1000 && hub->getStats().disconnected == 0; i++) {
+        hub->publish("slow", big);
+        usleep(100);
+    }
+    waitUntil([hub]() { return hub->getStats().disconnected == 1; });
+    auto stats = hub->getStats();
+    printf("%d subscribers x %d events of %zuB: %.0f deliveries/s, %.1f MB/s, %.1fus/event\n",
+           subscribers, events, eventSize, (double)subscribers * events * 1000000 / cost,
+           bytes / (cost / 1000000.0) / 1024 / 1024, (double)cost / events);
+    printf("published=%lu delivered=%lu dropped=%lu disconnected=%lu subscribers=%ld\n",
+           stats.published, stats.delivered, stats.dropped, stats.disconnected,
+           stats.subscribers);
+
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    ::close(slow);
+    ::close(ep);
+    waitUntil([hub]() { return hub->getSubscriberCount() == 0; });
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::ERROR);
+    int subscribers = argc > 1 ? atoi(argv[1]) : 2000;
+    int events = argc > 2 ? atoi(argv[2]) : 500;
+    size_t eventSize = argc > 3 ? atoi(argv[3]) : 4096;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    SseHub::Options options;
+    options.maxQueue = 64;
+    SseHub::SPtr hub = std::make_shared<SseHub>(options);
+    server.getDispatch()->addServlet("/events/:topic", std::make_shared<SseServlet>(hub));
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, hub.get(), subscribers, events, eventSize), "sse_client");
+    thread.start();
+    thread.join();
+    printf("sse bench passed\n");
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,212 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_static_servlet.h"
+#include "reyao/thread.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+using namespace reyao;
+
+// 1KB 和 10MB 文件的 requests/s：每次 ReadFile 与 StaticFileServlet（sendfile / 内存层）对比，
+// 并检查 304、206、416 的响应
+// ./http_static_bench [count]
+
+static const int kPort = 8016;
+static const char kDir[] = "/tmp/reyao_static_bench";
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+struct Response {
+    int status = 0;
+    std::string header;
+    size_t bodySize = 0;
+    std::string body;       // 只保留前 1KB 用于检查
+};
+
+static int connectServer() {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static std::string headerValue(const std::string& header, const char* key) {
+    std::string k = std::string("\r\n") + key + ": ";
+    size_t pos = header.find(k);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += k.size();
+    return header.substr(pos, header.find("\r\n", pos) - pos);
+}
+
+// 在阻塞 socket 上发一个 keep-alive 请求并读完响应
+static bool request(int fd, const std::string& path, const std::string& extra,
+                    Response* rsp) {
+    std::string req = "GET " + path + " HTTP/1.1\r\n"
+                      "Connection: Keep-Alive\r\n" + extra + "\r\n";
+    if (::send(fd, req.data(), req.size(), 0) != (ssize_t)req.size()) {
+        return false;
+    }
+    static thread_local char buf[64 * 1024];
+    std::string data;
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        data.append(buf, n);
+    }
+    rsp->header = data.substr(0, end + 2);
+    rsp->status = atoi(data.c_str() + 9);
+    size_t length = atol(headerValue(rsp->header, "Content-Length").c_str());
+    size_t got = data.size() - end - 4;
+    rsp->body = data.substr(end + 4, 1024);
+    while (got < length) {
+        ssize_t n = ::recv(fd, buf, std::min(sizeof(buf), length - got), 0);
+        if (n <= 0) {
+            return false;
+        }
+        if (rsp->body.size() < 1024) {
+            rsp->body.append(buf, std::min<size_t>(n, 1024 - rsp->body.size()));
+        }
+        got += n;
+    }
+    rsp->bodySize = got;
+    return got == length;
+}
+
+static void writeFile(const std::string& path, size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        data[i] = 'a' + i % 26;
+    }
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(data.data(), data.size());
+}
+
+static void check(int fd) {
+    Response rsp;
+    assert(request(fd, "/static/small.bin", "", &rsp));
+    assert(rsp.status == 200 && rsp.bodySize == 1024 && rsp.body.compare(0, 3, "abc") == 0);
+    std::string etag = headerValue(rsp.header, "ETag");
+    std::string lastModified = headerValue(rsp.header, "Last-Modified");
+    assert(!etag.empty() && !lastModified.empty());
+
+    assert(request(fd, "/static/small.bin", "If-None-Match: " + etag + "\r\n", &rsp));
+    assert(rsp.status == 304 && rsp.bodySize == 0);
+    assert(request(fd, "/static/small.bin", "If-Modified-Since: " + lastModified + "\r\n", &rsp));
+    assert(rsp.status == 304);
+
+    assert(request(fd, "/static/big.bin", "Range: bytes=26-51\r\n", &rsp));
+    assert(rsp.status == 206 && rsp.body == "abcdefghijklmnopqrstuvwxyz");
+    assert(headerValue(rsp.header, "Content-Range") == "bytes 26-51/10485760");
+    assert(request(fd, "/mem/small.bin", "Range: bytes=-2\r\n", &rsp));
+    assert(rsp.status == 206 && rsp.body == "ij");
+    assert(request(fd, "/static/small.bin", "Range: bytes=4096-\r\n", &rsp));
+    assert(rsp.status == 416);
+    // If-Range 不匹配时返回完整文件
+    assert(request(fd, "/static/small.bin", "Range: bytes=0-9\r\nIf-Range: \"old\"\r\n", &rsp));
+    assert(rsp.status == 200 && rsp.bodySize == 1024);
+
+    assert(request(fd, "/static/../etc/passwd", "", &rsp));
+    assert(rsp.status == 404);
+    assert(request(fd, "/static/none.bin", "", &rsp));
+    assert(rsp.status == 404);
+}
+
+static void bench(int fd, const char* name, const std::string& path, int count) {
+    Response rsp;
+    int64_t start = nowUs();
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        if (!request(fd, path, "", &rsp) || rsp.status != 200) {
+            LOG_ERROR << name << " request " << path << " fail";
+            return;
+        }
+        bytes += rsp.bodySize;
+    }
+    double sec = (nowUs() - start) / 1000000.0;
+    printf("  %-10s %10.0f req/s %10.1f MB/s\n", name, count / sec,
+           bytes / sec / 1024 / 1024);
+}
+
+static void client(int count) {
+    int fd = connectServer();
+    assert(fd >= 0);
+    check(fd);
+    const char* files[] = {"small.bin", "big.bin"};
+    const char* names[] = {"1KB", "10MB"};
+    for (int i = 0; i < 2; i++) {
+        // 10MB 的请求次数少一些
+        int n = i == 0 ? count : std::max(count / 200, 10);
+        printf("%s x %d:\n", names[i], n);
+        bench(fd, "readfile", std::string("/read/") + files[i], n);
+        bench(fd, "sendfile", std::string("/static/") + files[i], n);
+        bench(fd, "memory", std::string("/mem/") + files[i], n);
+    }
+    fflush(stdout);
+    ::close(fd);
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::WARN);
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+
+    mkdir(kDir, 0755);
+    writeFile(std::string(kDir) + "/small.bin", 1024);
+    writeFile(std::string(kDir) + "/big.bin", 10 * 1024 * 1024);
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    auto dispatch = server.getDispatch();
+    // 改造前的做法：每个请求读一次文件
+    dispatch->addServlet("/read/*", [](const HttpRequest& req,
+                                       HttpResponse* rsp,
+                                       const HttpSession& session) {
+        rsp->setBody(ReadFile(std::string(kDir) + "/" +
+                              req.getRouteParam("*").toString()));
+        return 0;
+    });
+    dispatch->addServlet("/static/*", std::make_shared<StaticFileServlet>(kDir));
+    StaticFileServlet::Options options;
+    options.maxMemoryFileSize = 16 * 1024 * 1024;
+    auto memory = std::make_shared<StaticFileServlet>(kDir, options);
+    dispatch->addServlet("/mem/*", memory);
+    server.start();
+    usleep(100 * 1000);
+
+    Thread thread(std::bind(client, count), "static_client");
+    thread.start();
+    thread.join();
+
+    auto stats = memory->getStats();
+    printf("memory tier: files=%zu memory=%zuKB hits=%lu misses=%lu\n",
+           stats.files, stats.memorySize / 1024, stats.hits, stats.misses);
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,103 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_client.h"
+#include "reyao/connection_pool.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <assert.h>
+#include <stdlib.h>
+
+using namespace reyao;
+
+// 流式响应：未知长度用 chunked，已知长度用 Content-Length，
+// 大响应边生成边发送，记录首字节时间和总时间
+// ./http_stream_test [chunks]
+
+static const size_t kChunkSize = 16 * 1024;
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int chunks = argc > 1 ? atoi(argv[1]) : 1024;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", 8014);
+    HttpServer server(&sh, addr, true);
+    // 每次只在内存中保留一个 chunk
+    server.getDispatch()->addServlet("/export", [chunks](const HttpRequest& req,
+                                                         HttpResponse* rsp,
+                                                         const HttpSession& session) {
+        rsp->addHeader("Content-Type", "text/csv");
+        rsp->beginStream();
+        std::string chunk(kChunkSize, 'x');
+        for (int i = 0; i < chunks; i++) {
+            chunk[0] = 'a' + i % 26;
+            if (!rsp->write(chunk)) {
+                break;
+            }
+        }
+        return 0;
+    });
+    server.getDispatch()->addServlet("/fixed", [](const HttpRequest& req,
+                                                  HttpResponse* rsp,
+                                                  const HttpSession& session) {
+        rsp->beginStream(10);
+        rsp->write(StringPiece("hello"));
+        rsp->write(StringPiece("world"));
+        rsp->endStream();
+        return 0;
+    });
+    server.start();
+
+    auto pool = std::make_shared<ConnectionPool>(&sh);
+    HttpClient client(addr, pool);
+    sh.addTimer(100, [&]() {
+        auto rsp = client.get("/fixed");
+        assert(rsp && rsp->getBody() == "helloworld");
+        assert(rsp->getHeader("Content-Length") == "10");
+
+        int64_t start = nowUs();
+        rsp = client.get("/export");
+        int64_t cost = nowUs() - start;
+        assert(rsp && rsp->getBody().size() == kChunkSize * chunks);
+        assert(rsp->getHeader("Transfer-Encoding") == "chunked");
+        assert(rsp->getBody()[kChunkSize] == 'b');
+        LOG_INFO << "chunked body=" << rsp->getBody().size() << " cost=" << cost << "us";
+
+        // chunked 响应结束后连接可以继续复用
+        rsp = client.get("/fixed");
+        assert(rsp && rsp->getBody() == "helloworld");
+        auto stats = pool->getStats();
+        LOG_INFO << "created=" << stats.created << " reused=" << stats.reused;
+        assert(stats.created == 1);
+
+        // 首字节时间：只读到响应头就返回
+        Socket::SPtr sock = Socket::CreateTcp();
+        sock->connect(*addr);
+        std::string request = "GET /export HTTP/1.1\r\n\r\n";
+        start = nowUs();
+        sock->send(request.data(), request.size());
+        char buf[64 * 1024];
+        int n = sock->recv(buf, sizeof(buf));
+        int64_t ttfb = nowUs() - start;
+        size_t total = n > 0 ? n : 0;
+        while (n > 0) {
+            n = sock->recv(buf, sizeof(buf));
+            total += n > 0 ? n : 0;
+        }
+        LOG_INFO << "ttfb=" << ttfb << "us total=" << nowUs() - start
+                 << "us bytes=" << total;
+        sock->close();
+
+        pool->stop();
+        sh.stop();
+    });
+    sh.wait();
+    return 0;
+}
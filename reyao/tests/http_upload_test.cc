@@ -0,0 +1,155 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_client.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace reyao;
+
+// 流式上传：servlet 边读 body 边写文件，body 不在内存中缓冲；
+// 缓冲模式超过限制时回复 413，头部过大时回复 431
+// ./http_upload_test [size_mb]
+
+static const char kUploadFile[] = "/tmp/reyao_upload_test";
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static std::string rawRequest(Address::SPtr addr, const std::string& data,
+                              bool waitContinue = false,
+                              const std::string& body = "") {
+    Socket::SPtr sock = Socket::CreateTcp();
+    sock->connect(*addr);
+    sock->send(data.data(), data.size());
+    char buf[4096];
+    std::string rsp;
+    if (waitContinue) {
+        int n = sock->recv(buf, sizeof(buf));
+        assert(n > 0);
+        rsp.assign(buf, n);
+        assert(rsp.find("100 Continue") != std::string::npos);
+        sock->send(body.data(), body.size());
+        rsp.clear();
+    }
+    int n = 0;
+    while ((n = sock->recv(buf, sizeof(buf))) > 0) {
+        rsp.append(buf, n);
+        if (rsp.find("\r\n\r\n") != std::string::npos) {
+            break;
+        }
+    }
+    sock->close();
+    return rsp;
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    size_t size = (argc > 1 ? atoi(argv[1]) : 16) * 1024 * 1024;
+
+    Scheduler sh(2);
+    sh.startAsync();
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", 8015);
+    HttpServer server(&sh, addr, true);
+    HttpLimits limits;
+    limits.maxHeaderSize = 1024;
+    limits.maxBodySize = 64 * 1024;
+    server.setLimits(limits);
+
+    Servlet::SPtr upload(new FunctionServlet([](const HttpRequest& req,
+                                                HttpResponse* rsp,
+                                                const HttpSession& session) {
+        int fd = ::open(kUploadFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        char buf[64 * 1024];
+        size_t total = 0;
+        int n = 0;
+        while ((n = req.getBodyReader()->read(buf, sizeof(buf))) > 0) {
+            ::write(fd, buf, n);
+            total += n;
+        }
+        ::close(fd);
+        rsp->setBody(std::to_string(n < 0 ? -1 : (int64_t)total));
+        return 0;
+    }));
+    upload->setStreamBody(true);
+    server.getDispatch()->addServlet("/upload", upload);
+    server.getDispatch()->addServlet("/echo", [](const HttpRequest& req,
+                                                 HttpResponse* rsp,
+                                                 const HttpSession& session) {
+        rsp->setBody(req.getBody().toString());
+        return 0;
+    });
+    server.start();
+
+    HttpClient client(addr);
+    sh.addTimer(100, [&]() {
+        std::string body(size, 'x');
+        body[size - 1] = 'y';
+        int64_t start = nowUs();
+        auto rsp = client.post("/upload", body);
+        assert(rsp && rsp->getBody() == std::to_string(size));
+        LOG_INFO << "upload " << size << " bytes cost=" << nowUs() - start << "us";
+        std::string saved = ReadFile(kUploadFile);
+        assert(saved == body);
+        ::unlink(kUploadFile);
+
+        // chunked 上传，并且带 Expect: 100-continue
+        std::string chunked = "POST /upload HTTP/1.1\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "Expect: 100-continue\r\n\r\n";
+        std::string chunks = "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\n\r\n";
+        std::string res = rawRequest(addr, chunked, true, chunks);
+        assert(res.find("\r\n\r\n11") != std::string::npos);
+        assert(ReadFile(kUploadFile) == "hello world");
+        ::unlink(kUploadFile);
+
+        // 缓冲模式小 body 正常，超过 maxBodySize 返回 413
+        rsp = client.post("/echo", "ping");
+        assert(rsp && rsp->getBody() == "ping");
+        rsp = client.post("/echo", std::string(limits.maxBodySize + 1, 'x'));
+        assert(rsp && rsp->getStatus() == HttpStatus::PAYLOAD_TOO_LARGE);
+
+        // chunked 在读到大小行时就检查上限，超过 32 位的大小不会被截断，
+        // 非法的大小和 chunk 数据后缺少 CRLF 返回 400
+        std::string echoChunked = "POST /echo HTTP/1.1\r\n"
+                                  "Transfer-Encoding: chunked\r\n\r\n";
+        res = rawRequest(addr, echoChunked + "3\r\nabc\r\n0\r\n\r\n");
+        assert(res.find("200") != std::string::npos);
+        res = rawRequest(addr, echoChunked + "fffffff\r\n");
+        assert(res.find("413") != std::string::npos);
+        res = rawRequest(addr, echoChunked + "100000000\r\n0\r\n\r\n");
+        assert(res.find("413") != std::string::npos);
+        res = rawRequest(addr, echoChunked + "10000000000000000\r\n");
+        assert(res.find("400") != std::string::npos);
+        res = rawRequest(addr, echoChunked + "-1\r\n");
+        assert(res.find("400") != std::string::npos);
+        res = rawRequest(addr, echoChunked + "3\r\nabcd\r\n0\r\n\r\n");
+        assert(res.find("400") != std::string::npos);
+
+        // Content-Length 溢出或重复且不同时返回 400，重复且相同时正常处理
+        res = rawRequest(addr, "POST /echo HTTP/1.1\r\n"
+                         "Content-Length: 18446744073709551617\r\n\r\n");
+        assert(res.find("400") != std::string::npos);
+        res = rawRequest(addr, "POST /echo HTTP/1.1\r\nContent-Length: 3\r\n"
+                         "Content-Length: 30\r\n\r\nabc");
+        assert(res.find("400") != std::string::npos);
+        res = rawRequest(addr, "POST /echo HTTP/1.1\r\nContent-Length: 3\r\n"
+                         "Content-Length: 3\r\n\r\nabc");
+        assert(res.find("200") != std::string::npos);
+
+        res = rawRequest(addr, "GET /echo HTTP/1.1\r\nX-Big: " +
+                         std::string(2048, 'x') + "\r\n\r\n");
+        assert(res.find("431") != std::string::npos);
+        LOG_INFO << "limits ok";
+        sh.stop();
+    });
+    sh.wait();
+    return 0;
+}
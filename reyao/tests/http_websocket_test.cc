@@ -0,0 +1,230 @@
+#include "reyao/http/http_server.h"
+#include "reyao/http/http_websocket.h"
+#include "reyao/util.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+using namespace reyao;
+
+// WebSocket：帧编解码和掩码的正确性、逐字节与按字/SSE2 去掩码的速度，
+// 升级、回显、分片、ping/pong、握手后紧跟的帧、close，以及与 HTTP keep-alive 的往返耗时对比
+// ./http_websocket_test [count]
+
+static const int kPort = 8021;
+static std::atomic<bool> s_done(false);
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void maskBytewise(char* data, size_t len, const uint8_t* mask) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] ^= mask[i % 4];
+    }
+}
+
+static void testCodec() {
+    // RFC 6455 1.3 的示例
+    assert(WsCodec::AcceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    assert(Base64Encode("ab", 2) == "YWI=");
+
+    const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::string src(1000, '\0');
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = i * 7;
+    }
+    // 任意起点和长度分段去掩码，结果与逐字节一致
+    for (size_t off = 0; off < 40; off++) {
+        for (size_t len = 0; off + len <= 200; len += 13) {
+            std::string a = src, b = src;
+            maskBytewise(&a[0], a.size(), mask);
+            WsCodec::Mask(&b[0], off, mask);
+            WsCodec::Mask(&b[off], len, mask, off);
+            WsCodec::Mask(&b[off + len], b.size() - off - len, mask, off + len);
+            assert(a == b);
+        }
+    }
+
+    char buf[WsCodec::kMaxHeaderSize];
+    uint64_t lens[] = {0, 125, 126, 65535, 65536, 1ULL << 40};
+    for (uint64_t len : lens) {
+        for (int masked = 0; masked < 2; masked++) {
+            size_t n = WsCodec::EncodeHeader(buf, false, WsOpcode::BINARY, len,
+                                             masked ? mask : nullptr);
+            WsFrameHeader header;
+            assert(WsCodec::ParseHeader(buf, n - 1, &header) == 0);
+            assert(WsCodec::ParseHeader(buf, n, &header) == (int)n);
+            assert(!header.fin && header.opcode == WsOpcode::BINARY);
+            assert(header.payloadLen == len && header.masked == (bool)masked);
+        }
+    }
+    // 分片的控制帧不合法
+    WsCodec::EncodeHeader(buf, false, WsOpcode::PING, 0);
+    WsFrameHeader header;
+    assert(WsCodec::ParseHeader(buf, 2, &header) == -1);
+
+    std::string data(1024 * 1024, 'x');
+    const int rounds = 200;
+    int64_t start = nowUs();
+    for (int i = 0; i < rounds; i++) {
+        maskBytewise(&data[0], data.size(), mask);
+    }
+    int64_t bytewise = nowUs() - start;
+    start = nowUs();
+    for (int i = 0; i < rounds; i++) {
+        WsCodec::Mask(&data[0], data.size(), mask);
+    }
+    int64_t wide = nowUs() - start;
+    printf("unmask 1MB: bytewise %.0f MB/s, WsCodec::Mask %.0f MB/s\n",
+           rounds * 1e6 / bytewise, rounds * 1e6 / wide);
+}
+
+// 在同一个连接上发 keep-alive 请求并读完响应，返回 body
+static std::string httpGet(Socket::SPtr sock, const std::string& path) {
+    std::string req = "GET " + path + " HTTP/1.1\r\nConnection: Keep-Alive\r\n\r\n";
+    assert(sock->send(req.data(), req.size()) == (int)req.size());
+    std::string data;
+    char buf[4096];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        int n = sock->recv(buf, sizeof(buf));
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    size_t pos = data.find("Content-Length: ");
+    size_t length = pos == std::string::npos ? 0 : atol(data.c_str() + pos + 16);
+    while (data.size() < end + 4 + length) {
+        int n = sock->recv(buf, sizeof(buf));
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    return data.substr(0, 12) + data.substr(end + 4);
+}
+
+static void client(int count) {
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", kPort);
+    WebSocket::SPtr ws = WebSocket::Connect(addr, "/ws");
+    assert(ws);
+    std::string msg;
+    WsOpcode opcode;
+
+    assert(ws->sendMessage("hello"));
+    assert(ws->recvMessage(&msg, &opcode) && msg == "hello" && opcode == WsOpcode::TEXT);
+    // 16 位和 64 位长度
+    for (size_t size : {1000, 100 * 1000}) {
+        std::string big(size, 'b');
+        assert(ws->sendMessage(big, WsOpcode::BINARY));
+        assert(ws->recvMessage(&msg, &opcode) && msg == big && opcode == WsOpcode::BINARY);
+    }
+    // 分片，中间夹一个 ping
+    assert(ws->sendFrame("frag", WsOpcode::TEXT, false));
+    assert(ws->ping("p"));
+    assert(ws->sendFrame("ment", WsOpcode::CONTINUATION, false));
+    assert(ws->sendFrame("ed", WsOpcode::CONTINUATION, true));
+    assert(ws->recvMessage(&msg) && msg == "fragmented");
+    // 服务端发 ping，recvMessage 自动回 pong
+    assert(ws->sendMessage("ping-me"));
+    assert(ws->recvMessage(&msg) && msg == "pinged");
+
+    // 握手请求后面紧跟一个帧，升级后不能丢
+    Socket::SPtr raw = Socket::CreateTcp();
+    assert(raw->connect(*addr));
+    std::string req = "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n"
+                      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    const uint8_t mask[4] = {1, 2, 3, 4};
+    char frame[64];
+    size_t n = WsCodec::EncodeHeader(frame, true, WsOpcode::TEXT, 5, mask);
+    memcpy(frame + n, "early", 5);
+    WsCodec::Mask(frame + n, 5, mask);
+    req.append(frame, n + 5);
+    assert(raw->send(req.data(), req.size()) == (int)req.size());
+    std::string data;
+    char buf[1024];
+    while (data.find("\r\n\r\n") == std::string::npos) {
+        int r = raw->recv(buf, sizeof(buf));
+        assert(r > 0);
+        data.append(buf, r);
+    }
+    assert(data.find("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\n") == 0);
+    assert(data.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos);
+    WebSocket early(raw, true, data.substr(data.find("\r\n\r\n") + 4), true);
+    assert(early.recvMessage(&msg) && msg == "early");
+    early.sendClose();
+    assert(!early.recvMessage(&msg) && early.getCloseCode() == 1000);
+
+    // 不是升级请求
+    Socket::SPtr http = Socket::CreateTcp();
+    assert(http->connect(*addr));
+    assert(httpGet(http, "/ws").compare(0, 12, "HTTP/1.1 400") == 0);
+
+    // 往返耗时：WebSocket 消息与 HTTP keep-alive 请求
+    int64_t start = nowUs();
+    for (int i = 0; i < count; i++) {
+        ws->sendMessage("tick");
+        ws->recvMessage(&msg);
+    }
+    int64_t wsCost = nowUs() - start;
+    http = Socket::CreateTcp();
+    assert(http->connect(*addr));
+    start = nowUs();
+    for (int i = 0; i < count; i++) {
+        assert(httpGet(http, "/echo").compare(12, 4, "tick") == 0);
+    }
+    int64_t httpCost = nowUs() - start;
+    printf("round trip x %d: websocket %.1fus, http keep-alive %.1fus\n", count,
+           (double)wsCost / count, (double)httpCost / count);
+
+    ws->sendClose(1000, "bye");
+    assert(!ws->recvMessage(&msg) && ws->getCloseCode() == 1000);
+    s_done = true;
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::ERROR);
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    testCodec();
+
+    Scheduler sh(2);
+    sh.startAsync();
+    HttpServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", kPort), true);
+    auto dispatch = server.getDispatch();
+    dispatch->addServlet("/ws", std::make_shared<WebSocketServlet>(
+                         [](const HttpRequest& req, WebSocket::SPtr ws) {
+        std::string msg;
+        WsOpcode opcode;
+        while (ws->recvMessage(&msg, &opcode)) {
+            if (msg == "ping-me") {
+                ws->ping("x");
+                msg = "pinged";
+            }
+            ws->sendMessage(msg, opcode);
+        }
+    }));
+    dispatch->addServlet("/echo", [](const HttpRequest& req,
+                                     HttpResponse* rsp,
+                                     const HttpSession& session) {
+        rsp->setBody("tick");
+        return 0;
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    sh.addTask(std::bind(client, count));
+    while (!s_done) {
+        usleep(10 * 1000);
+    }
+    printf("websocket test passed\n");
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,133 @@
+#include "reyao/rpc/rpc_server.h"
+#include "reyao/rpc/rpc_client.h"
+#include "reyao/rpc/codec.h"
+#include "reyao/log.h"
+
+#include "echo.pb.h"
+
+#include <netinet/tcp.h>
+#include <assert.h>
+#include <unistd.h>
+
+using namespace reyao;
+using namespace reyao::rpc;
+using namespace echo;
+
+// 同一连接上连续的请求、跨多次 read 到达的消息都能正确拆包，
+// 连接池借出的连接可以被后续调用复用
+// ./rpc_codec_test
+
+static MessageSPtr Echo(std::shared_ptr<EchoRequest> req) {
+    std::shared_ptr<EchoResponse> rsp(new EchoResponse);
+    rsp->set_msg(req->msg());
+    return rsp;
+}
+
+static std::shared_ptr<EchoRequest> makeRequest(const std::string& msg) {
+    std::shared_ptr<EchoRequest> req(new EchoRequest);
+    req->set_msg(msg);
+    return req;
+}
+
+static std::string recvEcho(ProtobufCodec& codec) {
+    MessageSPtr rsp;
+    auto err = codec.receive(rsp);
+    if (err->errcode != ProtobufCodec::kNoError || !rsp) {
+        LOG_ERROR << "receive error: " << err->errstr;
+        return "";
+    }
+    return std::static_pointer_cast<EchoResponse>(rsp)->msg();
+}
+
+// 按 codec 的格式手工编码：len | nameLen | name '\0' | payload
+static std::string encode(const EchoRequest& req) {
+    const std::string& name = req.GetTypeName();
+    std::string payload = req.SerializeAsString();
+    ByteArray ba;
+    ba.writeInt32(sizeof(int32_t) + name.size() + 1 + payload.size());
+    ba.writeInt32(name.size() + 1);
+    ba.write(name.c_str(), name.size() + 1);
+    ba.write(payload.data(), payload.size());
+    return ba.toString();
+}
+
+// 两个请求一次发出，服务端一次 read 可能读到两条消息
+static void testBackToBack(Address::SPtr addr, ConnectionPool::SPtr pool) {
+    Socket::SPtr conn = pool->borrow(addr);
+    assert(conn);
+    // 消息被丢掉时超时返回，不会一直等下去
+    conn->setRecvTimeout(2000);
+    {
+        ProtobufCodec codec(conn);
+        codec.send(makeRequest("one"));
+        codec.send(makeRequest("two"));
+        std::string first = recvEcho(codec);
+        std::string second = recvEcho(codec);
+        assert(first == "one" && second == "two");
+    }
+    pool->giveBack(addr, conn);
+
+    // 归还的连接被 RpcClient 的后续调用复用
+    RpcClient client(Worker::GetScheduler(), addr, pool);
+    int done = 0;
+    for (int i = 0; i < 2; i++) {
+        std::string msg = "call" + std::to_string(i);
+        client.Call<EchoResponse>(makeRequest(msg),
+                                  [&done, msg](std::shared_ptr<EchoResponse> rsp) {
+            assert(rsp->msg() == msg);
+            ++done;
+        });
+        while (done != i + 1) {
+            usleep(1000);
+        }
+    }
+    auto stats = pool->getStats();
+    LOG_INFO << "created=" << stats.created << " reused=" << stats.reused;
+    assert(stats.created == 1 && stats.reused == 2);
+    LOG_INFO << "back to back ok";
+}
+
+// 两条消息拆成三段发送，分段点落在长度字段中间和两条消息之间
+static void testSplit(Address::SPtr addr) {
+    Socket::SPtr sock = Socket::CreateTcp();
+    bool ok = sock->connect(*addr);
+    assert(ok);
+    sock->setOption(IPPROTO_TCP, TCP_NODELAY, 1);
+    sock->setRecvTimeout(2000);
+    std::string first = encode(*makeRequest("split-first"));
+    std::string data = first + encode(*makeRequest("split-second"));
+    size_t cuts[] = { 0, 2, first.size() + 3, data.size() };
+    for (size_t i = 0; i + 1 < sizeof(cuts) / sizeof(cuts[0]); i++) {
+        int n = sock->send(data.data() + cuts[i], cuts[i + 1] - cuts[i]);
+        assert(n == (int)(cuts[i + 1] - cuts[i]));
+        (void)n;
+        usleep(20 * 1000);
+    }
+    ProtobufCodec codec(sock);
+    std::string rsp1 = recvEcho(codec);
+    std::string rsp2 = recvEcho(codec);
+    assert(rsp1 == "split-first" && rsp2 == "split-second");
+    sock->close();
+    (void)ok;
+    LOG_INFO << "split ok";
+}
+
+int main(int argc, char** argv) {
+    Scheduler sh(2);
+    sh.startAsync();
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", 9011);
+    RpcServer server(&sh, addr);
+    server.registerRpcHandler<EchoRequest>(Echo);
+    server.start();
+
+    auto pool = std::make_shared<ConnectionPool>(&sh);
+    sh.addTimer(100, [&]() {
+        testBackToBack(addr, pool);
+        testSplit(addr);
+        pool->stop();
+        sh.stop();
+    });
+    sh.wait();
+    printf("rpc codec test passed\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "reyao/rpc/rpc_server.h"
+#include "reyao/rpc/codec.h"
+#include "reyao/log.h"
+
+#include "echo.pb.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace reyao;
+using namespace reyao::rpc;
+using namespace echo;
+
+// 同一台机器上对比 loopback tcp 和 unix domain socket 的 echo rpc 延迟
+// RpcServer 每个连接只处理一个请求，所以每次调用都包含 connect
+// ./rpc_uds_bench [count]
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+MessageSPtr Echo(std::shared_ptr<EchoRequest> req) {
+    std::shared_ptr<EchoResponse> rsp(new EchoResponse);
+    rsp->set_msg(req->msg());
+    return rsp;
+}
+
+static void bench(const std::string& name, Address::SPtr addr, int count) {
+    std::shared_ptr<EchoRequest> req(new EchoRequest);
+    req->set_msg("helloServer!");
+
+    std::vector<int64_t> cost;
+    cost.reserve(count);
+    for (int i = 0; i < count; i++) {
+        int64_t start = nowUs();
+        Socket::SPtr conn = Socket::CreateStream(*addr);
+        if (!conn->connect(*addr)) {
+            LOG_ERROR << name << " connect error=" << strerror(errno);
+            return;
+        }
+        ProtobufCodec codec(conn);
+        codec.send(req);
+        MessageSPtr rsp;
+        auto err = codec.receive(rsp);
+        if (err->errcode != ProtobufCodec::kNoError || !rsp) {
+            LOG_ERROR << name << " receive error: " << err->errstr;
+            return;
+        }
+        conn->close();
+        cost.push_back(nowUs() - start);
+    }
+
+    std::sort(cost.begin(), cost.end());
+    int64_t sum = 0;
+    for (auto c : cost) {
+        sum += c;
+    }
+    LOG_INFO << name << " " << addr->toString()
+             << " count=" << count
+             << " avg=" << sum / count << "us"
+             << " p50=" << cost[count / 2] << "us"
+             << " p99=" << cost[count * 99 / 100] << "us";
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 10000;
+
+    Scheduler sche(2);
+    sche.startAsync();
+
+    auto tcpAddr = IPv4Address::CreateAddress("127.0.0.1", 9001);
+    RpcServer tcpServer(&sche, tcpAddr);
+    tcpServer.registerRpcHandler<EchoRequest>(Echo);
+    tcpServer.start();
+
+    auto udsAddr = UnixAddress::CreateAddress("@reyao_rpc_uds_bench");
+    RpcServer udsServer(&sche, udsAddr);
+    udsServer.registerRpcHandler<EchoRequest>(Echo);
+    udsServer.start();
+
+    sche.addTimer(100, [&]() {
+        bench("tcp", tcpAddr, count);
+        bench("uds", udsAddr, count);
+        sche.stop();
+    });
+    sche.wait();
+    return 0;
+}
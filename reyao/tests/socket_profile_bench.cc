@@ -0,0 +1,118 @@
+#include "reyao/tcp_server.h"
+#include "reyao/socket.h"
+#include "reyao/log.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace reyao;
+
+// 短连接首个请求的延迟：默认参数 vs TCP_FASTOPEN + TCP_DEFER_ACCEPT + TCP_QUICKACK
+// 服务端 fast open 需要 net.ipv4.tcp_fastopen 包含 0x2
+// ./socket_profile_bench [count]
+
+static const char kRequest[] = "ping";
+static const char kResponse[] = "pong";
+
+static int64_t nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+class PingServer : public TcpServer {
+public:
+    PingServer(Scheduler* sche, Address::SPtr addr)
+        : TcpServer(sche, addr, "PingServer") {}
+
+    void handleClient(Socket::SPtr client) override {
+        char buf[64];
+        if (client->recv(buf, sizeof(buf)) > 0) {
+            client->send(kResponse, sizeof(kResponse));
+        }
+        client->close();
+    }
+};
+
+static void bench(const std::string& name, Address::SPtr addr,
+                  const SocketProfile& profile, int count) {
+    std::vector<int64_t> cost;
+    cost.reserve(count);
+    SocketProfile applied;
+    for (int i = 0; i < count; i++) {
+        int64_t start = nowUs();
+        Socket::SPtr conn = Socket::CreateTcp();
+        conn->newSock();
+        conn->applyProfile(profile, Socket::CONNECT_STAGE);
+        if (!conn->connect(*addr)) {
+            LOG_ERROR << name << " connect error=" << strerror(errno);
+            return;
+        }
+        char buf[64];
+        if (conn->send(kRequest, sizeof(kRequest)) <= 0 ||
+            conn->recv(buf, sizeof(buf)) <= 0) {
+            LOG_ERROR << name << " request error=" << strerror(errno);
+            return;
+        }
+        if (i == 0) {
+            applied = conn->getAppliedProfile();
+        }
+        conn->close();
+        cost.push_back(nowUs() - start);
+    }
+
+    std::sort(cost.begin(), cost.end());
+    int64_t sum = 0;
+    for (auto c : cost) {
+        sum += c;
+    }
+    LOG_INFO << name << " count=" << count
+             << " avg=" << sum / count << "us"
+             << " p50=" << cost[count / 2] << "us"
+             << " p99=" << cost[count * 99 / 100] << "us";
+    LOG_INFO << name << " client applied: " << applied.toString();
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int count = argc > 1 ? atoi(argv[1]) : 5000;
+
+    std::ifstream ifs("/proc/sys/net/ipv4/tcp_fastopen");
+    int tfo = 0;
+    ifs >> tfo;
+    if (!(tfo & 0x2)) {
+        LOG_INFO << "net.ipv4.tcp_fastopen=" << tfo
+                 << ", server side fast open is disabled";
+    }
+
+    Scheduler sche(2);
+    sche.startAsync();
+
+    auto defaultAddr = IPv4Address::CreateAddress("127.0.0.1", 9003);
+    PingServer defaultServer(&sche, defaultAddr);
+    defaultServer.start();
+
+    SocketProfile tuned;
+    tuned.deferAccept = 1;
+    tuned.fastOpenQueue = 1024;
+    tuned.fastOpenConnect = true;
+    tuned.quickAck = true;
+    auto tunedAddr = IPv4Address::CreateAddress("127.0.0.1", 9004);
+    PingServer tunedServer(&sche, tunedAddr);
+    tunedServer.setProfile(tuned);
+    tunedServer.start();
+
+    sche.addTimer(100, [&]() {
+        LOG_INFO << "tuned server applied: "
+                 << tunedServer.getAppliedProfile().toString();
+        bench("default", defaultAddr, SocketProfile(), count);
+        bench("tuned", tunedAddr, tuned, count);
+        sche.stop();
+    });
+    sche.wait();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "reyao/socket_stream.h"
+#include "reyao/scheduler.h"
+#include "reyao/log.h"
+
+#include <assert.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace reyao;
+
+// spliceTo：数据经由管道从一条连接转到另一条，发送队列里已有的数据先发出，
+// 只转发 len 字节，剩下的数据仍然可以读进 ByteArray；对端关闭后返回 0
+// ./socket_stream_test
+
+static const size_t kSpliceSize = 256 * 1024 + 17;
+static const size_t kTailSize = 100;
+
+static std::string makeData(size_t size) {
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = 'a' + i % 26;
+    }
+    return data;
+}
+
+static void test() {
+    auto addr = IPv4Address::CreateAddress("127.0.0.1", 8023);
+    Socket::SPtr listen = Socket::CreateTcp();
+    bool ok = listen->bind(*addr) && listen->listen();
+    assert(ok);
+
+    // src -> srcPeer 经 spliceTo 转到 dst -> dstPeer
+    Socket::SPtr src = Socket::CreateTcp();
+    ok = src->connect(*addr);
+    assert(ok);
+    Socket::SPtr srcPeer = listen->accept();
+    Socket::SPtr dst = Socket::CreateTcp();
+    ok = dst->connect(*addr);
+    assert(ok);
+    Socket::SPtr dstPeer = listen->accept();
+    assert(srcPeer && dstPeer);
+
+    const std::string data = makeData(kSpliceSize + kTailSize);
+    Worker* worker = Worker::GetWorker();
+    worker->addTask([src, &data]() {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int n = src->send(data.data() + sent, data.size() - sent);
+            assert(n > 0);
+            sent += n;
+        }
+    });
+    std::string received;
+    bool readerDone = false;
+    worker->addTask([dstPeer, &received, &readerDone]() {
+        char buf[16 * 1024];
+        int n;
+        while ((n = dstPeer->recv(buf, sizeof(buf))) > 0) {
+            received.append(buf, n);
+        }
+        readerDone = true;
+    });
+
+    int64_t moved = 0;
+    {
+        // 两个 stream 持有 splice 用的管道，在关闭调度器之前析构
+        SocketStream in(srcPeer);
+        SocketStream out(dst);
+        // 排在发送队列里的数据要先于转发的数据到达
+        out.setCork(true);
+        out.write("head", 4);
+        assert(out.getPendingSize() == 4);
+        moved = in.spliceTo(&out, kSpliceSize);
+        assert(moved == (int64_t)kSpliceSize);
+        assert(out.getPendingSize() == 0);
+        assert(in.getStats().bytesRead == kSpliceSize);
+        assert(out.getStats().bytesWritten == kSpliceSize + 4);
+
+        // 超出 len 的部分没有被转发，按普通方式读进 ByteArray
+        ByteArray ba;
+        size_t tail = 0;
+        while (tail < kTailSize) {
+            int n = in.read(&ba, kTailSize - tail);
+            assert(n > 0);
+            tail += n;
+        }
+        assert(ba.getReadSize() == kTailSize);
+        assert(ba.peekView() == StringPiece(data.data() + kSpliceSize, kTailSize));
+        std::string tailData = ba.toString();
+        assert(tailData == data.substr(kSpliceSize));
+        assert(ba.getReadSize() == 0);
+
+        // 源连接关闭后提前返回 0
+        src->close();
+        moved = in.spliceTo(&out);
+        assert(moved == 0);
+    }
+
+    dst->close();
+    // hook 过的 usleep 让出协程，worker 空闲时才会处理 epoll 事件
+    while (!readerDone) {
+        usleep(1000);
+    }
+    assert(received.size() == 4 + kSpliceSize);
+    assert(received.compare(0, 4, "head") == 0);
+    assert(received.compare(4, kSpliceSize, data, 0, kSpliceSize) == 0);
+
+    srcPeer->close();
+    dstPeer->close();
+    listen->close();
+    (void)ok;
+    (void)moved;
+    LOG_INFO << "splice " << kSpliceSize << " bytes ok";
+}
+
+int main(int argc, char** argv) {
+    Scheduler sh(1);
+    sh.startAsync();
+    sh.addTimer(100, [&]() {
+        test();
+        sh.stop();
+    });
+    sh.wait();
+    printf("socket stream test passed\n");
+    return 0;
+}
@@ -1,17 +1,189 @@
 #include "reyao/tcp_server.h"
+#include "reyao/socket_stream.h"
+#include "reyao/bytearray.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
 
 using namespace reyao;
 
+static bool exists(const char* path) {
+    return ::access(path, F_OK) == 0;
+}
 
-int main(int argc, char** argv) {
-    Scheduler sh;
+// 析构时只删除自己 bind 出来的 unix socket 文件，路径已被别人替换时保留
+static void testUnixPath() {
+    const char* owned = "/tmp/reyao_tcp_server_owned.sock";
+    const char* replaced = "/tmp/reyao_tcp_server_replaced.sock";
+    ::unlink(owned);
+    ::unlink(replaced);
+    {
+        Scheduler sh(1);
+        sh.startAsync();
+        TcpServer server1(&sh, UnixAddress::CreateAddress(owned));
+        TcpServer server2(&sh, UnixAddress::CreateAddress(replaced));
+        server1.start();
+        server2.start();
+        usleep(100 * 1000);
+        assert(exists(owned) && exists(replaced));
+        ::unlink(replaced);
+        int fd = ::open(replaced, O_WRONLY | O_CREAT, 0644);
+        assert(fd >= 0);
+        ::close(fd);
+        sh.stop();
+        sh.wait();
+    }
+    assert(!exists(owned));
+    assert(exists(replaced));
+    ::unlink(replaced);
+    LOG_INFO << "unix path ok";
+}
+
+
+// 回显直到对端关闭，连接一直占用着 server 的名额
+class HoldServer : public TcpServer {
+public:
+    HoldServer(Scheduler* sche, Address::SPtr addr)
+        : TcpServer(sche, addr, "hold_server") {}
+
+    void handleClient(Socket::SPtr client) override {
+        SocketStream ss(client);
+        ByteArray ba;
+        while (ss.read(&ba, 1024) > 0) {
+            ss.write(&ba, 1024);
+        }
+    }
+};
+
+// 以下在非 worker 线程上直接使用系统调用，不经过 hook
+static int connectTo(uint16_t port) {
+    IPv4Address addr("127.0.0.1", port);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int rt = ::connect(fd, addr.getAddr(), addr.getAddrLen());
+    assert(rt == 0);
+    (void)rt;
+    return fd;
+}
+
+static bool readable(int fd, int timeout) {
+    pollfd pfd = { fd, POLLIN, 0 };
+    return ::poll(&pfd, 1, timeout) == 1;
+}
+
+// 读一个字节，返回 recv 的结果
+static ssize_t recvByte(int fd, char* c) {
+    return readable(fd, 2000) ? ::recv(fd, c, 1, 0) : -1;
+}
+
+// 发一个字节并等回显，timeout 内没有回显返回 false
+static bool echo(int fd, int timeout = 2000) {
+    char c = 'x';
+    if (::send(fd, &c, 1, MSG_NOSIGNAL) != 1 || !readable(fd, timeout)) {
+        return false;
+    }
+    return ::recv(fd, &c, 1, 0) == 1 && c == 'x';
+}
+
+template <typename Cond>
+static bool waitFor(Cond cond, int timeout = 2000) {
+    for (int i = 0; i < timeout / 10; i++) {
+        if (cond()) {
+            return true;
+        }
+        usleep(10 * 1000);
+    }
+    return cond();
+}
+
+// 所有 worker 都满时新连接被 RST 关闭，不影响已有连接
+static void testRejectWhenWorkersFull() {
+    Scheduler sh(2);    // 一个 worker 线程，accept 在 main worker 上
     sh.startAsync();
-    auto addr = IPv4Address::CreateAddress("0.0.0.0", 30000);
-    LOG_INFO << addr->toString();
-    TcpServer tcp_server(&sh, addr);
+    HoldServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", 30001));
+    server.setMaxConnectionsPerWorker(1);
+    server.start();
+    usleep(100 * 1000);
+
+    int held = connectTo(30001);
+    bool ok = echo(held);
+    assert(ok);
+    int extra = connectTo(30001);
+    ok = waitFor([&]() { return server.getRejectedCount() == 1; });
+    assert(ok);
+    char c;
+    errno = 0;
+    ssize_t n = recvByte(extra, &c);
+    assert(n == 0 || (n < 0 && errno == ECONNRESET));
+    assert(server.getConnectionCount() == 1);
+    ok = echo(held);
+    assert(ok);
 
-    tcp_server.start();
+    // 名额释放后可以再接入
+    ::close(held);
+    ok = waitFor([&]() { return server.getConnectionCount() == 0; });
+    assert(ok);
+    int again = connectTo(30001);
+    ok = echo(again);
+    assert(ok);
+    assert(server.getRejectedCount() == 1);
+    ::close(again);
+    ::close(extra);
+    sh.stop();
     sh.wait();
+    (void)n;
+    (void)ok;
+    LOG_INFO << "reject ok";
+}
+
+// 连接总数达到上限时暂停 accept，超出的连接留在 backlog 里等待空出名额
+static void testPauseAtMaxConnections() {
+    Scheduler sh(2);
+    sh.startAsync();
+    HoldServer server(&sh, IPv4Address::CreateAddress("127.0.0.1", 30002));
+    server.setMaxConnections(2);
+    server.start();
+    usleep(100 * 1000);
+
+    int c1 = connectTo(30002);
+    int c2 = connectTo(30002);
+    bool ok = echo(c1) && echo(c2);
+    assert(ok);
+    int c3 = connectTo(30002);
+    ok = echo(c3, 200);
+    assert(!ok);
+    assert(server.getConnectionCount() == 2);
+    assert(server.getPeakConnectionCount() == 2);
+    assert(server.getPauseCount() >= 1);
+    assert(server.getRejectedCount() == 0);
 
+    // 空出名额后 c3 被 accept，之前发出的数据得到回显
+    ::close(c1);
+    char c = 0;
+    ssize_t n = recvByte(c3, &c);
+    assert(n == 1 && c == 'x');
+    ok = echo(c3);
+    assert(ok);
+    assert(server.getPeakConnectionCount() == 2);
+
+    ::close(c2);
+    ::close(c3);
+    ok = waitFor([&]() { return server.getConnectionCount() == 0; });
+    assert(ok);
+    sh.stop();
+    sh.wait();
+    (void)n;
+    (void)ok;
+    LOG_INFO << "pause ok";
+}
+
+int main(int argc, char** argv) {
+    testUnixPath();
+    testRejectWhenWorkersFull();
+    testPauseAtMaxConnections();
+    printf("tcp server test passed\n");
     return 0;
-}
\ No newline at end of file
+}
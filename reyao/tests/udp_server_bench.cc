@@ -0,0 +1,174 @@
+#include "reyao/udp_server.h"
+#include "reyao/thread.h"
+#include "reyao/log.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace reyao;
+
+// udp 收包 pps 测试：若干个发送线程用 sendmmsg 打小包，服务端统计每秒收包/回包数
+// ./udp_server_bench [server_threads] [client_threads] [seconds] [echo]
+
+static const int kPort = 9002;
+static const int kPacketSize = 32;
+static const int kSendBatch = 64;
+
+static std::atomic<bool> g_running(true);
+
+static void client() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::connect(fd, (sockaddr*)&addr, sizeof(addr));
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    char payload[kPacketSize] = "metrics.cpu.load:1|g";
+    iovec iovs[kSendBatch];
+    mmsghdr msgs[kSendBatch];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < kSendBatch; i++) {
+        iovs[i].iov_base = payload;
+        iovs[i].iov_len = sizeof(payload);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    char drain[kPacketSize * kSendBatch];
+    while (g_running) {
+        ::sendmmsg(fd, msgs, kSendBatch, 0);
+        // 丢弃 echo 模式下的回包，避免接收缓冲区满
+        while (::recv(fd, drain, sizeof(drain), MSG_DONTWAIT) > 0) {
+        }
+    }
+    ::close(fd);
+}
+
+// 没有调用 stop 就析构：析构函数停止并等待收包循环退出后才返回
+static void testDestroyWithoutStop(Scheduler* sche) {
+    std::unique_ptr<UdpServer> server(
+        new UdpServer(sche, IPv4Address::CreateAddress("127.0.0.1", kPort + 1)));
+    server->setHandler([](const StringPiece&, const Address&, UdpServer::ReplyBatch&) {
+    });
+    server->start();
+    usleep(100 * 1000);
+    assert(server->getLoopCount() > 0);
+    server.reset();
+    LOG_INFO << "destroy without stop ok";
+}
+
+// 回包攒满一批时在 reply 中提前发出，这部分也要计入统计
+static void testReplyStats(Scheduler* sche) {
+    const int kCount = 10;
+    const int kReplies = 3;
+    UdpServer server(sche, IPv4Address::CreateAddress("127.0.0.1", kPort + 2));
+    server.setBatchSize(2);
+    server.setHandler([](const StringPiece& data, const Address& from,
+                         UdpServer::ReplyBatch& replies) {
+        for (int i = 0; i < kReplies; i++) {
+            replies.reply(from, data);
+        }
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    IPv4Address addr("127.0.0.1", kPort + 2);
+    int rt = ::connect(fd, addr.getAddr(), addr.getAddrLen());
+    assert(rt == 0);
+    timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    char buf[kPacketSize];
+    int received = 0;
+    // 一次只发一个，每个数据报都会触发一次提前发送
+    for (int i = 0; i < kCount; i++) {
+        ::send(fd, "ping", 4, 0);
+        for (int j = 0; j < kReplies && ::recv(fd, buf, sizeof(buf), 0) == 4; j++) {
+            ++received;
+        }
+    }
+    ::close(fd);
+    (void)rt;
+
+    // 客户端可能在服务端计数之前就收到了回包
+    UdpServer::Stats stats = server.getStats();
+    for (int i = 0; i < 1000 && stats.packetsOut < (uint64_t)kCount * kReplies; i++) {
+        usleep(1000);
+        stats = server.getStats();
+    }
+    LOG_INFO << "received=" << received << " in=" << stats.packetsIn
+             << " out=" << stats.packetsOut << " sendCalls=" << stats.sendCalls;
+    assert(received == kCount * kReplies);
+    assert(stats.packetsIn == (uint64_t)kCount);
+    assert(stats.packetsOut == (uint64_t)kCount * kReplies);
+    assert(stats.sendCalls >= (uint64_t)kCount * 2);
+    server.stop();
+}
+
+int main(int argc, char** argv) {
+    g_logger->setLevel(LogLevel::INFO);
+    int serverThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int clientThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    bool echo = argc > 4 && atoi(argv[4]) != 0;
+
+    Scheduler sche(serverThreads + 1);
+    sche.startAsync();
+    testDestroyWithoutStop(&sche);
+    testReplyStats(&sche);
+
+    UdpServer server(&sche, IPv4Address::CreateAddress("127.0.0.1", kPort));
+    server.setHandler([echo](const StringPiece& data,
+                             const Address& from,
+                             UdpServer::ReplyBatch& replies) {
+        if (echo) {
+            replies.reply(from, data);
+        }
+    });
+    server.start();
+    usleep(100 * 1000);
+
+    std::vector<Thread::SPtr> clients;
+    for (int i = 0; i < clientThreads; i++) {
+        clients.push_back(std::make_shared<Thread>(client, "udp_client_" + std::to_string(i)));
+        clients.back()->start();
+    }
+
+    UdpServer::Stats last = server.getStats();
+    for (int i = 0; i < seconds; i++) {
+        sleep(1);
+        UdpServer::Stats now = server.getStats();
+        uint64_t calls = now.recvCalls - last.recvCalls;
+        LOG_INFO << "in=" << now.packetsIn - last.packetsIn << "pps"
+                 << " out=" << now.packetsOut - last.packetsOut << "pps"
+                 << " avg_batch=" << (calls ? (now.packetsIn - last.packetsIn) / calls : 0);
+        last = now;
+    }
+
+    g_running = false;
+    for (auto& c : clients) {
+        c->join();
+    }
+    // 没有数据报到达时收包循环也能被 stop 唤醒并退出
+    sleep(1);
+    server.stop();
+    for (int i = 0; i < 1000 && server.getLoopCount() > 0; i++) {
+        usleep(1000);
+    }
+    assert(server.getLoopCount() == 0);
+    LOG_INFO << "all loops stopped";
+    sche.stop();
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <time.h>
 
 #include <functional>
+#include <string>
 #include <memory>
 
 namespace reyao {
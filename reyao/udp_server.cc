@@ -0,0 +1,241 @@
+#include "reyao/udp_server.h"
+#include "reyao/hook.h"
+
+#include <string.h>
+#include <assert.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace reyao {
+
+static const size_t kDefaultBatchSize = 64;
+static const size_t kDefaultMaxDatagramSize = 2048;
+
+UdpServer::ReplyBatch::ReplyBatch(UdpServer* server, Socket::SPtr sock, size_t maxCount)
+    : server_(server),
+      sock_(sock),
+      maxCount_(maxCount) {
+    lens_.reserve(maxCount);
+    addrs_.reserve(maxCount);
+    addrLens_.reserve(maxCount);
+    iovs_.reserve(maxCount);
+    msgs_.reserve(maxCount);
+}
+
+void UdpServer::ReplyBatch::reply(const Address& to, const void* buf, size_t len) {
+    if (lens_.size() >= maxCount_) {
+        flush();
+    }
+    data_.append(static_cast<const char*>(buf), len);
+    lens_.push_back(len);
+    sockaddr_storage addr;
+    socklen_t addrLen = std::min((size_t)to.getAddrLen(), sizeof(addr));
+    memcpy(&addr, to.getAddr(), addrLen);
+    addrs_.push_back(addr);
+    addrLens_.push_back(addrLen);
+}
+
+int UdpServer::ReplyBatch::flush() {
+    size_t count = lens_.size();
+    if (count == 0) {
+        return 0;
+    }
+    // data_ 在 reply 时可能扩容，所以在 flush 时才生成 iovec
+    iovs_.resize(count);
+    msgs_.resize(count);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        iovs_[i].iov_base = &data_[offset];
+        iovs_[i].iov_len = lens_[i];
+        offset += lens_[i];
+        msghdr& hdr = msgs_[i].msg_hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &addrs_[i];
+        hdr.msg_namelen = addrLens_[i];
+        hdr.msg_iov = &iovs_[i];
+        hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int n = sock_->sendMsgs(&msgs_[sent], count - sent);
+        ++server_->sendCalls_;
+        if (n <= 0) {
+            LOG_ERROR << "sendmmsg error=" << strerror(errno)
+                      << " drop " << count - sent << " replies";
+            break;
+        }
+        sent += n;
+    }
+    server_->packetsOut_ += sent;
+
+    data_.clear();
+    lens_.clear();
+    addrs_.clear();
+    addrLens_.clear();
+    return sent == 0 && count != 0 ? -1 : sent;
+}
+
+UdpServer::UdpServer(Scheduler* sche,
+                     Address::SPtr addr,
+                     const std::string& name)
+    : sche_(sche),
+      addr_(addr),
+      name_(name),
+      running_(false),
+      batchSize_(kDefaultBatchSize),
+      maxDatagramSize_(kDefaultMaxDatagramSize),
+      packetsIn_(0),
+      packetsOut_(0),
+      recvCalls_(0),
+      sendCalls_(0),
+      truncated_(0) {
+}
+
+UdpServer::~UdpServer() {
+    // 收包循环绑定了 this，全部退出之后才能释放
+    stop();
+    while (loops_ > 0) {
+        usleep(1000);
+    }
+}
+
+void UdpServer::stop() {
+    running_ = false;
+    MutexGuard lock(mutex_);
+    for (auto& it : socks_) {
+        Socket::SPtr sock = it.second;
+        // 读事件注册在 socket 所在 worker 的 epoller 上，只能在那个 worker 上取消。
+        // 循环在检查 running_ 和挂起之间不会切换协程，取消时它要么已挂起，要么会看到 running_
+        it.first->addTask([sock]() {
+            if (sock->isValid()) {
+                sock->cancelRead();
+            }
+        });
+    }
+}
+
+void UdpServer::start() {
+    if (running_) {
+        return;
+    }
+    assert(handler_);
+    running_ = true;
+    auto& workers = sche_->getWorkers();
+    // unix 数据报不支持 SO_REUSEPORT 分流，只在一个 worker 上收包
+    size_t count = addr_->getFamily() == AF_UNIX ? 1 : workers.size();
+    loops_ += count;
+    for (size_t i = 0; i < count; i++) {
+        workers[i]->addTask(std::bind(&UdpServer::loop, this));
+    }
+}
+
+UdpServer::Stats UdpServer::getStats() const {
+    Stats stats;
+    stats.packetsIn = packetsIn_;
+    stats.packetsOut = packetsOut_;
+    stats.recvCalls = recvCalls_;
+    stats.sendCalls = sendCalls_;
+    stats.truncated = truncated_;
+    return stats;
+}
+
+void UdpServer::loop() {
+    // socket 需要在 worker 线程上创建，这样才会被 FdManager 管理
+    Socket::SPtr sock = addr_->getFamily() == AF_UNIX ? Socket::CreateUnixDgram()
+                                                      : Socket::CreateUdp();
+    sock->newSock();
+    if (addr_->getFamily() != AF_UNIX) {
+        sock->setReusePort();
+    }
+    if (!sock->bind(*addr_)) {
+        LOG_ERROR << name_ << " bind error addr=" << addr_->toString()
+                  << " error=" << strerror(errno);
+        sock->close();
+        --loops_;
+        return;
+    }
+    {
+        MutexGuard lock(mutex_);
+        socks_.push_back(std::make_pair(Worker::GetWorker(), sock));
+    }
+
+    const size_t batch = batchSize_;
+    const size_t maxSize = maxDatagramSize_;
+    std::vector<char> buf(batch * maxSize);
+    std::vector<Address::SPtr> peers(batch);
+    std::vector<socklen_t> peerLens(batch);
+    std::vector<iovec> iovs(batch);
+    std::vector<mmsghdr> msgs(batch);
+    for (size_t i = 0; i < batch; i++) {
+        peers[i] = Address::Create(addr_->getFamily());
+        peerLens[i] = peers[i]->getAddrLen();
+        iovs[i].iov_base = &buf[i * maxSize];
+        iovs[i].iov_len = maxSize;
+        msghdr& hdr = msgs[i].msg_hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = peers[i]->getAddr();
+        hdr.msg_iov = &iovs[i];
+        hdr.msg_iovlen = 1;
+    }
+    ReplyBatch replies(this, sock, batch);
+
+    while (running_) {
+        for (size_t i = 0; i < batch; i++) {
+            msgs[i].msg_hdr.msg_namelen = peerLens[i];
+        }
+        // 不经过 hook 的阻塞等待：读事件被 stop 取消后回到循环开头检查 running_
+        int n = recvmmsg_origin(sock->getSockfd(), &msgs[0], batch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                if (!Worker::AddEvent(sock->getSockfd(), EPOLLIN)) {
+                    break;
+                }
+                Coroutine::YieldToSuspend();
+                continue;
+            }
+            LOG_ERROR << name_ << " recvmmsg error=" << strerror(errno);
+            break;
+        }
+        ++recvCalls_;
+
+        uint64_t truncated = 0;
+        for (int i = 0; i < n; i++) {
+            const msghdr& hdr = msgs[i].msg_hdr;
+            if (hdr.msg_flags & MSG_TRUNC) {
+                ++truncated;
+                continue;
+            }
+            peers[i]->setAddrLen(hdr.msg_namelen);
+            handler_(StringPiece((const char*)iovs[i].iov_base, msgs[i].msg_len),
+                     *peers[i], replies);
+        }
+        packetsIn_ += n;
+        if (truncated) {
+            truncated_ += truncated;
+        }
+
+        replies.flush();
+    }
+    removeLoop(sock);
+    sock->close();
+    --loops_;
+}
+
+void UdpServer::removeLoop(const Socket::SPtr& sock) {
+    MutexGuard lock(mutex_);
+    for (size_t i = 0; i < socks_.size(); i++) {
+        if (socks_[i].second == sock) {
+            socks_[i] = socks_.back();
+            socks_.pop_back();
+            break;
+        }
+    }
+}
+
+} // namespace reyao
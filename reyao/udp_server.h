@@ -0,0 +1,114 @@
+#pragma once
+
+#include "reyao/socket.h"
+#include "reyao/log.h"
+#include "reyao/nocopyable.h"
+#include "reyao/address.h"
+#include "reyao/scheduler.h"
+#include "reyao/stringpiece.h"
+#include "reyao/mutex.h"
+
+#include <sys/socket.h>
+
+#include <memory>
+#include <functional>
+#include <vector>
+#include <string>
+#include <utility>
+#include <atomic>
+
+namespace reyao {
+
+// 每个 worker 一个 SO_REUSEPORT 的 udp socket，由内核按四元组把数据报分散到各个 socket
+// 每轮循环用 recvmmsg 批量收包，handler 产生的回包在本轮结束时用 sendmmsg 一次发出
+class UdpServer : public NoCopyable {
+public:
+    typedef std::shared_ptr<UdpServer> SPtr;
+
+    // 一轮循环内累积的回包，数据会拷贝到内部缓冲区，handler 返回后原数据即可释放。
+    // 攒满 maxCount 个时在 reply 中提前发出，每次发送都计入 server 的统计
+    class ReplyBatch : public NoCopyable {
+    public:
+        ReplyBatch(UdpServer* server, Socket::SPtr sock, size_t maxCount);
+
+        void reply(const Address& to, const void* buf, size_t len);
+        void reply(const Address& to, const StringPiece& data) {
+            reply(to, data.data(), data.size());
+        }
+        // 用 sendmmsg 发出所有回包，返回发出的个数，出错返回 -1
+        int flush();
+        size_t size() const { return lens_.size(); }
+
+    private:
+        UdpServer* server_;
+        Socket::SPtr sock_;
+        size_t maxCount_;
+        std::string data_;
+        std::vector<size_t> lens_;
+        std::vector<sockaddr_storage> addrs_;
+        std::vector<socklen_t> addrLens_;
+        std::vector<iovec> iovs_;
+        std::vector<mmsghdr> msgs_;
+    };
+
+    // data 指向本轮的接收缓冲区，只在 handler 调用期间有效
+    typedef std::function<void(const StringPiece& data,
+                               const Address& from,
+                               ReplyBatch& replies)> Handler;
+
+    struct Stats {
+        uint64_t packetsIn = 0;
+        uint64_t packetsOut = 0;
+        uint64_t recvCalls = 0;
+        uint64_t sendCalls = 0;
+        uint64_t truncated = 0;
+    };
+
+    UdpServer(Scheduler* sche,
+              Address::SPtr addr,
+              const std::string& name = "UdpServer");
+    // 会调用 stop 并等待所有收包循环退出，析构时 Scheduler 必须还在运行
+    ~UdpServer();
+
+    // 需要在 Scheduler::startAsync 之后调用，每个 worker 上启动一个收包循环
+    void start();
+    // 任意线程调用，唤醒阻塞在收包上的循环，循环随后关闭 socket 退出
+    void stop();
+
+    void setHandler(const Handler& handler) { handler_ = handler; }
+    // 每次 recvmmsg 最多收取的数据报个数
+    void setBatchSize(size_t size) { batchSize_ = size; }
+    // 单个数据报的最大长度，超过的数据报会被截断并丢弃
+    void setMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+
+    Scheduler* getScheduler() const { return sche_; }
+    std::string getName() const { return name_; }
+    bool isStop() const { return !running_; }
+    // 还没有退出的收包循环个数
+    size_t getLoopCount() const { return loops_; }
+    Stats getStats() const;
+
+private:
+    void loop();
+    void removeLoop(const Socket::SPtr& sock);
+
+    Scheduler* sche_;
+    Address::SPtr addr_;
+    std::string name_;
+    std::atomic<bool> running_;
+    Handler handler_;
+    size_t batchSize_;
+    size_t maxDatagramSize_;
+    // 正在收包的 socket 和所在的 worker，stop 时到对应的 worker 上取消读事件
+    Mutex mutex_;
+    std::vector<std::pair<Worker*, Socket::SPtr>> socks_;
+    std::atomic<size_t> loops_{0};
+
+    std::atomic<uint64_t> packetsIn_;
+    std::atomic<uint64_t> packetsOut_;
+    std::atomic<uint64_t> recvCalls_;
+    std::atomic<uint64_t> sendCalls_;
+    std::atomic<uint64_t> truncated_;
+};
+
+} // namespace reyao
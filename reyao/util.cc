@@ -2,6 +2,8 @@
 #include "reyao/log.h"
 
 #include <sys/time.h>
+#include <string.h>
+#include <strings.h>
 #include <fstream>
 #include <sstream>
 
@@ -13,7 +15,7 @@ int64_t GetCurrentMs() {
     return tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
-int HexToDec(std::string hex) {
+int HexToDec(const StringPiece& hex) {
     size_t res = 0;
     for (size_t i = 0; i < hex.size(); i++) {
         char c = hex[i];
@@ -30,18 +32,171 @@ int HexToDec(std::string hex) {
 }
 
 std::string ReadFile(const std::string& pathname) {
-    std::ifstream in(pathname, std::ios::in);
+    std::ifstream in(pathname, std::ios::in | std::ios::binary);
     if (!in.is_open()) {
         LOG_ERROR << "open " << pathname << "error: " << strerror(errno);
         return "";
     }
     std::stringstream buf;
-    std::string line;
-    while (getline(in, line)) {
-        buf << line;
-    }
+    buf << in.rdbuf();
     in.close();
     return buf.str();
 }
 
+static inline uint32_t Rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void Sha1Block(uint32_t* h, const uint8_t* p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+               (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = Rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = Rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = Rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void Sha1(const void* data, size_t len, uint8_t* digest) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    size_t left = len;
+    for (; left >= 64; left -= 64, p += 64) {
+        Sha1Block(h, p);
+    }
+    // 补 0x80、0 和 64 位的比特长度，最多多出一块
+    uint8_t tail[128] = {0};
+    memcpy(tail, p, left);
+    tail[left] = 0x80;
+    size_t tailLen = left < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailLen - 1 - i] = bits >> (i * 8);
+    }
+    for (size_t off = 0; off < tailLen; off += 64) {
+        Sha1Block(h, tail + off);
+    }
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = h[i] >> 24;
+        digest[i * 4 + 1] = h[i] >> 16;
+        digest[i * 4 + 2] = h[i] >> 8;
+        digest[i * 4 + 3] = h[i];
+    }
+}
+
+std::string Base64Encode(const void* data, size_t len) {
+    static const char kTable[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (uint32_t)p[i] << 16 | (uint32_t)p[i + 1] << 8 | p[i + 2];
+        out.push_back(kTable[v >> 18]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.push_back(kTable[(v >> 6) & 0x3F]);
+        out.push_back(kTable[v & 0x3F]);
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)p[i] << 16;
+        if (i + 1 < len) {
+            v |= (uint32_t)p[i + 1] << 8;
+        }
+        out.push_back(kTable[v >> 18]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.push_back(i + 1 < len ? kTable[(v >> 6) & 0x3F] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+bool Base64Decode(const StringPiece& str, std::string* out) {
+    size_t len = str.size();
+    while (len > 0 && str[len - 1] == '=') {
+        len--;
+    }
+    out->clear();
+    out->reserve(len * 3 / 4);
+    uint32_t v = 0;
+    int bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = str[i];
+        int d;
+        if (c >= 'A' && c <= 'Z') {
+            d = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            d = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            d = c - '0' + 52;
+        } else if (c == '+' || c == '-') {
+            d = 62;
+        } else if (c == '/' || c == '_') {
+            d = 63;
+        } else {
+            return false;
+        }
+        v = v << 6 | d;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out->push_back((char)(v >> bits));
+        }
+    }
+    // 剩下的不足一个字节的位只能是 2 或 4 位
+    return bits != 6;
+}
+
+bool HasToken(const StringPiece& list, const char* token) {
+    size_t tokenLen = strlen(token);
+    const char* p = list.data();
+    const char* end = p + list.size();
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == ',')) {
+            p++;
+        }
+        const char* begin = p;
+        while (p < end && *p != ',') {
+            p++;
+        }
+        const char* last = p;
+        while (last > begin && last[-1] == ' ') {
+            last--;
+        }
+        if ((size_t)(last - begin) == tokenLen && strncasecmp(begin, token, tokenLen) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 } // namespace reyao
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "reyao/stringpiece.h"
+
 #include <sys/types.h>
+#include <stdint.h>
 
 #include <string>
 
@@ -8,8 +11,18 @@ namespace reyao {
 
 int64_t GetCurrentMs();
 
-int HexToDec(std::string hex);
+int HexToDec(const StringPiece& hex);
 
 std::string ReadFile(const std::string& pathname);
 
+// SHA-1 摘要，digest 为 20 字节
+void Sha1(const void* data, size_t len, uint8_t* digest);
+
+std::string Base64Encode(const void* data, size_t len);
+// 同时接受标准和 URL 安全的字母表，结尾的 '=' 可以省略，有非法字符时返回 false
+bool Base64Decode(const StringPiece& str, std::string* out);
+
+// Connection 等头部是逗号分隔的 token 列表，不区分大小写
+bool HasToken(const StringPiece& list, const char* token);
+
 } // namespace reyao
\ No newline at end of file
@@ -52,6 +52,11 @@ public:
     void notify();
 
     bool isIdle() { return idle_; }
+    // 等待调度的任务数，用于判断 worker 的排队深度
+    size_t getTaskCount() {
+        MutexGuard lock(mutex_);
+        return tasks_.size();
+    }
 
 public:
     struct Task {